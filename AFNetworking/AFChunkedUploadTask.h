@@ -0,0 +1,253 @@
+// AFChunkedUploadTask.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+@class AFURLSessionManager, AFHTTPRetryPolicy;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `AFChunkedUploadPart` is one contiguous range of the file uploaded by an `AFChunkedUploadTask`.
+ */
+@interface AFChunkedUploadPart : NSObject
+
+/**
+ The position of the part in the file, starting at `0`.
+ */
+@property (readonly, nonatomic, assign) NSUInteger index;
+
+/**
+ The offset, in bytes, of the part in the file.
+ */
+@property (readonly, nonatomic, assign) unsigned long long offset;
+
+/**
+ The length, in bytes, of the part.
+ */
+@property (readonly, nonatomic, assign) unsigned long long length;
+
+/**
+ The value identifying the part on the server once it is uploaded, such as its entity tag or URL, or `nil` if the part is not uploaded yet.
+ */
+@property (readonly, nonatomic, copy, nullable) NSString *tag;
+
+@end
+
+#pragma mark -
+
+/**
+ The `AFChunkedUploadAdapter` protocol is adopted by objects that describe how an `AFChunkedUploadTask` talks to a server: how an upload is created, how each part is sent, and how the parts are assembled once they are all uploaded.
+
+ Parts are sent concurrently and in any order, and a part may be sent more than once when it is retried.
+ */
+@protocol AFChunkedUploadAdapter <NSObject>
+
+/**
+ Returns the request uploading the specified part. The data of the part is sent as the body of the request.
+
+ @param part The part.
+ @param uploadIdentifier The identifier of the upload, or `nil` if the adapter does not create uploads.
+ */
+- (NSURLRequest *)requestForUploadingPart:(AFChunkedUploadPart *)part
+                             uploadIdentifier:(nullable NSString *)uploadIdentifier;
+
+/**
+ Returns the tag identifying the specified part on the server, read from the response to its upload request.
+
+ @param part The part.
+ @param response The response to the upload request of the part.
+ @param error The error that occurred while reading the tag.
+
+ @return The tag, or `nil` if the response is not valid.
+ */
+- (nullable NSString *)tagForUploadedPart:(AFChunkedUploadPart *)part
+                                 response:(NSHTTPURLResponse *)response
+                                    error:(NSError * _Nullable __autoreleasing *)error;
+
+/**
+ Returns the request assembling the uploaded parts once every part has a tag.
+
+ @param parts The parts, in the order of the file.
+ @param uploadIdentifier The identifier of the upload, or `nil` if the adapter does not create uploads.
+ */
+- (NSURLRequest *)requestForCompletingUploadWithParts:(NSArray <AFChunkedUploadPart *> *)parts
+                                       uploadIdentifier:(nullable NSString *)uploadIdentifier;
+
+@optional
+
+/**
+ Returns the request creating an upload on the server before any part is sent. If not implemented, parts are sent right away, and no upload identifier is used.
+
+ @param length The length, in bytes, of the file.
+ */
+- (NSURLRequest *)requestForCreatingUploadOfLength:(unsigned long long)length;
+
+/**
+ Returns the identifier of the upload, read from the response to the request creating it. Must be implemented if `-requestForCreatingUploadOfLength:` is.
+
+ @param response The response to the request creating the upload.
+ @param data The body of the response.
+ @param error The error that occurred while reading the identifier.
+
+ @return The identifier, or `nil` if the response is not valid.
+ */
+- (nullable NSString *)uploadIdentifierFromResponse:(NSHTTPURLResponse *)response
+                                               data:(nullable NSData *)data
+                                              error:(NSError * _Nullable __autoreleasing *)error;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFS3MultipartUploadAdapter` uploads parts with the multipart upload API of Amazon S3 and compatible services. The upload is created with a `POST ?uploads` request, each part is sent with a `PUT ?partNumber=&uploadId=` request and tagged with the `ETag` of its response, and the parts are assembled with a `POST ?uploadId=` request listing their tags.
+
+ Every part but the last must be at least 5 MB long. Requests are not signed; signing can be performed by a subclass overriding the request methods, or by the protocol classes of the session.
+ */
+@interface AFS3MultipartUploadAdapter : NSObject <AFChunkedUploadAdapter>
+
+/**
+ The request for the uploaded object, whose URL and header fields are used by every request of the upload.
+ */
+@property (readonly, nonatomic, copy) NSURLRequest *request;
+
+/**
+ Initializes an adapter uploading to the object of the specified request.
+
+ @param request The request for the uploaded object.
+
+ @return The newly-initialized adapter.
+ */
+- (instancetype)initWithRequest:(NSURLRequest *)request NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFTusUploadAdapter` uploads parts with the tus resumable upload protocol and its concatenation extension. Each part is created as a partial upload whose body is sent along with the creation request, and tagged with its URL. The parts are then concatenated by creating a final upload listing their URLs.
+ */
+@interface AFTusUploadAdapter : NSObject <AFChunkedUploadAdapter>
+
+/**
+ The request for the upload creation endpoint, whose URL and header fields are used by every request of the upload.
+ */
+@property (readonly, nonatomic, copy) NSURLRequest *request;
+
+/**
+ Initializes an adapter uploading to the creation endpoint of the specified request.
+
+ @param request The request for the upload creation endpoint.
+
+ @return The newly-initialized adapter.
+ */
+- (instancetype)initWithRequest:(NSURLRequest *)request NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFChunkedUploadTask` uploads a large file in parts sent concurrently, so that a failure only requires sending the failed part again, and throughput is not limited by a single connection.
+
+ The file is memory-mapped and sliced into parts of `partLength` bytes, without being copied. Up to `maximumConcurrentPartCount` parts are uploaded at once through the adapter. A failed part is retried on its own according to `retryPolicy`; once every part is uploaded, the adapter assembles them.
+
+ When `journalURL` is set, the identifier of the upload and the tags of the uploaded parts are recorded in a small journal as parts complete. A new task for the same file and journal then only uploads the missing parts, provided the file has not been modified.
+ */
+@interface AFChunkedUploadTask : NSObject
+
+/**
+ The manager used to upload the parts.
+ */
+@property (readonly, nonatomic, strong) AFURLSessionManager *sessionManager;
+
+/**
+ The uploaded file.
+ */
+@property (readonly, nonatomic, copy) NSURL *fileURL;
+
+/**
+ The adapter describing how the parts are uploaded.
+ */
+@property (readonly, nonatomic, strong) id <AFChunkedUploadAdapter> adapter;
+
+/**
+ The length, in bytes, of every part but the last. `8` MB by default.
+ */
+@property (nonatomic, assign) unsigned long long partLength;
+
+/**
+ The maximum number of parts uploaded at once. `4` by default. The number of concurrent connections is also limited by the `HTTPMaximumConnectionsPerHost` of the session configuration.
+ */
+@property (nonatomic, assign) NSUInteger maximumConcurrentPartCount;
+
+/**
+ The policy deciding whether a failed part is uploaded again, and after which delay. By default, the default policy without a deadline, which also retries `POST` and `PATCH` requests since parts can always be sent again. If `nil`, failed parts are not retried.
+ */
+@property (nonatomic, strong, nullable) AFHTTPRetryPolicy *retryPolicy;
+
+/**
+ The file URL of the journal recording the uploaded parts, or `nil` if the upload cannot be resumed. `nil` by default.
+ */
+@property (nonatomic, copy, nullable) NSURL *journalURL;
+
+/**
+ The progress of the whole upload, in bytes, including the parts uploaded by an earlier task. It never decreases, even while a failed part is sent again.
+ */
+@property (readonly, nonatomic, strong) NSProgress *progress;
+
+/**
+ Initializes a task uploading the specified file through the specified adapter.
+
+ @param sessionManager The manager used to upload the parts.
+ @param fileURL The file URL of the uploaded file.
+ @param adapter The adapter describing how the parts are uploaded.
+
+ @return The newly-initialized task.
+ */
+- (instancetype)initWithSessionManager:(AFURLSessionManager *)sessionManager
+                               fileURL:(NSURL *)fileURL
+                               adapter:(id <AFChunkedUploadAdapter>)adapter NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Starts the upload. Has no effect if the task was already started. The task is kept alive until the upload finishes, and does not need to be retained by the caller.
+
+ @param completionHandler A block object to be executed on the completion queue of the manager when the upload finishes. This block has no return value and takes three arguments: the response to the request assembling the parts, its body, and the error that occurred, if any.
+ */
+- (void)resumeWithCompletionHandler:(nullable void (^)(NSURLResponse * _Nullable response, NSData * _Nullable responseData, NSError * _Nullable error))completionHandler;
+
+/**
+ Cancels the upload. The parts already uploaded stay recorded in the journal, so that a new task can resume the upload. The completion handler is called with an `NSURLErrorCancelled` error.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,713 @@
+// AFChunkedUploadTask.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "AFChunkedUploadTask.h"
+#import "AFHTTPRetryPolicy.h"
+#import "AFURLRequestSerialization.h"
+#import "AFURLSessionManager.h"
+
+#import <pthread.h>
+
+static NSString * const AFChunkedUploadJournalFilePathKey = @"filePath";
+static NSString * const AFChunkedUploadJournalFileSizeKey = @"fileSize";
+static NSString * const AFChunkedUploadJournalModificationDateKey = @"modificationDate";
+static NSString * const AFChunkedUploadJournalPartLengthKey = @"partLength";
+static NSString * const AFChunkedUploadJournalUploadIdentifierKey = @"uploadIdentifier";
+static NSString * const AFChunkedUploadJournalTagsKey = @"tags";
+
+static NSError * AFChunkedUploadBadServerResponseError(NSURLResponse *response) {
+    NSDictionary *userInfo = response.URL ? @{NSURLErrorFailingURLErrorKey: response.URL} : nil;
+    return [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:userInfo];
+}
+
+static NSString * AFChunkedUploadXMLEscapedString(NSString *string) {
+    string = [string stringByReplacingOccurrencesOfString:@"&" withString:@"&amp;"];
+    string = [string stringByReplacingOccurrencesOfString:@"<" withString:@"&lt;"];
+    return [string stringByReplacingOccurrencesOfString:@">" withString:@"&gt;"];
+}
+
+@interface AFChunkedUploadPart ()
+@property (readwrite, nonatomic, assign) NSUInteger index;
+@property (readwrite, nonatomic, assign) unsigned long long offset;
+@property (readwrite, nonatomic, assign) unsigned long long length;
+@property (readwrite, nonatomic, copy) NSString *tag;
+@property (readwrite, nonatomic, assign) int64_t sentLength;
+@property (readwrite, nonatomic, assign) NSUInteger attemptCount;
+@property (readwrite, nonatomic, assign) CFAbsoluteTime firstAttemptTime;
+@property (readwrite, nonatomic, strong) NSURLSessionTask *task;
+@end
+
+@implementation AFChunkedUploadPart
+@end
+
+#pragma mark -
+
+@interface AFS3MultipartUploadAdapter ()
+@property (readwrite, nonatomic, copy) NSURLRequest *request;
+@end
+
+@implementation AFS3MultipartUploadAdapter
+
+- (instancetype)initWithRequest:(NSURLRequest *)request {
+    NSParameterAssert(request.URL);
+
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    self.request = request;
+
+    return self;
+}
+
+- (NSMutableURLRequest *)requestWithHTTPMethod:(NSString *)method
+                                         query:(NSString *)query
+{
+    NSURLComponents *components = [NSURLComponents componentsWithURL:self.request.URL resolvingAgainstBaseURL:NO];
+    components.percentEncodedQuery = query;
+
+    NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+    mutableRequest.URL = components.URL;
+    mutableRequest.HTTPMethod = method;
+    mutableRequest.HTTPBody = nil;
+
+    return mutableRequest;
+}
+
+- (NSURLRequest *)requestForCreatingUploadOfLength:(__unused unsigned long long)length {
+    return [self requestWithHTTPMethod:@"POST" query:@"uploads"];
+}
+
+- (NSString *)uploadIdentifierFromResponse:(NSHTTPURLResponse *)response
+                                      data:(NSData *)data
+                                     error:(NSError * __autoreleasing *)error
+{
+    NSString *body = data ? [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding] : nil;
+    NSRange startRange = body ? [body rangeOfString:@"<UploadId>"] : NSMakeRange(NSNotFound, 0);
+    NSRange endRange = startRange.location != NSNotFound ? [body rangeOfString:@"</UploadId>" options:0 range:NSMakeRange(NSMaxRange(startRange), body.length - NSMaxRange(startRange))] : NSMakeRange(NSNotFound, 0);
+    if (endRange.location == NSNotFound) {
+        if (error) {
+            *error = AFChunkedUploadBadServerResponseError(response);
+        }
+
+        return nil;
+    }
+
+    return [body substringWithRange:NSMakeRange(NSMaxRange(startRange), endRange.location - NSMaxRange(startRange))];
+}
+
+- (NSURLRequest *)requestForUploadingPart:(AFChunkedUploadPart *)part
+                         uploadIdentifier:(NSString *)uploadIdentifier
+{
+    NSString *query = [NSString stringWithFormat:@"partNumber=%lu&uploadId=%@", (unsigned long)(part.index + 1), AFPercentEscapedStringFromString(uploadIdentifier ?: @"")];
+
+    return [self requestWithHTTPMethod:@"PUT" query:query];
+}
+
+- (NSString *)tagForUploadedPart:(__unused AFChunkedUploadPart *)part
+                        response:(NSHTTPURLResponse *)response
+                           error:(NSError * __autoreleasing *)error
+{
+    NSString *entityTag = response.allHeaderFields[@"ETag"];
+    if (entityTag.length == 0) {
+        if (error) {
+            *error = AFChunkedUploadBadServerResponseError(response);
+        }
+
+        return nil;
+    }
+
+    return entityTag;
+}
+
+- (NSURLRequest *)requestForCompletingUploadWithParts:(NSArray <AFChunkedUploadPart *> *)parts
+                                     uploadIdentifier:(NSString *)uploadIdentifier
+{
+    NSMutableString *body = [NSMutableString stringWithString:@"<CompleteMultipartUpload>"];
+    for (AFChunkedUploadPart *part in parts) {
+        [body appendFormat:@"<Part><PartNumber>%lu</PartNumber><ETag>%@</ETag></Part>", (unsigned long)(part.index + 1), AFChunkedUploadXMLEscapedString(part.tag)];
+    }
+    [body appendString:@"</CompleteMultipartUpload>"];
+
+    NSMutableURLRequest *mutableRequest = [self requestWithHTTPMethod:@"POST" query:[@"uploadId=" stringByAppendingString:AFPercentEscapedStringFromString(uploadIdentifier ?: @"")]];
+    [mutableRequest setValue:@"application/xml" forHTTPHeaderField:@"Content-Type"];
+    mutableRequest.HTTPBody = [body dataUsingEncoding:NSUTF8StringEncoding];
+
+    return mutableRequest;
+}
+
+@end
+
+#pragma mark -
+
+@interface AFTusUploadAdapter ()
+@property (readwrite, nonatomic, copy) NSURLRequest *request;
+@end
+
+@implementation AFTusUploadAdapter
+
+- (instancetype)initWithRequest:(NSURLRequest *)request {
+    NSParameterAssert(request.URL);
+
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    self.request = request;
+
+    return self;
+}
+
+- (NSMutableURLRequest *)creationRequestWithConcatenation:(NSString *)concatenation {
+    NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+    mutableRequest.HTTPMethod = @"POST";
+    mutableRequest.HTTPBody = nil;
+    [mutableRequest setValue:@"1.0.0" forHTTPHeaderField:@"Tus-Resumable"];
+    [mutableRequest setValue:concatenation forHTTPHeaderField:@"Upload-Concat"];
+
+    return mutableRequest;
+}
+
+- (NSURLRequest *)requestForUploadingPart:(AFChunkedUploadPart *)part
+                         uploadIdentifier:(__unused NSString *)uploadIdentifier
+{
+    NSMutableURLRequest *mutableRequest = [self creationRequestWithConcatenation:@"partial"];
+    [mutableRequest setValue:[NSString stringWithFormat:@"%llu", part.length] forHTTPHeaderField:@"Upload-Length"];
+    [mutableRequest setValue:@"application/offset+octet-stream" forHTTPHeaderField:@"Content-Type"];
+
+    return mutableRequest;
+}
+
+- (NSString *)tagForUploadedPart:(__unused AFChunkedUploadPart *)part
+                        response:(NSHTTPURLResponse *)response
+                           error:(NSError * __autoreleasing *)error
+{
+    NSString *location = response.allHeaderFields[@"Location"];
+    NSURL *URL = location ? [NSURL URLWithString:location relativeToURL:self.request.URL] : nil;
+    if (!URL) {
+        if (error) {
+            *error = AFChunkedUploadBadServerResponseError(response);
+        }
+
+        return nil;
+    }
+
+    return [URL absoluteString];
+}
+
+- (NSURLRequest *)requestForCompletingUploadWithParts:(NSArray <AFChunkedUploadPart *> *)parts
+                                     uploadIdentifier:(__unused NSString *)uploadIdentifier
+{
+    NSArray <NSString *> *tags = [parts valueForKey:NSStringFromSelector(@selector(tag))];
+
+    return [self creationRequestWithConcatenation:[@"final;" stringByAppendingString:[tags componentsJoinedByString:@" "]]];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFChunkedUploadTask () {
+    pthread_mutex_t _mutex;
+    pthread_mutex_t _progressMutex;
+    int64_t _sentLength;
+}
+@property (readwrite, nonatomic, strong) AFURLSessionManager *sessionManager;
+@property (readwrite, nonatomic, copy) NSURL *fileURL;
+@property (readwrite, nonatomic, strong) id <AFChunkedUploadAdapter> adapter;
+@property (readwrite, nonatomic, strong) NSProgress *progress;
+@property (readwrite, nonatomic, copy) void (^completionHandler)(NSURLResponse *response, NSData *responseData, NSError *error);
+@property (readwrite, nonatomic, strong) NSData *fileData;
+@property (readwrite, nonatomic, strong) NSDictionary *journal;
+@property (readwrite, nonatomic, strong) NSArray <AFChunkedUploadPart *> *parts;
+@property (readwrite, nonatomic, strong) NSMutableArray <AFChunkedUploadPart *> *pendingParts;
+@property (readwrite, nonatomic, assign) NSUInteger runningPartCount;
+@property (readwrite, nonatomic, copy) NSString *uploadIdentifier;
+@property (readwrite, nonatomic, strong) NSURLSessionTask *requestTask;
+@property (readwrite, nonatomic, strong) NSError *error;
+@property (readwrite, nonatomic, assign, getter=isStarted) BOOL started;
+@property (readwrite, nonatomic, assign, getter=isCancelled) BOOL cancelled;
+@property (readwrite, nonatomic, assign, getter=isCompleting) BOOL completing;
+@property (readwrite, nonatomic, assign, getter=isFinished) BOOL finished;
+@end
+
+@implementation AFChunkedUploadTask
+
+- (instancetype)initWithSessionManager:(AFURLSessionManager *)sessionManager
+                               fileURL:(NSURL *)fileURL
+                               adapter:(id <AFChunkedUploadAdapter>)adapter
+{
+    NSParameterAssert(sessionManager);
+    NSParameterAssert([fileURL isFileURL]);
+    NSParameterAssert(adapter);
+
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_mutex_init(&_progressMutex, NULL);
+
+    self.sessionManager = sessionManager;
+    self.fileURL = fileURL;
+    self.adapter = adapter;
+    self.partLength = 8 * 1024 * 1024;
+    self.maximumConcurrentPartCount = 4;
+
+    AFHTTPRetryPolicy *retryPolicy = [AFHTTPRetryPolicy defaultPolicy];
+    retryPolicy.retriableHTTPMethods = [retryPolicy.retriableHTTPMethods setByAddingObjectsFromArray:@[@"POST", @"PATCH"]];
+    retryPolicy.deadline = 0;
+    self.retryPolicy = retryPolicy;
+
+    self.progress = [NSProgress progressWithTotalUnitCount:NSURLSessionTransferSizeUnknown];
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+    pthread_mutex_destroy(&_progressMutex);
+}
+
+- (void)resumeWithCompletionHandler:(void (^)(NSURLResponse *response, NSData *responseData, NSError *error))completionHandler {
+    pthread_mutex_lock(&_mutex);
+    BOOL starts = !self.started && !self.cancelled;
+    if (starts) {
+        self.started = YES;
+        self.completionHandler = completionHandler;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (starts) {
+        // Mapping the file and reading the journal touch the disk, which is kept off the calling thread.
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [self prepareParts];
+        });
+    }
+}
+
+- (void)cancel {
+    pthread_mutex_lock(&_mutex);
+    self.cancelled = YES;
+    NSMutableArray <NSURLSessionTask *> *tasks = [NSMutableArray array];
+    if (self.requestTask) {
+        [tasks addObject:self.requestTask];
+    }
+    for (AFChunkedUploadPart *part in self.parts) {
+        if (part.task) {
+            [tasks addObject:part.task];
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    for (NSURLSessionTask *task in tasks) {
+        [task cancel];
+    }
+}
+
+- (NSError *)cancelledError {
+    return [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+}
+
+#pragma mark - Journal
+
+- (NSDictionary *)journalMatchingFileSize:(unsigned long long)fileSize
+                         modificationDate:(NSDate *)modificationDate
+                                partCount:(NSUInteger)partCount
+{
+    NSDictionary *journal = self.journalURL ? [NSDictionary dictionaryWithContentsOfURL:self.journalURL] : nil;
+    if (!journal) {
+        return nil;
+    }
+
+    // Dates are stored as numbers, which keep their sub-second precision in a property list.
+    NSTimeInterval modificationInterval = [journal[AFChunkedUploadJournalModificationDateKey] doubleValue];
+    if (![journal[AFChunkedUploadJournalFilePathKey] isEqual:self.fileURL.path] || [journal[AFChunkedUploadJournalFileSizeKey] unsignedLongLongValue] != fileSize || fabs(modificationInterval - [modificationDate timeIntervalSinceReferenceDate]) > 0.001 || [journal[AFChunkedUploadJournalPartLengthKey] unsignedLongLongValue] != self.partLength) {
+        return nil;
+    }
+
+    NSArray *tags = journal[AFChunkedUploadJournalTagsKey];
+    if (![tags isKindOfClass:[NSArray class]] || tags.count != partCount) {
+        return nil;
+    }
+
+    return journal;
+}
+
+// Called with the lock held, so that the journal is never overwritten by an older state.
+- (void)writeJournal {
+    if (!self.journal) {
+        return;
+    }
+
+    NSMutableArray <NSString *> *tags = [NSMutableArray arrayWithCapacity:self.parts.count];
+    for (AFChunkedUploadPart *part in self.parts) {
+        [tags addObject:part.tag ?: @""];
+    }
+
+    NSMutableDictionary *journal = [self.journal mutableCopy];
+    journal[AFChunkedUploadJournalTagsKey] = tags;
+    if (self.uploadIdentifier) {
+        journal[AFChunkedUploadJournalUploadIdentifierKey] = self.uploadIdentifier;
+    }
+    self.journal = journal;
+
+    [journal writeToURL:self.journalURL atomically:YES];
+}
+
+#pragma mark - Parts
+
+- (void)prepareParts {
+    NSError *error = nil;
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:self.fileURL.path error:&error];
+    NSData *fileData = attributes ? [NSData dataWithContentsOfURL:self.fileURL options:NSDataReadingMappedAlways error:&error] : nil;
+    if (!fileData) {
+        [self finishWithResponse:nil data:nil error:error];
+        return;
+    }
+
+    unsigned long long fileSize = fileData.length;
+    unsigned long long partLength = MAX(self.partLength, 1ull);
+    NSUInteger partCount = (NSUInteger)MAX((fileSize + partLength - 1) / partLength, 1ull);
+    NSDictionary *journal = [self journalMatchingFileSize:fileSize modificationDate:[attributes fileModificationDate] partCount:partCount];
+    NSArray *tags = journal[AFChunkedUploadJournalTagsKey];
+
+    NSMutableArray <AFChunkedUploadPart *> *parts = [NSMutableArray arrayWithCapacity:partCount];
+    NSMutableArray <AFChunkedUploadPart *> *pendingParts = [NSMutableArray array];
+    int64_t sentLength = 0;
+    for (NSUInteger index = 0; index < partCount; index++) {
+        AFChunkedUploadPart *part = [[AFChunkedUploadPart alloc] init];
+        part.index = index;
+        part.offset = index * partLength;
+        part.length = MIN(partLength, fileSize - part.offset);
+
+        NSString *tag = tags[index];
+        if ([tag isKindOfClass:[NSString class]] && tag.length > 0) {
+            part.tag = tag;
+            part.sentLength = (int64_t)part.length;
+            sentLength += part.sentLength;
+        } else {
+            [pendingParts addObject:part];
+        }
+
+        [parts addObject:part];
+    }
+
+    if (!journal && self.journalURL) {
+        journal = @{
+                    AFChunkedUploadJournalFilePathKey: self.fileURL.path,
+                    AFChunkedUploadJournalFileSizeKey: @(fileSize),
+                    AFChunkedUploadJournalModificationDateKey: @([[attributes fileModificationDate] timeIntervalSinceReferenceDate]),
+                    AFChunkedUploadJournalPartLengthKey: @(self.partLength),
+                    };
+    }
+
+    pthread_mutex_lock(&_mutex);
+    self.fileData = fileData;
+    self.journal = journal;
+    self.parts = parts;
+    self.pendingParts = pendingParts;
+    self.uploadIdentifier = journal[AFChunkedUploadJournalUploadIdentifierKey];
+    _sentLength = sentLength;
+    pthread_mutex_unlock(&_mutex);
+
+    self.progress.totalUnitCount = (int64_t)fileSize;
+    [self updateProgressWithSentLength:sentLength];
+
+    if (!self.uploadIdentifier && [self.adapter respondsToSelector:@selector(requestForCreatingUploadOfLength:)]) {
+        [self createUploadOfLength:fileSize];
+    } else {
+        [self uploadParts];
+    }
+}
+
+- (void)createUploadOfLength:(unsigned long long)length {
+    NSURLRequest *request = [self.adapter requestForCreatingUploadOfLength:length];
+    [self sendRequest:request completionHandler:^(NSHTTPURLResponse *response, NSData *data, NSError *error) {
+        NSString *uploadIdentifier = nil;
+        if (!error) {
+            uploadIdentifier = [self.adapter uploadIdentifierFromResponse:response data:data error:&error];
+        }
+
+        if (!uploadIdentifier) {
+            [self finishWithResponse:response data:data error:(error ?: AFChunkedUploadBadServerResponseError(response))];
+            return;
+        }
+
+        pthread_mutex_lock(&self->_mutex);
+        self.uploadIdentifier = uploadIdentifier;
+        [self writeJournal];
+        pthread_mutex_unlock(&self->_mutex);
+
+        [self uploadParts];
+    }];
+}
+
+// Starts pending parts while fewer than `maximumConcurrentPartCount` are running, and completes or fails the upload once none is left running.
+- (void)uploadParts {
+    NSMutableArray <AFChunkedUploadPart *> *startedParts = [NSMutableArray array];
+
+    pthread_mutex_lock(&_mutex);
+    BOOL stopped = self.cancelled || self.error;
+    NSUInteger maximumConcurrentPartCount = MAX(self.maximumConcurrentPartCount, 1u);
+    while (!stopped && self.runningPartCount < maximumConcurrentPartCount && self.pendingParts.count > 0) {
+        [startedParts addObject:self.pendingParts.firstObject];
+        [self.pendingParts removeObjectAtIndex:0];
+        self.runningPartCount++;
+    }
+
+    BOOL finishes = self.runningPartCount == 0 && (stopped || self.pendingParts.count == 0) && !self.completing;
+    if (finishes) {
+        self.completing = YES;
+    }
+    NSError *error = self.cancelled ? [self cancelledError] : self.error;
+    pthread_mutex_unlock(&_mutex);
+
+    for (AFChunkedUploadPart *part in startedParts) {
+        [self uploadPart:part];
+    }
+
+    if (finishes && stopped) {
+        [self finishWithResponse:nil data:nil error:error];
+    } else if (finishes) {
+        [self completeUpload];
+    }
+}
+
+- (void)uploadPart:(AFChunkedUploadPart *)part {
+    NSURLRequest *request = [self.adapter requestForUploadingPart:part uploadIdentifier:self.uploadIdentifier];
+
+    // The part refers to the bytes of the mapped file, which stays mapped as long as the part data is used.
+    NSData *fileData = self.fileData;
+    NSData *partData = [[NSData alloc] initWithBytesNoCopy:(void *)((const uint8_t *)fileData.bytes + part.offset) length:(NSUInteger)part.length deallocator:^(__unused void *bytes, __unused NSUInteger length) {
+        (void)fileData;
+    }];
+
+    part.attemptCount++;
+    if (part.attemptCount == 1) {
+        part.firstAttemptTime = CFAbsoluteTimeGetCurrent();
+    }
+
+    NSURLSessionUploadTask *task = [self.sessionManager uploadTaskWithRequest:request fromData:partData progress:^(NSProgress *uploadProgress) {
+        [self part:part didSendLength:uploadProgress.completedUnitCount];
+    } completionHandler:^(NSURLResponse *response, __unused id responseObject, NSError *error) {
+        [self part:part didCompleteWithRequest:request response:(NSHTTPURLResponse *)response error:error];
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    part.task = task;
+    BOOL cancelled = self.cancelled;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [task cancel];
+    }
+
+    [task resume];
+}
+
+- (void)part:(AFChunkedUploadPart *)part
+didSendLength:(int64_t)sentLength
+{
+    pthread_mutex_lock(&_mutex);
+    _sentLength += sentLength - part.sentLength;
+    part.sentLength = sentLength;
+    int64_t totalSentLength = _sentLength;
+    pthread_mutex_unlock(&_mutex);
+
+    [self updateProgressWithSentLength:totalSentLength];
+}
+
+// Parts report their progress from different queues, so a report read before another part's may arrive after it.
+// A part that is sent again is counted from the start again, but the progress waits until it catches up rather than going back.
+- (void)updateProgressWithSentLength:(int64_t)sentLength {
+    pthread_mutex_lock(&_progressMutex);
+    if (sentLength > self.progress.completedUnitCount) {
+        self.progress.completedUnitCount = sentLength;
+    }
+    pthread_mutex_unlock(&_progressMutex);
+}
+
+- (void)part:(AFChunkedUploadPart *)part
+didCompleteWithRequest:(NSURLRequest *)request
+    response:(NSHTTPURLResponse *)response
+       error:(NSError *)error
+{
+    NSString *tag = nil;
+    if (!error) {
+        tag = [self.adapter tagForUploadedPart:part response:response error:&error];
+        if (!tag && !error) {
+            error = AFChunkedUploadBadServerResponseError(response);
+        }
+    }
+
+    pthread_mutex_lock(&_mutex);
+    part.task = nil;
+    BOOL stopped = self.cancelled || self.error;
+    if (tag) {
+        part.tag = tag;
+        self.runningPartCount--;
+        [self writeJournal];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (tag) {
+        [self part:part didSendLength:(int64_t)part.length];
+        [self uploadParts];
+        return;
+    }
+
+    [self part:part didSendLength:0];
+
+    NSTimeInterval delay = 0.0;
+    if (!stopped && [self shouldRetryPart:part request:request response:response error:error delay:&delay]) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            pthread_mutex_lock(&self->_mutex);
+            BOOL cancelled = self.cancelled;
+            pthread_mutex_unlock(&self->_mutex);
+
+            if (cancelled) {
+                [self partDidFail:part error:[self cancelledError]];
+            } else {
+                [self uploadPart:part];
+            }
+        });
+        return;
+    }
+
+    [self partDidFail:part error:error];
+}
+
+- (BOOL)shouldRetryPart:(AFChunkedUploadPart *)part
+                request:(NSURLRequest *)request
+               response:(NSHTTPURLResponse *)response
+                  error:(NSError *)error
+                  delay:(NSTimeInterval *)delay
+{
+    AFHTTPRetryPolicy *retryPolicy = self.retryPolicy;
+    if (!retryPolicy || part.attemptCount >= retryPolicy.maximumNumberOfAttempts || ![retryPolicy shouldRetryRequest:request response:response error:error]) {
+        return NO;
+    }
+
+    *delay = [retryPolicy delayBeforeRetry:part.attemptCount response:response];
+
+    return retryPolicy.deadline <= 0 || CFAbsoluteTimeGetCurrent() - part.firstAttemptTime + *delay <= retryPolicy.deadline;
+}
+
+- (void)partDidFail:(__unused AFChunkedUploadPart *)part
+              error:(NSError *)error
+{
+    NSMutableArray <NSURLSessionTask *> *otherTasks = [NSMutableArray array];
+
+    pthread_mutex_lock(&_mutex);
+    self.runningPartCount--;
+    if (!self.error) {
+        self.error = error;
+
+        // The first failure stops the other parts; those already uploaded stay recorded in the journal.
+        for (AFChunkedUploadPart *otherPart in self.parts) {
+            if (otherPart.task) {
+                [otherTasks addObject:otherPart.task];
+            }
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    for (NSURLSessionTask *otherTask in otherTasks) {
+        [otherTask cancel];
+    }
+
+    [self uploadParts];
+}
+
+- (void)completeUpload {
+    NSURLRequest *request = [self.adapter requestForCompletingUploadWithParts:self.parts uploadIdentifier:self.uploadIdentifier];
+    [self sendRequest:request completionHandler:^(NSHTTPURLResponse *response, NSData *data, NSError *error) {
+        if (!error && self.journalURL) {
+            [[NSFileManager defaultManager] removeItemAtURL:self.journalURL error:nil];
+        }
+
+        [self finishWithResponse:response data:data error:error];
+    }];
+}
+
+#pragma mark -
+
+// Sends a request whose response body is returned as is, rather than through the response serializer of the manager.
+- (void)sendRequest:(NSURLRequest *)request
+  completionHandler:(void (^)(NSHTTPURLResponse *response, NSData *data, NSError *error))completionHandler
+{
+    NSMutableData *data = [NSMutableData data];
+    NSURLSessionDataTask *task = [self.sessionManager dataTaskWithRequest:request highWatermark:0 lowWatermark:0 queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) chunkHandler:^(NSData *chunk) {
+        [data appendData:chunk];
+    } completionHandler:^(NSURLResponse *response, NSError *error) {
+        pthread_mutex_lock(&self->_mutex);
+        self.requestTask = nil;
+        BOOL cancelled = self.cancelled;
+        pthread_mutex_unlock(&self->_mutex);
+
+        if (cancelled) {
+            [self finishWithResponse:nil data:nil error:[self cancelledError]];
+            return;
+        }
+
+        completionHandler((NSHTTPURLResponse *)response, data, error);
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    self.requestTask = task;
+    BOOL cancelled = self.cancelled;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [task cancel];
+    }
+
+    [task resume];
+}
+
+- (void)finishWithResponse:(NSURLResponse *)response
+                      data:(NSData *)data
+                     error:(NSError *)error
+{
+    pthread_mutex_lock(&_mutex);
+    BOOL finishes = !self.finished;
+    self.finished = YES;
+    self.fileData = nil;
+    void (^completionHandler)(NSURLResponse *response, NSData *responseData, NSError *error) = self.completionHandler;
+    self.completionHandler = nil;
+    pthread_mutex_unlock(&_mutex);
+
+    if (!finishes || !completionHandler) {
+        return;
+    }
+
+    dispatch_async(self.sessionManager.completionQueue ?: dispatch_get_main_queue(), ^{
+        completionHandler(response, data, error);
+    });
+}
+
+@end
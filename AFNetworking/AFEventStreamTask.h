@@ -0,0 +1,230 @@
+// AFEventStreamTask.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+@class AFURLSessionManager;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The formats of the event streams read by `AFEventStreamParser` and `AFEventStreamTask`.
+
+ - `AFEventStreamFormatServerSentEvents`: A `text/event-stream`, as defined by the Server-Sent Events specification.
+ - `AFEventStreamFormatNDJSON`: Newline-delimited JSON, with one JSON text per line.
+ */
+typedef NS_ENUM(NSUInteger, AFEventStreamFormat) {
+    AFEventStreamFormatServerSentEvents,
+    AFEventStreamFormatNDJSON,
+};
+
+/**
+ `AFEventStreamEvent` is a single event read from an event stream.
+ */
+@interface AFEventStreamEvent : NSObject
+
+/**
+ The type of the event, which is `message` unless set by an `event` field. Always `nil` for NDJSON events.
+ */
+@property (readonly, nonatomic, copy, nullable) NSString *type;
+
+/**
+ The last event ID of the stream when the event was dispatched. Always `nil` for NDJSON events.
+ */
+@property (readonly, nonatomic, copy, nullable) NSString *identifier;
+
+/**
+ The data of the event: the `data` fields joined by line feeds for Server-Sent Events, or the line for NDJSON events.
+ */
+@property (readonly, nonatomic, copy) NSData *data;
+
+/**
+ The JSON object read from the line of an NDJSON event, or `nil` if the line is not valid JSON. Always `nil` for Server-Sent Events.
+ */
+@property (readonly, nonatomic, strong, nullable) id JSONObject;
+
+/**
+ Initializes an event.
+
+ @param type The type of the event.
+ @param identifier The last event ID of the stream.
+ @param data The data of the event.
+ @param JSONObject The JSON object read from the data.
+
+ @return The newly-initialized event.
+ */
+- (instancetype)initWithType:(nullable NSString *)type
+                  identifier:(nullable NSString *)identifier
+                        data:(NSData *)data
+                  JSONObject:(nullable id)JSONObject NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Returns the data of the event decoded as UTF-8.
+ */
+- (nullable NSString *)dataString;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFEventStreamParser` incrementally reads events from the bytes of an event stream, as they are received in chunks of any size.
+
+ Lines are found and their fields matched on the raw bytes, without creating a string for each line. Only the values of the fields of an event are copied, once the event is dispatched. A parser is not thread-safe, and must be used from one thread or serial queue at a time.
+ */
+@interface AFEventStreamParser : NSObject
+
+/**
+ The format of the stream.
+ */
+@property (readonly, nonatomic, assign) AFEventStreamFormat format;
+
+/**
+ The last event ID set by an `id` field, which is kept from one event to the next. `nil` until an `id` field is read.
+ */
+@property (nonatomic, copy, nullable) NSString *lastEventIdentifier;
+
+/**
+ The reconnection time, in seconds, set by the last `retry` field, or a negative value if none was read.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval reconnectionInterval;
+
+/**
+ Initializes a parser for a stream in the specified format.
+
+ @param format The format of the stream.
+
+ @return The newly-initialized parser.
+ */
+- (instancetype)initWithFormat:(AFEventStreamFormat)format NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Reads the specified bytes of the stream, and calls the block for each event they complete. Bytes which do not complete a line are kept until the next call.
+
+ @param data The next bytes of the stream.
+ @param block The block called with each event.
+ */
+- (void)parseData:(NSData *)data
+       usingBlock:(void (^)(AFEventStreamEvent *event))block;
+
+/**
+ Reads the end of the stream, calling the block for an NDJSON line that is not followed by a line break. As required by the Server-Sent Events specification, an incomplete event is discarded.
+
+ @param block The block called with the last event, if any.
+ */
+- (void)finishUsingBlock:(void (^)(AFEventStreamEvent *event))block;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFEventStreamTask` reads a long-lived event stream with an `AFURLSessionManager`, and delivers its events as they are received.
+
+ When the connection ends or fails with a network error, the stream is reconnected after `reconnectionInterval`, sending the last event ID received in a `Last-Event-ID` header. The stream is closed, without reconnecting, when the task is cancelled, when the server responds with `204 No Content`, or when the response fails validation by the response serializer of the manager.
+
+ The stream is only read while the task is retained. Deallocating the task cancels its connection, without calling the close block.
+ */
+@interface AFEventStreamTask : NSObject
+
+/**
+ The manager used to connect to the stream.
+ */
+@property (readonly, nonatomic, strong) AFURLSessionManager *sessionManager;
+
+/**
+ The request used to connect to the stream.
+ */
+@property (readonly, nonatomic, copy) NSURLRequest *request;
+
+/**
+ The format of the stream.
+ */
+@property (readonly, nonatomic, assign) AFEventStreamFormat format;
+
+/**
+ The queue on which events are delivered. If `nil`, the main queue is used.
+ */
+@property (nonatomic, strong, nullable) dispatch_queue_t eventQueue;
+
+/**
+ The time, in seconds, waited before reconnecting. `3` seconds by default, and replaced by the reconnection time sent by the server in a `retry` field.
+ */
+@property (atomic, assign) NSTimeInterval reconnectionInterval;
+
+/**
+ The ID of the last event received, sent in the `Last-Event-ID` header when reconnecting.
+ */
+@property (readonly, atomic, copy, nullable) NSString *lastEventIdentifier;
+
+/**
+ The data task of the current connection, if any.
+ */
+@property (readonly, atomic, strong, nullable) NSURLSessionDataTask *currentTask;
+
+/**
+ Initializes a task reading the stream at the specified request with the specified manager.
+
+ @param sessionManager The manager used to connect to the stream.
+ @param request The request used to connect to the stream. An `Accept` header for the format is added if the request has none.
+ @param format The format of the stream.
+
+ @return The newly-initialized task.
+ */
+- (instancetype)initWithSessionManager:(AFURLSessionManager *)sessionManager
+                               request:(NSURLRequest *)request
+                                format:(AFEventStreamFormat)format NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Sets a block to be executed on `eventQueue` for each event received.
+
+ @param block The block, which takes a single argument: the event.
+ */
+- (void)setEventBlock:(nullable void (^)(AFEventStreamEvent *event))block;
+
+/**
+ Sets a block to be executed on `eventQueue` when the stream is closed and will not be reconnected.
+
+ @param block The block, which takes a single argument: the error that closed the stream, or `nil` if the task was cancelled or the server ended the stream with `204 No Content`.
+ */
+- (void)setDidCloseBlock:(nullable void (^)(NSError * _Nullable error))block;
+
+/**
+ Connects to the stream. Has no effect if the task is already connected or was cancelled.
+ */
+- (void)resume;
+
+/**
+ Closes the stream and stops reconnecting.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,484 @@
+// AFEventStreamTask.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "AFEventStreamTask.h"
+#import "AFURLSessionManager.h"
+
+#import <pthread.h>
+
+static NSTimeInterval const AFEventStreamDefaultReconnectionInterval = 3.0;
+static NSUInteger const AFEventStreamHighWatermark = 1024 * 1024;
+static NSUInteger const AFEventStreamLowWatermark = 256 * 1024;
+
+static inline BOOL AFEventStreamFieldNameEquals(const uint8_t *name, NSUInteger length, const char *expectedName) {
+    return length == strlen(expectedName) && memcmp(name, expectedName, length) == 0;
+}
+
+@implementation AFEventStreamEvent
+
+- (instancetype)initWithType:(NSString *)type
+                  identifier:(NSString *)identifier
+                        data:(NSData *)data
+                  JSONObject:(id)JSONObject
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    _type = [type copy];
+    _identifier = [identifier copy];
+    _data = [data copy];
+    _JSONObject = JSONObject;
+
+    return self;
+}
+
+- (NSString *)dataString {
+    return [[NSString alloc] initWithData:self.data encoding:NSUTF8StringEncoding];
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, type: %@, identifier: %@, data: %@>", NSStringFromClass([self class]), self, self.type, self.identifier, [self dataString]];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFEventStreamParser ()
+@property (readwrite, nonatomic, assign) AFEventStreamFormat format;
+@property (readwrite, nonatomic, assign) NSTimeInterval reconnectionInterval;
+@property (readwrite, nonatomic, strong) NSMutableData *lineBuffer;
+@property (readwrite, nonatomic, strong) NSMutableData *eventData;
+@property (readwrite, nonatomic, copy) NSString *eventType;
+@property (readwrite, nonatomic, assign) BOOL skipsLineFeed;
+@property (readwrite, nonatomic, assign) BOOL parsedFirstLine;
+@end
+
+@implementation AFEventStreamParser
+
+- (instancetype)initWithFormat:(AFEventStreamFormat)format {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    self.format = format;
+    self.reconnectionInterval = -1.0;
+    self.lineBuffer = [NSMutableData data];
+    self.eventData = [NSMutableData data];
+
+    return self;
+}
+
+- (void)parseData:(NSData *)data
+       usingBlock:(void (^)(AFEventStreamEvent *event))block
+{
+    NSParameterAssert(block);
+
+    const uint8_t *bytes = (const uint8_t *)data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger offset = 0;
+
+    // A carriage return ending the previous chunk may be followed by the line feed of the same line break.
+    if (self.skipsLineFeed && length > 0) {
+        if (bytes[0] == '\n') {
+            offset = 1;
+        }
+
+        self.skipsLineFeed = NO;
+    }
+
+    while (offset < length) {
+        NSUInteger lineEnd = offset;
+        while (lineEnd < length && bytes[lineEnd] != '\n' && bytes[lineEnd] != '\r') {
+            lineEnd++;
+        }
+
+        if (lineEnd == length) {
+            [self.lineBuffer appendBytes:bytes + offset length:length - offset];
+            break;
+        }
+
+        // Lines contained in the chunk are read in place. Only lines split across chunks are copied, into the line buffer.
+        if (self.lineBuffer.length > 0) {
+            [self.lineBuffer appendBytes:bytes + offset length:lineEnd - offset];
+            [self parseLine:(const uint8_t *)self.lineBuffer.bytes length:self.lineBuffer.length usingBlock:block];
+            self.lineBuffer.length = 0;
+        } else {
+            [self parseLine:bytes + offset length:lineEnd - offset usingBlock:block];
+        }
+
+        offset = lineEnd + 1;
+        if (bytes[lineEnd] == '\r') {
+            if (offset < length) {
+                if (bytes[offset] == '\n') {
+                    offset++;
+                }
+            } else {
+                self.skipsLineFeed = YES;
+            }
+        }
+    }
+}
+
+- (void)finishUsingBlock:(void (^)(AFEventStreamEvent *event))block {
+    NSParameterAssert(block);
+
+    if (self.format == AFEventStreamFormatNDJSON && self.lineBuffer.length > 0) {
+        [self parseLine:(const uint8_t *)self.lineBuffer.bytes length:self.lineBuffer.length usingBlock:block];
+    }
+
+    self.lineBuffer.length = 0;
+    self.eventData.length = 0;
+    self.eventType = nil;
+    self.skipsLineFeed = NO;
+}
+
+#pragma mark -
+
+- (void)parseLine:(const uint8_t *)line
+           length:(NSUInteger)length
+       usingBlock:(void (^)(AFEventStreamEvent *event))block
+{
+    if (!self.parsedFirstLine) {
+        self.parsedFirstLine = YES;
+
+        static const uint8_t AFByteOrderMark[] = {0xEF, 0xBB, 0xBF};
+        if (length >= sizeof(AFByteOrderMark) && memcmp(line, AFByteOrderMark, sizeof(AFByteOrderMark)) == 0) {
+            line += sizeof(AFByteOrderMark);
+            length -= sizeof(AFByteOrderMark);
+        }
+    }
+
+    switch (self.format) {
+        case AFEventStreamFormatServerSentEvents:
+            [self parseServerSentEventsLine:line length:length usingBlock:block];
+            break;
+        case AFEventStreamFormatNDJSON:
+            [self parseNDJSONLine:line length:length usingBlock:block];
+            break;
+    }
+}
+
+- (void)parseNDJSONLine:(const uint8_t *)line
+                 length:(NSUInteger)length
+             usingBlock:(void (^)(AFEventStreamEvent *event))block
+{
+    if (length == 0) {
+        return;
+    }
+
+    NSData *data = [NSData dataWithBytes:line length:length];
+    id JSONObject = [NSJSONSerialization JSONObjectWithData:data options:NSJSONReadingAllowFragments error:nil];
+
+    block([[AFEventStreamEvent alloc] initWithType:nil identifier:nil data:data JSONObject:JSONObject]);
+}
+
+- (void)parseServerSentEventsLine:(const uint8_t *)line
+                           length:(NSUInteger)length
+                       usingBlock:(void (^)(AFEventStreamEvent *event))block
+{
+    if (length == 0) {
+        [self dispatchEventUsingBlock:block];
+        return;
+    }
+
+    if (line[0] == ':') {
+        return;
+    }
+
+    const uint8_t *colon = memchr(line, ':', length);
+    NSUInteger nameLength = colon ? (NSUInteger)(colon - line) : length;
+    const uint8_t *value = colon ? colon + 1 : line + length;
+    NSUInteger valueLength = length - (NSUInteger)(value - line);
+    if (valueLength > 0 && value[0] == ' ') {
+        value++;
+        valueLength--;
+    }
+
+    if (AFEventStreamFieldNameEquals(line, nameLength, "data")) {
+        [self.eventData appendBytes:value length:valueLength];
+        [self.eventData appendBytes:"\n" length:1];
+    } else if (AFEventStreamFieldNameEquals(line, nameLength, "event")) {
+        self.eventType = [[NSString alloc] initWithBytes:value length:valueLength encoding:NSUTF8StringEncoding];
+    } else if (AFEventStreamFieldNameEquals(line, nameLength, "id")) {
+        if (!memchr(value, '\0', valueLength)) {
+            self.lastEventIdentifier = [[NSString alloc] initWithBytes:value length:valueLength encoding:NSUTF8StringEncoding];
+        }
+    } else if (AFEventStreamFieldNameEquals(line, nameLength, "retry")) {
+        uint64_t milliseconds = 0;
+        for (NSUInteger index = 0; index < valueLength; index++) {
+            if (value[index] < '0' || value[index] > '9') {
+                return;
+            }
+
+            milliseconds = milliseconds * 10 + (uint64_t)(value[index] - '0');
+        }
+
+        if (valueLength > 0) {
+            self.reconnectionInterval = (NSTimeInterval)milliseconds / 1000.0;
+        }
+    }
+}
+
+- (void)dispatchEventUsingBlock:(void (^)(AFEventStreamEvent *event))block {
+    NSString *eventType = self.eventType;
+    self.eventType = nil;
+
+    if (self.eventData.length == 0) {
+        return;
+    }
+
+    // The line feed appended after the last data field is not part of the data.
+    NSData *data = [self.eventData subdataWithRange:NSMakeRange(0, self.eventData.length - 1)];
+    self.eventData.length = 0;
+
+    block([[AFEventStreamEvent alloc] initWithType:(eventType.length > 0 ? eventType : @"message") identifier:self.lastEventIdentifier data:data JSONObject:nil]);
+}
+
+@end
+
+#pragma mark -
+
+@interface AFEventStreamTask () {
+    pthread_mutex_t _mutex;
+}
+@property (readwrite, nonatomic, strong) AFURLSessionManager *sessionManager;
+@property (readwrite, nonatomic, copy) NSURLRequest *request;
+@property (readwrite, nonatomic, assign) AFEventStreamFormat format;
+@property (readwrite, atomic, copy) NSString *lastEventIdentifier;
+@property (readwrite, atomic, strong) NSURLSessionDataTask *currentTask;
+@property (readwrite, nonatomic, copy) void (^eventBlock)(AFEventStreamEvent *event);
+@property (readwrite, nonatomic, copy) void (^didCloseBlock)(NSError *error);
+@property (readwrite, nonatomic, assign, getter=isCancelled) BOOL cancelled;
+@property (readwrite, nonatomic, assign, getter=isConnecting) BOOL connecting;
+@property (readwrite, nonatomic, assign, getter=isClosed) BOOL closed;
+@end
+
+@implementation AFEventStreamTask
+
+- (instancetype)initWithSessionManager:(AFURLSessionManager *)sessionManager
+                               request:(NSURLRequest *)request
+                                format:(AFEventStreamFormat)format
+{
+    NSParameterAssert(sessionManager);
+    NSParameterAssert(request);
+
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_mutex, NULL);
+
+    self.sessionManager = sessionManager;
+    self.request = request;
+    self.format = format;
+    self.reconnectionInterval = AFEventStreamDefaultReconnectionInterval;
+
+    return self;
+}
+
+- (void)dealloc {
+    // The blocks of the connection only hold the task weakly, so the connection would otherwise outlive it.
+    [_currentTask cancel];
+
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (void)setEventBlock:(void (^)(AFEventStreamEvent *event))block {
+    _eventBlock = [block copy];
+}
+
+- (void)setDidCloseBlock:(void (^)(NSError *error))block {
+    _didCloseBlock = [block copy];
+}
+
+- (void)resume {
+    pthread_mutex_lock(&_mutex);
+    BOOL connects = !self.cancelled && !self.connecting;
+    if (connects) {
+        self.connecting = YES;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (connects) {
+        [self connect];
+    }
+}
+
+- (void)cancel {
+    pthread_mutex_lock(&_mutex);
+    NSURLSessionDataTask *task = self.currentTask;
+    // A running connection closes the stream once cancelled, but a pending one has to be closed here.
+    BOOL closes = !self.cancelled && self.connecting && !task;
+    self.cancelled = YES;
+    pthread_mutex_unlock(&_mutex);
+
+    [task cancel];
+
+    if (closes) {
+        [self closeWithError:nil];
+    }
+}
+
+#pragma mark -
+
+- (NSURLRequest *)connectionRequest {
+    NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+    if (![mutableRequest valueForHTTPHeaderField:@"Accept"]) {
+        [mutableRequest setValue:(self.format == AFEventStreamFormatNDJSON ? @"application/x-ndjson" : @"text/event-stream") forHTTPHeaderField:@"Accept"];
+    }
+
+    [mutableRequest setValue:@"no-cache" forHTTPHeaderField:@"Cache-Control"];
+
+    NSString *lastEventIdentifier = self.lastEventIdentifier;
+    if (lastEventIdentifier.length > 0) {
+        [mutableRequest setValue:lastEventIdentifier forHTTPHeaderField:@"Last-Event-ID"];
+    }
+
+    return mutableRequest;
+}
+
+- (void)connect {
+    AFEventStreamParser *parser = [[AFEventStreamParser alloc] initWithFormat:self.format];
+    parser.lastEventIdentifier = self.lastEventIdentifier;
+
+    // Chunks are parsed one at a time on the chunk queue of the data task, and the events of each chunk are delivered together.
+    __weak __typeof(self)weakSelf = self;
+    NSURLSessionDataTask *task = [self.sessionManager dataTaskWithRequest:[self connectionRequest] highWatermark:AFEventStreamHighWatermark lowWatermark:AFEventStreamLowWatermark chunkHandler:^(NSData *chunk) {
+        __strong __typeof(weakSelf)strongSelf = weakSelf;
+        NSMutableArray <AFEventStreamEvent *> *events = [NSMutableArray array];
+        [parser parseData:chunk usingBlock:^(AFEventStreamEvent *event) {
+            [events addObject:event];
+        }];
+
+        [strongSelf didParseEvents:events parser:parser];
+    } completionHandler:^(NSURLResponse *response, NSError *error) {
+        __strong __typeof(weakSelf)strongSelf = weakSelf;
+        NSMutableArray <AFEventStreamEvent *> *events = [NSMutableArray array];
+        [parser finishUsingBlock:^(AFEventStreamEvent *event) {
+            [events addObject:event];
+        }];
+
+        [strongSelf didParseEvents:events parser:parser];
+        [strongSelf connectionDidCompleteWithResponse:response error:error];
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    BOOL cancelled = self.cancelled;
+    self.currentTask = cancelled ? nil : task;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [task cancel];
+        return;
+    }
+
+    [task resume];
+}
+
+- (void)didParseEvents:(NSArray <AFEventStreamEvent *> *)events
+                parser:(AFEventStreamParser *)parser
+{
+    self.lastEventIdentifier = parser.lastEventIdentifier;
+    if (parser.reconnectionInterval >= 0) {
+        self.reconnectionInterval = parser.reconnectionInterval;
+    }
+
+    void (^eventBlock)(AFEventStreamEvent *event) = self.eventBlock;
+    if (events.count == 0 || !eventBlock) {
+        return;
+    }
+
+    dispatch_async(self.eventQueue ?: dispatch_get_main_queue(), ^{
+        for (AFEventStreamEvent *event in events) {
+            eventBlock(event);
+        }
+    });
+}
+
+- (void)connectionDidCompleteWithResponse:(NSURLResponse *)response
+                                    error:(NSError *)error
+{
+    NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? [(NSHTTPURLResponse *)response statusCode] : 0;
+
+    // Only the end of the stream and network errors are followed by a new connection. Cancellation, `204 No Content` and invalid responses close the stream.
+    BOOL reconnects = NO;
+    if (!error) {
+        reconnects = statusCode != 204;
+    } else if ([error.domain isEqualToString:NSURLErrorDomain] && error.code != NSURLErrorCancelled) {
+        reconnects = YES;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    self.currentTask = nil;
+    if (self.cancelled) {
+        reconnects = NO;
+        error = nil;
+    }
+    self.connecting = reconnects;
+    pthread_mutex_unlock(&_mutex);
+
+    if (!reconnects) {
+        [self closeWithError:error];
+        return;
+    }
+
+    __weak __typeof(self)weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.reconnectionInterval * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        __strong __typeof(weakSelf)strongSelf = weakSelf;
+        if (!strongSelf) {
+            return;
+        }
+
+        pthread_mutex_lock(&strongSelf->_mutex);
+        BOOL cancelled = strongSelf.cancelled;
+        pthread_mutex_unlock(&strongSelf->_mutex);
+
+        if (!cancelled) {
+            [strongSelf connect];
+        }
+    });
+}
+
+// A cancellation racing with a new connection may reach here from both `-cancel` and the completion of that connection, so only the first call closes the stream.
+- (void)closeWithError:(NSError *)error {
+    pthread_mutex_lock(&_mutex);
+    BOOL closes = !self.closed;
+    self.closed = YES;
+    pthread_mutex_unlock(&_mutex);
+
+    void (^didCloseBlock)(NSError *error) = self.didCloseBlock;
+    if (!closes || !didCloseBlock) {
+        return;
+    }
+
+    dispatch_async(self.eventQueue ?: dispatch_get_main_queue(), ^{
+        didCloseBlock(error);
+    });
+}
+
+@end
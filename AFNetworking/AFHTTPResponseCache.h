@@ -0,0 +1,267 @@
+// AFHTTPResponseCache.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ An `AFCachedHTTPResponse` is a response stored by an `AFHTTPResponseCache`, along with the information needed to compute its freshness as described in RFC 7234.
+ */
+@interface AFCachedHTTPResponse : NSObject <NSSecureCoding>
+
+/**
+ The stored response.
+ */
+@property (readonly, nonatomic, strong) NSHTTPURLResponse *response;
+
+/**
+ The stored response body.
+ */
+@property (readonly, nonatomic, strong) NSData *data;
+
+/**
+ The date at which the request that produced the response was sent.
+ */
+@property (readonly, nonatomic, strong) NSDate *requestDate;
+
+/**
+ The date at which the response was received.
+ */
+@property (readonly, nonatomic, strong) NSDate *responseDate;
+
+/**
+ The time, in seconds, during which the response is fresh, taken from the `max-age` directive or the `Expires` header, or estimated from the `Last-Modified` header when neither is present.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval freshnessLifetime;
+
+/**
+ Returns the age of the response, in seconds, at the specified date.
+
+ @param date The date at which to compute the age.
+ */
+- (NSTimeInterval)ageAtDate:(NSDate *)date;
+
+/**
+ Returns whether the response may be used without revalidation at the specified date.
+
+ @param date The date at which to evaluate the freshness.
+ */
+- (BOOL)isFreshAtDate:(NSDate *)date;
+
+/**
+ Returns whether the response may be used after a failed revalidation at the specified date, as allowed by its `stale-if-error` directive.
+
+ @param date The date at which the revalidation failed.
+ */
+- (BOOL)canBeServedAfterErrorAtDate:(NSDate *)date;
+
+@end
+
+#pragma mark -
+
+/**
+ The result of looking up a request in an `AFHTTPResponseCache`.
+
+ - `AFHTTPResponseCacheLookupMiss`: No usable response is stored. The request must be sent as is.
+ - `AFHTTPResponseCacheLookupFresh`: A fresh response is stored, and can be used without contacting the server.
+ - `AFHTTPResponseCacheLookupStale`: A stale response is stored, that can be used while it is revalidated in the background, as allowed by its `stale-while-revalidate` directive.
+ - `AFHTTPResponseCacheLookupRequiresRevalidation`: A stale response is stored, that can only be used once the server confirms it is still valid.
+ - `AFHTTPResponseCacheLookupStoredOnDisk`: A response may be stored in the disk tier, and must be looked up with `-lookupResponseOnDiskForRequest:completionHandler:`.
+ */
+typedef NS_ENUM(NSInteger, AFHTTPResponseCacheLookupResult) {
+    AFHTTPResponseCacheLookupMiss,
+    AFHTTPResponseCacheLookupFresh,
+    AFHTTPResponseCacheLookupStale,
+    AFHTTPResponseCacheLookupRequiresRevalidation,
+    AFHTTPResponseCacheLookupStoredOnDisk
+};
+
+/**
+ `AFHTTPResponseCache` is a private HTTP cache following RFC 7234, for use by `AFHTTPSessionManager` in place of `NSURLCache`.
+
+ Responses to `GET` requests are stored when their `Cache-Control` and `Expires` headers allow it, and when they can either be used for some time or be revalidated using their `ETag` or `Last-Modified` headers. Requests whose `Vary` headers differ from those of the stored request are not served from the cache. The `stale-while-revalidate` and `stale-if-error` extensions of RFC 5861 are supported.
+
+ Responses are kept in a memory tier, evicted by the system under memory pressure, and in a disk tier, from which the least recently used responses are removed when its capacity is exceeded.
+ */
+@interface AFHTTPResponseCache : NSObject
+
+/**
+ The capacity, in bytes, of the memory tier. `0` disables it.
+ */
+@property (readonly, nonatomic, assign) NSUInteger memoryCapacity;
+
+/**
+ The capacity, in bytes, of the disk tier. `0` disables it.
+ */
+@property (readonly, nonatomic, assign) NSUInteger diskCapacity;
+
+/**
+ The size, in bytes, of the responses currently stored on disk.
+ */
+@property (readonly, nonatomic, assign) NSUInteger currentDiskUsage;
+
+///-----------------------
+/// @name Cache Statistics
+///-----------------------
+
+/**
+ The number of lookups answered with a fresh response.
+ */
+@property (readonly, nonatomic, assign) NSUInteger hitCount;
+
+/**
+ The number of lookups answered with a stale response to be revalidated in the background.
+ */
+@property (readonly, nonatomic, assign) NSUInteger staleHitCount;
+
+/**
+ The number of lookups that found no usable response.
+ */
+@property (readonly, nonatomic, assign) NSUInteger missCount;
+
+/**
+ The number of lookups that required the stored response to be revalidated, in the background or not.
+ */
+@property (readonly, nonatomic, assign) NSUInteger revalidationCount;
+
+/**
+ The number of revalidations to which the server answered `304 Not Modified`, allowing the stored response to be reused.
+ */
+@property (readonly, nonatomic, assign) NSUInteger notModifiedCount;
+
+/**
+ Sets all statistics back to `0`.
+ */
+- (void)resetStatistics;
+
+///---------------------
+/// @name Initialization
+///---------------------
+
+/**
+ Initializes a cache with the specified capacities.
+
+ @param memoryCapacity The capacity, in bytes, of the memory tier.
+ @param diskCapacity The capacity, in bytes, of the disk tier.
+ @param path The directory in which to store responses on disk. If `nil`, a directory inside the caches directory of the application is used.
+
+ @return The newly-initialized cache.
+ */
+- (instancetype)initWithMemoryCapacity:(NSUInteger)memoryCapacity
+                          diskCapacity:(NSUInteger)diskCapacity
+                              diskPath:(nullable NSString *)path NS_DESIGNATED_INITIALIZER;
+
+/**
+ Initializes a cache with a memory capacity of 4 MB and a disk capacity of 20 MB.
+ */
+- (instancetype)init;
+
+///---------------------------------
+/// @name Customizing Cache Behavior
+///---------------------------------
+
+/**
+ Sets a block to be executed before a response is stored, to override the `Cache-Control` header sent by the server, such as to give a specific endpoint a freshness lifetime or a `stale-while-revalidate` window.
+
+ @param block A block object to be executed before a response is stored. The block returns the `Cache-Control` value to store the response with, or `nil` to keep the one sent by the server, and takes two arguments: the request and the response.
+ */
+- (void)setCacheControlOverrideBlock:(nullable NSString * _Nullable (^)(NSURLRequest *request, NSHTTPURLResponse *response))block;
+
+///-------------------------------
+/// @name Storing Cached Responses
+///-------------------------------
+
+/**
+ Looks up the response stored in the memory tier for the specified request, and decides how it can be used. The disk tier is never read, so that the lookup does not block the calling thread.
+
+ @param request The request to look up.
+ @param cachedResponse On output, the stored response, if any.
+
+ @return How the stored response can be used, or `AFHTTPResponseCacheLookupStoredOnDisk` if a response for the request may be stored in the disk tier.
+ */
+- (AFHTTPResponseCacheLookupResult)lookupResponseForRequest:(NSURLRequest *)request
+                                             cachedResponse:(AFCachedHTTPResponse * _Nullable __autoreleasing * _Nullable)cachedResponse;
+
+/**
+ Asynchronously looks up the response stored for the specified request, reading it from the disk tier if it is not in the memory tier, and decides how it can be used.
+
+ @param request The request to look up.
+ @param completionHandler A block to be executed on a background queue once the lookup is done. The block takes two arguments: how the stored response can be used, which is never `AFHTTPResponseCacheLookupStoredOnDisk`, and the stored response, if any.
+ */
+- (void)lookupResponseOnDiskForRequest:(NSURLRequest *)request
+                     completionHandler:(void (^)(AFHTTPResponseCacheLookupResult result, AFCachedHTTPResponse * _Nullable cachedResponse))completionHandler;
+
+/**
+ Returns a copy of the specified request carrying the `If-None-Match` and `If-Modified-Since` headers needed to revalidate the specified stored response.
+
+ @param request The request to revalidate.
+ @param cachedResponse The stored response.
+ */
+- (NSURLRequest *)conditionalRequestForRequest:(NSURLRequest *)request
+                                cachedResponse:(nullable AFCachedHTTPResponse *)cachedResponse;
+
+/**
+ Stores the specified response, if it is cacheable.
+
+ @param response The response.
+ @param data The response body.
+ @param request The request that produced the response.
+ @param requestDate The date at which the request was sent.
+
+ @return The stored response, or `nil` if the response is not cacheable.
+ */
+- (nullable AFCachedHTTPResponse *)storeResponse:(NSHTTPURLResponse *)response
+                                            data:(NSData *)data
+                                      forRequest:(NSURLRequest *)request
+                                     requestDate:(NSDate *)requestDate;
+
+/**
+ Updates the stored response with the headers of a `304 Not Modified` response received while revalidating it.
+
+ @param cachedResponse The stored response.
+ @param response The `304 Not Modified` response.
+ @param request The request that was revalidated.
+ @param requestDate The date at which the conditional request was sent.
+
+ @return The updated response, whose body is that of the stored response.
+ */
+- (AFCachedHTTPResponse *)updateCachedResponse:(AFCachedHTTPResponse *)cachedResponse
+                       withNotModifiedResponse:(NSHTTPURLResponse *)response
+                                    forRequest:(NSURLRequest *)request
+                                   requestDate:(NSDate *)requestDate;
+
+/**
+ Removes the response stored for the specified URL, such as after a request with an unsafe method succeeded for it.
+
+ @param URL The URL.
+ */
+- (void)removeCachedResponseForURL:(NSURL *)URL;
+
+/**
+ Removes all stored responses, from memory and from disk.
+ */
+- (void)removeAllCachedResponses;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,816 @@
+// AFHTTPResponseCache.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "AFHTTPResponseCache.h"
+#import "AFTracing.h"
+
+#import <pthread.h>
+
+static NSTimeInterval const AFHTTPResponseCacheMaximumHeuristicFreshnessLifetime = 24.0 * 60.0 * 60.0;
+static NSString * const AFHTTPResponseCacheArchiveKey = @"cachedResponse";
+
+static NSDateFormatter * AFHTTPResponseCacheDateFormatter() {
+    static NSDateFormatter *dateFormatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [[NSDateFormatter alloc] init];
+        dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+        dateFormatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+
+    return dateFormatter;
+}
+
+static NSDate * AFHTTPDateFromString(NSString *string) {
+    if (!string) {
+        return nil;
+    }
+
+    return [AFHTTPResponseCacheDateFormatter() dateFromString:string];
+}
+
+static NSString * AFHTTPHeaderFieldValue(NSDictionary *headerFields, NSString *field) {
+    NSString *value = headerFields[field];
+    if (value) {
+        return value;
+    }
+
+    for (NSString *key in headerFields) {
+        if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+            return headerFields[key];
+        }
+    }
+
+    return nil;
+}
+
+static NSDictionary <NSString *, NSString *> * AFHTTPCacheControlDirectives(NSString *cacheControl) {
+    NSMutableDictionary *directives = [NSMutableDictionary dictionary];
+    NSCharacterSet *whitespaceCharacterSet = [NSCharacterSet whitespaceCharacterSet];
+
+    for (NSString *component in [cacheControl componentsSeparatedByString:@","]) {
+        NSString *directive = [component stringByTrimmingCharactersInSet:whitespaceCharacterSet];
+        if (directive.length == 0) {
+            continue;
+        }
+
+        NSRange separatorRange = [directive rangeOfString:@"="];
+        if (separatorRange.location == NSNotFound) {
+            directives[[directive lowercaseString]] = @"";
+        } else {
+            NSString *name = [[directive substringToIndex:separatorRange.location] stringByTrimmingCharactersInSet:whitespaceCharacterSet];
+            NSString *value = [[directive substringFromIndex:NSMaxRange(separatorRange)] stringByTrimmingCharactersInSet:whitespaceCharacterSet];
+            directives[[name lowercaseString]] = [value stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@"\""]];
+        }
+    }
+
+    return directives;
+}
+
+static NSString * AFHTTPResponseCacheKeyForURL(NSURL *URL) {
+    return URL.absoluteString ?: @"";
+}
+
+// FNV-1a, only used to name files; the full key is stored in each file and checked when reading it back.
+static NSString * AFHTTPResponseCacheFileNameForKey(NSString *key) {
+    const char *bytes = [key UTF8String];
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t index = 0; bytes[index] != '\0'; index++) {
+        hash ^= (uint8_t)bytes[index];
+        hash *= 1099511628211ULL;
+    }
+
+    return [NSString stringWithFormat:@"%016llx", (unsigned long long)hash];
+}
+
+static BOOL AFHTTPStatusCodeIsCacheable(NSInteger statusCode) {
+    switch (statusCode) {
+        case 200:
+        case 203:
+        case 204:
+        case 300:
+        case 301:
+        case 308:
+        case 404:
+        case 405:
+        case 410:
+        case 414:
+        case 501:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+#pragma mark -
+
+@interface AFCachedHTTPResponse ()
+@property (readwrite, nonatomic, strong) NSHTTPURLResponse *response;
+@property (readwrite, nonatomic, strong) NSData *data;
+@property (readwrite, nonatomic, strong) NSDate *requestDate;
+@property (readwrite, nonatomic, strong) NSDate *responseDate;
+@property (readwrite, nonatomic, copy) NSString *key;
+@property (readwrite, nonatomic, copy) NSDictionary <NSString *, NSString *> *varyHeaders;
+@property (readwrite, nonatomic, copy) NSDictionary <NSString *, NSString *> *cacheControlDirectives;
+@end
+
+@implementation AFCachedHTTPResponse
+
+- (instancetype)initWithResponse:(NSHTTPURLResponse *)response
+                            data:(NSData *)data
+                     requestDate:(NSDate *)requestDate
+                    responseDate:(NSDate *)responseDate
+                             key:(NSString *)key
+                     varyHeaders:(NSDictionary <NSString *, NSString *> *)varyHeaders
+{
+    if (self = [self init]) {
+        self.response = response;
+        self.data = data ?: [NSData data];
+        self.requestDate = requestDate;
+        self.responseDate = responseDate;
+        self.key = key;
+        self.varyHeaders = varyHeaders;
+        self.cacheControlDirectives = AFHTTPCacheControlDirectives([self valueForHTTPHeaderField:@"Cache-Control"]);
+    }
+    return self;
+}
+
+- (NSString *)valueForHTTPHeaderField:(NSString *)field {
+    return AFHTTPHeaderFieldValue(self.response.allHeaderFields, field);
+}
+
+- (NSDate *)dateValue {
+    return AFHTTPDateFromString([self valueForHTTPHeaderField:@"Date"]) ?: self.responseDate;
+}
+
+- (NSTimeInterval)freshnessLifetime {
+    NSString *maxAge = self.cacheControlDirectives[@"max-age"];
+    if (maxAge) {
+        return MAX(0.0, [maxAge doubleValue]);
+    }
+
+    NSString *expires = [self valueForHTTPHeaderField:@"Expires"];
+    if (expires) {
+        // An invalid Expires header, such as "0", means the response is already expired
+        NSDate *expirationDate = AFHTTPDateFromString(expires);
+        return expirationDate ? MAX(0.0, [expirationDate timeIntervalSinceDate:[self dateValue]]) : 0.0;
+    }
+
+    NSDate *lastModified = AFHTTPDateFromString([self valueForHTTPHeaderField:@"Last-Modified"]);
+    if (lastModified) {
+        return MIN(AFHTTPResponseCacheMaximumHeuristicFreshnessLifetime, MAX(0.0, [[self dateValue] timeIntervalSinceDate:lastModified] * 0.1));
+    }
+
+    return 0.0;
+}
+
+- (NSTimeInterval)ageAtDate:(NSDate *)date {
+    NSTimeInterval apparentAge = MAX(0.0, [self.responseDate timeIntervalSinceDate:[self dateValue]]);
+    NSTimeInterval responseDelay = MAX(0.0, [self.responseDate timeIntervalSinceDate:self.requestDate]);
+    NSTimeInterval correctedAgeValue = MAX(0.0, [[self valueForHTTPHeaderField:@"Age"] doubleValue]) + responseDelay;
+    NSTimeInterval correctedInitialAge = MAX(apparentAge, correctedAgeValue);
+    NSTimeInterval residentTime = MAX(0.0, [date timeIntervalSinceDate:self.responseDate]);
+
+    return correctedInitialAge + residentTime;
+}
+
+- (BOOL)isFreshAtDate:(NSDate *)date {
+    if (self.cacheControlDirectives[@"no-cache"]) {
+        return NO;
+    }
+
+    return [self ageAtDate:date] < self.freshnessLifetime;
+}
+
+- (BOOL)canBeServedWhileRevalidatingAtDate:(NSDate *)date {
+    NSString *staleWhileRevalidate = self.cacheControlDirectives[@"stale-while-revalidate"];
+    if (!staleWhileRevalidate || self.cacheControlDirectives[@"no-cache"] || self.cacheControlDirectives[@"must-revalidate"]) {
+        return NO;
+    }
+
+    return [self ageAtDate:date] - self.freshnessLifetime < [staleWhileRevalidate doubleValue];
+}
+
+- (BOOL)canBeServedAfterErrorAtDate:(NSDate *)date {
+    if ([self isFreshAtDate:date]) {
+        return YES;
+    }
+
+    NSString *staleIfError = self.cacheControlDirectives[@"stale-if-error"];
+    if (!staleIfError) {
+        return NO;
+    }
+
+    return [self ageAtDate:date] - self.freshnessLifetime < [staleIfError doubleValue];
+}
+
+- (BOOL)matchesVaryHeadersOfRequest:(NSURLRequest *)request {
+    for (NSString *field in self.varyHeaders) {
+        NSString *value = [request valueForHTTPHeaderField:field] ?: @"";
+        if (![value isEqualToString:self.varyHeaders[field]]) {
+            return NO;
+        }
+    }
+
+    return YES;
+}
+
+#pragma mark - NSSecureCoding
+
++ (BOOL)supportsSecureCoding {
+    return YES;
+}
+
+- (instancetype)initWithCoder:(NSCoder *)decoder {
+    NSSet *headerClasses = [NSSet setWithObjects:[NSDictionary class], [NSString class], nil];
+    NSURL *URL = [decoder decodeObjectOfClass:[NSURL class] forKey:NSStringFromSelector(@selector(URL))];
+    NSDictionary *headerFields = [decoder decodeObjectOfClasses:headerClasses forKey:NSStringFromSelector(@selector(allHeaderFields))];
+    NSInteger statusCode = [decoder decodeIntegerForKey:NSStringFromSelector(@selector(statusCode))];
+    if (!URL) {
+        return nil;
+    }
+
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+
+    return [self initWithResponse:response
+                             data:[decoder decodeObjectOfClass:[NSData class] forKey:NSStringFromSelector(@selector(data))]
+                      requestDate:[decoder decodeObjectOfClass:[NSDate class] forKey:NSStringFromSelector(@selector(requestDate))]
+                     responseDate:[decoder decodeObjectOfClass:[NSDate class] forKey:NSStringFromSelector(@selector(responseDate))]
+                              key:[decoder decodeObjectOfClass:[NSString class] forKey:NSStringFromSelector(@selector(key))]
+                      varyHeaders:[decoder decodeObjectOfClasses:headerClasses forKey:NSStringFromSelector(@selector(varyHeaders))]];
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.response.URL forKey:NSStringFromSelector(@selector(URL))];
+    [coder encodeObject:self.response.allHeaderFields forKey:NSStringFromSelector(@selector(allHeaderFields))];
+    [coder encodeInteger:self.response.statusCode forKey:NSStringFromSelector(@selector(statusCode))];
+    [coder encodeObject:self.data forKey:NSStringFromSelector(@selector(data))];
+    [coder encodeObject:self.requestDate forKey:NSStringFromSelector(@selector(requestDate))];
+    [coder encodeObject:self.responseDate forKey:NSStringFromSelector(@selector(responseDate))];
+    [coder encodeObject:self.key forKey:NSStringFromSelector(@selector(key))];
+    [coder encodeObject:self.varyHeaders forKey:NSStringFromSelector(@selector(varyHeaders))];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFHTTPResponseCacheDiskEntry : NSObject
+@property (nonatomic, assign) NSUInteger size;
+@property (nonatomic, strong) NSDate *accessDate;
+@end
+
+@implementation AFHTTPResponseCacheDiskEntry
+@end
+
+typedef struct {
+    NSUInteger hitCount;
+    NSUInteger staleHitCount;
+    NSUInteger missCount;
+    NSUInteger revalidationCount;
+    NSUInteger notModifiedCount;
+} AFHTTPResponseCacheStatistics;
+
+@interface AFHTTPResponseCache ()
+@property (readwrite, nonatomic, assign) NSUInteger memoryCapacity;
+@property (readwrite, nonatomic, assign) NSUInteger diskCapacity;
+@property (readwrite, nonatomic, copy) NSString *diskPath;
+@property (readwrite, nonatomic, strong) NSCache <NSString *, AFCachedHTTPResponse *> *memoryCache;
+@property (readwrite, nonatomic, strong) dispatch_queue_t ioQueue;
+@property (readwrite, nonatomic, strong) NSMutableDictionary <NSString *, AFHTTPResponseCacheDiskEntry *> *diskEntries;
+@property (readwrite, atomic, copy) NSString * (^cacheControlOverride)(NSURLRequest *request, NSHTTPURLResponse *response);
+@end
+
+@implementation AFHTTPResponseCache {
+    pthread_mutex_t _statisticsMutex;
+    pthread_mutex_t _diskEntriesMutex;
+    AFHTTPResponseCacheStatistics _statistics;
+    NSUInteger _currentDiskUsage;
+    BOOL _diskEntriesLoaded;
+}
+
+- (instancetype)init {
+    return [self initWithMemoryCapacity:4 * 1024 * 1024 diskCapacity:20 * 1024 * 1024 diskPath:nil];
+}
+
+- (instancetype)initWithMemoryCapacity:(NSUInteger)memoryCapacity
+                          diskCapacity:(NSUInteger)diskCapacity
+                              diskPath:(NSString *)path
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    self.memoryCapacity = memoryCapacity;
+    self.diskCapacity = diskCapacity;
+
+    if (memoryCapacity > 0) {
+        self.memoryCache = [[NSCache alloc] init];
+        self.memoryCache.totalCostLimit = memoryCapacity;
+    }
+
+    if (!path) {
+        NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) firstObject] ?: NSTemporaryDirectory();
+        path = [cachesDirectory stringByAppendingPathComponent:@"com.alamofire.httpresponsecache"];
+    }
+    self.diskPath = path;
+    self.diskEntries = [NSMutableDictionary dictionary];
+
+    pthread_mutex_init(&_statisticsMutex, NULL);
+    pthread_mutex_init(&_diskEntriesMutex, NULL);
+
+    NSString *name = [NSString stringWithFormat:@"com.alamofire.httpresponsecache.io-%@", [[NSUUID UUID] UUIDString]];
+    self.ioQueue = dispatch_queue_create([name cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_SERIAL);
+
+    if (diskCapacity > 0) {
+        dispatch_async(self.ioQueue, ^{
+            [self loadDiskEntries];
+        });
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_statisticsMutex);
+    pthread_mutex_destroy(&_diskEntriesMutex);
+}
+
+- (void)setCacheControlOverrideBlock:(NSString * (^)(NSURLRequest *request, NSHTTPURLResponse *response))block {
+    self.cacheControlOverride = block;
+}
+
+#pragma mark - Statistics
+
+- (AFHTTPResponseCacheStatistics)statistics {
+    pthread_mutex_lock(&_statisticsMutex);
+    AFHTTPResponseCacheStatistics statistics = _statistics;
+    pthread_mutex_unlock(&_statisticsMutex);
+
+    return statistics;
+}
+
+- (NSUInteger)hitCount {
+    return [self statistics].hitCount;
+}
+
+- (NSUInteger)staleHitCount {
+    return [self statistics].staleHitCount;
+}
+
+- (NSUInteger)missCount {
+    return [self statistics].missCount;
+}
+
+- (NSUInteger)revalidationCount {
+    return [self statistics].revalidationCount;
+}
+
+- (NSUInteger)notModifiedCount {
+    return [self statistics].notModifiedCount;
+}
+
+- (void)resetStatistics {
+    pthread_mutex_lock(&_statisticsMutex);
+    memset(&_statistics, 0, sizeof(_statistics));
+    pthread_mutex_unlock(&_statisticsMutex);
+}
+
+#pragma mark - Lookup
+
+- (AFHTTPResponseCacheLookupResult)lookupResponseForRequest:(NSURLRequest *)request
+                                             cachedResponse:(AFCachedHTTPResponse * __autoreleasing *)cachedResponse
+{
+    AFCachedHTTPResponse *storedResponse = nil;
+    if ([self canLookUpRequest:request]) {
+        NSString *key = AFHTTPResponseCacheKeyForURL(request.URL);
+        storedResponse = [self.memoryCache objectForKey:key];
+        if (!storedResponse && [self mayStoreResponseOnDiskForKey:key]) {
+            if (cachedResponse) {
+                *cachedResponse = nil;
+            }
+
+            return AFHTTPResponseCacheLookupStoredOnDisk;
+        }
+    }
+
+    return [self lookupStoredResponse:storedResponse forRequest:request cachedResponse:cachedResponse];
+}
+
+- (void)lookupResponseOnDiskForRequest:(NSURLRequest *)request
+                     completionHandler:(void (^)(AFHTTPResponseCacheLookupResult result, AFCachedHTTPResponse *cachedResponse))completionHandler
+{
+    BOOL canLookUpRequest = [self canLookUpRequest:request];
+    NSString *key = AFHTTPResponseCacheKeyForURL(request.URL);
+
+    // Reads are queued after the writes and removals already requested, so that they never see an entry that was replaced or removed.
+    dispatch_async(self.ioQueue, ^{
+        AFCachedHTTPResponse *storedResponse = nil;
+        if (canLookUpRequest) {
+            storedResponse = [self.memoryCache objectForKey:key] ?: [self diskCachedResponseForKey:key];
+        }
+
+        AFCachedHTTPResponse *cachedResponse = nil;
+        AFHTTPResponseCacheLookupResult result = [self lookupStoredResponse:storedResponse forRequest:request cachedResponse:&cachedResponse];
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            completionHandler(result, cachedResponse);
+        });
+    });
+}
+
+- (BOOL)canLookUpRequest:(NSURLRequest *)request {
+    return [request.HTTPMethod ?: @"GET" isEqualToString:@"GET"] && request.cachePolicy != NSURLRequestReloadIgnoringLocalCacheData;
+}
+
+- (AFHTTPResponseCacheLookupResult)lookupStoredResponse:(AFCachedHTTPResponse *)storedResponse
+                                             forRequest:(NSURLRequest *)request
+                                         cachedResponse:(AFCachedHTTPResponse * __autoreleasing *)cachedResponse
+{
+    if (![storedResponse matchesVaryHeadersOfRequest:request]) {
+        storedResponse = nil;
+    }
+
+    if (cachedResponse) {
+        *cachedResponse = storedResponse;
+    }
+
+    AFHTTPResponseCacheLookupResult result = AFHTTPResponseCacheLookupMiss;
+    if (storedResponse) {
+        NSDate *now = [NSDate date];
+        NSDictionary *requestDirectives = AFHTTPCacheControlDirectives([request valueForHTTPHeaderField:@"Cache-Control"]);
+        NSString *requestMaxAge = requestDirectives[@"max-age"];
+        BOOL requiresRevalidation = requestDirectives[@"no-cache"] || [[request valueForHTTPHeaderField:@"Pragma"] rangeOfString:@"no-cache" options:NSCaseInsensitiveSearch].location != NSNotFound || (requestMaxAge && [storedResponse ageAtDate:now] >= [requestMaxAge doubleValue]);
+
+        if (!requiresRevalidation && [storedResponse isFreshAtDate:now]) {
+            result = AFHTTPResponseCacheLookupFresh;
+        } else if (!requiresRevalidation && [storedResponse canBeServedWhileRevalidatingAtDate:now]) {
+            result = AFHTTPResponseCacheLookupStale;
+        } else {
+            result = AFHTTPResponseCacheLookupRequiresRevalidation;
+        }
+    }
+
+    pthread_mutex_lock(&_statisticsMutex);
+    switch (result) {
+        case AFHTTPResponseCacheLookupMiss:
+            _statistics.missCount++;
+            break;
+        case AFHTTPResponseCacheLookupFresh:
+            _statistics.hitCount++;
+            break;
+        case AFHTTPResponseCacheLookupStale:
+            _statistics.staleHitCount++;
+            _statistics.revalidationCount++;
+            break;
+        case AFHTTPResponseCacheLookupRequiresRevalidation:
+            _statistics.revalidationCount++;
+            break;
+        case AFHTTPResponseCacheLookupStoredOnDisk:
+            break;
+    }
+    pthread_mutex_unlock(&_statisticsMutex);
+
+    return result;
+}
+
+- (NSURLRequest *)conditionalRequestForRequest:(NSURLRequest *)request
+                                cachedResponse:(AFCachedHTTPResponse *)cachedResponse
+{
+    NSMutableURLRequest *mutableRequest = [request mutableCopy];
+    // Revalidation is handled here, so it must not be answered by NSURLCache
+    mutableRequest.cachePolicy = NSURLRequestReloadIgnoringLocalCacheData;
+
+    NSString *entityTag = [cachedResponse valueForHTTPHeaderField:@"ETag"];
+    if (entityTag && ![request valueForHTTPHeaderField:@"If-None-Match"]) {
+        [mutableRequest setValue:entityTag forHTTPHeaderField:@"If-None-Match"];
+    }
+
+    NSString *lastModified = [cachedResponse valueForHTTPHeaderField:@"Last-Modified"];
+    if (lastModified && ![request valueForHTTPHeaderField:@"If-Modified-Since"]) {
+        [mutableRequest setValue:lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+
+    return mutableRequest;
+}
+
+#pragma mark - Storage
+
+- (NSHTTPURLResponse *)response:(NSHTTPURLResponse *)response withHeaderFields:(NSDictionary *)headerFields {
+    return [[NSHTTPURLResponse alloc] initWithURL:response.URL statusCode:response.statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+}
+
+- (NSHTTPURLResponse *)response:(NSHTTPURLResponse *)response settingValue:(NSString *)value forHTTPHeaderField:(NSString *)field inHeaderFields:(NSMutableDictionary *)headerFields {
+    for (NSString *key in [headerFields allKeys]) {
+        if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+            [headerFields removeObjectForKey:key];
+        }
+    }
+    headerFields[field] = value;
+
+    return [self response:response withHeaderFields:headerFields];
+}
+
+- (AFCachedHTTPResponse *)cachedResponseWithResponse:(NSHTTPURLResponse *)response
+                                                data:(NSData *)data
+                                          forRequest:(NSURLRequest *)request
+                                         requestDate:(NSDate *)requestDate
+{
+    NSString * (^cacheControlOverride)(NSURLRequest *, NSHTTPURLResponse *) = self.cacheControlOverride;
+    NSString *cacheControl = cacheControlOverride ? cacheControlOverride(request, response) : nil;
+    if (cacheControl) {
+        response = [self response:response settingValue:cacheControl forHTTPHeaderField:@"Cache-Control" inHeaderFields:[response.allHeaderFields mutableCopy]];
+    }
+
+    NSMutableDictionary *varyHeaders = [NSMutableDictionary dictionary];
+    NSString *vary = AFHTTPHeaderFieldValue(response.allHeaderFields, @"Vary");
+    for (NSString *component in [vary componentsSeparatedByString:@","]) {
+        NSString *field = [[component stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+        if ([field isEqualToString:@"*"]) {
+            return nil;
+        } else if (field.length > 0) {
+            varyHeaders[field] = [request valueForHTTPHeaderField:field] ?: @"";
+        }
+    }
+
+    return [[AFCachedHTTPResponse alloc] initWithResponse:response
+                                                     data:data
+                                              requestDate:requestDate
+                                             responseDate:[NSDate date]
+                                                      key:AFHTTPResponseCacheKeyForURL(request.URL)
+                                              varyHeaders:varyHeaders];
+}
+
+- (AFCachedHTTPResponse *)storeResponse:(NSHTTPURLResponse *)response
+                                   data:(NSData *)data
+                             forRequest:(NSURLRequest *)request
+                            requestDate:(NSDate *)requestDate
+{
+    if (![request.HTTPMethod ?: @"GET" isEqualToString:@"GET"]) {
+        return nil;
+    }
+
+    NSString *key = AFHTTPResponseCacheKeyForURL(request.URL);
+    AFCachedHTTPResponse *cachedResponse = [self cachedResponseWithResponse:response data:data forRequest:request requestDate:requestDate];
+
+    BOOL cacheable = cachedResponse && AFHTTPStatusCodeIsCacheable(response.statusCode);
+    cacheable = cacheable && !AFHTTPCacheControlDirectives([request valueForHTTPHeaderField:@"Cache-Control"])[@"no-store"];
+    cacheable = cacheable && !cachedResponse.cacheControlDirectives[@"no-store"];
+    cacheable = cacheable && (cachedResponse.freshnessLifetime > 0.0 || [cachedResponse valueForHTTPHeaderField:@"ETag"] || [cachedResponse valueForHTTPHeaderField:@"Last-Modified"]);
+    // Like NSURLCache, do not let a single response take more than 5% of the cache
+    cacheable = cacheable && data.length <= MAX(self.memoryCapacity, self.diskCapacity) / 20;
+
+    if (!cacheable) {
+        [self removeCachedResponseForKey:key];
+        return nil;
+    }
+
+    [self storeCachedResponse:cachedResponse forKey:key];
+
+    return cachedResponse;
+}
+
+- (AFCachedHTTPResponse *)updateCachedResponse:(AFCachedHTTPResponse *)cachedResponse
+                       withNotModifiedResponse:(NSHTTPURLResponse *)response
+                                    forRequest:(NSURLRequest *)request
+                                   requestDate:(NSDate *)requestDate
+{
+    NSMutableDictionary *headerFields = [cachedResponse.response.allHeaderFields mutableCopy];
+    [response.allHeaderFields enumerateKeysAndObjectsUsingBlock:^(NSString *field, NSString *value, __unused BOOL *stop) {
+        if ([field caseInsensitiveCompare:@"Content-Length"] == NSOrderedSame) {
+            return;
+        }
+
+        for (NSString *key in [headerFields allKeys]) {
+            if ([key caseInsensitiveCompare:field] == NSOrderedSame) {
+                [headerFields removeObjectForKey:key];
+            }
+        }
+        headerFields[field] = value;
+    }];
+
+    NSHTTPURLResponse *updatedResponse = [self response:cachedResponse.response withHeaderFields:headerFields];
+    AFCachedHTTPResponse *updatedCachedResponse = [self cachedResponseWithResponse:updatedResponse data:cachedResponse.data forRequest:request requestDate:requestDate];
+    if (updatedCachedResponse) {
+        [self storeCachedResponse:updatedCachedResponse forKey:updatedCachedResponse.key];
+    } else {
+        updatedCachedResponse = cachedResponse;
+    }
+
+    pthread_mutex_lock(&_statisticsMutex);
+    _statistics.notModifiedCount++;
+    pthread_mutex_unlock(&_statisticsMutex);
+
+    return updatedCachedResponse;
+}
+
+- (void)removeCachedResponseForURL:(NSURL *)URL {
+    [self removeCachedResponseForKey:AFHTTPResponseCacheKeyForURL(URL)];
+}
+
+- (void)removeAllCachedResponses {
+    [self.memoryCache removeAllObjects];
+
+    dispatch_async(self.ioQueue, ^{
+        [[NSFileManager defaultManager] removeItemAtPath:self.diskPath error:nil];
+        pthread_mutex_lock(&self->_diskEntriesMutex);
+        [self.diskEntries removeAllObjects];
+        pthread_mutex_unlock(&self->_diskEntriesMutex);
+        self->_currentDiskUsage = 0;
+    });
+}
+
+#pragma mark - Memory and Disk Tiers
+
+// The disk entries are only changed on the ioQueue, under the disk entries mutex, so that they can be checked from any thread.
+- (BOOL)mayStoreResponseOnDiskForKey:(NSString *)key {
+    if (self.diskCapacity == 0) {
+        return NO;
+    }
+
+    pthread_mutex_lock(&_diskEntriesMutex);
+    BOOL mayStoreResponse = !_diskEntriesLoaded || self.diskEntries[AFHTTPResponseCacheFileNameForKey(key)] != nil;
+    pthread_mutex_unlock(&_diskEntriesMutex);
+
+    return mayStoreResponse;
+}
+
+//This method should only be called from safely within the ioQueue
+- (AFCachedHTTPResponse *)diskCachedResponseForKey:(NSString *)key {
+    if (self.diskCapacity == 0) {
+        return nil;
+    }
+
+    NSString *fileName = AFHTTPResponseCacheFileNameForKey(key);
+    AFHTTPResponseCacheDiskEntry *entry = self.diskEntries[fileName];
+    if (!entry) {
+        return nil;
+    }
+
+    NSData *archive = [NSData dataWithContentsOfFile:[self.diskPath stringByAppendingPathComponent:fileName]];
+    if (!archive) {
+        return nil;
+    }
+
+    AFCachedHTTPResponse *diskResponse = nil;
+    @try {
+        NSKeyedUnarchiver *unarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:archive];
+        unarchiver.requiresSecureCoding = YES;
+        diskResponse = [unarchiver decodeObjectOfClass:[AFCachedHTTPResponse class] forKey:AFHTTPResponseCacheArchiveKey];
+        [unarchiver finishDecoding];
+    } @catch (__unused NSException *exception) {
+        diskResponse = nil;
+    }
+
+    if (![diskResponse.key isEqualToString:key]) {
+        return nil;
+    }
+
+    entry.accessDate = [NSDate date];
+    [self.memoryCache setObject:diskResponse forKey:key cost:diskResponse.data.length];
+
+    return diskResponse;
+}
+
+- (void)storeCachedResponse:(AFCachedHTTPResponse *)cachedResponse forKey:(NSString *)key {
+    [self.memoryCache setObject:cachedResponse forKey:key cost:cachedResponse.data.length];
+
+    if (self.diskCapacity == 0) {
+        return;
+    }
+
+    dispatch_async(self.ioQueue, ^{
+        NSMutableData *archive = [NSMutableData data];
+        NSKeyedArchiver *archiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:archive];
+        archiver.requiresSecureCoding = YES;
+        [archiver encodeObject:cachedResponse forKey:AFHTTPResponseCacheArchiveKey];
+        [archiver finishEncoding];
+        NSString *fileName = AFHTTPResponseCacheFileNameForKey(key);
+
+        [[NSFileManager defaultManager] createDirectoryAtPath:self.diskPath withIntermediateDirectories:YES attributes:nil error:nil];
+        if (![archive writeToFile:[self.diskPath stringByAppendingPathComponent:fileName] atomically:YES]) {
+            return;
+        }
+
+        [self removeDiskEntryWithFileName:fileName deletingFile:NO];
+
+        AFHTTPResponseCacheDiskEntry *entry = [[AFHTTPResponseCacheDiskEntry alloc] init];
+        entry.size = archive.length;
+        entry.accessDate = [NSDate date];
+        pthread_mutex_lock(&self->_diskEntriesMutex);
+        self.diskEntries[fileName] = entry;
+        pthread_mutex_unlock(&self->_diskEntriesMutex);
+        self->_currentDiskUsage += entry.size;
+
+        [self trimDiskToCapacity];
+    });
+}
+
+- (void)removeCachedResponseForKey:(NSString *)key {
+    [self.memoryCache removeObjectForKey:key];
+
+    if (self.diskCapacity == 0) {
+        return;
+    }
+
+    dispatch_async(self.ioQueue, ^{
+        [self removeDiskEntryWithFileName:AFHTTPResponseCacheFileNameForKey(key) deletingFile:YES];
+    });
+}
+
+//This method should only be called from safely within the ioQueue
+- (void)removeDiskEntryWithFileName:(NSString *)fileName deletingFile:(BOOL)deletingFile {
+    AFHTTPResponseCacheDiskEntry *entry = self.diskEntries[fileName];
+    if (!entry) {
+        return;
+    }
+
+    if (deletingFile) {
+        [[NSFileManager defaultManager] removeItemAtPath:[self.diskPath stringByAppendingPathComponent:fileName] error:nil];
+    }
+
+    pthread_mutex_lock(&_diskEntriesMutex);
+    [self.diskEntries removeObjectForKey:fileName];
+    pthread_mutex_unlock(&_diskEntriesMutex);
+    _currentDiskUsage -= MIN(_currentDiskUsage, entry.size);
+}
+
+//This method should only be called from safely within the ioQueue
+- (void)trimDiskToCapacity {
+    if (_currentDiskUsage <= self.diskCapacity) {
+        return;
+    }
+
+    uint64_t traceBeginTime = AFTraceBegin();
+    NSArray <NSString *> *fileNames = [self.diskEntries keysSortedByValueUsingComparator:^NSComparisonResult(AFHTTPResponseCacheDiskEntry *firstEntry, AFHTTPResponseCacheDiskEntry *secondEntry) {
+        return [firstEntry.accessDate compare:secondEntry.accessDate];
+    }];
+
+    for (NSString *fileName in fileNames) {
+        if (_currentDiskUsage <= self.diskCapacity) {
+            break;
+        }
+
+        [self removeDiskEntryWithFileName:fileName deletingFile:YES];
+    }
+    AFTraceEnd(traceBeginTime, "response cache disk purge", "cache");
+}
+
+//This method should only be called from safely within the ioQueue
+- (void)loadDiskEntries {
+    NSArray *keys = @[NSURLFileSizeKey, NSURLContentModificationDateKey];
+    NSArray <NSURL *> *fileURLs = [[NSFileManager defaultManager] contentsOfDirectoryAtURL:[NSURL fileURLWithPath:self.diskPath isDirectory:YES] includingPropertiesForKeys:keys options:NSDirectoryEnumerationSkipsHiddenFiles error:nil];
+
+    for (NSURL *fileURL in fileURLs) {
+        NSDictionary *resourceValues = [fileURL resourceValuesForKeys:keys error:nil];
+        NSString *fileName = [fileURL lastPathComponent];
+        if (self.diskEntries[fileName]) {
+            continue;
+        }
+
+        AFHTTPResponseCacheDiskEntry *entry = [[AFHTTPResponseCacheDiskEntry alloc] init];
+        entry.size = [resourceValues[NSURLFileSizeKey] unsignedIntegerValue];
+        entry.accessDate = resourceValues[NSURLContentModificationDateKey] ?: [NSDate distantPast];
+        pthread_mutex_lock(&_diskEntriesMutex);
+        self.diskEntries[fileName] = entry;
+        pthread_mutex_unlock(&_diskEntriesMutex);
+        _currentDiskUsage += entry.size;
+    }
+
+    pthread_mutex_lock(&_diskEntriesMutex);
+    _diskEntriesLoaded = YES;
+    pthread_mutex_unlock(&_diskEntriesMutex);
+
+    [self trimDiskToCapacity];
+}
+
+- (NSUInteger)currentDiskUsage {
+    __block NSUInteger currentDiskUsage = 0;
+    dispatch_sync(self.ioQueue, ^{
+        currentDiskUsage = self->_currentDiskUsage;
+    });
+
+    return currentDiskUsage;
+}
+
+@end
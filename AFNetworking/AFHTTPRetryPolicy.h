@@ -0,0 +1,142 @@
+// AFHTTPRetryPolicy.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import <Foundation/Foundation.h>
+
+/**
+ `AFHTTPRetryPolicy` decides whether a failed request should be attempted again, and how long to wait before doing so.
+
+ By default, requests with an idempotent method are retried after transient network errors and `429` or `5xx` responses, up to three attempts in total. Delays grow exponentially with full jitter, unless the server asks for a specific delay with a `Retry-After` header. All attempts of a request share a single deadline.
+
+ A policy can also hedge `GET` requests: when the first attempt takes longer than the 95th percentile of recently observed latencies, a second identical attempt is started, and whichever finishes successfully first wins.
+ */
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface AFHTTPRetryPolicy : NSObject <NSCopying>
+
+/**
+ The maximum number of attempts for a request, including the first one. `3` by default.
+ */
+@property (nonatomic, assign) NSUInteger maximumNumberOfAttempts;
+
+/**
+ The HTTP methods of requests that may be retried. `GET`, `HEAD`, `OPTIONS`, `TRACE`, `PUT` and `DELETE` by default.
+ */
+@property (nonatomic, copy) NSSet <NSString *> *retriableHTTPMethods;
+
+/**
+ The HTTP status codes of responses that are retried. `429` and `500` through `599` by default.
+ */
+@property (nonatomic, copy) NSIndexSet *retriableStatusCodes;
+
+/**
+ The `NSURLErrorDomain` error codes that are retried. By default, these are the codes of transient errors: timeouts, lost connections, and failures to look up or connect to the host.
+ */
+@property (nonatomic, copy) NSSet <NSNumber *> *retriableURLErrorCodes;
+
+/**
+ The upper bound of the delay before the first retry. Each following retry doubles it, up to `maximumDelay`. The actual delay is chosen uniformly between zero and that bound. `0.5` seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval baseDelay;
+
+/**
+ The maximum delay before any retry. `30` seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval maximumDelay;
+
+/**
+ Whether the delay requested by a `Retry-After` response header is used instead of the computed delay. `YES` by default.
+ */
+@property (nonatomic, assign) BOOL respectsRetryAfterHeader;
+
+/**
+ The total time, in seconds, that all attempts of a request may take. No retry is scheduled if it could not start before the deadline, and attempts still running when it passes are cancelled, failing the request with an `NSURLErrorTimedOut` error. `60` seconds by default; `0` means no deadline.
+ */
+@property (nonatomic, assign) NSTimeInterval deadline;
+
+///-------------------------
+/// @name Hedging Requests
+///-------------------------
+
+/**
+ Whether a second attempt of a `GET` request is started when the first one is slower than usual. `NO` by default.
+ */
+@property (nonatomic, assign) BOOL hedgesRequests;
+
+/**
+ The delay used before hedging while too few latencies have been observed, and the minimum hedging delay afterwards. `0.1` seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval minimumHedgingDelay;
+
+/**
+ The delay after which a hedged attempt is started: the 95th percentile of recently observed latencies, or `minimumHedgingDelay` if that is longer.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval hedgingDelay;
+
+/**
+ Records the latency of a successful attempt, which is used to compute `hedgingDelay`.
+
+ @param latency The time between the start and the completion of the attempt, in seconds.
+ */
+- (void)recordLatency:(NSTimeInterval)latency;
+
+///------------------------------
+/// @name Creating Retry Policies
+///------------------------------
+
+/**
+ Returns a retry policy with the default settings.
+ */
++ (instancetype)defaultPolicy;
+
+///------------------------
+/// @name Retrying Requests
+///------------------------
+
+/**
+ Returns whether a failed attempt of the specified request should be retried. Only the method of the request, the status code of the response and the error are considered, not the number of attempts or the deadline.
+
+ @param request The request that failed.
+ @param response The response received for the request, if any.
+ @param error The error that occurred.
+
+ @return `YES` if the request should be attempted again, `NO` otherwise.
+ */
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request
+                  response:(nullable NSURLResponse *)response
+                     error:(NSError *)error;
+
+/**
+ Returns the delay before the specified retry.
+
+ @param retryCount The number of the retry, starting at `1` for the second attempt.
+ @param response The response that caused the retry, if any. Its `Retry-After` header is used when `respectsRetryAfterHeader` is `YES`.
+
+ @return The delay, in seconds.
+ */
+- (NSTimeInterval)delayBeforeRetry:(NSUInteger)retryCount
+                          response:(nullable NSURLResponse *)response;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,191 @@
+// AFHTTPRetryPolicy.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "AFHTTPRetryPolicy.h"
+
+#import <pthread.h>
+
+enum {
+    AFHTTPRetryPolicyLatencySampleCount = 64,
+    AFHTTPRetryPolicyMinimumLatencySampleCount = 16,
+};
+
+static NSDateFormatter * AFHTTPRetryAfterDateFormatter() {
+    static NSDateFormatter *dateFormatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        dateFormatter = [[NSDateFormatter alloc] init];
+        dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+        dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+        dateFormatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+
+    return dateFormatter;
+}
+
+static int AFCompareTimeIntervals(const void *a, const void *b) {
+    NSTimeInterval first = *(const NSTimeInterval *)a;
+    NSTimeInterval second = *(const NSTimeInterval *)b;
+
+    return (first > second) - (first < second);
+}
+
+@implementation AFHTTPRetryPolicy {
+    pthread_mutex_t _latencyMutex;
+    NSTimeInterval _latencies[AFHTTPRetryPolicyLatencySampleCount];
+    NSUInteger _latencyCount;
+    NSUInteger _nextLatencyIndex;
+}
+
++ (instancetype)defaultPolicy {
+    return [[self alloc] init];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    self.maximumNumberOfAttempts = 3;
+    self.retriableHTTPMethods = [NSSet setWithObjects:@"GET", @"HEAD", @"OPTIONS", @"TRACE", @"PUT", @"DELETE", nil];
+
+    NSMutableIndexSet *statusCodes = [NSMutableIndexSet indexSetWithIndex:429];
+    [statusCodes addIndexesInRange:NSMakeRange(500, 100)];
+    self.retriableStatusCodes = statusCodes;
+
+    self.retriableURLErrorCodes = [NSSet setWithObjects:@(NSURLErrorTimedOut), @(NSURLErrorCannotFindHost), @(NSURLErrorCannotConnectToHost), @(NSURLErrorNetworkConnectionLost), @(NSURLErrorDNSLookupFailed), @(NSURLErrorNotConnectedToInternet), nil];
+
+    self.baseDelay = 0.5;
+    self.maximumDelay = 30.0;
+    self.respectsRetryAfterHeader = YES;
+    self.deadline = 60.0;
+    self.minimumHedgingDelay = 0.1;
+
+    pthread_mutex_init(&_latencyMutex, NULL);
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_latencyMutex);
+}
+
+#pragma mark -
+
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request
+                  response:(NSURLResponse *)response
+                     error:(NSError *)error
+{
+    if (![self.retriableHTTPMethods containsObject:[request.HTTPMethod uppercaseString]]) {
+        return NO;
+    }
+
+    if ([error.domain isEqualToString:NSURLErrorDomain] && [self.retriableURLErrorCodes containsObject:@(error.code)]) {
+        return YES;
+    }
+
+    if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+        return [self.retriableStatusCodes containsIndex:(NSUInteger)((NSHTTPURLResponse *)response).statusCode];
+    }
+
+    return NO;
+}
+
+- (NSTimeInterval)delayBeforeRetry:(NSUInteger)retryCount
+                          response:(NSURLResponse *)response
+{
+    if (self.respectsRetryAfterHeader && [response isKindOfClass:[NSHTTPURLResponse class]]) {
+        NSString *retryAfter = ((NSHTTPURLResponse *)response).allHeaderFields[@"Retry-After"];
+        if (retryAfter) {
+            NSTimeInterval delay = -1.0;
+            NSScanner *scanner = [NSScanner scannerWithString:retryAfter];
+            NSInteger seconds = 0;
+            if ([scanner scanInteger:&seconds] && [scanner isAtEnd]) {
+                delay = (NSTimeInterval)seconds;
+            } else {
+                NSDate *date = [AFHTTPRetryAfterDateFormatter() dateFromString:retryAfter];
+                if (date) {
+                    delay = [date timeIntervalSinceNow];
+                }
+            }
+
+            if (delay >= 0.0) {
+                return delay;
+            }
+        }
+    }
+
+    // Full jitter: a uniformly random delay up to the exponentially growing bound
+    double exponent = (double)MIN(retryCount, (NSUInteger)32) - 1.0;
+    NSTimeInterval bound = MIN(self.maximumDelay, self.baseDelay * pow(2.0, MAX(exponent, 0.0)));
+
+    return bound * ((double)arc4random() / (double)UINT32_MAX);
+}
+
+#pragma mark -
+
+- (void)recordLatency:(NSTimeInterval)latency {
+    pthread_mutex_lock(&_latencyMutex);
+    _latencies[_nextLatencyIndex] = latency;
+    _nextLatencyIndex = (_nextLatencyIndex + 1) % AFHTTPRetryPolicyLatencySampleCount;
+    _latencyCount = MIN(_latencyCount + 1, (NSUInteger)AFHTTPRetryPolicyLatencySampleCount);
+    pthread_mutex_unlock(&_latencyMutex);
+}
+
+- (NSTimeInterval)hedgingDelay {
+    NSTimeInterval latencies[AFHTTPRetryPolicyLatencySampleCount];
+
+    pthread_mutex_lock(&_latencyMutex);
+    NSUInteger count = _latencyCount;
+    memcpy(latencies, _latencies, sizeof(latencies));
+    pthread_mutex_unlock(&_latencyMutex);
+
+    if (count < AFHTTPRetryPolicyMinimumLatencySampleCount) {
+        return self.minimumHedgingDelay;
+    }
+
+    qsort(latencies, count, sizeof(NSTimeInterval), AFCompareTimeIntervals);
+    NSUInteger index = MIN(count - 1, (NSUInteger)ceil(0.95 * (double)count) - 1);
+
+    return MAX(self.minimumHedgingDelay, latencies[index]);
+}
+
+#pragma mark - NSCopying
+
+- (instancetype)copyWithZone:(NSZone *)zone {
+    AFHTTPRetryPolicy *policy = [[[self class] allocWithZone:zone] init];
+    policy.maximumNumberOfAttempts = self.maximumNumberOfAttempts;
+    policy.retriableHTTPMethods = self.retriableHTTPMethods;
+    policy.retriableStatusCodes = self.retriableStatusCodes;
+    policy.retriableURLErrorCodes = self.retriableURLErrorCodes;
+    policy.baseDelay = self.baseDelay;
+    policy.maximumDelay = self.maximumDelay;
+    policy.respectsRetryAfterHeader = self.respectsRetryAfterHeader;
+    policy.deadline = self.deadline;
+    policy.hedgesRequests = self.hedgesRequests;
+    policy.minimumHedgingDelay = self.minimumHedgingDelay;
+
+    return policy;
+}
+
+@end
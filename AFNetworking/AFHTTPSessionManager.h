@@ -32,6 +32,8 @@
 #endif
 
 #import "AFURLSessionManager.h"
+#import "AFHTTPRetryPolicy.h"
+#import "AFHTTPResponseCache.h"
 
 /**
  `AFHTTPSessionManager` is a subclass of `AFURLSessionManager` with convenience methods for making HTTP requests. When a `baseURL` is provided, requests made with the `GET` / `POST` / et al. convenience methods can be made with relative paths.
@@ -73,6 +75,23 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ The `AFHTTPSharedRequestReceipt` is an object vended by the `AFHTTPSessionManager` when starting a shared request. Several receipts may refer to the same data task, so shared requests should be cancelled using `-cancelSharedRequestForReceipt:` instead of calling `cancel` directly on the `task` itself.
+ */
+@interface AFHTTPSharedRequestReceipt : NSObject
+
+/**
+ The data task shared by all identical in-flight requests.
+ */
+@property (readonly, nonatomic, strong) NSURLSessionDataTask *task;
+
+/**
+ The unique identifier for the success and failure blocks of this request.
+ */
+@property (readonly, nonatomic, strong) NSUUID *receiptID;
+
+@end
+
 @interface AFHTTPSessionManager : AFURLSessionManager <NSSecureCoding, NSCopying>
 
 /**
@@ -103,6 +122,32 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, strong) AFSecurityPolicy *securityPolicy;
 
+///------------------------
+/// @name Retrying Requests
+///------------------------
+
+/**
+ The policy used to retry, and optionally hedge, requests made with the `GET` / `POST` / et al. convenience methods. `nil` by default, in which case requests are never retried.
+
+ The request is serialized once, and every attempt reuses it. The task returned by a convenience method is the first attempt; success and failure blocks are passed the task of the attempt that finished the request. Cancelling the returned task only stops the request while its first attempt is running.
+
+ Multipart `POST` requests are not retried, since their body streams cannot be replayed.
+ */
+@property (nonatomic, strong, nullable) AFHTTPRetryPolicy *retryPolicy;
+
+///------------------------
+/// @name Caching Responses
+///------------------------
+
+/**
+ The cache through which `GET` requests made with the convenience methods are served, in place of `NSURLCache`. `nil` by default.
+
+ A fresh stored response is passed to the success block without contacting the server; no task is created, so `nil` is returned and passed to the block. A stale response within its `stale-while-revalidate` window is served the same way, while it is revalidated in the background. Responses that are not in the memory tier are read from disk without blocking the calling thread; `nil` is then returned, and the task started once the response is read, if any, is passed to the blocks. Other stored responses are revalidated before being used, and a `304 Not Modified` reply reuses the stored body. A stored response within its `stale-if-error` window is served when revalidation fails with a network error or a `5xx` status. Successful requests with other methods remove the response stored for their URL.
+
+ Requests served through the cache are not retried by `retryPolicy`.
+ */
+@property (nonatomic, strong, nullable) AFHTTPResponseCache *responseCache;
+
 ///---------------------
 /// @name Initialization
 ///---------------------
@@ -143,14 +188,16 @@ NS_ASSUME_NONNULL_BEGIN
 
  @param URLString The URL string used to create the request URL.
  @param parameters The parameters to be encoded according to the client request serializer.
- @param success A block object to be executed when the task finishes successfully. This block has no return value and takes two arguments: the data task, and the response object created by the client response serializer.
+ @param success A block object to be executed when the task finishes successfully. This block has no return value and takes two arguments: the data task, or `nil` if the response was served by `responseCache` without a task, and the response object created by the client response serializer.
  @param failure A block object to be executed when the task finishes unsuccessfully, or that finishes successfully, but encountered an error while parsing the response data. This block has no return value and takes a two arguments: the data task and the error describing the network or parsing error that occurred.
 
+ @return The data task, or `nil` if the request could not be serialized, or is served by `responseCache` without a task.
+
  @see -dataTaskWithRequest:completionHandler:
  */
 - (nullable NSURLSessionDataTask *)GET:(NSString *)URLString
                    parameters:(nullable id)parameters
-                      success:(nullable void (^)(NSURLSessionDataTask *task, id _Nullable responseObject))success
+                      success:(nullable void (^)(NSURLSessionDataTask * _Nullable task, id _Nullable responseObject))success
                       failure:(nullable void (^)(NSURLSessionDataTask * _Nullable task, NSError *error))failure DEPRECATED_ATTRIBUTE;
 
 
@@ -160,15 +207,17 @@ NS_ASSUME_NONNULL_BEGIN
  @param URLString The URL string used to create the request URL.
  @param parameters The parameters to be encoded according to the client request serializer.
  @param downloadProgress A block object to be executed when the download progress is updated. Note this block is called on the session queue, not the main queue.
- @param success A block object to be executed when the task finishes successfully. This block has no return value and takes two arguments: the data task, and the response object created by the client response serializer.
+ @param success A block object to be executed when the task finishes successfully. This block has no return value and takes two arguments: the data task, or `nil` if the response was served by `responseCache` without a task, and the response object created by the client response serializer.
  @param failure A block object to be executed when the task finishes unsuccessfully, or that finishes successfully, but encountered an error while parsing the response data. This block has no return value and takes a two arguments: the data task and the error describing the network or parsing error that occurred.
 
+ @return The data task, or `nil` if the request could not be serialized, or is served by `responseCache` without a task.
+
  @see -dataTaskWithRequest:uploadProgress:downloadProgress:completionHandler:
  */
 - (nullable NSURLSessionDataTask *)GET:(NSString *)URLString
                             parameters:(nullable id)parameters
                               progress:(nullable void (^)(NSProgress *downloadProgress))downloadProgress
-                               success:(nullable void (^)(NSURLSessionDataTask *task, id _Nullable responseObject))success
+                               success:(nullable void (^)(NSURLSessionDataTask * _Nullable task, id _Nullable responseObject))success
                                failure:(nullable void (^)(NSURLSessionDataTask * _Nullable task, NSError *error))failure;
 
 /**
@@ -299,6 +348,51 @@ NS_ASSUME_NONNULL_BEGIN
                          success:(nullable void (^)(NSURLSessionDataTask *task, id _Nullable responseObject))success
                          failure:(nullable void (^)(NSURLSessionDataTask * _Nullable task, NSError *error))failure;
 
+///----------------------------------
+/// @name Making Shared HTTP Requests
+///----------------------------------
+
+/**
+ Runs a `GET` request, sharing a single data task with any identical request already in flight.
+
+ Requests are identical when their method, URL, header fields and cache policy are all equal. The response is serialized once, and the result is delivered to every request sharing the task, in the order they were made.
+
+ @param URLString The URL string used to create the request URL.
+ @param parameters The parameters to be encoded according to the client request serializer.
+ @param success A block object to be executed when the task finishes successfully. This block has no return value and takes two arguments: the shared data task, and the response object created by the client response serializer.
+ @param failure A block object to be executed when the task finishes unsuccessfully, or when the request is cancelled. This block has no return value and takes a two arguments: the shared data task and the error describing the network or parsing error that occurred.
+
+ @return A receipt for the request, or `nil` if the request could not be serialized.
+ */
+- (nullable AFHTTPSharedRequestReceipt *)sharedGET:(NSString *)URLString
+                                        parameters:(nullable id)parameters
+                                           success:(nullable void (^)(NSURLSessionDataTask *task, id _Nullable responseObject))success
+                                           failure:(nullable void (^)(NSURLSessionDataTask * _Nullable task, NSError *error))failure;
+
+/**
+ Runs a `HEAD` request, sharing a single data task with any identical request already in flight.
+
+ @param URLString The URL string used to create the request URL.
+ @param parameters The parameters to be encoded according to the client request serializer.
+ @param success A block object to be executed when the task finishes successfully. This block has no return value and takes a single argument: the shared data task.
+ @param failure A block object to be executed when the task finishes unsuccessfully, or when the request is cancelled. This block has no return value and takes a two arguments: the shared data task and the error describing the network error that occurred.
+
+ @return A receipt for the request, or `nil` if the request could not be serialized.
+
+ @see -sharedGET:parameters:success:failure:
+ */
+- (nullable AFHTTPSharedRequestReceipt *)sharedHEAD:(NSString *)URLString
+                                         parameters:(nullable id)parameters
+                                            success:(nullable void (^)(NSURLSessionDataTask *task))success
+                                            failure:(nullable void (^)(NSURLSessionDataTask * _Nullable task, NSError *error))failure;
+
+/**
+ Cancels a shared request. Its failure block is called with an `NSURLErrorCancelled` error. The shared data task is only cancelled once no other request is waiting on it.
+
+ @param receipt The receipt of the request to cancel.
+ */
+- (void)cancelSharedRequestForReceipt:(AFHTTPSharedRequestReceipt *)receipt;
+
 @end
 
 NS_ASSUME_NONNULL_END
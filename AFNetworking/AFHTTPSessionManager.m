@@ -40,8 +40,109 @@
 #import <WatchKit/WatchKit.h>
 #endif
 
+static NSString * AFSharedRequestKeyFromRequest(NSURLRequest *request) {
+    NSMutableString *key = [NSMutableString stringWithFormat:@"%@ %@ %lu", request.HTTPMethod, request.URL.absoluteString, (unsigned long)request.cachePolicy];
+    NSDictionary <NSString *, NSString *> *headerFields = request.allHTTPHeaderFields;
+    for (NSString *field in [[headerFields allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)]) {
+        [key appendFormat:@"\n%@: %@", [field lowercaseString], headerFields[field]];
+    }
+
+    return key;
+}
+
+@interface AFHTTPSharedRequestReceipt ()
+@property (readwrite, nonatomic, strong) NSURLSessionDataTask *task;
+@property (readwrite, nonatomic, strong) NSUUID *receiptID;
+@property (nonatomic, copy) NSString *key;
+@end
+
+@implementation AFHTTPSharedRequestReceipt
+
+- (instancetype)initWithReceiptID:(NSUUID *)receiptID task:(NSURLSessionDataTask *)task key:(NSString *)key {
+    if (self = [self init]) {
+        self.receiptID = receiptID;
+        self.task = task;
+        self.key = key;
+    }
+    return self;
+}
+
+@end
+
+@interface AFHTTPSessionManagerSharedRequestHandler : NSObject
+@property (nonatomic, strong) NSUUID *receiptID;
+@property (nonatomic, copy) void (^successBlock)(NSURLSessionDataTask *, id);
+@property (nonatomic, copy) void (^failureBlock)(NSURLSessionDataTask *, NSError *);
+@end
+
+@implementation AFHTTPSessionManagerSharedRequestHandler
+
+- (instancetype)initWithReceiptID:(NSUUID *)receiptID
+                          success:(void (^)(NSURLSessionDataTask *task, id responseObject))success
+                          failure:(void (^)(NSURLSessionDataTask *task, NSError *error))failure
+{
+    if (self = [self init]) {
+        self.receiptID = receiptID;
+        self.successBlock = success;
+        self.failureBlock = failure;
+    }
+    return self;
+}
+
+@end
+
+@interface AFHTTPSessionManagerSharedRequest : NSObject
+@property (nonatomic, copy) NSString *key;
+@property (nonatomic, strong) NSURLSessionDataTask *task;
+@property (nonatomic, strong) NSMutableArray <AFHTTPSessionManagerSharedRequestHandler *> *handlers;
+@end
+
+@implementation AFHTTPSessionManagerSharedRequest
+
+- (instancetype)initWithKey:(NSString *)key {
+    if (self = [self init]) {
+        self.key = key;
+        self.handlers = [NSMutableArray array];
+    }
+    return self;
+}
+
+@end
+
+@interface AFHTTPSessionManagerRetryingRequest : NSObject
+@property (nonatomic, strong) NSURLRequest *request;
+@property (nonatomic, strong) AFHTTPRetryPolicy *retryPolicy;
+@property (nonatomic, copy) void (^uploadProgressBlock)(NSProgress *);
+@property (nonatomic, copy) void (^downloadProgressBlock)(NSProgress *);
+@property (nonatomic, copy) void (^successBlock)(NSURLSessionDataTask *, id);
+@property (nonatomic, copy) void (^failureBlock)(NSURLSessionDataTask *, NSError *);
+@property (nonatomic, assign) CFAbsoluteTime startTime;
+@property (nonatomic, assign) NSUInteger numberOfAttempts;
+@property (nonatomic, strong) NSMutableSet <NSURLSessionDataTask *> *activeTasks;
+@property (nonatomic, strong) NSURLSessionDataTask *lastTask;
+@property (nonatomic, assign, getter=isFinished) BOOL finished;
+@end
+
+@implementation AFHTTPSessionManagerRetryingRequest
+
+- (instancetype)initWithRequest:(NSURLRequest *)request retryPolicy:(AFHTTPRetryPolicy *)retryPolicy {
+    if (self = [self init]) {
+        self.request = request;
+        self.retryPolicy = retryPolicy;
+        self.startTime = CFAbsoluteTimeGetCurrent();
+        self.activeTasks = [NSMutableSet set];
+    }
+    return self;
+}
+
+@end
+
 @interface AFHTTPSessionManager ()
 @property (readwrite, nonatomic, strong) NSURL *baseURL;
+@property (nonatomic, strong) dispatch_queue_t sharedRequestSynchronizationQueue;
+@property (nonatomic, strong) NSMutableDictionary <NSString *, AFHTTPSessionManagerSharedRequest *> *sharedRequests;
+@property (nonatomic, strong) dispatch_queue_t retrySynchronizationQueue;
+@property (nonatomic, strong) NSMutableSet <NSURL *> *backgroundRevalidationURLs;
 @end
 
 @implementation AFHTTPSessionManager
@@ -81,6 +182,14 @@
     self.requestSerializer = [AFHTTPRequestSerializer serializer];
     self.responseSerializer = [AFJSONResponseSerializer serializer];
 
+    NSString *name = [NSString stringWithFormat:@"com.alamofire.httpsessionmanager.sharedrequests-%@", [[NSUUID UUID] UUIDString]];
+    self.sharedRequestSynchronizationQueue = dispatch_queue_create([name cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_SERIAL);
+    self.sharedRequests = [NSMutableDictionary dictionary];
+    self.backgroundRevalidationURLs = [NSMutableSet set];
+
+    name = [NSString stringWithFormat:@"com.alamofire.httpsessionmanager.retry-%@", [[NSUUID UUID] UUIDString]];
+    self.retrySynchronizationQueue = dispatch_queue_create([name cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_SERIAL);
+
     return self;
 }
 
@@ -129,7 +238,7 @@
 - (NSURLSessionDataTask *)GET:(NSString *)URLString
                    parameters:(id)parameters
                      progress:(void (^)(NSProgress * _Nonnull))downloadProgress
-                      success:(void (^)(NSURLSessionDataTask * _Nonnull, id _Nullable))success
+                      success:(void (^)(NSURLSessionDataTask * _Nullable, id _Nullable))success
                       failure:(void (^)(NSURLSessionDataTask * _Nullable, NSError * _Nonnull))failure
 {
 
@@ -141,7 +250,7 @@
                                                           success:success
                                                           failure:failure];
 
-    [dataTask resume];
+    [self scheduleTask:dataTask];
 
     return dataTask;
 }
@@ -157,7 +266,7 @@
         }
     } failure:failure];
 
-    [dataTask resume];
+    [self scheduleTask:dataTask];
 
     return dataTask;
 }
@@ -178,7 +287,7 @@
 {
     NSURLSessionDataTask *dataTask = [self dataTaskWithHTTPMethod:@"POST" URLString:URLString parameters:parameters uploadProgress:uploadProgress downloadProgress:nil success:success failure:failure];
 
-    [dataTask resume];
+    [self scheduleTask:dataTask];
 
     return dataTask;
 }
@@ -200,7 +309,9 @@
                        failure:(void (^)(NSURLSessionDataTask *task, NSError *error))failure
 {
     NSError *serializationError = nil;
+    CFAbsoluteTime serializationStartTime = CFAbsoluteTimeGetCurrent();
     NSMutableURLRequest *request = [self.requestSerializer multipartFormRequestWithMethod:@"POST" URLString:[[NSURL URLWithString:URLString relativeToURL:self.baseURL] absoluteString] parameters:parameters constructingBodyWithBlock:block error:&serializationError];
+    NSTimeInterval serializationDuration = CFAbsoluteTimeGetCurrent() - serializationStartTime;
     if (serializationError) {
         if (failure) {
             dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
@@ -223,7 +334,8 @@
         }
     }];
 
-    [task resume];
+    [self recordDuration:serializationDuration ofPhase:AFURLSessionTaskPhaseRequestSerialization forTask:task];
+    [self scheduleTask:task];
 
     return task;
 }
@@ -235,7 +347,7 @@
 {
     NSURLSessionDataTask *dataTask = [self dataTaskWithHTTPMethod:@"PUT" URLString:URLString parameters:parameters uploadProgress:nil downloadProgress:nil success:success failure:failure];
 
-    [dataTask resume];
+    [self scheduleTask:dataTask];
 
     return dataTask;
 }
@@ -247,7 +359,7 @@
 {
     NSURLSessionDataTask *dataTask = [self dataTaskWithHTTPMethod:@"PATCH" URLString:URLString parameters:parameters uploadProgress:nil downloadProgress:nil success:success failure:failure];
 
-    [dataTask resume];
+    [self scheduleTask:dataTask];
 
     return dataTask;
 }
@@ -259,7 +371,7 @@
 {
     NSURLSessionDataTask *dataTask = [self dataTaskWithHTTPMethod:@"DELETE" URLString:URLString parameters:parameters uploadProgress:nil downloadProgress:nil success:success failure:failure];
 
-    [dataTask resume];
+    [self scheduleTask:dataTask];
 
     return dataTask;
 }
@@ -273,7 +385,9 @@
                                          failure:(void (^)(NSURLSessionDataTask *, NSError *))failure
 {
     NSError *serializationError = nil;
+    CFAbsoluteTime serializationStartTime = CFAbsoluteTimeGetCurrent();
     NSMutableURLRequest *request = [self.requestSerializer requestWithMethod:method URLString:[[NSURL URLWithString:URLString relativeToURL:self.baseURL] absoluteString] parameters:parameters error:&serializationError];
+    NSTimeInterval serializationDuration = CFAbsoluteTimeGetCurrent() - serializationStartTime;
     if (serializationError) {
         if (failure) {
             dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
@@ -284,6 +398,39 @@
         return nil;
     }
 
+    AFHTTPResponseCache *responseCache = self.responseCache;
+    if (responseCache) {
+        if ([method isEqualToString:@"GET"]) {
+            NSURLSessionDataTask *dataTask = [self dataTaskWithCachedRequest:request responseCache:responseCache uploadProgress:uploadProgress downloadProgress:downloadProgress success:success failure:failure];
+            [self recordDuration:serializationDuration ofPhase:AFURLSessionTaskPhaseRequestSerialization forTask:dataTask];
+
+            return dataTask;
+        } else if (![method isEqualToString:@"HEAD"]) {
+            void (^originalSuccess)(NSURLSessionDataTask *, id) = success;
+            success = ^(NSURLSessionDataTask *task, id responseObject) {
+                [responseCache removeCachedResponseForURL:request.URL];
+
+                if (originalSuccess) {
+                    originalSuccess(task, responseObject);
+                }
+            };
+        }
+    }
+
+    AFHTTPRetryPolicy *retryPolicy = self.retryPolicy;
+    if (retryPolicy) {
+        AFHTTPSessionManagerRetryingRequest *retryingRequest = [[AFHTTPSessionManagerRetryingRequest alloc] initWithRequest:request retryPolicy:retryPolicy];
+        retryingRequest.uploadProgressBlock = uploadProgress;
+        retryingRequest.downloadProgressBlock = downloadProgress;
+        retryingRequest.successBlock = success;
+        retryingRequest.failureBlock = failure;
+
+        NSURLSessionDataTask *dataTask = [self dataTaskWithRetryingRequest:retryingRequest];
+        [self recordDuration:serializationDuration ofPhase:AFURLSessionTaskPhaseRequestSerialization forTask:dataTask];
+
+        return dataTask;
+    }
+
     __block NSURLSessionDataTask *dataTask = nil;
     dataTask = [self dataTaskWithRequest:request
                           uploadProgress:uploadProgress
@@ -300,9 +447,437 @@
         }
     }];
 
+    [self recordDuration:serializationDuration ofPhase:AFURLSessionTaskPhaseRequestSerialization forTask:dataTask];
+
     return dataTask;
 }
 
+#pragma mark -
+
+- (AFHTTPSharedRequestReceipt *)sharedGET:(NSString *)URLString
+                               parameters:(id)parameters
+                                  success:(void (^)(NSURLSessionDataTask *task, id responseObject))success
+                                  failure:(void (^)(NSURLSessionDataTask *task, NSError *error))failure
+{
+    return [self sharedDataTaskWithHTTPMethod:@"GET" URLString:URLString parameters:parameters success:success failure:failure];
+}
+
+- (AFHTTPSharedRequestReceipt *)sharedHEAD:(NSString *)URLString
+                                parameters:(id)parameters
+                                   success:(void (^)(NSURLSessionDataTask *task))success
+                                   failure:(void (^)(NSURLSessionDataTask *task, NSError *error))failure
+{
+    return [self sharedDataTaskWithHTTPMethod:@"HEAD" URLString:URLString parameters:parameters success:^(NSURLSessionDataTask *task, __unused id responseObject) {
+        if (success) {
+            success(task);
+        }
+    } failure:failure];
+}
+
+- (AFHTTPSharedRequestReceipt *)sharedDataTaskWithHTTPMethod:(NSString *)method
+                                                   URLString:(NSString *)URLString
+                                                  parameters:(id)parameters
+                                                     success:(void (^)(NSURLSessionDataTask *, id))success
+                                                     failure:(void (^)(NSURLSessionDataTask *, NSError *))failure
+{
+    NSError *serializationError = nil;
+    CFAbsoluteTime serializationStartTime = CFAbsoluteTimeGetCurrent();
+    NSMutableURLRequest *request = [self.requestSerializer requestWithMethod:method URLString:[[NSURL URLWithString:URLString relativeToURL:self.baseURL] absoluteString] parameters:parameters error:&serializationError];
+    NSTimeInterval serializationDuration = CFAbsoluteTimeGetCurrent() - serializationStartTime;
+    if (serializationError) {
+        if (failure) {
+            dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
+                failure(nil, serializationError);
+            });
+        }
+
+        return nil;
+    }
+
+    NSString *key = AFSharedRequestKeyFromRequest(request);
+    AFHTTPSessionManagerSharedRequestHandler *handler = [[AFHTTPSessionManagerSharedRequestHandler alloc] initWithReceiptID:[NSUUID UUID] success:success failure:failure];
+
+    __block NSURLSessionDataTask *task = nil;
+    __block BOOL createdTask = NO;
+    dispatch_sync(self.sharedRequestSynchronizationQueue, ^{
+        AFHTTPSessionManagerSharedRequest *sharedRequest = self.sharedRequests[key];
+        if (!sharedRequest) {
+            sharedRequest = [[AFHTTPSessionManagerSharedRequest alloc] initWithKey:key];
+            sharedRequest.task = [self dataTaskWithRequest:request
+                                            uploadProgress:nil
+                                          downloadProgress:nil
+                                         completionHandler:^(NSURLResponse * __unused response, id responseObject, NSError *error) {
+                [self completeSharedRequest:sharedRequest withResponseObject:responseObject error:error];
+            }];
+            self.sharedRequests[key] = sharedRequest;
+            createdTask = YES;
+        }
+
+        [sharedRequest.handlers addObject:handler];
+        task = sharedRequest.task;
+    });
+
+    if (createdTask) {
+        [self recordDuration:serializationDuration ofPhase:AFURLSessionTaskPhaseRequestSerialization forTask:task];
+        [self scheduleTask:task];
+    }
+
+    return [[AFHTTPSharedRequestReceipt alloc] initWithReceiptID:handler.receiptID task:task key:key];
+}
+
+- (void)completeSharedRequest:(AFHTTPSessionManagerSharedRequest *)sharedRequest
+           withResponseObject:(id)responseObject
+                        error:(NSError *)error
+{
+    __block NSArray <AFHTTPSessionManagerSharedRequestHandler *> *handlers = nil;
+    dispatch_sync(self.sharedRequestSynchronizationQueue, ^{
+        if (self.sharedRequests[sharedRequest.key] == sharedRequest) {
+            [self.sharedRequests removeObjectForKey:sharedRequest.key];
+        }
+        handlers = [sharedRequest.handlers copy];
+        [sharedRequest.handlers removeAllObjects];
+    });
+
+    for (AFHTTPSessionManagerSharedRequestHandler *handler in handlers) {
+        if (error) {
+            if (handler.failureBlock) {
+                handler.failureBlock(sharedRequest.task, error);
+            }
+        } else {
+            if (handler.successBlock) {
+                handler.successBlock(sharedRequest.task, responseObject);
+            }
+        }
+    }
+}
+
+- (void)cancelSharedRequestForReceipt:(AFHTTPSharedRequestReceipt *)receipt {
+    __block AFHTTPSessionManagerSharedRequestHandler *cancelledHandler = nil;
+    __block BOOL cancelTask = NO;
+    dispatch_sync(self.sharedRequestSynchronizationQueue, ^{
+        AFHTTPSessionManagerSharedRequest *sharedRequest = self.sharedRequests[receipt.key];
+        if (sharedRequest.task != receipt.task) {
+            return;
+        }
+
+        NSUInteger index = [sharedRequest.handlers indexOfObjectPassingTest:^BOOL(AFHTTPSessionManagerSharedRequestHandler * _Nonnull handler, __unused NSUInteger idx, __unused BOOL * _Nonnull stop) {
+            return [handler.receiptID isEqual:receipt.receiptID];
+        }];
+        if (index == NSNotFound) {
+            return;
+        }
+
+        cancelledHandler = sharedRequest.handlers[index];
+        [sharedRequest.handlers removeObjectAtIndex:index];
+
+        if (sharedRequest.handlers.count == 0) {
+            [self.sharedRequests removeObjectForKey:receipt.key];
+            cancelTask = YES;
+        }
+    });
+
+    if (cancelTask) {
+        [receipt.task cancel];
+    }
+
+    if (cancelledHandler.failureBlock) {
+        NSString *failureReason = [NSString stringWithFormat:@"AFHTTPSessionManager cancelled shared request: %@", receipt.task.originalRequest.URL.absoluteString];
+        NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:@{NSLocalizedFailureReasonErrorKey:failureReason}];
+        dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
+            cancelledHandler.failureBlock(receipt.task, error);
+        });
+    }
+}
+
+#pragma mark - Response Cache
+
+- (nullable NSURLSessionDataTask *)dataTaskWithCachedRequest:(NSURLRequest *)request
+                                               responseCache:(AFHTTPResponseCache *)responseCache
+                                              uploadProgress:(void (^)(NSProgress *uploadProgress))uploadProgress
+                                            downloadProgress:(void (^)(NSProgress *downloadProgress))downloadProgress
+                                                     success:(void (^)(NSURLSessionDataTask *, id))success
+                                                     failure:(void (^)(NSURLSessionDataTask *, NSError *))failure
+{
+    AFCachedHTTPResponse *cachedResponse = nil;
+    AFHTTPResponseCacheLookupResult result = [responseCache lookupResponseForRequest:request cachedResponse:&cachedResponse];
+
+    if (result == AFHTTPResponseCacheLookupStoredOnDisk) {
+        // The stored response is read without blocking the calling thread, and the task it needs, if any, is started once it is read.
+        [responseCache lookupResponseOnDiskForRequest:request completionHandler:^(AFHTTPResponseCacheLookupResult diskResult, AFCachedHTTPResponse *diskCachedResponse) {
+            NSURLSessionDataTask *dataTask = [self dataTaskServingLookupResult:diskResult cachedResponse:diskCachedResponse forRequest:request responseCache:responseCache uploadProgress:uploadProgress downloadProgress:downloadProgress success:success failure:failure];
+            [self scheduleTask:dataTask];
+        }];
+        return nil;
+    }
+
+    return [self dataTaskServingLookupResult:result cachedResponse:cachedResponse forRequest:request responseCache:responseCache uploadProgress:uploadProgress downloadProgress:downloadProgress success:success failure:failure];
+}
+
+- (nullable NSURLSessionDataTask *)dataTaskServingLookupResult:(AFHTTPResponseCacheLookupResult)result
+                                                cachedResponse:(AFCachedHTTPResponse *)cachedResponse
+                                                    forRequest:(NSURLRequest *)request
+                                                 responseCache:(AFHTTPResponseCache *)responseCache
+                                                uploadProgress:(void (^)(NSProgress *uploadProgress))uploadProgress
+                                              downloadProgress:(void (^)(NSProgress *downloadProgress))downloadProgress
+                                                       success:(void (^)(NSURLSessionDataTask *, id))success
+                                                       failure:(void (^)(NSURLSessionDataTask *, NSError *))failure
+{
+    if (result == AFHTTPResponseCacheLookupFresh) {
+        [self serveCachedResponse:cachedResponse task:nil success:success failure:failure];
+        return nil;
+    } else if (result == AFHTTPResponseCacheLookupStale) {
+        [self serveCachedResponse:cachedResponse task:nil success:success failure:failure];
+        [self revalidateCachedResponse:cachedResponse inBackgroundForRequest:request responseCache:responseCache];
+        return nil;
+    }
+
+    return [self dataTaskRevalidatingCachedResponse:cachedResponse forRequest:request responseCache:responseCache uploadProgress:uploadProgress downloadProgress:downloadProgress success:success failure:failure];
+}
+
+- (void)revalidateCachedResponse:(AFCachedHTTPResponse *)cachedResponse
+          inBackgroundForRequest:(NSURLRequest *)request
+                   responseCache:(AFHTTPResponseCache *)responseCache
+{
+    NSURL *URL = request.URL;
+    __block BOOL alreadyRevalidating = NO;
+    dispatch_sync(self.sharedRequestSynchronizationQueue, ^{
+        alreadyRevalidating = [self.backgroundRevalidationURLs containsObject:URL];
+        [self.backgroundRevalidationURLs addObject:URL];
+    });
+
+    if (alreadyRevalidating) {
+        return;
+    }
+
+    void (^finishRevalidation)(void) = ^{
+        dispatch_async(self.sharedRequestSynchronizationQueue, ^{
+            [self.backgroundRevalidationURLs removeObject:URL];
+        });
+    };
+
+    NSURLSessionDataTask *dataTask = [self dataTaskRevalidatingCachedResponse:cachedResponse forRequest:request responseCache:responseCache uploadProgress:nil downloadProgress:nil success:^(NSURLSessionDataTask * __unused task, id __unused responseObject) {
+        finishRevalidation();
+    } failure:^(NSURLSessionDataTask * __unused task, NSError * __unused error) {
+        finishRevalidation();
+    }];
+
+    [self scheduleTask:dataTask priority:AFURLSessionTaskPriorityLow];
+}
+
+- (NSURLSessionDataTask *)dataTaskRevalidatingCachedResponse:(AFCachedHTTPResponse *)cachedResponse
+                                                  forRequest:(NSURLRequest *)request
+                                               responseCache:(AFHTTPResponseCache *)responseCache
+                                              uploadProgress:(void (^)(NSProgress *uploadProgress))uploadProgress
+                                            downloadProgress:(void (^)(NSProgress *downloadProgress))downloadProgress
+                                                     success:(void (^)(NSURLSessionDataTask *, id))success
+                                                     failure:(void (^)(NSURLSessionDataTask *, NSError *))failure
+{
+    NSURLRequest *conditionalRequest = [responseCache conditionalRequestForRequest:request cachedResponse:cachedResponse];
+    NSDate *requestDate = [NSDate date];
+
+    __block NSURLSessionDataTask *dataTask = nil;
+    dataTask = [self dataTaskWithRequest:conditionalRequest
+                          uploadProgress:uploadProgress
+                        downloadProgress:downloadProgress
+                   dataCompletionHandler:^(NSURLResponse *response, NSData *data, id responseObject, NSError *error) {
+        NSHTTPURLResponse *HTTPResponse = [response isKindOfClass:[NSHTTPURLResponse class]] ? (NSHTTPURLResponse *)response : nil;
+
+        if (cachedResponse && HTTPResponse.statusCode == 304) {
+            AFCachedHTTPResponse *updatedCachedResponse = [responseCache updateCachedResponse:cachedResponse withNotModifiedResponse:HTTPResponse forRequest:request requestDate:requestDate];
+            [self serveCachedResponse:updatedCachedResponse task:dataTask success:success failure:failure];
+            return;
+        }
+
+        BOOL transportFailed = [error.domain isEqualToString:NSURLErrorDomain];
+        if (error && (transportFailed || HTTPResponse.statusCode >= 500) && [cachedResponse canBeServedAfterErrorAtDate:[NSDate date]]) {
+            [self serveCachedResponse:cachedResponse task:dataTask success:success failure:failure];
+            return;
+        }
+
+        if (HTTPResponse && !transportFailed) {
+            [responseCache storeResponse:HTTPResponse data:data ?: [NSData data] forRequest:request requestDate:requestDate];
+        }
+
+        if (error) {
+            if (failure) {
+                failure(dataTask, error);
+            }
+        } else {
+            if (success) {
+                success(dataTask, responseObject);
+            }
+        }
+    }];
+
+    return dataTask;
+}
+
+- (void)serveCachedResponse:(AFCachedHTTPResponse *)cachedResponse
+                       task:(nullable NSURLSessionDataTask *)task
+                    success:(void (^)(NSURLSessionDataTask *, id))success
+                    failure:(void (^)(NSURLSessionDataTask *, NSError *))failure
+{
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError *serializationError = nil;
+        id responseObject = [self responseObjectForResponse:cachedResponse.response data:cachedResponse.data error:&serializationError];
+
+        dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
+            if (serializationError) {
+                if (failure) {
+                    failure(task, serializationError);
+                }
+            } else {
+                if (success) {
+                    success(task, responseObject);
+                }
+            }
+        });
+    });
+}
+
+#pragma mark - Retrying Requests
+
+- (NSURLSessionDataTask *)dataTaskWithRetryingRequest:(AFHTTPSessionManagerRetryingRequest *)retryingRequest {
+    __block NSURLSessionDataTask *dataTask = nil;
+    dispatch_sync(self.retrySynchronizationQueue, ^{
+        dataTask = [self startAttemptOfRetryingRequest:retryingRequest];
+
+        if (retryingRequest.retryPolicy.hedgesRequests && [retryingRequest.request.HTTPMethod isEqualToString:@"GET"]) {
+            [self scheduleHedgedAttemptOfRetryingRequest:retryingRequest];
+        }
+
+        if (retryingRequest.retryPolicy.deadline > 0.0) {
+            [self scheduleDeadlineOfRetryingRequest:retryingRequest];
+        }
+    });
+
+    return dataTask;
+}
+
+//This method should only be called from safely within the retrySynchronizationQueue
+- (NSURLSessionDataTask *)startAttemptOfRetryingRequest:(AFHTTPSessionManagerRetryingRequest *)retryingRequest {
+    retryingRequest.numberOfAttempts += 1;
+    CFAbsoluteTime attemptStartTime = CFAbsoluteTimeGetCurrent();
+
+    __block NSURLSessionDataTask *dataTask = nil;
+    dataTask = [self dataTaskWithRequest:retryingRequest.request
+                          uploadProgress:retryingRequest.uploadProgressBlock
+                        downloadProgress:retryingRequest.downloadProgressBlock
+                       completionHandler:^(NSURLResponse * __unused response, id responseObject, NSError *error) {
+        NSTimeInterval latency = CFAbsoluteTimeGetCurrent() - attemptStartTime;
+        dispatch_async(self.retrySynchronizationQueue, ^{
+            [self retryingRequest:retryingRequest didCompleteAttempt:dataTask withResponseObject:responseObject error:error latency:latency];
+        });
+    }];
+    [retryingRequest.activeTasks addObject:dataTask];
+    retryingRequest.lastTask = dataTask;
+
+    return dataTask;
+}
+
+//This method should only be called from safely within the retrySynchronizationQueue
+- (void)scheduleDeadlineOfRetryingRequest:(AFHTTPSessionManagerRetryingRequest *)retryingRequest {
+    NSTimeInterval deadline = retryingRequest.retryPolicy.deadline - (CFAbsoluteTimeGetCurrent() - retryingRequest.startTime);
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(MAX(deadline, 0.0) * NSEC_PER_SEC)), self.retrySynchronizationQueue, ^{
+        if (retryingRequest.isFinished) {
+            return;
+        }
+
+        // Attempts still running when the deadline passes are cancelled, so that no attempt outlives it.
+        NSURLSessionDataTask *task = [retryingRequest.activeTasks anyObject] ?: retryingRequest.lastTask;
+        NSDictionary *userInfo = retryingRequest.request.URL ? @{NSURLErrorFailingURLErrorKey: retryingRequest.request.URL} : nil;
+        [self finishRetryingRequest:retryingRequest withTask:task responseObject:nil error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:userInfo]];
+    });
+}
+
+//This method should only be called from safely within the retrySynchronizationQueue
+- (void)scheduleHedgedAttemptOfRetryingRequest:(AFHTTPSessionManagerRetryingRequest *)retryingRequest {
+    NSTimeInterval hedgingDelay = retryingRequest.retryPolicy.hedgingDelay;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(hedgingDelay * NSEC_PER_SEC)), self.retrySynchronizationQueue, ^{
+        if (retryingRequest.isFinished || retryingRequest.numberOfAttempts != 1 || retryingRequest.numberOfAttempts >= retryingRequest.retryPolicy.maximumNumberOfAttempts) {
+            return;
+        }
+
+        NSURLSessionDataTask *firstTask = [retryingRequest.activeTasks anyObject];
+        if (firstTask.state != NSURLSessionTaskStateRunning) {
+            return;
+        }
+
+        [self scheduleTask:[self startAttemptOfRetryingRequest:retryingRequest]];
+    });
+}
+
+//This method should only be called from safely within the retrySynchronizationQueue
+- (void)retryingRequest:(AFHTTPSessionManagerRetryingRequest *)retryingRequest
+     didCompleteAttempt:(NSURLSessionDataTask *)task
+     withResponseObject:(id)responseObject
+                  error:(NSError *)error
+                latency:(NSTimeInterval)latency
+{
+    [retryingRequest.activeTasks removeObject:task];
+    if (retryingRequest.isFinished) {
+        return;
+    }
+
+    if (!error) {
+        [retryingRequest.retryPolicy recordLatency:latency];
+        [self finishRetryingRequest:retryingRequest withTask:task responseObject:responseObject error:nil];
+        return;
+    }
+
+    if ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled) {
+        [self finishRetryingRequest:retryingRequest withTask:task responseObject:nil error:error];
+        return;
+    }
+
+    // A hedged attempt is still running, and may yet succeed
+    if (retryingRequest.activeTasks.count > 0) {
+        return;
+    }
+
+    AFHTTPRetryPolicy *retryPolicy = retryingRequest.retryPolicy;
+    NSTimeInterval delay = [retryPolicy delayBeforeRetry:retryingRequest.numberOfAttempts response:task.response];
+    NSTimeInterval elapsed = CFAbsoluteTimeGetCurrent() - retryingRequest.startTime;
+    BOOL withinDeadline = retryPolicy.deadline <= 0.0 || elapsed + delay < retryPolicy.deadline;
+    if (retryingRequest.numberOfAttempts >= retryPolicy.maximumNumberOfAttempts || !withinDeadline || ![retryPolicy shouldRetryRequest:retryingRequest.request response:task.response error:error]) {
+        [self finishRetryingRequest:retryingRequest withTask:task responseObject:nil error:error];
+        return;
+    }
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), self.retrySynchronizationQueue, ^{
+        if (retryingRequest.isFinished) {
+            return;
+        }
+
+        [self scheduleTask:[self startAttemptOfRetryingRequest:retryingRequest]];
+    });
+}
+
+//This method should only be called from safely within the retrySynchronizationQueue
+- (void)finishRetryingRequest:(AFHTTPSessionManagerRetryingRequest *)retryingRequest
+                     withTask:(NSURLSessionDataTask *)task
+               responseObject:(id)responseObject
+                        error:(NSError *)error
+{
+    retryingRequest.finished = YES;
+    for (NSURLSessionDataTask *activeTask in retryingRequest.activeTasks) {
+        [activeTask cancel];
+    }
+    [retryingRequest.activeTasks removeAllObjects];
+
+    dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
+        if (error) {
+            if (retryingRequest.failureBlock) {
+                retryingRequest.failureBlock(task, error);
+            }
+        } else {
+            if (retryingRequest.successBlock) {
+                retryingRequest.successBlock(task, responseObject);
+            }
+        }
+    });
+}
+
 #pragma mark - NSObject
 
 - (NSString *)description {
@@ -366,6 +941,8 @@
     HTTPClient.requestSerializer = [self.requestSerializer copyWithZone:zone];
     HTTPClient.responseSerializer = [self.responseSerializer copyWithZone:zone];
     HTTPClient.securityPolicy = [self.securityPolicy copyWithZone:zone];
+    HTTPClient.retryPolicy = [self.retryPolicy copyWithZone:zone];
+    HTTPClient.responseCache = self.responseCache;
     return HTTPClient;
 }
 
@@ -27,6 +27,7 @@
 #ifndef _AFNETWORKING_
     #define _AFNETWORKING_
 
+    #import "AFTracing.h"
     #import "AFURLRequestSerialization.h"
     #import "AFURLResponseSerialization.h"
     #import "AFSecurityPolicy.h"
@@ -35,7 +36,13 @@
     #import "AFNetworkReachabilityManager.h"
 #endif
 
+    #import "AFURLSessionMetrics.h"
     #import "AFURLSessionManager.h"
+    #import "AFHTTPRetryPolicy.h"
+    #import "AFHTTPResponseCache.h"
+    #import "AFEventStreamTask.h"
+    #import "AFSegmentedDownloadTask.h"
+    #import "AFChunkedUploadTask.h"
     #import "AFHTTPSessionManager.h"
 
 #endif /* _AFNETWORKING_ */
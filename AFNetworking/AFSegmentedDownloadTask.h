@@ -0,0 +1,98 @@
+// AFSegmentedDownloadTask.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import <Foundation/Foundation.h>
+
+@class AFURLSessionManager;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ `AFSegmentedDownloadTask` downloads a file over several connections at once, each fetching one byte range of the file, which is faster than a single connection on links with a high latency.
+
+ The download starts with a request for the first byte of the file, which tells whether the server supports range requests and how long the file is. The file is then split into `numberOfSegments` ranges, which are fetched concurrently and written into place in a file preallocated next to the destination. Once every range is complete, that file is moved to the destination. When the server does not support range requests, or does not report the length of the file, the file is downloaded over a single connection instead.
+
+ The ranges already written are recorded next to the destination as the download progresses and when it fails or is cancelled, so that a new task for the same request and destination only fetches the missing ranges, provided the file has not changed on the server.
+ */
+@interface AFSegmentedDownloadTask : NSObject
+
+/**
+ The manager used to download the file.
+ */
+@property (readonly, nonatomic, strong) AFURLSessionManager *sessionManager;
+
+/**
+ The request for the file.
+ */
+@property (readonly, nonatomic, copy) NSURLRequest *request;
+
+/**
+ The file URL to which the file is moved once downloaded. An existing file at that URL is replaced.
+ */
+@property (readonly, nonatomic, copy) NSURL *destinationURL;
+
+/**
+ The number of ranges fetched concurrently. `4` by default. The number of concurrent connections is also limited by the `HTTPMaximumConnectionsPerHost` of the session configuration.
+ */
+@property (nonatomic, assign) NSUInteger numberOfSegments;
+
+/**
+ The minimum length, in bytes, of each range, so that small files are fetched over fewer connections. `1` MB by default.
+ */
+@property (nonatomic, assign) NSUInteger minimumSegmentLength;
+
+/**
+ The progress of the whole download, in bytes, including the ranges written by an earlier task.
+ */
+@property (readonly, nonatomic, strong) NSProgress *progress;
+
+/**
+ Initializes a task downloading the file at the specified request to the specified destination.
+
+ @param sessionManager The manager used to download the file.
+ @param request The request for the file.
+ @param destinationURL The file URL to which the file is moved once downloaded.
+
+ @return The newly-initialized task.
+ */
+- (instancetype)initWithSessionManager:(AFURLSessionManager *)sessionManager
+                               request:(NSURLRequest *)request
+                        destinationURL:(NSURL *)destinationURL NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Starts the download. Has no effect if the task was already started. The task is kept alive until the download finishes, and does not need to be retained by the caller.
+
+ @param completionHandler A block object to be executed on the completion queue of the manager when the download finishes. This block has no return value and takes two arguments: the destination URL of the file, or `nil` if the download failed, and the error that occurred, if any.
+ */
+- (void)resumeWithCompletionHandler:(nullable void (^)(NSURL * _Nullable fileURL, NSError * _Nullable error))completionHandler;
+
+/**
+ Cancels the download, recording the ranges already written so that a new task can resume it. The completion handler is called with an `NSURLErrorCancelled` error.
+ */
+- (void)cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,604 @@
+// AFSegmentedDownloadTask.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "AFSegmentedDownloadTask.h"
+#import "AFURLSessionManager.h"
+
+#import <errno.h>
+#import <fcntl.h>
+#import <pthread.h>
+#import <unistd.h>
+
+static NSUInteger const AFSegmentedDownloadHighWatermark = 4 * 1024 * 1024;
+static NSUInteger const AFSegmentedDownloadLowWatermark = 1024 * 1024;
+static long long const AFSegmentedDownloadStateSaveInterval = 8 * 1024 * 1024;
+
+static NSString * const AFSegmentedDownloadStateURLKey = @"url";
+static NSString * const AFSegmentedDownloadStateLengthKey = @"length";
+static NSString * const AFSegmentedDownloadStateValidatorKey = @"validator";
+static NSString * const AFSegmentedDownloadStateSegmentsKey = @"segments";
+
+// Returns the complete length from a `Content-Range` header such as `bytes 0-0/1234`, or -1 if it is unknown.
+static long long AFSegmentedDownloadCompleteLength(NSString *contentRange) {
+    NSRange slashRange = [contentRange rangeOfString:@"/" options:NSBackwardsSearch];
+    if (![contentRange hasPrefix:@"bytes "] || slashRange.location == NSNotFound) {
+        return -1;
+    }
+
+    NSString *completeLength = [contentRange substringFromIndex:NSMaxRange(slashRange)];
+    NSScanner *scanner = [NSScanner scannerWithString:completeLength];
+    long long length = -1;
+    if (![scanner scanLongLong:&length] || !scanner.isAtEnd) {
+        return -1;
+    }
+
+    return length;
+}
+
+static BOOL AFSegmentedDownloadWriteData(int fileDescriptor, NSData *data, off_t offset) {
+    const uint8_t *bytes = (const uint8_t *)data.bytes;
+    size_t length = data.length;
+    while (length > 0) {
+        ssize_t bytesWritten = pwrite(fileDescriptor, bytes, length, offset);
+        if (bytesWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return NO;
+        }
+
+        bytes += bytesWritten;
+        length -= (size_t)bytesWritten;
+        offset += bytesWritten;
+    }
+
+    return YES;
+}
+
+@interface AFSegmentedDownloadSegment : NSObject
+@property (nonatomic, assign) long long start;
+@property (nonatomic, assign) long long end;
+@property (nonatomic, assign) long long writtenLength;
+@property (nonatomic, strong) NSURLSessionDataTask *task;
+@property (nonatomic, strong) NSError *error;
+
+- (long long)length;
+- (BOOL)isComplete;
+@end
+
+@implementation AFSegmentedDownloadSegment
+
+- (long long)length {
+    return self.end - self.start + 1;
+}
+
+- (BOOL)isComplete {
+    return self.writtenLength == [self length];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFSegmentedDownloadTask () {
+    pthread_mutex_t _mutex;
+    pthread_mutex_t _progressMutex;
+    pthread_mutex_t _saveMutex;
+    int _fileDescriptor;
+    long long _completedLength;
+    long long _unsavedLength;
+}
+@property (readwrite, nonatomic, strong) AFURLSessionManager *sessionManager;
+@property (readwrite, nonatomic, copy) NSURLRequest *request;
+@property (readwrite, nonatomic, copy) NSURL *destinationURL;
+@property (readwrite, nonatomic, strong) NSProgress *progress;
+@property (readwrite, nonatomic, copy) void (^completionHandler)(NSURL *fileURL, NSError *error);
+@property (readwrite, nonatomic, strong) NSURLSessionTask *singleTask;
+@property (readwrite, nonatomic, strong) NSArray <AFSegmentedDownloadSegment *> *segments;
+@property (readwrite, nonatomic, assign) NSUInteger remainingSegmentCount;
+@property (readwrite, nonatomic, assign) long long contentLength;
+@property (readwrite, nonatomic, copy) NSString *validator;
+@property (readwrite, nonatomic, strong) NSError *error;
+@property (readwrite, nonatomic, assign, getter=isStarted) BOOL started;
+@property (readwrite, nonatomic, assign, getter=isCancelled) BOOL cancelled;
+@property (readwrite, nonatomic, assign, getter=isFinished) BOOL finished;
+@end
+
+@implementation AFSegmentedDownloadTask
+
+- (instancetype)initWithSessionManager:(AFURLSessionManager *)sessionManager
+                               request:(NSURLRequest *)request
+                        destinationURL:(NSURL *)destinationURL
+{
+    NSParameterAssert(sessionManager);
+    NSParameterAssert(request);
+    NSParameterAssert([destinationURL isFileURL]);
+
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_mutex, NULL);
+    pthread_mutex_init(&_progressMutex, NULL);
+    pthread_mutex_init(&_saveMutex, NULL);
+    _fileDescriptor = -1;
+
+    self.sessionManager = sessionManager;
+    self.request = request;
+    self.destinationURL = destinationURL;
+    self.numberOfSegments = 4;
+    self.minimumSegmentLength = 1024 * 1024;
+    self.progress = [NSProgress progressWithTotalUnitCount:NSURLSessionTransferSizeUnknown];
+
+    return self;
+}
+
+- (void)dealloc {
+    if (_fileDescriptor >= 0) {
+        close(_fileDescriptor);
+    }
+
+    pthread_mutex_destroy(&_mutex);
+    pthread_mutex_destroy(&_progressMutex);
+    pthread_mutex_destroy(&_saveMutex);
+}
+
+- (NSURL *)partialFileURL {
+    return [self.destinationURL URLByAppendingPathExtension:@"afdownload"];
+}
+
+- (NSURL *)stateFileURL {
+    return [self.destinationURL URLByAppendingPathExtension:@"afdownload-state"];
+}
+
+- (void)resumeWithCompletionHandler:(void (^)(NSURL *fileURL, NSError *error))completionHandler {
+    pthread_mutex_lock(&_mutex);
+    BOOL starts = !self.started && !self.cancelled;
+    if (starts) {
+        self.started = YES;
+        self.completionHandler = completionHandler;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (starts) {
+        [self probe];
+    }
+}
+
+- (void)cancel {
+    pthread_mutex_lock(&_mutex);
+    self.cancelled = YES;
+    NSMutableArray <NSURLSessionTask *> *tasks = [NSMutableArray array];
+    if (self.singleTask) {
+        [tasks addObject:self.singleTask];
+    }
+    for (AFSegmentedDownloadSegment *segment in self.segments) {
+        if (segment.task) {
+            [tasks addObject:segment.task];
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    for (NSURLSessionTask *task in tasks) {
+        [task cancel];
+    }
+}
+
+#pragma mark - Probing
+
+// Requesting the first byte tells whether ranges are supported, and the complete length of the file.
+- (void)probe {
+    NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+    [mutableRequest setValue:@"bytes=0-0" forHTTPHeaderField:@"Range"];
+
+    __block NSURLSessionDataTask *probeTask = nil;
+    __block NSUInteger receivedLength = 0;
+    probeTask = [self.sessionManager dataTaskWithRequest:mutableRequest highWatermark:0 lowWatermark:0 queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) chunkHandler:^(NSData *chunk) {
+        receivedLength += chunk.length;
+
+        // A server ignoring the range sends the whole file, which is not needed to decide how to download it.
+        if (receivedLength > 1) {
+            [probeTask cancel];
+        }
+    } completionHandler:^(NSURLResponse *response, NSError *error) {
+        probeTask = nil;
+        [self probeDidCompleteWithResponse:(NSHTTPURLResponse *)response error:(receivedLength > 1 ? nil : error)];
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    self.singleTask = probeTask;
+    BOOL cancelled = self.cancelled;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [probeTask cancel];
+    }
+
+    [probeTask resume];
+}
+
+- (void)probeDidCompleteWithResponse:(NSHTTPURLResponse *)response
+                               error:(NSError *)error
+{
+    pthread_mutex_lock(&_mutex);
+    self.singleTask = nil;
+    BOOL cancelled = self.cancelled;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [self finishWithFileURL:nil error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+        return;
+    }
+
+    NSInteger statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? response.statusCode : 0;
+    long long contentLength = statusCode == 206 ? AFSegmentedDownloadCompleteLength(response.allHeaderFields[@"Content-Range"]) : -1;
+
+    if (!error && contentLength > 0) {
+        // `If-Range` only accepts a strong entity tag, or a date.
+        NSString *entityTag = response.allHeaderFields[@"ETag"];
+        self.validator = [entityTag hasPrefix:@"W/"] ? response.allHeaderFields[@"Last-Modified"] : (entityTag ?: response.allHeaderFields[@"Last-Modified"]);
+        self.contentLength = contentLength;
+        [self downloadSegments];
+    } else if (!error || statusCode == 416) {
+        [self downloadWithSingleConnection];
+    } else {
+        [self finishWithFileURL:nil error:error];
+    }
+}
+
+#pragma mark - Single Connection
+
+- (void)downloadWithSingleConnection {
+    NSURL *destinationURL = self.destinationURL;
+    NSProgress *progress = self.progress;
+
+    NSURLSessionDownloadTask *task = [self.sessionManager downloadTaskWithRequest:self.request progress:^(NSProgress *downloadProgress) {
+        progress.totalUnitCount = downloadProgress.totalUnitCount;
+        progress.completedUnitCount = downloadProgress.completedUnitCount;
+    } destination:^NSURL *(__unused NSURL *targetPath, NSURLResponse *response) {
+        if (![response isKindOfClass:[NSHTTPURLResponse class]] || [(NSHTTPURLResponse *)response statusCode] / 100 != 2) {
+            return nil;
+        }
+
+        [[NSFileManager defaultManager] removeItemAtURL:destinationURL error:nil];
+
+        return destinationURL;
+    } completionHandler:^(__unused NSURLResponse *response, NSURL *filePath, NSError *error) {
+        pthread_mutex_lock(&self->_mutex);
+        self.singleTask = nil;
+        pthread_mutex_unlock(&self->_mutex);
+
+        [self finishWithFileURL:(error ? nil : filePath) error:error];
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    self.singleTask = task;
+    BOOL cancelled = self.cancelled;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [task cancel];
+    }
+
+    [task resume];
+}
+
+#pragma mark - Segments
+
+- (NSArray <AFSegmentedDownloadSegment *> *)savedSegments {
+    NSDictionary *state = [NSDictionary dictionaryWithContentsOfURL:[self stateFileURL]];
+    NSDictionary *attributes = [[NSFileManager defaultManager] attributesOfItemAtPath:[self partialFileURL].path error:nil];
+    if (!state || !self.validator || [attributes fileSize] != (unsigned long long)self.contentLength) {
+        return nil;
+    }
+
+    if (![state[AFSegmentedDownloadStateURLKey] isEqual:self.request.URL.absoluteString] || [state[AFSegmentedDownloadStateLengthKey] longLongValue] != self.contentLength || ![state[AFSegmentedDownloadStateValidatorKey] isEqual:self.validator]) {
+        return nil;
+    }
+
+    NSMutableArray <AFSegmentedDownloadSegment *> *segments = [NSMutableArray array];
+    for (NSArray <NSNumber *> *savedSegment in state[AFSegmentedDownloadStateSegmentsKey]) {
+        if (![savedSegment isKindOfClass:[NSArray class]] || savedSegment.count != 3) {
+            return nil;
+        }
+
+        AFSegmentedDownloadSegment *segment = [[AFSegmentedDownloadSegment alloc] init];
+        segment.start = [savedSegment[0] longLongValue];
+        segment.end = [savedSegment[1] longLongValue];
+        segment.writtenLength = MIN(MAX([savedSegment[2] longLongValue], 0), [segment length]);
+        [segments addObject:segment];
+    }
+
+    return segments.count > 0 ? segments : nil;
+}
+
+- (NSArray <AFSegmentedDownloadSegment *> *)newSegments {
+    long long contentLength = self.contentLength;
+    long long numberOfSegments = (long long)MAX(self.numberOfSegments, 1u);
+    if (self.minimumSegmentLength > 0) {
+        numberOfSegments = MIN(numberOfSegments, MAX(contentLength / (long long)self.minimumSegmentLength, 1));
+    }
+
+    long long segmentLength = contentLength / numberOfSegments;
+    NSMutableArray <AFSegmentedDownloadSegment *> *segments = [NSMutableArray array];
+    for (long long index = 0; index < numberOfSegments; index++) {
+        AFSegmentedDownloadSegment *segment = [[AFSegmentedDownloadSegment alloc] init];
+        segment.start = index * segmentLength;
+        segment.end = index == numberOfSegments - 1 ? contentLength - 1 : segment.start + segmentLength - 1;
+        [segments addObject:segment];
+    }
+
+    return segments;
+}
+
+- (void)downloadSegments {
+    NSArray <AFSegmentedDownloadSegment *> *segments = [self savedSegments];
+    BOOL resumes = segments != nil;
+    if (!resumes) {
+        segments = [self newSegments];
+        [[NSFileManager defaultManager] removeItemAtURL:[self stateFileURL] error:nil];
+    }
+
+    int fileDescriptor = open([self partialFileURL].fileSystemRepresentation, O_RDWR | O_CREAT | (resumes ? 0 : O_TRUNC), 0644);
+    if (fileDescriptor < 0 || (!resumes && ftruncate(fileDescriptor, (off_t)self.contentLength) != 0)) {
+        NSError *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        if (fileDescriptor >= 0) {
+            close(fileDescriptor);
+        }
+
+        [self finishWithFileURL:nil error:error];
+        return;
+    }
+
+    long long completedLength = 0;
+    NSMutableArray <AFSegmentedDownloadSegment *> *remainingSegments = [NSMutableArray array];
+    for (AFSegmentedDownloadSegment *segment in segments) {
+        completedLength += segment.writtenLength;
+        if (![segment isComplete]) {
+            [remainingSegments addObject:segment];
+        }
+    }
+
+    pthread_mutex_lock(&_mutex);
+    _fileDescriptor = fileDescriptor;
+    _completedLength = completedLength;
+    self.segments = segments;
+    self.remainingSegmentCount = remainingSegments.count;
+    pthread_mutex_unlock(&_mutex);
+
+    self.progress.totalUnitCount = self.contentLength;
+    [self updateProgressWithCompletedLength:completedLength];
+
+    if (remainingSegments.count == 0) {
+        [self finishSegments];
+        return;
+    }
+
+    for (AFSegmentedDownloadSegment *segment in remainingSegments) {
+        [self downloadSegment:segment];
+    }
+}
+
+- (void)downloadSegment:(AFSegmentedDownloadSegment *)segment {
+    NSMutableURLRequest *mutableRequest = [self.request mutableCopy];
+    [mutableRequest setValue:[NSString stringWithFormat:@"bytes=%lld-%lld", segment.start + segment.writtenLength, segment.end] forHTTPHeaderField:@"Range"];
+    if (self.validator) {
+        // A file changed on the server is sent whole, and then rejected, rather than mixed with the ranges already written.
+        [mutableRequest setValue:self.validator forHTTPHeaderField:@"If-Range"];
+    }
+
+    __weak __typeof(self)weakSelf = self;
+    __block NSURLSessionDataTask *task = nil;
+    task = [self.sessionManager dataTaskWithRequest:mutableRequest highWatermark:AFSegmentedDownloadHighWatermark lowWatermark:AFSegmentedDownloadLowWatermark queue:dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0) chunkHandler:^(NSData *chunk) {
+        [weakSelf segment:segment didReceiveChunk:chunk task:task];
+    } completionHandler:^(__unused NSURLResponse *response, NSError *error) {
+        task = nil;
+        [self segment:segment didCompleteWithError:error];
+    }];
+
+    pthread_mutex_lock(&_mutex);
+    segment.task = task;
+    BOOL cancelled = self.cancelled;
+    pthread_mutex_unlock(&_mutex);
+
+    if (cancelled) {
+        [task cancel];
+    }
+
+    [task resume];
+}
+
+// Chunks of a segment are handled one at a time and in order, so they are written right after the bytes already written.
+- (void)segment:(AFSegmentedDownloadSegment *)segment
+didReceiveChunk:(NSData *)chunk
+           task:(NSURLSessionDataTask *)task
+{
+    if (segment.error) {
+        return;
+    }
+
+    NSHTTPURLResponse *response = (NSHTTPURLResponse *)task.response;
+    long long offset = segment.start + segment.writtenLength;
+    if (![response isKindOfClass:[NSHTTPURLResponse class]] || response.statusCode != 206 || offset + (long long)chunk.length > segment.end + 1) {
+        segment.error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:@{NSURLErrorFailingURLErrorKey: self.request.URL}];
+        [task cancel];
+        return;
+    }
+
+    if (!AFSegmentedDownloadWriteData(_fileDescriptor, chunk, (off_t)offset)) {
+        segment.error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+        [task cancel];
+        return;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    segment.writtenLength += (long long)chunk.length;
+    _completedLength += (long long)chunk.length;
+    int64_t completedLength = _completedLength;
+    _unsavedLength += (long long)chunk.length;
+    BOOL saves = _unsavedLength >= AFSegmentedDownloadStateSaveInterval;
+    if (saves) {
+        _unsavedLength = 0;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    [self updateProgressWithCompletedLength:completedLength];
+
+    // The ranges are recorded as the download goes, so that a process that is killed keeps most of its progress.
+    if (saves) {
+        [self saveSegmentsSynchronizingFileDescriptor:_fileDescriptor];
+    }
+}
+
+// Segments report their progress from different queues, so a report read before another segment's may arrive after it.
+- (void)updateProgressWithCompletedLength:(int64_t)completedLength {
+    pthread_mutex_lock(&_progressMutex);
+    if (completedLength > self.progress.completedUnitCount) {
+        self.progress.completedUnitCount = completedLength;
+    }
+    pthread_mutex_unlock(&_progressMutex);
+}
+
+- (void)segment:(AFSegmentedDownloadSegment *)segment
+didCompleteWithError:(NSError *)error
+{
+    error = segment.error ?: error;
+    if (!error && ![segment isComplete]) {
+        error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:@{NSURLErrorFailingURLErrorKey: self.request.URL}];
+    }
+
+    NSMutableArray <NSURLSessionTask *> *otherTasks = [NSMutableArray array];
+
+    pthread_mutex_lock(&_mutex);
+    segment.task = nil;
+    self.remainingSegmentCount--;
+    BOOL finishes = self.remainingSegmentCount == 0;
+    if (error && !self.error) {
+        self.error = error;
+
+        // The first failure stops the other segments, whose ranges are recorded for a later task.
+        for (AFSegmentedDownloadSegment *otherSegment in self.segments) {
+            if (otherSegment.task) {
+                [otherTasks addObject:otherSegment.task];
+            }
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    for (NSURLSessionTask *otherTask in otherTasks) {
+        [otherTask cancel];
+    }
+
+    if (finishes) {
+        [self finishSegments];
+    }
+}
+
+- (void)finishSegments {
+    pthread_mutex_lock(&_mutex);
+    int fileDescriptor = _fileDescriptor;
+    _fileDescriptor = -1;
+    NSError *error = self.error;
+    if (self.cancelled) {
+        error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (error) {
+        [self saveSegmentsSynchronizingFileDescriptor:fileDescriptor];
+    }
+
+    if (fileDescriptor >= 0) {
+        close(fileDescriptor);
+    }
+
+    if (error) {
+        [self finishWithFileURL:nil error:error];
+        return;
+    }
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager removeItemAtURL:self.destinationURL error:nil];
+    if (![fileManager moveItemAtURL:[self partialFileURL] toURL:self.destinationURL error:&error]) {
+        [self finishWithFileURL:nil error:error];
+        return;
+    }
+
+    [fileManager removeItemAtURL:[self stateFileURL] error:nil];
+    [self finishWithFileURL:self.destinationURL error:nil];
+}
+
+// Saves are serialized, and the ranges are read before the file is flushed, so that the recorded ranges only include bytes that are on disk,
+// and a state saved late never replaces a newer one.
+- (void)saveSegmentsSynchronizingFileDescriptor:(int)fileDescriptor {
+    if (!self.validator) {
+        return;
+    }
+
+    pthread_mutex_lock(&_saveMutex);
+    NSMutableArray <NSArray <NSNumber *> *> *savedSegments = [NSMutableArray array];
+    pthread_mutex_lock(&_mutex);
+    for (AFSegmentedDownloadSegment *segment in self.segments) {
+        [savedSegments addObject:@[@(segment.start), @(segment.end), @(segment.writtenLength)]];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (fileDescriptor >= 0 && fsync(fileDescriptor) != 0) {
+        pthread_mutex_unlock(&_saveMutex);
+        return;
+    }
+
+    NSDictionary *state = @{
+                            AFSegmentedDownloadStateURLKey: self.request.URL.absoluteString,
+                            AFSegmentedDownloadStateLengthKey: @(self.contentLength),
+                            AFSegmentedDownloadStateValidatorKey: self.validator,
+                            AFSegmentedDownloadStateSegmentsKey: savedSegments,
+                            };
+    [state writeToURL:[self stateFileURL] atomically:YES];
+    pthread_mutex_unlock(&_saveMutex);
+}
+
+#pragma mark -
+
+- (void)finishWithFileURL:(NSURL *)fileURL
+                    error:(NSError *)error
+{
+    pthread_mutex_lock(&_mutex);
+    BOOL finishes = !self.finished;
+    self.finished = YES;
+    void (^completionHandler)(NSURL *fileURL, NSError *error) = self.completionHandler;
+    self.completionHandler = nil;
+    pthread_mutex_unlock(&_mutex);
+
+    if (!finishes || !completionHandler) {
+        return;
+    }
+
+    dispatch_async(self.sessionManager.completionQueue ?: dispatch_get_main_queue(), ^{
+        completionHandler(fileURL, error);
+    });
+}
+
+@end
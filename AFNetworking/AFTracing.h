@@ -0,0 +1,109 @@
+// AFTracing.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The number of spans each thread keeps. Once a thread has recorded more, its oldest spans are overwritten.
+ */
+FOUNDATION_EXPORT NSUInteger const AFTraceBufferCapacity;
+
+/**
+ Whether spans are recorded. Read directly by `AFTraceBegin()`, so that instrumentation costs a single load and branch while tracing is disabled. Use the `enabled` property of `AFTracer` to change it.
+ */
+FOUNDATION_EXPORT BOOL AFTracingEnabled;
+
+/**
+ Returns the current time in the units used by spans.
+ */
+FOUNDATION_EXPORT uint64_t AFTraceCurrentTime(void);
+
+/**
+ Records a span in the buffer of the calling thread. The buffer is only written by its thread, and is read without locking when the trace is exported.
+
+ @param name The name of the span. It is not copied, and must live as long as the process, such as a string literal.
+ @param category The category of the span. It is not copied, and must live as long as the process.
+ @param beginTime The time at which the span began, as returned by `AFTraceCurrentTime()`.
+ @param endTime The time at which the span ended, as returned by `AFTraceCurrentTime()`.
+ */
+FOUNDATION_EXPORT void AFTraceRecordSpan(const char *name, const char *category, uint64_t beginTime, uint64_t endTime);
+
+/**
+ Begins a span, returning the value to pass to `AFTraceEnd()`, or `0` if tracing is disabled.
+ */
+static inline uint64_t AFTraceBegin(void) {
+    return AFTracingEnabled ? AFTraceCurrentTime() : 0;
+}
+
+/**
+ Ends a span begun by `AFTraceBegin()`. Does nothing if tracing was disabled when the span began.
+ */
+static inline void AFTraceEnd(uint64_t beginTime, const char *name, const char *category) {
+    if (beginTime != 0) {
+        AFTraceRecordSpan(name, category, beginTime, AFTraceCurrentTime());
+    }
+}
+
+#pragma mark -
+
+/**
+ `AFTracer` controls the recording of spans around the internal stages of AFNetworking, such as request serialization, multipart stream reads, session delegate callbacks, response serialization, image decoding and cache purges, and exports them in the Chrome trace event format, which can be loaded in `chrome://tracing` or Perfetto.
+
+ Each thread records its spans in its own ring buffer of `AFTraceBufferCapacity` spans, so that threads never wait for each other. Buffers are allocated the first time a thread records a span while tracing is enabled, and reused by later threads once their thread exits.
+ */
+@interface AFTracer : NSObject
+
+/**
+ Whether spans are recorded. `NO` by default.
+ */
+@property (nonatomic, assign, getter = isEnabled) BOOL enabled;
+
+/**
+ Returns the shared tracer.
+ */
++ (instancetype)sharedTracer;
+
+/**
+ Returns the spans recorded by every thread since the last call to `-removeAllSpans`, as a JSON object in the Chrome trace event format. Spans may be recorded while the trace is exported; those overwritten during the export are left out.
+ */
+- (NSData *)chromeTraceData;
+
+/**
+ Writes the data returned by `-chromeTraceData` to the specified file.
+
+ @param URL The URL of the file to write.
+ @param error The error that occurred while writing the file, if any.
+
+ @return Whether the file was written.
+ */
+- (BOOL)writeChromeTraceToURL:(NSURL *)URL
+                        error:(NSError * _Nullable __autoreleasing *)error;
+
+/**
+ Leaves every span recorded so far out of later exports.
+ */
+- (void)removeAllSpans;
+
+@end
+
+NS_ASSUME_NONNULL_END
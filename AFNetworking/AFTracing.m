@@ -0,0 +1,215 @@
+// AFTracing.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFTracing.h"
+
+#import <mach/mach_time.h>
+#import <pthread.h>
+#import <stdatomic.h>
+#import <unistd.h>
+
+enum {
+    AFTraceBufferSpanCount = 2048,
+};
+
+NSUInteger const AFTraceBufferCapacity = AFTraceBufferSpanCount;
+
+BOOL AFTracingEnabled = NO;
+
+typedef struct {
+    const char *name;
+    const char *category;
+    uint64_t threadIdentifier;
+    uint64_t beginTime;
+    uint64_t endTime;
+} AFTraceSpan;
+
+typedef struct AFTraceBuffer {
+    struct AFTraceBuffer *next;
+    _Atomic(bool) owned;
+    uint64_t threadIdentifier;
+    _Atomic(uint64_t) writeIndex;
+    AFTraceSpan spans[AFTraceBufferSpanCount];
+} AFTraceBuffer;
+
+static _Atomic(AFTraceBuffer *) AFTraceBuffers = NULL;
+static _Atomic(uint64_t) AFTraceClearTime = 0;
+static pthread_key_t AFTraceBufferKey;
+
+uint64_t AFTraceCurrentTime(void) {
+    return mach_absolute_time();
+}
+
+static double AFTraceMicrosecondsPerTimeUnit(void) {
+    static double microsecondsPerTimeUnit = 0.0;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        mach_timebase_info_data_t timebase;
+        mach_timebase_info(&timebase);
+        microsecondsPerTimeUnit = (double)timebase.numer / (double)timebase.denom / NSEC_PER_USEC;
+    });
+
+    return microsecondsPerTimeUnit;
+}
+
+// Buffers are never freed: when a thread exits, its buffer is released for the next thread to claim, keeping the spans it recorded until they are overwritten.
+static void AFTraceBufferRelease(void *buffer) {
+    atomic_store_explicit(&((AFTraceBuffer *)buffer)->owned, false, memory_order_release);
+}
+
+static AFTraceBuffer * AFTraceCurrentThreadBuffer(void) {
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&AFTraceBufferKey, AFTraceBufferRelease);
+    });
+
+    AFTraceBuffer *buffer = pthread_getspecific(AFTraceBufferKey);
+    if (buffer) {
+        return buffer;
+    }
+
+    for (buffer = atomic_load_explicit(&AFTraceBuffers, memory_order_acquire); buffer; buffer = buffer->next) {
+        bool owned = false;
+        if (atomic_compare_exchange_strong_explicit(&buffer->owned, &owned, true, memory_order_acquire, memory_order_relaxed)) {
+            break;
+        }
+    }
+
+    if (!buffer) {
+        buffer = calloc(1, sizeof(AFTraceBuffer));
+        if (!buffer) {
+            return NULL;
+        }
+        atomic_init(&buffer->owned, true);
+
+        AFTraceBuffer *head = atomic_load_explicit(&AFTraceBuffers, memory_order_relaxed);
+        do {
+            buffer->next = head;
+        } while (!atomic_compare_exchange_weak_explicit(&AFTraceBuffers, &head, buffer, memory_order_release, memory_order_relaxed));
+    }
+
+    pthread_threadid_np(NULL, &buffer->threadIdentifier);
+    pthread_setspecific(AFTraceBufferKey, buffer);
+
+    return buffer;
+}
+
+void AFTraceRecordSpan(const char *name, const char *category, uint64_t beginTime, uint64_t endTime) {
+    AFTraceBuffer *buffer = AFTraceCurrentThreadBuffer();
+    if (!buffer) {
+        return;
+    }
+
+    uint64_t writeIndex = atomic_load_explicit(&buffer->writeIndex, memory_order_relaxed);
+    AFTraceSpan *span = &buffer->spans[writeIndex % AFTraceBufferSpanCount];
+    span->name = name;
+    span->category = category;
+    span->threadIdentifier = buffer->threadIdentifier;
+    span->beginTime = beginTime;
+    span->endTime = endTime;
+    atomic_store_explicit(&buffer->writeIndex, writeIndex + 1, memory_order_release);
+}
+
+static NSArray <NSDictionary *> * AFTraceEventsFromBuffer(AFTraceBuffer *buffer, uint64_t clearTime, double microsecondsPerTimeUnit, NSNumber *processIdentifier) {
+    uint64_t endIndex = atomic_load_explicit(&buffer->writeIndex, memory_order_acquire);
+    uint64_t startIndex = endIndex > AFTraceBufferSpanCount ? endIndex - AFTraceBufferSpanCount : 0;
+
+    AFTraceSpan *spans = malloc(MAX((size_t)(endIndex - startIndex), (size_t)1) * sizeof(AFTraceSpan));
+    for (uint64_t index = startIndex; index < endIndex; index++) {
+        spans[index - startIndex] = buffer->spans[index % AFTraceBufferSpanCount];
+    }
+
+    // The owning thread may have wrapped around while the spans were copied. Slots up to the one it may be writing now can no longer be trusted.
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t writeIndex = atomic_load_explicit(&buffer->writeIndex, memory_order_relaxed);
+    uint64_t firstValidIndex = writeIndex >= AFTraceBufferSpanCount ? writeIndex - AFTraceBufferSpanCount + 1 : 0;
+
+    NSMutableArray <NSDictionary *> *events = [NSMutableArray arrayWithCapacity:(NSUInteger)(endIndex - startIndex)];
+    for (uint64_t index = MAX(startIndex, firstValidIndex); index < endIndex; index++) {
+        AFTraceSpan span = spans[index - startIndex];
+        if (span.beginTime < clearTime || !span.name) {
+            continue;
+        }
+
+        [events addObject:@{
+            @"name": @(span.name),
+            @"cat": span.category ? @(span.category) : @"",
+            @"ph": @"X",
+            @"ts": @((double)span.beginTime * microsecondsPerTimeUnit),
+            @"dur": @((double)(span.endTime - span.beginTime) * microsecondsPerTimeUnit),
+            @"pid": processIdentifier,
+            @"tid": @(span.threadIdentifier),
+        }];
+    }
+
+    free(spans);
+
+    return events;
+}
+
+#pragma mark -
+
+@implementation AFTracer
+
++ (instancetype)sharedTracer {
+    static AFTracer *_sharedTracer = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _sharedTracer = [[self alloc] init];
+    });
+
+    return _sharedTracer;
+}
+
+- (BOOL)isEnabled {
+    return AFTracingEnabled;
+}
+
+- (void)setEnabled:(BOOL)enabled {
+    AFTracingEnabled = enabled;
+}
+
+- (NSData *)chromeTraceData {
+    uint64_t clearTime = atomic_load_explicit(&AFTraceClearTime, memory_order_relaxed);
+    double microsecondsPerTimeUnit = AFTraceMicrosecondsPerTimeUnit();
+    NSNumber *processIdentifier = @(getpid());
+
+    NSMutableArray <NSDictionary *> *events = [NSMutableArray array];
+    for (AFTraceBuffer *buffer = atomic_load_explicit(&AFTraceBuffers, memory_order_acquire); buffer; buffer = buffer->next) {
+        [events addObjectsFromArray:AFTraceEventsFromBuffer(buffer, clearTime, microsecondsPerTimeUnit, processIdentifier)];
+    }
+
+    return [NSJSONSerialization dataWithJSONObject:@{@"traceEvents": events, @"displayTimeUnit": @"ms"} options:(NSJSONWritingOptions)0 error:nil];
+}
+
+- (BOOL)writeChromeTraceToURL:(NSURL *)URL
+                        error:(NSError * __autoreleasing *)error
+{
+    NSParameterAssert(URL);
+
+    return [[self chromeTraceData] writeToURL:URL options:NSDataWritingAtomic error:error];
+}
+
+- (void)removeAllSpans {
+    atomic_store_explicit(&AFTraceClearTime, AFTraceCurrentTime(), memory_order_relaxed);
+}
+
+@end
@@ -20,6 +20,7 @@
 // THE SOFTWARE.
 
 #import "AFURLRequestSerialization.h"
+#import "AFTracing.h"
 
 #if TARGET_OS_IOS || TARGET_OS_WATCH || TARGET_OS_TV
 #import <MobileCoreServices/MobileCoreServices.h>
@@ -373,7 +374,9 @@ forHTTPHeaderField:(NSString *)field
         }
     }
 
+    uint64_t traceBeginTime = AFTraceBegin();
     mutableRequest = [[self requestBySerializingRequest:mutableRequest withParameters:parameters error:error] mutableCopy];
+    AFTraceEnd(traceBeginTime, "requestBySerializingRequest:withParameters:error:", "serialization");
 
 	return mutableRequest;
 }
@@ -905,6 +908,7 @@ NSTimeInterval const kAFUploadStream3GSuggestedDelay = 0.2;
         return 0;
     }
 
+    uint64_t traceBeginTime = AFTraceBegin();
     NSInteger totalNumberOfBytesRead = 0;
 
     while ((NSUInteger)totalNumberOfBytesRead < MIN(length, self.numberOfBytesInPacket)) {
@@ -928,6 +932,8 @@ NSTimeInterval const kAFUploadStream3GSuggestedDelay = 0.2;
         }
     }
 
+    AFTraceEnd(traceBeginTime, "multipart body stream read", "stream");
+
     return totalNumberOfBytesRead;
 }
 
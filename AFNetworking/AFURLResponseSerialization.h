@@ -80,6 +80,11 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, copy, nullable) NSSet <NSString *> *acceptableContentTypes;
 
+/**
+ The maximum length, in bytes, of the response data a session manager loads for this serializer. When the data received exceeds this length, the transfer is stopped and the task fails with an `NSURLErrorDataLengthExceedsMaximum` error in the `AFURLResponseSerializationErrorDomain`. `0`, the default, sets no limit.
+ */
+@property (nonatomic, assign) NSUInteger maximumResponseDataLength;
+
 /**
  Validates the specified response and data.
 
@@ -95,6 +100,21 @@ NS_ASSUME_NONNULL_BEGIN
                     data:(nullable NSData *)data
                    error:(NSError * _Nullable __autoreleasing *)error;
 
+/**
+ Validates the status code and content type of the specified response when its headers are received, before its data is loaded.
+
+ Unlike `-validateResponse:data:error:`, an unacceptable content type is reported even if no data was received, unless the response announces an empty body. Domain-specific checks added by subclasses to `-validateResponse:data:error:` are not performed.
+
+ @param response The response to be validated.
+ @param data The part of the response data received so far, if any, which is included in the error.
+ @param error The error that occurred while attempting to validate the response.
+
+ @return `YES` if the response is valid, otherwise `NO`.
+ */
+- (BOOL)validateResponseBeforeLoadingData:(nullable NSHTTPURLResponse *)response
+                              partialData:(nullable NSData *)data
+                                    error:(NSError * _Nullable __autoreleasing *)error;
+
 @end
 
 #pragma mark -
@@ -267,6 +287,70 @@ NS_ASSUME_NONNULL_BEGIN
 
 @end
 
+#pragma mark -
+
+/**
+ `AFLazyResponseObject` holds a validated response and its data, and only deserializes the data with its response serializer the first time the response object is requested. The response object, or the error that occurred while creating it, is kept, so that the data is deserialized at most once however many times and from however many threads the object is accessed.
+
+ Lazy response objects are passed to completion handlers in place of the response object by an `AFURLSessionManager` whose `defersResponseSerialization` property is set to `YES`.
+ */
+@interface AFLazyResponseObject : NSObject
+
+/**
+ The response.
+ */
+@property (readonly, nonatomic, strong, nullable) NSURLResponse *response;
+
+/**
+ The response data.
+ */
+@property (readonly, nonatomic, strong, nullable) NSData *data;
+
+/**
+ The serializer used to create the response object.
+ */
+@property (readonly, nonatomic, strong) id <AFURLResponseSerialization> responseSerializer;
+
+/**
+ Whether the response object has already been created.
+ */
+@property (readonly, nonatomic, assign, getter=isSerialized) BOOL serialized;
+
+/**
+ Initializes a lazy response object for the specified response and data.
+
+ @param response The response.
+ @param data The response data.
+ @param responseSerializer The serializer used to create the response object.
+
+ @return The newly-initialized lazy response object.
+ */
+- (instancetype)initWithResponse:(nullable NSURLResponse *)response
+                            data:(nullable NSData *)data
+              responseSerializer:(id <AFURLResponseSerialization>)responseSerializer NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Returns the response object, deserializing the response data on the current thread if it has not been deserialized yet. Threads requesting the response object while it is being created wait for it.
+
+ @param error The error that occurred while deserializing the response data, if any.
+
+ @return The response object.
+ */
+- (nullable id)responseObjectWithError:(NSError * _Nullable __autoreleasing *)error;
+
+/**
+ Asynchronously creates the response object on the specified queue, and calls the completion handler on that queue.
+
+ @param queue The queue on which the response data is deserialized and the completion handler is called. If `nil`, a global concurrent queue is used.
+ @param completionHandler The block called with the response object, and the error that occurred while deserializing the response data, if any.
+ */
+- (void)getResponseObjectOnQueue:(nullable dispatch_queue_t)queue
+               completionHandler:(void (^)(id _Nullable responseObject, NSError * _Nullable error))completionHandler;
+
+@end
+
 ///----------------
 /// @name Constants
 ///----------------
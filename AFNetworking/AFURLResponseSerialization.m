@@ -20,8 +20,10 @@
 // THE SOFTWARE.
 
 #import "AFURLResponseSerialization.h"
+#import "AFTracing.h"
 
 #import <TargetConditionals.h>
+#import <pthread.h>
 
 #if TARGET_OS_IOS
 #import <UIKit/UIKit.h>
@@ -108,6 +110,22 @@ static id AFJSONObjectByRemovingKeysWithNullValues(id JSONObject, NSJSONReadingO
 - (BOOL)validateResponse:(NSHTTPURLResponse *)response
                     data:(NSData *)data
                    error:(NSError * __autoreleasing *)error
+{
+    return [self validateResponse:response data:data reportsUnacceptableContentTypeWithoutData:NO error:error];
+}
+
+- (BOOL)validateResponseBeforeLoadingData:(NSHTTPURLResponse *)response
+                              partialData:(NSData *)data
+                                    error:(NSError * __autoreleasing *)error
+{
+    // A response announcing an empty body is not rejected for its content type, as it would not be once loaded either.
+    return [self validateResponse:response data:data reportsUnacceptableContentTypeWithoutData:(response.expectedContentLength != 0) error:error];
+}
+
+- (BOOL)validateResponse:(NSHTTPURLResponse *)response
+                    data:(NSData *)data
+reportsUnacceptableContentTypeWithoutData:(BOOL)reportsUnacceptableContentTypeWithoutData
+                   error:(NSError * __autoreleasing *)error
 {
     BOOL responseIsValid = YES;
     NSError *validationError = nil;
@@ -116,7 +134,7 @@ static id AFJSONObjectByRemovingKeysWithNullValues(id JSONObject, NSJSONReadingO
         if (self.acceptableContentTypes && ![self.acceptableContentTypes containsObject:[response MIMEType]] &&
             !([response MIMEType] == nil && [data length] == 0)) {
 
-            if ([data length] > 0 && [response URL]) {
+            if (([data length] > 0 || reportsUnacceptableContentTypeWithoutData) && [response URL]) {
                 NSMutableDictionary *mutableUserInfo = [@{
                                                           NSLocalizedDescriptionKey: [NSString stringWithFormat:NSLocalizedStringFromTable(@"Request failed: unacceptable content-type: %@", @"AFNetworking", nil), [response MIMEType]],
                                                           NSURLErrorFailingURLErrorKey:[response URL],
@@ -181,6 +199,7 @@ static id AFJSONObjectByRemovingKeysWithNullValues(id JSONObject, NSJSONReadingO
 
     self.acceptableStatusCodes = [decoder decodeObjectOfClass:[NSIndexSet class] forKey:NSStringFromSelector(@selector(acceptableStatusCodes))];
     self.acceptableContentTypes = [decoder decodeObjectOfClass:[NSIndexSet class] forKey:NSStringFromSelector(@selector(acceptableContentTypes))];
+    self.maximumResponseDataLength = (NSUInteger)[decoder decodeIntegerForKey:NSStringFromSelector(@selector(maximumResponseDataLength))];
 
     return self;
 }
@@ -188,6 +207,7 @@ static id AFJSONObjectByRemovingKeysWithNullValues(id JSONObject, NSJSONReadingO
 - (void)encodeWithCoder:(NSCoder *)coder {
     [coder encodeObject:self.acceptableStatusCodes forKey:NSStringFromSelector(@selector(acceptableStatusCodes))];
     [coder encodeObject:self.acceptableContentTypes forKey:NSStringFromSelector(@selector(acceptableContentTypes))];
+    [coder encodeInteger:(NSInteger)self.maximumResponseDataLength forKey:NSStringFromSelector(@selector(maximumResponseDataLength))];
 }
 
 #pragma mark - NSCopying
@@ -196,6 +216,7 @@ static id AFJSONObjectByRemovingKeysWithNullValues(id JSONObject, NSJSONReadingO
     AFHTTPResponseSerializer *serializer = [[[self class] allocWithZone:zone] init];
     serializer.acceptableStatusCodes = [self.acceptableStatusCodes copyWithZone:zone];
     serializer.acceptableContentTypes = [self.acceptableContentTypes copyWithZone:zone];
+    serializer.maximumResponseDataLength = self.maximumResponseDataLength;
 
     return serializer;
 }
@@ -682,22 +703,23 @@ static UIImage * AFInflatedImageFromResponseWithDataAtScale(NSHTTPURLResponse *r
         }
     }
 
+    uint64_t traceBeginTime = AFTraceBegin();
 #if TARGET_OS_IOS || TARGET_OS_TV || TARGET_OS_WATCH
+    UIImage *image = nil;
     if (self.automaticallyInflatesResponseImage) {
-        return AFInflatedImageFromResponseWithDataAtScale((NSHTTPURLResponse *)response, data, self.imageScale);
+        image = AFInflatedImageFromResponseWithDataAtScale((NSHTTPURLResponse *)response, data, self.imageScale);
     } else {
-        return AFImageWithDataAtScale(data, self.imageScale);
+        image = AFImageWithDataAtScale(data, self.imageScale);
     }
 #else
     // Ensure that the image is set to it's correct pixel width and height
     NSBitmapImageRep *bitimage = [[NSBitmapImageRep alloc] initWithData:data];
     NSImage *image = [[NSImage alloc] initWithSize:NSMakeSize([bitimage pixelsWide], [bitimage pixelsHigh])];
     [image addRepresentation:bitimage];
-
-    return image;
 #endif
+    AFTraceEnd(traceBeginTime, "image decode", "image");
 
-    return nil;
+    return image;
 }
 
 #pragma mark - NSSecureCoding
@@ -815,3 +837,77 @@ static UIImage * AFInflatedImageFromResponseWithDataAtScale(NSHTTPURLResponse *r
 }
 
 @end
+
+#pragma mark -
+
+@interface AFLazyResponseObject () {
+    pthread_mutex_t _lock;
+}
+@property (readwrite, nonatomic, strong) NSURLResponse *response;
+@property (readwrite, nonatomic, strong) NSData *data;
+@property (readwrite, nonatomic, strong) id <AFURLResponseSerialization> responseSerializer;
+@property (readwrite, nonatomic, strong) id responseObject;
+@property (readwrite, nonatomic, strong) NSError *serializationError;
+@property (readwrite, nonatomic, assign, getter=isSerialized) BOOL serialized;
+@end
+
+@implementation AFLazyResponseObject
+
+- (instancetype)initWithResponse:(NSURLResponse *)response
+                            data:(NSData *)data
+              responseSerializer:(id <AFURLResponseSerialization>)responseSerializer
+{
+    NSParameterAssert(responseSerializer);
+
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_lock, NULL);
+
+    self.response = response;
+    self.data = data;
+    self.responseSerializer = responseSerializer;
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_lock);
+}
+
+- (id)responseObjectWithError:(NSError * __autoreleasing *)error {
+    pthread_mutex_lock(&_lock);
+    if (!self.serialized) {
+        NSError *serializationError = nil;
+        self.responseObject = [self.responseSerializer responseObjectForResponse:self.response data:self.data error:&serializationError];
+        self.serializationError = serializationError;
+        self.serialized = YES;
+    }
+
+    id responseObject = self.responseObject;
+    NSError *serializationError = self.serializationError;
+    pthread_mutex_unlock(&_lock);
+
+    if (error) {
+        *error = serializationError;
+    }
+
+    return responseObject;
+}
+
+- (void)getResponseObjectOnQueue:(dispatch_queue_t)queue
+               completionHandler:(void (^)(id responseObject, NSError *error))completionHandler
+{
+    NSParameterAssert(completionHandler);
+
+    dispatch_async(queue ?: dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+        NSError *serializationError = nil;
+        id responseObject = [self responseObjectWithError:&serializationError];
+
+        completionHandler(responseObject, serializationError);
+    });
+}
+
+@end
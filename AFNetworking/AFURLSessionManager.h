@@ -25,6 +25,7 @@
 #import "AFURLResponseSerialization.h"
 #import "AFURLRequestSerialization.h"
 #import "AFSecurityPolicy.h"
+#import "AFURLSessionMetrics.h"
 #if !TARGET_OS_WATCH
 #import "AFNetworkReachabilityManager.h"
 #endif
@@ -87,6 +88,19 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+/**
+ The priority with which a task is scheduled by `-scheduleTask:priority:`. Queued tasks with a higher priority are started before those with a lower priority, and the priority of the task itself is set to match.
+
+ - `AFURLSessionTaskPriorityLow`: Work the user is not waiting for, such as background synchronization. Maps to `NSURLSessionTaskPriorityLow`.
+ - `AFURLSessionTaskPriorityDefault`: Maps to `NSURLSessionTaskPriorityDefault`.
+ - `AFURLSessionTaskPriorityHigh`: Work the user is waiting for. Maps to `NSURLSessionTaskPriorityHigh`.
+ */
+typedef NS_ENUM(NSInteger, AFURLSessionTaskPriority) {
+    AFURLSessionTaskPriorityLow,
+    AFURLSessionTaskPriorityDefault,
+    AFURLSessionTaskPriorityHigh
+};
+
 @interface AFURLSessionManager : NSObject <NSURLSessionDelegate, NSURLSessionTaskDelegate, NSURLSessionDataDelegate, NSURLSessionDownloadDelegate, NSSecureCoding, NSCopying>
 
 /**
@@ -131,25 +145,56 @@ NS_ASSUME_NONNULL_BEGIN
 ///----------------------------
 
 /**
- The data, upload, and download tasks currently run by the managed session.
+ The data, upload, and download tasks created by the manager that have not yet completed.
+
+ Task accessors are served from an index the manager keeps as tasks are created and completed, and never wait on the session or its delegate queue.
+
+ @warning Tasks created directly on `session`, rather than through the manager, are not included, whereas earlier versions returned every task of the session. Tasks that a background session restores when the manager is created are included. Use `-getTasksWithCompletionHandler:` to ask the session for all of its tasks.
  */
 @property (readonly, nonatomic, strong) NSArray <NSURLSessionTask *> *tasks;
 
 /**
- The data tasks currently run by the managed session.
+ The data tasks created by the manager that have not yet completed. Tasks created directly on `session` are not included; see `tasks`.
  */
 @property (readonly, nonatomic, strong) NSArray <NSURLSessionDataTask *> *dataTasks;
 
 /**
- The upload tasks currently run by the managed session.
+ The upload tasks created by the manager that have not yet completed. Tasks created directly on `session` are not included; see `tasks`.
  */
 @property (readonly, nonatomic, strong) NSArray <NSURLSessionUploadTask *> *uploadTasks;
 
 /**
- The download tasks currently run by the managed session.
+ The download tasks created by the manager that have not yet completed. Tasks created directly on `session` are not included; see `tasks`.
  */
 @property (readonly, nonatomic, strong) NSArray <NSURLSessionDownloadTask *> *downloadTasks;
 
+/**
+ The number of tasks created by the manager that have not yet completed. Unlike `tasks`, this does not build an array.
+ */
+@property (readonly, nonatomic, assign) NSUInteger taskCount;
+
+/**
+ The number of data tasks created by the manager that have not yet completed.
+ */
+@property (readonly, nonatomic, assign) NSUInteger dataTaskCount;
+
+/**
+ The number of upload tasks created by the manager that have not yet completed.
+ */
+@property (readonly, nonatomic, assign) NSUInteger uploadTaskCount;
+
+/**
+ The number of download tasks created by the manager that have not yet completed.
+ */
+@property (readonly, nonatomic, assign) NSUInteger downloadTaskCount;
+
+/**
+ Asynchronously asks the managed session for all of its data, upload, and download tasks.
+
+ @param completionHandler A block to be executed on the `completionQueue` with the tasks of the session, including tasks that were not created by the manager.
+ */
+- (void)getTasksWithCompletionHandler:(void (^)(NSArray <NSURLSessionDataTask *> *dataTasks, NSArray <NSURLSessionUploadTask *> *uploadTasks, NSArray <NSURLSessionDownloadTask *> *downloadTasks))completionHandler;
+
 ///-------------------------------
 /// @name Managing Callback Queues
 ///-------------------------------
@@ -164,6 +209,194 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, strong, nullable) dispatch_group_t completionGroup;
 
+///-------------------------------------
+/// @name Dispatching Delegate Callbacks
+///-------------------------------------
+
+/**
+ The number of serial lanes onto which task delegate callbacks are dispatched. `0` by default.
+
+ When `0`, every session callback runs on `operationQueue`, one at a time. Otherwise, `operationQueue` only routes each task callback onto a lane chosen by task identifier: callbacks for a given task keep their order, while callbacks for different tasks run concurrently. The task callback blocks set on the manager must then be safe to call from several threads at once. This should be set before any task is created.
+ */
+@property (nonatomic, assign) NSUInteger delegateLaneCount;
+
+///-----------------------
+/// @name Scheduling Tasks
+///-----------------------
+
+/**
+ The maximum number of tasks started by `-scheduleTask:priority:` that may run at once. `0`, the default, means no limit.
+ */
+@property (nonatomic, assign) NSUInteger maximumActiveTasks;
+
+/**
+ The maximum number of tasks started by `-scheduleTask:priority:` that may run at once against a single host. `0`, the default, means no limit.
+ */
+@property (nonatomic, assign) NSUInteger maximumActiveTasksPerHost;
+
+/**
+ The maximum number of tasks that `-scheduleTask:priority:` starts per second. Short bursts of up to that many tasks are allowed. `0`, the default, means no limit.
+ */
+@property (nonatomic, assign) double maximumTaskStartsPerSecond;
+
+/**
+ The maximum number of tasks that `-scheduleTask:priority:` starts per second against a single host. `0`, the default, means no limit.
+ */
+@property (nonatomic, assign) double maximumTaskStartsPerSecondPerHost;
+
+/**
+ The time, in seconds, after which a queued task is treated as if it had the next higher priority, so that low priority tasks cannot be starved by a steady stream of higher priority ones. `5` by default. `0` disables aging.
+ */
+@property (nonatomic, assign) NSTimeInterval taskPriorityAgingInterval;
+
+/**
+ The number of tasks waiting to be started by the scheduler.
+ */
+@property (readonly, nonatomic, assign) NSUInteger queuedTaskCount;
+
+/**
+ Resumes the specified task as soon as the scheduling limits of the manager allow it, ahead of queued tasks with a lower priority.
+
+ When no limit is set, the task is resumed immediately. Limits only apply to tasks started through this method; tasks resumed directly are neither counted nor delayed. Cancelling a queued task removes it from the queue. The convenience methods of `AFHTTPSessionManager` schedule their tasks with `AFURLSessionTaskPriorityDefault`.
+
+ @param task A suspended task created by the manager.
+ @param priority The priority of the task.
+ */
+- (void)scheduleTask:(NSURLSessionTask *)task
+            priority:(AFURLSessionTaskPriority)priority;
+
+/**
+ Schedules the specified task with `AFURLSessionTaskPriorityDefault`.
+
+ @param task A suspended task created by the manager.
+ */
+- (void)scheduleTask:(NSURLSessionTask *)task;
+
+/**
+ Sets a block to be executed when the scheduler is about to resume a task, as handled by `-scheduleTask:priority:`.
+
+ @param block A block object to be executed when the scheduler is about to resume a task. The block has no return value, and takes three arguments: the session, the task, and the time in seconds the task waited in the queue.
+ */
+- (void)setTaskWillStartFromSchedulerBlock:(nullable void (^)(NSURLSession *session, NSURLSessionTask *task, NSTimeInterval queueWaitTime))block;
+
+///---------------------------------
+/// @name Posting Task Notifications
+///---------------------------------
+
+/**
+ Whether `AFNetworkingTaskDidResumeNotification` and `AFNetworkingTaskDidSuspendNotification` are posted when tasks created by the manager are resumed or suspended. `YES` by default.
+
+ State changes are dispatched directly to the manager that created the task. Applications that do not observe these notifications can set this property to `NO` to avoid posting one to the main queue for every state change.
+ */
+@property (nonatomic, assign) BOOL postsTaskResumeAndSuspendNotifications;
+
+///------------------------------
+/// @name Reporting Task Progress
+///------------------------------
+
+/**
+ The minimum interval, in seconds, between invocations of a task's upload or download progress block. `1.0 / 30.0` by default.
+
+ Updates arriving more frequently are coalesced. The update that completes a transfer, and the most recent update when a task completes, are always delivered. Changing this value only affects tasks created afterwards. `NSProgress` objects returned by `-uploadProgressForTask:` and `-downloadProgressForTask:` are not throttled.
+ */
+@property (nonatomic, assign) NSTimeInterval minimumProgressReportingInterval;
+
+///-------------------------------
+/// @name Caching Response Objects
+///-------------------------------
+
+/**
+ The total cost, in bytes of response data, of the response objects the manager may keep to avoid deserializing identical responses again. `0`, the default, disables the cache.
+
+ Objects are keyed by response URL, strong `ETag` or SHA-256 digest of the body, content type, and by the configuration of the response serializer. Changing a setting of the serializer, or of the serializers of an `AFCompoundResponseSerializer`, removes the cached objects, and a cached object is only returned once the serializer has validated the response again. Cached objects are shared between every task that receives an identical response, and must not be mutated. For that reason, only objects created by the serializers provided by AFNetworking and configured to return immutable objects are cached, and responses smaller than 1 KB are always deserialized.
+ */
+@property (nonatomic, assign) NSUInteger responseObjectCacheCostLimit;
+
+/**
+ Returns the object created by `responseSerializer` for the specified response and data, reusing a cached object when an identical response has already been deserialized.
+
+ @param response The response.
+ @param data The response data.
+ @param error The error that occurred while deserializing the response data, if any.
+
+ @return The response object.
+ */
+- (nullable id)responseObjectForResponse:(nullable NSURLResponse *)response
+                                    data:(nullable NSData *)data
+                                   error:(NSError * _Nullable __autoreleasing *)error;
+
+///---------------------------------------
+/// @name Deferring Response Serialization
+///---------------------------------------
+
+/**
+ Whether the response data of data and upload tasks is deserialized only when the response object is first accessed. `NO` by default.
+
+ When `YES`, and `responseSerializer` is an `AFHTTPResponseSerializer`, the response is still validated before the completion handler is called, but completion handlers receive an `AFLazyResponseObject` instead of the deserialized response object, so that responses which are never read are never parsed. Responses which fail validation, download tasks, and other response serializers are handled as usual.
+ */
+@property (nonatomic, assign) BOOL defersResponseSerialization;
+
+///--------------------------------------
+/// @name Validating Responses on Receipt
+///--------------------------------------
+
+/**
+ Whether data and upload tasks validate the status code and content type of their response as soon as its headers are received, rather than once all of its data is loaded. `NO` by default.
+
+ When `YES`, and `responseSerializer` is an `AFHTTPResponseSerializer`, responses rejected by `-validateResponseBeforeLoadingData:partialData:error:` stop loading after `maximumRejectedResponseDataLength` bytes, and the task fails with the validation error for the data received so far, as it would once all of the data was loaded. The block set with `-setDataTaskDidReceiveResponseBlock:` is not called for rejected responses.
+ */
+@property (nonatomic, assign) BOOL validatesResponsesOnReceipt;
+
+/**
+ The maximum length, in bytes, of the data loaded for a response rejected on receipt, such as the body of an error page. `0`, the default, cancels the transfer as soon as the response is rejected.
+ */
+@property (nonatomic, assign) NSUInteger maximumRejectedResponseDataLength;
+
+///------------------------------
+/// @name Loading Large Responses
+///------------------------------
+
+/**
+ The maximum length, in bytes, of the response data of a task kept in memory while it is loaded. `0`, the default, sets no limit.
+
+ Once the data received by a task exceeds this length, it is written to a temporary file as it is received, and passed to the response serializer as data mapped from that file, so that the memory used by the task stays the same however large its response is. Data tasks whose response announces a `Content-Length` above this length become download tasks as soon as the response is received, unless a block set with `-setDataTaskDidReceiveResponseBlock:` returns a disposition other than `NSURLSessionResponseAllow`, or the response serializer limits the length of the response data. Task notifications are then posted for the download task.
+ */
+@property (nonatomic, assign) NSUInteger maximumInMemoryResponseDataLength;
+
+///----------------------------
+/// @name Measuring Task Phases
+///----------------------------
+
+/**
+ Whether the manager measures the time each task spends in each of its phases, from the serialization of its request to the delivery of its completion handler. `NO` by default.
+
+ The cost of measuring a task is a handful of clock reads and atomic increments, and is meant to be low enough to leave enabled in production. Metrics are only collected for tasks created while this property is `YES`.
+ */
+@property (nonatomic, assign) BOOL collectsTaskPhaseMetrics;
+
+/**
+ The recorder aggregating the phase metrics of the completed tasks of the manager into a histogram per phase and host. Call `-snapshot` on it to read the histograms.
+ */
+@property (readonly, nonatomic, strong) AFURLSessionMetricsRecorder *taskPhaseMetricsRecorder;
+
+/**
+ Records the time spent by the specified task in the specified phase, such as the time a subclass spent building its request. Does nothing if the task has no phase metrics. This must be called before the task completes.
+
+ @param duration The time, in seconds, spent in the phase.
+ @param phase The phase.
+ @param task The task.
+ */
+- (void)recordDuration:(NSTimeInterval)duration
+               ofPhase:(AFURLSessionTaskPhase)phase
+               forTask:(nullable NSURLSessionTask *)task;
+
+/**
+ Sets a block to be executed once the phase metrics of a task are complete, just before its completion handler is called.
+
+ @param block A block object to be executed once the phase metrics of a task are complete. The block has no return value, and takes three arguments: the session, the task, and its phase metrics. The block is executed on the completion queue.
+ */
+- (void)setTaskDidFinishCollectingPhaseMetricsBlock:(nullable void (^)(NSURLSession *session, NSURLSessionTask *task, AFURLSessionTaskPhaseMetrics *metrics))block;
+
 ///---------------------------------
 /// @name Working Around System Bugs
 ///---------------------------------
@@ -223,6 +456,66 @@ NS_ASSUME_NONNULL_BEGIN
                              downloadProgress:(nullable void (^)(NSProgress *downloadProgress))downloadProgressBlock
                             completionHandler:(nullable void (^)(NSURLResponse *response, id _Nullable responseObject,  NSError * _Nullable error))completionHandler;
 
+/**
+ Creates an `NSURLSessionDataTask` with the specified request, whose completion handler is also passed the raw response data, such as for caching it.
+
+ @param request The HTTP request for the request.
+ @param uploadProgressBlock A block object to be executed when the upload progress is updated. Note this block is called on the session queue, not the main queue.
+ @param downloadProgressBlock A block object to be executed when the download progress is updated. Note this block is called on the session queue, not the main queue.
+ @param completionHandler A block object to be executed when the task finishes. This block has no return value and takes four arguments: the server response, the data received, the response object created by that serializer, and the error that occurred, if any.
+ */
+- (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request
+                               uploadProgress:(nullable void (^)(NSProgress *uploadProgress))uploadProgressBlock
+                             downloadProgress:(nullable void (^)(NSProgress *downloadProgress))downloadProgressBlock
+                        dataCompletionHandler:(nullable void (^)(NSURLResponse *response, NSData * _Nullable data, id _Nullable responseObject, NSError * _Nullable error))completionHandler;
+
+/**
+ Creates an `NSURLSessionDataTask` with the specified request, whose response data is passed to a handler as it is received rather than accumulated, such as for consuming a stream of records or a log.
+
+ Chunks are passed to the chunk handler one at a time and in order, on a serial queue targeting `completionQueue`, and the completion handler is called on the same queue once every chunk has been handled. When the chunks received but not yet handled exceed the high watermark, the task is suspended until they drop back to the low watermark, so that a slow chunk handler holds back the transfer instead of letting chunks pile up in memory.
+
+ @param request The HTTP request for the request.
+ @param highWatermark The length, in bytes, of the chunks waiting to be handled above which the task is suspended. If `0`, the task is never suspended.
+ @param lowWatermark The length, in bytes, of the chunks waiting to be handled at or below which a suspended task is resumed. Must not be greater than `highWatermark`.
+ @param chunkHandler A block object to be executed for each chunk of the response data. This block has no return value and takes a single argument: the chunk.
+ @param completionHandler A block object to be executed when the task finishes. This block has no return value and takes two arguments: the server response, and the error that occurred, if any. The response is validated by the response serializer, without any data.
+ */
+- (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request
+                                highWatermark:(NSUInteger)highWatermark
+                                 lowWatermark:(NSUInteger)lowWatermark
+                                 chunkHandler:(void (^)(NSData *chunk))chunkHandler
+                            completionHandler:(nullable void (^)(NSURLResponse *response, NSError * _Nullable error))completionHandler;
+
+/**
+ Creates an `NSURLSessionDataTask` with the specified request, whose response data is passed to a handler on the specified queue as it is received rather than accumulated.
+
+ Behaves like `-dataTaskWithRequest:highWatermark:lowWatermark:chunkHandler:completionHandler:`, except that chunks are handled, and the completion handler called, on a serial queue targeting the specified queue instead of `completionQueue`. This allows chunks to be handled off the main queue, such as for writing them to a file.
+
+ @param request The HTTP request for the request.
+ @param highWatermark The length, in bytes, of the chunks waiting to be handled above which the task is suspended. If `0`, the task is never suspended.
+ @param lowWatermark The length, in bytes, of the chunks waiting to be handled at or below which a suspended task is resumed. Must not be greater than `highWatermark`.
+ @param queue The queue targeted by the queue on which chunks are handled. If `nil`, `completionQueue` is used.
+ @param chunkHandler A block object to be executed for each chunk of the response data. This block has no return value and takes a single argument: the chunk.
+ @param completionHandler A block object to be executed when the task finishes. This block has no return value and takes two arguments: the server response, and the error that occurred, if any.
+ */
+- (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request
+                                highWatermark:(NSUInteger)highWatermark
+                                 lowWatermark:(NSUInteger)lowWatermark
+                                        queue:(nullable dispatch_queue_t)queue
+                                 chunkHandler:(void (^)(NSData *chunk))chunkHandler
+                            completionHandler:(nullable void (^)(NSURLResponse *response, NSError * _Nullable error))completionHandler;
+
+/**
+ Creates an `NSURLSessionDataTask` for each of the specified requests. The tasks are registered with the manager all at once, which is cheaper than creating them one at a time when fanning out many requests.
+
+ @param requests The HTTP requests.
+ @param completionHandler A block object to be executed when each task finishes. This block has no return value and takes four arguments: the task that finished, the server response, the response object created by that serializer, and the error that occurred, if any.
+
+ @return The data tasks, in the same order as `requests`.
+ */
+- (NSArray <NSURLSessionDataTask *> *)dataTasksWithRequests:(NSArray <NSURLRequest *> *)requests
+                                           completionHandler:(nullable void (^)(NSURLSessionDataTask *task, NSURLResponse *response, id _Nullable responseObject, NSError * _Nullable error))completionHandler;
+
 ///---------------------------
 /// @name Running Upload Tasks
 ///---------------------------
@@ -497,4 +790,14 @@ FOUNDATION_EXPORT NSString * const AFNetworkingTaskDidCompleteAssetPathKey;
  */
 FOUNDATION_EXPORT NSString * const AFNetworkingTaskDidCompleteErrorKey;
 
+/**
+ The time in seconds the task waited in the queue of its manager before being resumed, as an `NSNumber`. Included in the userInfo dictionary of the `AFNetworkingTaskDidCompleteNotification` if the task was started with `-scheduleTask:priority:`.
+ */
+FOUNDATION_EXPORT NSString * const AFNetworkingTaskDidCompleteQueueWaitTimeKey;
+
+/**
+ The `AFURLSessionTaskPhaseMetrics` of the task. Included in the userInfo dictionary of the `AFNetworkingTaskDidCompleteNotification` if the manager collected phase metrics for the task.
+ */
+FOUNDATION_EXPORT NSString * const AFNetworkingTaskDidCompletePhaseMetricsKey;
+
 NS_ASSUME_NONNULL_END
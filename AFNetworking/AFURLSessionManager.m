@@ -20,8 +20,28 @@
 // THE SOFTWARE.
 
 #import "AFURLSessionManager.h"
+#import "AFTracing.h"
 #import <objc/runtime.h>
+#import <pthread.h>
+#import <CommonCrypto/CommonDigest.h>
+
+// Task identifiers could collide when tasks were created concurrently before iOS 8 and OS X 10.10, so creation is serialized on those systems only.
+// Open Radar:http://openradar.appspot.com/radar?id=5871104061079552 (status: Fixed in iOS8)
+// Issue about:https://github.com/AFNetworking/AFNetworking/issues/2093
+#if (defined(__IPHONE_OS_VERSION_MIN_REQUIRED) && __IPHONE_OS_VERSION_MIN_REQUIRED < 80000) || (defined(__MAC_OS_X_VERSION_MIN_REQUIRED) && __MAC_OS_X_VERSION_MIN_REQUIRED < 101000)
+#define AF_SERIALIZE_TASK_CREATION 1
+#else
+#define AF_SERIALIZE_TASK_CREATION 0
+#endif
+
+// `NSURLSessionTaskMetrics` is only declared by the iOS 10, macOS 10.12, watchOS 3 and tvOS 10 SDKs, and only reported by those systems.
+#if (defined(__IPHONE_OS_VERSION_MAX_ALLOWED) && __IPHONE_OS_VERSION_MAX_ALLOWED >= 100000) || (defined(__MAC_OS_X_VERSION_MAX_ALLOWED) && __MAC_OS_X_VERSION_MAX_ALLOWED >= 101200) || (defined(__WATCH_OS_VERSION_MAX_ALLOWED) && __WATCH_OS_VERSION_MAX_ALLOWED >= 30000)
+#define AF_CAN_COLLECT_TASK_METRICS 1
+#else
+#define AF_CAN_COLLECT_TASK_METRICS 0
+#endif
 
+#if AF_SERIALIZE_TASK_CREATION
 #ifndef NSFoundationVersionNumber_iOS_8_0
 #define NSFoundationVersionNumber_With_Fixed_5871104061079552_bug 1140.11
 #else
@@ -37,16 +57,17 @@ static dispatch_queue_t url_session_manager_creation_queue() {
 
     return af_url_session_manager_creation_queue;
 }
+#endif
 
 static void url_session_manager_create_task_safely(dispatch_block_t block) {
+#if AF_SERIALIZE_TASK_CREATION
     if (NSFoundationVersionNumber < NSFoundationVersionNumber_With_Fixed_5871104061079552_bug) {
-        // Fix of bug
-        // Open Radar:http://openradar.appspot.com/radar?id=5871104061079552 (status: Fixed in iOS8)
-        // Issue about:https://github.com/AFNetworking/AFNetworking/issues/2093
         dispatch_sync(url_session_manager_creation_queue(), block);
-    } else {
-        block();
+        return;
     }
+#endif
+
+    block();
 }
 
 static dispatch_queue_t url_session_manager_processing_queue() {
@@ -80,10 +101,43 @@ NSString * const AFNetworkingTaskDidCompleteResponseSerializerKey = @"com.alamof
 NSString * const AFNetworkingTaskDidCompleteResponseDataKey = @"com.alamofire.networking.complete.finish.responsedata";
 NSString * const AFNetworkingTaskDidCompleteErrorKey = @"com.alamofire.networking.task.complete.error";
 NSString * const AFNetworkingTaskDidCompleteAssetPathKey = @"com.alamofire.networking.task.complete.assetpath";
-
-static NSString * const AFURLSessionManagerLockName = @"com.alamofire.networking.session.manager.lock";
+NSString * const AFNetworkingTaskDidCompleteQueueWaitTimeKey = @"com.alamofire.networking.task.complete.queuewaittime";
+NSString * const AFNetworkingTaskDidCompletePhaseMetricsKey = @"com.alamofire.networking.task.complete.phasemetrics";
 
 static NSUInteger const AFMaximumNumberOfAttemptsToRecreateBackgroundSessionUploadTask = 3;
+static NSUInteger const AFMinimumDataLengthForCachedResponseObject = 1024;
+
+static NSError * af_dataLengthExceedsMaximumError(NSURLResponse *response, NSData *data, NSUInteger maximumDataLength) {
+    NSMutableDictionary *mutableUserInfo = [NSMutableDictionary dictionary];
+    mutableUserInfo[NSLocalizedDescriptionKey] = [NSString stringWithFormat:NSLocalizedStringFromTable(@"Request failed: response data exceeds %lu bytes", @"AFNetworking", nil), (unsigned long)maximumDataLength];
+    mutableUserInfo[NSURLErrorFailingURLErrorKey] = response.URL;
+    mutableUserInfo[AFNetworkingOperationFailingURLResponseErrorKey] = response;
+    mutableUserInfo[AFNetworkingOperationFailingURLResponseDataErrorKey] = data;
+
+    return [NSError errorWithDomain:AFURLResponseSerializationErrorDomain code:NSURLErrorDataLengthExceedsMaximum userInfo:mutableUserInfo];
+}
+
+static NSURL * af_responseDataFileURL() {
+    NSString *fileName = [NSString stringWithFormat:@"com.alamofire.response-data-%@", [[NSUUID UUID] UUIDString]];
+
+    return [NSURL fileURLWithPath:[NSTemporaryDirectory() stringByAppendingPathComponent:fileName]];
+}
+
+static BOOL af_writeDataToStream(NSData *data, NSOutputStream *outputStream) {
+    const uint8_t *bytes = (const uint8_t *)data.bytes;
+    NSUInteger length = data.length;
+    while (length > 0) {
+        NSInteger bytesWritten = [outputStream write:bytes maxLength:length];
+        if (bytesWritten <= 0) {
+            return NO;
+        }
+
+        bytes += bytesWritten;
+        length -= (NSUInteger)bytesWritten;
+    }
+
+    return YES;
+}
 
 typedef void (^AFURLSessionDidBecomeInvalidBlock)(NSURLSession *session, NSError *error);
 typedef NSURLSessionAuthChallengeDisposition (^AFURLSessionDidReceiveAuthenticationChallengeBlock)(NSURLSession *session, NSURLAuthenticationChallenge *challenge, NSURLCredential * __autoreleasing *credential);
@@ -107,24 +161,100 @@ typedef void (^AFURLSessionDownloadTaskDidResumeBlock)(NSURLSession *session, NS
 typedef void (^AFURLSessionTaskProgressBlock)(NSProgress *);
 
 typedef void (^AFURLSessionTaskCompletionHandler)(NSURLResponse *response, id responseObject, NSError *error);
+typedef void (^AFURLSessionTaskDataCompletionHandler)(NSURLResponse *response, NSData *data, id responseObject, NSError *error);
+typedef void (^AFURLSessionDataTaskChunkHandler)(NSData *chunk);
+typedef void (^AFURLSessionTaskDidFinishCollectingPhaseMetricsBlock)(NSURLSession *session, NSURLSessionTask *task, AFURLSessionTaskPhaseMetrics *metrics);
 
 
 #pragma mark -
 
+#if AF_CAN_COLLECT_TASK_METRICS
+static void af_recordNetworkPhaseMetrics(AFURLSessionTaskPhaseMetrics *phaseMetrics, NSURLSessionTaskMetrics *metrics) {
+    // Earlier transactions are redirects or attempts answered from the cache; the last one produced the response.
+    NSURLSessionTaskTransactionMetrics *transactionMetrics = [metrics.transactionMetrics lastObject];
+    if (!transactionMetrics) {
+        return;
+    }
+
+    if (transactionMetrics.domainLookupStartDate && transactionMetrics.domainLookupEndDate) {
+        [phaseMetrics recordDuration:[transactionMetrics.domainLookupEndDate timeIntervalSinceDate:transactionMetrics.domainLookupStartDate] forPhase:AFURLSessionTaskPhaseDomainLookup];
+    }
+
+    if (transactionMetrics.connectStartDate && transactionMetrics.connectEndDate) {
+        NSDate *secureConnectionStartDate = transactionMetrics.secureConnectionStartDate;
+        if (secureConnectionStartDate && transactionMetrics.secureConnectionEndDate) {
+            [phaseMetrics recordDuration:[secureConnectionStartDate timeIntervalSinceDate:transactionMetrics.connectStartDate] forPhase:AFURLSessionTaskPhaseConnect];
+            [phaseMetrics recordDuration:[transactionMetrics.secureConnectionEndDate timeIntervalSinceDate:secureConnectionStartDate] forPhase:AFURLSessionTaskPhaseSecureConnection];
+        } else {
+            [phaseMetrics recordDuration:[transactionMetrics.connectEndDate timeIntervalSinceDate:transactionMetrics.connectStartDate] forPhase:AFURLSessionTaskPhaseConnect];
+        }
+    }
+
+    if (transactionMetrics.requestStartDate && transactionMetrics.responseStartDate) {
+        [phaseMetrics recordDuration:[transactionMetrics.responseStartDate timeIntervalSinceDate:transactionMetrics.requestStartDate] forPhase:AFURLSessionTaskPhaseTimeToFirstByte];
+    }
+
+    if (transactionMetrics.responseStartDate && transactionMetrics.responseEndDate) {
+        [phaseMetrics recordDuration:[transactionMetrics.responseEndDate timeIntervalSinceDate:transactionMetrics.responseStartDate] forPhase:AFURLSessionTaskPhaseBodyTransfer];
+    }
+}
+#endif
+
+@interface AFURLSessionManager ()
+- (void)taskDidFinishCollectingPhaseMetrics:(AFURLSessionTaskPhaseMetrics *)phaseMetrics forTask:(NSURLSessionTask *)task;
+@end
+
+typedef struct {
+    int64_t completedUnitCount;
+    int64_t totalUnitCount;
+    int64_t reportedUnitCount;
+    CFAbsoluteTime reportTime;
+} AFURLSessionTaskTransferState;
+
 @interface AFURLSessionManagerTaskDelegate : NSObject <NSURLSessionTaskDelegate, NSURLSessionDataDelegate, NSURLSessionDownloadDelegate>
 - (instancetype)initWithTask:(NSURLSessionTask *)task;
 @property (nonatomic, weak) AFURLSessionManager *manager;
+@property (nonatomic, weak) NSURLSessionTask *task;
 @property (nonatomic, strong) NSMutableData *mutableData;
-@property (nonatomic, strong) NSProgress *uploadProgress;
-@property (nonatomic, strong) NSProgress *downloadProgress;
+@property (nonatomic, assign) NSUInteger receivedDataLength;
+@property (nonatomic, copy) NSURL *responseDataFileURL;
+@property (nonatomic, strong) NSOutputStream *responseDataOutputStream;
+@property (nonatomic, strong) NSError *responseDataError;
+@property (nonatomic, assign) BOOL loadsResponseDataToFile;
+@property (readonly, nonatomic, strong) NSProgress *uploadProgress;
+@property (readonly, nonatomic, strong) NSProgress *downloadProgress;
+@property (nonatomic, assign) NSTimeInterval progressReportingInterval;
+@property (atomic, copy) NSNumber *queueWaitTime;
+@property (nonatomic, strong) AFURLSessionTaskPhaseMetrics *phaseMetrics;
 @property (nonatomic, copy) NSURL *downloadFileURL;
+@property (nonatomic, strong) AFHTTPResponseSerializer *rejectedResponseSerializer;
+@property (readonly, nonatomic, assign) NSUInteger maximumDataLength;
+@property (nonatomic, assign) BOOL exceededMaximumDataLength;
 @property (nonatomic, copy) AFURLSessionDownloadTaskDidFinishDownloadingBlock downloadTaskDidFinishDownloading;
 @property (nonatomic, copy) AFURLSessionTaskProgressBlock uploadProgressBlock;
 @property (nonatomic, copy) AFURLSessionTaskProgressBlock downloadProgressBlock;
 @property (nonatomic, copy) AFURLSessionTaskCompletionHandler completionHandler;
+@property (nonatomic, copy) AFURLSessionTaskDataCompletionHandler dataCompletionHandler;
+@property (nonatomic, copy) AFURLSessionDataTaskChunkHandler chunkHandler;
+@property (nonatomic, strong) dispatch_queue_t chunkQueue;
+@property (nonatomic, assign) NSUInteger highWatermark;
+@property (nonatomic, assign) NSUInteger lowWatermark;
+- (BOOL)acceptsResponse:(NSURLResponse *)response;
+- (BOOL)shouldBecomeDownloadTaskForResponse:(NSURLResponse *)response;
 @end
 
-@implementation AFURLSessionManagerTaskDelegate
+@implementation AFURLSessionManagerTaskDelegate {
+    pthread_mutex_t _progressMutex;
+    NSUInteger _maximumDataLength;
+    BOOL _resolvedMaximumDataLength;
+    pthread_mutex_t _chunkMutex;
+    NSUInteger _pendingChunkLength;
+    BOOL _suspendedForPendingChunks;
+    NSProgress *_uploadProgress;
+    NSProgress *_downloadProgress;
+    AFURLSessionTaskTransferState _uploadState;
+    AFURLSessionTaskTransferState _downloadState;
+}
 
 - (instancetype)initWithTask:(NSURLSessionTask *)task {
     self = [super init];
@@ -132,55 +262,143 @@ typedef void (^AFURLSessionTaskCompletionHandler)(NSURLResponse *response, id re
         return nil;
     }
     
+    _task = task;
     _mutableData = [NSMutableData data];
-    _uploadProgress = [[NSProgress alloc] initWithParent:nil userInfo:nil];
-    _downloadProgress = [[NSProgress alloc] initWithParent:nil userInfo:nil];
-    
-    __weak __typeof__(task) weakTask = task;
-    for (NSProgress *progress in @[ _uploadProgress, _downloadProgress ])
-    {
-        progress.totalUnitCount = NSURLSessionTransferSizeUnknown;
-        progress.cancellable = YES;
-        progress.cancellationHandler = ^{
-            [weakTask cancel];
-        };
-        progress.pausable = YES;
-        progress.pausingHandler = ^{
-            [weakTask suspend];
-        };
-        if ([progress respondsToSelector:@selector(setResumingHandler:)]) {
-            progress.resumingHandler = ^{
-                [weakTask resume];
-            };
-        }
-        [progress addObserver:self
-                   forKeyPath:NSStringFromSelector(@selector(fractionCompleted))
-                      options:NSKeyValueObservingOptionNew
-                      context:NULL];
-    }
+
+    pthread_mutex_init(&_progressMutex, NULL);
+    pthread_mutex_init(&_chunkMutex, NULL);
+    _uploadState.totalUnitCount = NSURLSessionTransferSizeUnknown;
+    _uploadState.reportedUnitCount = -1;
+    _downloadState.totalUnitCount = NSURLSessionTransferSizeUnknown;
+    _downloadState.reportedUnitCount = -1;
+
     return self;
 }
 
 - (void)dealloc {
-    [self.downloadProgress removeObserver:self forKeyPath:NSStringFromSelector(@selector(fractionCompleted))];
-    [self.uploadProgress removeObserver:self forKeyPath:NSStringFromSelector(@selector(fractionCompleted))];
+    pthread_mutex_destroy(&_progressMutex);
+    pthread_mutex_destroy(&_chunkMutex);
+
+    [_responseDataOutputStream close];
+    if (_responseDataFileURL) {
+        [[NSFileManager defaultManager] removeItemAtURL:_responseDataFileURL error:nil];
+    }
 }
 
 #pragma mark - NSProgress Tracking
 
-- (void)observeValueForKeyPath:(NSString __unused *)keyPath ofObject:(id)object
-                        change:(NSDictionary<NSString *,id> __unused *)change
-                       context:(void __unused *)context {
-   if ([object isEqual:self.downloadProgress]) {
-        if (self.downloadProgressBlock) {
-            self.downloadProgressBlock(object);
-        }
+// Progress objects are only created once they are asked for, either by a progress block or by `-uploadProgressForTask:` / `-downloadProgressForTask:`. Until then, only the unit counts are tracked.
+- (NSProgress *)progressWithTransferState:(AFURLSessionTaskTransferState)state {
+    NSProgress *progress = [[NSProgress alloc] initWithParent:nil userInfo:nil];
+    progress.totalUnitCount = state.totalUnitCount;
+    progress.completedUnitCount = state.completedUnitCount;
+
+    __weak __typeof__(self.task) weakTask = self.task;
+    progress.cancellable = YES;
+    progress.cancellationHandler = ^{
+        [weakTask cancel];
+    };
+    progress.pausable = YES;
+    progress.pausingHandler = ^{
+        [weakTask suspend];
+    };
+    if ([progress respondsToSelector:@selector(setResumingHandler:)]) {
+        progress.resumingHandler = ^{
+            [weakTask resume];
+        };
     }
-    else if ([object isEqual:self.uploadProgress]) {
-        if (self.uploadProgressBlock) {
-            self.uploadProgressBlock(object);
-        }
+
+    return progress;
+}
+
+- (NSProgress *)uploadProgress {
+    pthread_mutex_lock(&_progressMutex);
+    if (!_uploadProgress) {
+        _uploadProgress = [self progressWithTransferState:_uploadState];
+    }
+    NSProgress *progress = _uploadProgress;
+    pthread_mutex_unlock(&_progressMutex);
+
+    return progress;
+}
+
+- (NSProgress *)downloadProgress {
+    pthread_mutex_lock(&_progressMutex);
+    if (!_downloadProgress) {
+        _downloadProgress = [self progressWithTransferState:_downloadState];
+    }
+    NSProgress *progress = _downloadProgress;
+    pthread_mutex_unlock(&_progressMutex);
+
+    return progress;
+}
+
+- (void)updateUploadProgressWithCompletedUnitCount:(int64_t)completedUnitCount
+                                    totalUnitCount:(int64_t)totalUnitCount
+{
+    pthread_mutex_lock(&_progressMutex);
+    _uploadState.completedUnitCount = completedUnitCount;
+    _uploadState.totalUnitCount = totalUnitCount;
+    NSProgress *progress = _uploadProgress;
+    pthread_mutex_unlock(&_progressMutex);
+
+    if (progress) {
+        progress.totalUnitCount = totalUnitCount;
+        progress.completedUnitCount = completedUnitCount;
+    }
+
+    if (self.uploadProgressBlock && [self shouldReportTransferState:&_uploadState force:NO]) {
+        self.uploadProgressBlock(self.uploadProgress);
+    }
+}
+
+- (void)updateDownloadProgressWithCompletedUnitCount:(int64_t)completedUnitCount
+                                      totalUnitCount:(int64_t)totalUnitCount
+{
+    pthread_mutex_lock(&_progressMutex);
+    _downloadState.completedUnitCount = completedUnitCount;
+    _downloadState.totalUnitCount = totalUnitCount;
+    NSProgress *progress = _downloadProgress;
+    pthread_mutex_unlock(&_progressMutex);
+
+    if (progress) {
+        progress.totalUnitCount = totalUnitCount;
+        progress.completedUnitCount = completedUnitCount;
+    }
+
+    if (self.downloadProgressBlock && [self shouldReportTransferState:&_downloadState force:NO]) {
+        self.downloadProgressBlock(self.downloadProgress);
+    }
+}
+
+- (void)reportFinalProgress {
+    if (self.uploadProgressBlock && [self shouldReportTransferState:&_uploadState force:YES]) {
+        self.uploadProgressBlock(self.uploadProgress);
+    }
+
+    if (self.downloadProgressBlock && [self shouldReportTransferState:&_downloadState force:YES]) {
+        self.downloadProgressBlock(self.downloadProgress);
+    }
+}
+
+// Progress blocks are invoked at most once per `progressReportingInterval`, except for the update that completes a transfer, and the final update when the task completes.
+//This method should only be called from the session delegate queue
+- (BOOL)shouldReportTransferState:(AFURLSessionTaskTransferState *)state force:(BOOL)force {
+    if (state->completedUnitCount == state->reportedUnitCount) {
+        return NO;
     }
+
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    BOOL finished = state->totalUnitCount > 0 && state->completedUnitCount >= state->totalUnitCount;
+    BOOL intervalElapsed = now - state->reportTime >= self.progressReportingInterval || now < state->reportTime;
+    if (!force && !finished && !intervalElapsed) {
+        return NO;
+    }
+
+    state->reportedUnitCount = state->completedUnitCount;
+    state->reportTime = now;
+
+    return YES;
 }
 
 #pragma mark - NSURLSessionTaskDelegate
@@ -191,14 +409,21 @@ didCompleteWithError:(NSError *)error
 {
     __strong AFURLSessionManager *manager = self.manager;
 
-    __block id responseObject = nil;
+    [self reportFinalProgress];
+
+    AFURLSessionTaskPhaseMetrics *phaseMetrics = self.phaseMetrics;
 
     __block NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
     userInfo[AFNetworkingTaskDidCompleteResponseSerializerKey] = manager.responseSerializer;
+    if (self.queueWaitTime) {
+        userInfo[AFNetworkingTaskDidCompleteQueueWaitTimeKey] = self.queueWaitTime;
+    }
 
     //Performance Improvement from #2672
     NSData *data = nil;
-    if (self.mutableData) {
+    if (self.responseDataFileURL) {
+        data = [self mappedResponseData];
+    } else if (self.mutableData) {
         data = [self.mutableData copy];
         //We no longer need the reference, so nil it out to gain back some memory.
         self.mutableData = nil;
@@ -210,22 +435,36 @@ didCompleteWithError:(NSError *)error
         userInfo[AFNetworkingTaskDidCompleteResponseDataKey] = data;
     }
 
+    if (!error || ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorCancelled)) {
+        if (self.responseDataError) {
+            error = self.responseDataError;
+        } else if (self.rejectedResponseSerializer) {
+            // The transfer was stopped because the response was rejected on receipt, so report why rather than the cancellation.
+            NSError *validationError = nil;
+            [self.rejectedResponseSerializer validateResponseBeforeLoadingData:(NSHTTPURLResponse *)task.response partialData:data error:&validationError];
+            error = validationError ?: error;
+        } else if (self.exceededMaximumDataLength) {
+            error = af_dataLengthExceedsMaximumError(task.response, data, self.maximumDataLength);
+        }
+    }
+
     if (error) {
         userInfo[AFNetworkingTaskDidCompleteErrorKey] = error;
 
-        dispatch_group_async(manager.completionGroup ?: url_session_manager_completion_group(), manager.completionQueue ?: dispatch_get_main_queue(), ^{
-            if (self.completionHandler) {
-                self.completionHandler(task.response, responseObject, error);
-            }
+        [self completeTask:task withResponseObject:nil data:data error:error userInfo:userInfo];
+    } else if ([self canDeferSerializationOfResponse:task.response data:data]) {
+        AFLazyResponseObject *lazyResponseObject = [[AFLazyResponseObject alloc] initWithResponse:task.response data:data responseSerializer:manager.responseSerializer];
 
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidCompleteNotification object:task userInfo:userInfo];
-            });
-        });
+        [self completeTask:task withResponseObject:lazyResponseObject data:data error:nil userInfo:userInfo];
     } else {
+        CFAbsoluteTime processingEnqueueTime = CFAbsoluteTimeGetCurrent();
         dispatch_async(url_session_manager_processing_queue(), ^{
+            CFAbsoluteTime serializationStartTime = CFAbsoluteTimeGetCurrent();
+            [phaseMetrics recordDuration:serializationStartTime - processingEnqueueTime forPhase:AFURLSessionTaskPhaseProcessingQueueWait];
+
             NSError *serializationError = nil;
-            responseObject = [manager.responseSerializer responseObjectForResponse:task.response data:data error:&serializationError];
+            id responseObject = [manager responseObjectForResponse:task.response data:data error:&serializationError];
+            [phaseMetrics recordDuration:CFAbsoluteTimeGetCurrent() - serializationStartTime forPhase:AFURLSessionTaskPhaseResponseSerialization];
 
             if (self.downloadFileURL) {
                 responseObject = self.downloadFileURL;
@@ -239,29 +478,234 @@ didCompleteWithError:(NSError *)error
                 userInfo[AFNetworkingTaskDidCompleteErrorKey] = serializationError;
             }
 
-            dispatch_group_async(manager.completionGroup ?: url_session_manager_completion_group(), manager.completionQueue ?: dispatch_get_main_queue(), ^{
-                if (self.completionHandler) {
-                    self.completionHandler(task.response, responseObject, serializationError);
-                }
+            [self completeTask:task withResponseObject:responseObject data:data error:serializationError userInfo:userInfo];
+        });
+    }
+}
+
+// Serialization is only deferred for data tasks whose response passes validation, so that invalid responses still fail as they would otherwise.
+- (BOOL)canDeferSerializationOfResponse:(NSURLResponse *)response
+                                   data:(NSData *)data
+{
+    __strong AFURLSessionManager *manager = self.manager;
+    if (!manager.defersResponseSerialization || self.downloadFileURL) {
+        return NO;
+    }
+
+    id <AFURLResponseSerialization> responseSerializer = manager.responseSerializer;
+    if (![responseSerializer isKindOfClass:[AFHTTPResponseSerializer class]]) {
+        return NO;
+    }
+
+    return [(AFHTTPResponseSerializer *)responseSerializer validateResponse:(NSHTTPURLResponse *)response data:data error:nil];
+}
+
+- (void)completeTask:(NSURLSessionTask *)task
+  withResponseObject:(id)responseObject
+                data:(NSData *)data
+               error:(NSError *)error
+            userInfo:(NSMutableDictionary *)userInfo
+{
+    __strong AFURLSessionManager *manager = self.manager;
+    AFURLSessionTaskPhaseMetrics *phaseMetrics = self.phaseMetrics;
+
+    // Streaming tasks complete on their chunk queue, so that the completion handler is only called once every chunk has been handled.
+    dispatch_queue_t completionQueue = self.chunkQueue ?: manager.completionQueue ?: dispatch_get_main_queue();
+
+    CFAbsoluteTime completionEnqueueTime = CFAbsoluteTimeGetCurrent();
+    dispatch_group_async(manager.completionGroup ?: url_session_manager_completion_group(), completionQueue, ^{
+        if (phaseMetrics) {
+            [phaseMetrics recordDuration:CFAbsoluteTimeGetCurrent() - completionEnqueueTime forPhase:AFURLSessionTaskPhaseCompletionDelivery];
+            userInfo[AFNetworkingTaskDidCompletePhaseMetricsKey] = phaseMetrics;
+            [manager taskDidFinishCollectingPhaseMetrics:phaseMetrics forTask:task];
+        }
+
+        if (self.completionHandler) {
+            self.completionHandler(task.response, responseObject, error);
+        }
+
+        if (self.dataCompletionHandler) {
+            self.dataCompletionHandler(task.response, data, responseObject, error);
+        }
 
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidCompleteNotification object:task userInfo:userInfo];
-                });
-            });
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidCompleteNotification object:task userInfo:userInfo];
         });
+    });
+}
+
+#pragma mark - Response Validation
+
+- (BOOL)acceptsResponse:(NSURLResponse *)response {
+    __strong AFURLSessionManager *manager = self.manager;
+    id <AFURLResponseSerialization> responseSerializer = manager.responseSerializer;
+    if (![responseSerializer isKindOfClass:[AFHTTPResponseSerializer class]]) {
+        return YES;
+    }
+
+    if ([(AFHTTPResponseSerializer *)responseSerializer validateResponseBeforeLoadingData:(NSHTTPURLResponse *)response partialData:nil error:nil]) {
+        return YES;
     }
+
+    self.rejectedResponseSerializer = (AFHTTPResponseSerializer *)responseSerializer;
+
+    return NO;
+}
+
+// The limit is resolved when the first data is received, once the response has been accepted or rejected.
+- (NSUInteger)maximumDataLength {
+    if (!_resolvedMaximumDataLength) {
+        __strong AFURLSessionManager *manager = self.manager;
+        id <AFURLResponseSerialization> responseSerializer = manager.responseSerializer;
+        if (self.rejectedResponseSerializer) {
+            _maximumDataLength = manager.maximumRejectedResponseDataLength;
+        } else if (self.chunkHandler) {
+            _maximumDataLength = 0;
+        } else if ([responseSerializer isKindOfClass:[AFHTTPResponseSerializer class]]) {
+            _maximumDataLength = [(AFHTTPResponseSerializer *)responseSerializer maximumResponseDataLength];
+        }
+
+        _resolvedMaximumDataLength = YES;
+    }
+
+    return _maximumDataLength;
+}
+
+#pragma mark - Response Data
+
+- (BOOL)shouldBecomeDownloadTaskForResponse:(NSURLResponse *)response {
+    NSUInteger maximumInMemoryResponseDataLength = self.manager.maximumInMemoryResponseDataLength;
+    if (maximumInMemoryResponseDataLength == 0 || response.expectedContentLength <= (long long)maximumInMemoryResponseDataLength) {
+        return NO;
+    }
+
+    // Download tasks do not report their data as it is received, so responses with a length limit or streamed to a chunk handler are loaded as data.
+    if (self.rejectedResponseSerializer || self.maximumDataLength > 0 || self.chunkHandler) {
+        return NO;
+    }
+
+    self.loadsResponseDataToFile = YES;
+
+    return YES;
+}
+
+- (void)appendResponseData:(NSData *)data
+                   forTask:(NSURLSessionTask *)task
+{
+    self.receivedDataLength += data.length;
+
+    if (self.chunkHandler) {
+        [self handleChunk:data forTask:task];
+        return;
+    }
+
+    if (self.responseDataError) {
+        return;
+    }
+
+    if (self.mutableData) {
+        NSUInteger maximumInMemoryResponseDataLength = self.manager.maximumInMemoryResponseDataLength;
+        if (maximumInMemoryResponseDataLength == 0 || self.receivedDataLength <= maximumInMemoryResponseDataLength) {
+            [self.mutableData appendData:data];
+            return;
+        }
+
+        // Move the data received so far to a file, and write the rest of the data to it as it is received.
+        self.responseDataFileURL = af_responseDataFileURL();
+        self.responseDataOutputStream = [NSOutputStream outputStreamWithURL:self.responseDataFileURL append:NO];
+        [self.responseDataOutputStream open];
+
+        NSData *receivedData = self.mutableData;
+        self.mutableData = nil;
+        if (!af_writeDataToStream(receivedData, self.responseDataOutputStream)) {
+            [self failToWriteResponseDataForTask:task];
+            return;
+        }
+    }
+
+    if (!af_writeDataToStream(data, self.responseDataOutputStream)) {
+        [self failToWriteResponseDataForTask:task];
+    }
+}
+
+// Chunks are handled one at a time on the chunk queue. The task is suspended while the chunks waiting to be handled exceed the high watermark, until they drop back to the low watermark.
+- (void)handleChunk:(NSData *)chunk
+            forTask:(NSURLSessionTask *)task
+{
+    NSUInteger chunkLength = chunk.length;
+
+    // The task is suspended and resumed with the lock held, so that a resume can never run ahead of the suspend it undoes.
+    pthread_mutex_lock(&_chunkMutex);
+    _pendingChunkLength += chunkLength;
+    if (self.highWatermark > 0 && !_suspendedForPendingChunks && _pendingChunkLength > self.highWatermark) {
+        _suspendedForPendingChunks = YES;
+        [task suspend];
+    }
+    pthread_mutex_unlock(&_chunkMutex);
+
+    AFURLSessionDataTaskChunkHandler chunkHandler = self.chunkHandler;
+    dispatch_async(self.chunkQueue, ^{
+        chunkHandler(chunk);
+
+        pthread_mutex_lock(&self->_chunkMutex);
+        self->_pendingChunkLength -= chunkLength;
+        if (self->_suspendedForPendingChunks && self->_pendingChunkLength <= self.lowWatermark) {
+            self->_suspendedForPendingChunks = NO;
+            [task resume];
+        }
+        pthread_mutex_unlock(&self->_chunkMutex);
+    });
+}
+
+- (void)failToWriteResponseDataForTask:(NSURLSessionTask *)task {
+    self.responseDataError = self.responseDataOutputStream.streamError ?: [NSError errorWithDomain:NSCocoaErrorDomain code:NSFileWriteUnknownError userInfo:nil];
+    [self.responseDataOutputStream close];
+    self.responseDataOutputStream = nil;
+
+    [task cancel];
+}
+
+// The file is removed once mapped, so that it never outlives the task. Its pages stay readable until the data is deallocated.
+- (NSData *)mappedResponseData {
+    [self.responseDataOutputStream close];
+    self.responseDataOutputStream = nil;
+
+    NSData *data = nil;
+    if (!self.responseDataError) {
+        NSError *readingError = nil;
+        data = [NSData dataWithContentsOfURL:self.responseDataFileURL options:NSDataReadingMappedIfSafe error:&readingError];
+        self.responseDataError = readingError;
+    }
+
+    [[NSFileManager defaultManager] removeItemAtURL:self.responseDataFileURL error:nil];
+    self.responseDataFileURL = nil;
+
+    return data;
 }
 
 #pragma mark - NSURLSessionDataDelegate
 
 - (void)URLSession:(__unused NSURLSession *)session
-          dataTask:(__unused NSURLSessionDataTask *)dataTask
+          dataTask:(NSURLSessionDataTask *)dataTask
     didReceiveData:(NSData *)data
 {
-    self.downloadProgress.totalUnitCount = dataTask.countOfBytesExpectedToReceive;
-    self.downloadProgress.completedUnitCount = dataTask.countOfBytesReceived;
+    [self updateDownloadProgressWithCompletedUnitCount:dataTask.countOfBytesReceived
+                                        totalUnitCount:dataTask.countOfBytesExpectedToReceive];
 
-    [self.mutableData appendData:data];
+    if (self.exceededMaximumDataLength) {
+        return;
+    }
+
+    NSUInteger maximumDataLength = self.maximumDataLength;
+    if (maximumDataLength > 0 && self.receivedDataLength + data.length > maximumDataLength) {
+        [self appendResponseData:[data subdataWithRange:NSMakeRange(0, maximumDataLength - self.receivedDataLength)] forTask:dataTask];
+        self.exceededMaximumDataLength = YES;
+        [dataTask cancel];
+
+        return;
+    }
+
+    [self appendResponseData:data forTask:dataTask];
 }
 
 - (void)URLSession:(NSURLSession __unused *)session task:(NSURLSessionTask *)task
@@ -269,8 +713,8 @@ didCompleteWithError:(NSError *)error
     totalBytesSent:(__unused int64_t)totalBytesSent
 totalBytesExpectedToSend:(__unused int64_t)totalBytesExpectedToSend{
     
-    self.uploadProgress.totalUnitCount = task.countOfBytesExpectedToSend;
-    self.uploadProgress.completedUnitCount = task.countOfBytesSent;
+    [self updateUploadProgressWithCompletedUnitCount:task.countOfBytesSent
+                                      totalUnitCount:task.countOfBytesExpectedToSend];
 }
 
 #pragma mark - NSURLSessionDownloadDelegate
@@ -278,11 +722,11 @@ totalBytesExpectedToSend:(__unused int64_t)totalBytesExpectedToSend{
 - (void)URLSession:(NSURLSession __unused *)session
       downloadTask:(NSURLSessionDownloadTask __unused *)downloadTask
       didWriteData:(__unused int64_t)bytesWritten
- totalBytesWritten:(__unused int64_t)totalBytesWritten
+ totalBytesWritten:(int64_t)totalBytesWritten
 totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite{
     
-    self.downloadProgress.totalUnitCount = totalBytesExpectedToWrite;
-    self.downloadProgress.completedUnitCount = totalBytesWritten;
+    [self updateDownloadProgressWithCompletedUnitCount:totalBytesWritten
+                                        totalUnitCount:totalBytesExpectedToWrite];
 }
 
 - (void)URLSession:(NSURLSession __unused *)session
@@ -290,8 +734,8 @@ totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite{
  didResumeAtOffset:(int64_t)fileOffset
 expectedTotalBytes:(int64_t)expectedTotalBytes{
     
-    self.downloadProgress.totalUnitCount = expectedTotalBytes;
-    self.downloadProgress.completedUnitCount = fileOffset;
+    [self updateDownloadProgressWithCompletedUnitCount:fileOffset
+                                        totalUnitCount:expectedTotalBytes];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -300,6 +744,21 @@ didFinishDownloadingToURL:(NSURL *)location
 {
     self.downloadFileURL = nil;
 
+    if (self.loadsResponseDataToFile) {
+        // The data task became a download task because its response was too large to be loaded in memory, so its data is mapped from the downloaded file once it completes.
+        NSURL *responseDataFileURL = af_responseDataFileURL();
+        NSError *fileManagerError = nil;
+        if ([[NSFileManager defaultManager] moveItemAtURL:location toURL:responseDataFileURL error:&fileManagerError]) {
+            self.responseDataFileURL = responseDataFileURL;
+        } else {
+            self.responseDataError = fileManagerError;
+        }
+
+        self.mutableData = nil;
+
+        return;
+    }
+
     if (self.downloadTaskDidFinishDownloading) {
         self.downloadFileURL = self.downloadTaskDidFinishDownloading(session, downloadTask, location);
         if (self.downloadFileURL) {
@@ -335,8 +794,36 @@ static inline BOOL af_addMethod(Class theClass, SEL selector, Method method) {
     return class_addMethod(theClass, selector,  method_getImplementation(method),  method_getTypeEncoding(method));
 }
 
-static NSString * const AFNSURLSessionTaskDidResumeNotification  = @"com.alamofire.networking.nsurlsessiontask.resume";
-static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofire.networking.nsurlsessiontask.suspend";
+@interface AFURLSessionManager ()
+- (void)taskDidResume:(NSURLSessionTask *)task;
+- (void)taskDidSuspend:(NSURLSessionTask *)task;
+@end
+
+/**
+ Associated with each task the manager creates, so that the swizzled `resume` and `suspend` can reach the manager directly. The manager is referenced weakly, since the task may outlive it.
+ */
+@interface AFURLSessionTaskOwner : NSObject
+@property (nonatomic, weak) AFURLSessionManager *manager;
+@end
+
+@implementation AFURLSessionTaskOwner
+@end
+
+static char AFURLSessionTaskOwnerKey;
+
+static inline void af_setTaskManager(NSURLSessionTask *task, AFURLSessionManager *manager) {
+    AFURLSessionTaskOwner *owner = nil;
+    if (manager) {
+        owner = [[AFURLSessionTaskOwner alloc] init];
+        owner.manager = manager;
+    }
+    objc_setAssociatedObject(task, &AFURLSessionTaskOwnerKey, owner, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+static inline AFURLSessionManager * af_taskManager(id task) {
+    AFURLSessionTaskOwner *owner = objc_getAssociatedObject(task, &AFURLSessionTaskOwnerKey);
+    return owner.manager;
+}
 
 @interface _AFURLSessionTaskSwizzling : NSObject
 
@@ -426,7 +913,7 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
     [self af_resume];
     
     if (state != NSURLSessionTaskStateRunning) {
-        [[NSNotificationCenter defaultCenter] postNotificationName:AFNSURLSessionTaskDidResumeNotification object:self];
+        [af_taskManager(self) taskDidResume:(NSURLSessionTask *)self];
     }
 }
 
@@ -436,57 +923,840 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
     [self af_suspend];
     
     if (state != NSURLSessionTaskStateSuspended) {
-        [[NSNotificationCenter defaultCenter] postNotificationName:AFNSURLSessionTaskDidSuspendNotification object:self];
+        [af_taskManager(self) taskDidSuspend:(NSURLSessionTask *)self];
     }
 }
 @end
 
 #pragma mark -
 
-@interface AFURLSessionManager ()
-@property (readwrite, nonatomic, strong) NSURLSessionConfiguration *sessionConfiguration;
-@property (readwrite, nonatomic, strong) NSOperationQueue *operationQueue;
-@property (readwrite, nonatomic, strong) NSURLSession *session;
-@property (readwrite, nonatomic, strong) NSMutableDictionary *mutableTaskDelegatesKeyedByTaskIdentifier;
-@property (readonly, nonatomic, copy) NSString *taskDescriptionForSessionTasks;
-@property (readwrite, nonatomic, strong) NSLock *lock;
-@property (readwrite, nonatomic, copy) AFURLSessionDidBecomeInvalidBlock sessionDidBecomeInvalid;
-@property (readwrite, nonatomic, copy) AFURLSessionDidReceiveAuthenticationChallengeBlock sessionDidReceiveAuthenticationChallenge;
-@property (readwrite, nonatomic, copy) AFURLSessionDidFinishEventsForBackgroundURLSessionBlock didFinishEventsForBackgroundURLSession;
-@property (readwrite, nonatomic, copy) AFURLSessionTaskWillPerformHTTPRedirectionBlock taskWillPerformHTTPRedirection;
-@property (readwrite, nonatomic, copy) AFURLSessionTaskDidReceiveAuthenticationChallengeBlock taskDidReceiveAuthenticationChallenge;
-@property (readwrite, nonatomic, copy) AFURLSessionTaskNeedNewBodyStreamBlock taskNeedNewBodyStream;
-@property (readwrite, nonatomic, copy) AFURLSessionTaskDidSendBodyDataBlock taskDidSendBodyData;
-@property (readwrite, nonatomic, copy) AFURLSessionTaskDidCompleteBlock taskDidComplete;
-@property (readwrite, nonatomic, copy) AFURLSessionDataTaskDidReceiveResponseBlock dataTaskDidReceiveResponse;
-@property (readwrite, nonatomic, copy) AFURLSessionDataTaskDidBecomeDownloadTaskBlock dataTaskDidBecomeDownloadTask;
-@property (readwrite, nonatomic, copy) AFURLSessionDataTaskDidReceiveDataBlock dataTaskDidReceiveData;
-@property (readwrite, nonatomic, copy) AFURLSessionDataTaskWillCacheResponseBlock dataTaskWillCacheResponse;
-@property (readwrite, nonatomic, copy) AFURLSessionDownloadTaskDidFinishDownloadingBlock downloadTaskDidFinishDownloading;
-@property (readwrite, nonatomic, copy) AFURLSessionDownloadTaskDidWriteDataBlock downloadTaskDidWriteData;
-@property (readwrite, nonatomic, copy) AFURLSessionDownloadTaskDidResumeBlock downloadTaskDidResume;
-@end
+enum {
+    AFURLSessionManagerTaskDelegateRegistryShardCount = 16,
+};
+
+typedef struct {
+    NSUInteger taskIdentifier;
+    void *delegate;
+} AFURLSessionManagerTaskDelegateRegistryEntry;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    AFURLSessionManagerTaskDelegateRegistryEntry *entries;
+    NSUInteger capacity;
+    NSUInteger count;
+    char padding[64];
+} AFURLSessionManagerTaskDelegateRegistryShard;
+
+static inline NSUInteger af_registryHomeIndex(AFURLSessionManagerTaskDelegateRegistryShard *shard, NSUInteger taskIdentifier) {
+    return (taskIdentifier / AFURLSessionManagerTaskDelegateRegistryShardCount) & (shard->capacity - 1);
+}
+
+static NSUInteger af_registryIndexOfTaskIdentifier(AFURLSessionManagerTaskDelegateRegistryShard *shard, NSUInteger taskIdentifier) {
+    NSUInteger mask = shard->capacity - 1;
+    NSUInteger index = af_registryHomeIndex(shard, taskIdentifier);
+    while (shard->entries[index].delegate != NULL) {
+        if (shard->entries[index].taskIdentifier == taskIdentifier) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+    return NSNotFound;
+}
 
-@implementation AFURLSessionManager
+static void af_registryInsertEntry(AFURLSessionManagerTaskDelegateRegistryShard *shard, AFURLSessionManagerTaskDelegateRegistryEntry entry) {
+    NSUInteger mask = shard->capacity - 1;
+    NSUInteger index = af_registryHomeIndex(shard, entry.taskIdentifier);
+    while (shard->entries[index].delegate != NULL) {
+        index = (index + 1) & mask;
+    }
+    shard->entries[index] = entry;
+    shard->count += 1;
+}
 
-- (instancetype)init {
-    return [self initWithSessionConfiguration:nil];
+static void af_registryGrowShard(AFURLSessionManagerTaskDelegateRegistryShard *shard) {
+    AFURLSessionManagerTaskDelegateRegistryEntry *entries = shard->entries;
+    NSUInteger capacity = shard->capacity;
+
+    shard->capacity = capacity * 2;
+    shard->entries = calloc(shard->capacity, sizeof(AFURLSessionManagerTaskDelegateRegistryEntry));
+    shard->count = 0;
+    for (NSUInteger index = 0; index < capacity; index++) {
+        if (entries[index].delegate != NULL) {
+            af_registryInsertEntry(shard, entries[index]);
+        }
+    }
+    free(entries);
 }
 
-- (instancetype)initWithSessionConfiguration:(NSURLSessionConfiguration *)configuration {
-    self = [super init];
-    if (!self) {
-        return nil;
+// Returns the replaced delegate, which the caller must release outside of the shard lock.
+static void * af_registrySetDelegate(AFURLSessionManagerTaskDelegateRegistryShard *shard, NSUInteger taskIdentifier, void *delegate) {
+    NSUInteger index = af_registryIndexOfTaskIdentifier(shard, taskIdentifier);
+    if (index != NSNotFound) {
+        void *replacedDelegate = shard->entries[index].delegate;
+        shard->entries[index].delegate = delegate;
+        return replacedDelegate;
     }
 
-    if (!configuration) {
-        configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    if ((shard->count + 1) * 4 > shard->capacity * 3) {
+        af_registryGrowShard(shard);
     }
+    AFURLSessionManagerTaskDelegateRegistryEntry entry = { taskIdentifier, delegate };
+    af_registryInsertEntry(shard, entry);
+    return NULL;
+}
 
-    self.sessionConfiguration = configuration;
+// Returns the removed delegate, which the caller must release outside of the shard lock.
+static void * af_registryRemoveDelegate(AFURLSessionManagerTaskDelegateRegistryShard *shard, NSUInteger taskIdentifier) {
+    NSUInteger index = af_registryIndexOfTaskIdentifier(shard, taskIdentifier);
+    if (index == NSNotFound) {
+        return NULL;
+    }
+    void *removedDelegate = shard->entries[index].delegate;
+
+    // Shift the following entries of the probe sequence back, so that lookups never need tombstones
+    NSUInteger mask = shard->capacity - 1;
+    NSUInteger hole = index;
+    NSUInteger next = (index + 1) & mask;
+    while (shard->entries[next].delegate != NULL) {
+        NSUInteger home = af_registryHomeIndex(shard, shard->entries[next].taskIdentifier);
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            shard->entries[hole] = shard->entries[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    shard->entries[hole].taskIdentifier = 0;
+    shard->entries[hole].delegate = NULL;
+    shard->count -= 1;
 
-    self.operationQueue = [[NSOperationQueue alloc] init];
-    self.operationQueue.maxConcurrentOperationCount = 1;
+    return removedDelegate;
+}
+
+/**
+ Maps task identifiers to task delegates without boxing the identifiers or allocating on lookup. Entries are spread across shards by task identifier, each an open-addressed table behind its own mutex, so that callbacks for different tasks rarely contend for the same lock.
+ */
+@interface AFURLSessionManagerTaskDelegateRegistry : NSObject
+@end
+
+@implementation AFURLSessionManagerTaskDelegateRegistry {
+    AFURLSessionManagerTaskDelegateRegistryShard _shards[AFURLSessionManagerTaskDelegateRegistryShardCount];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    for (NSUInteger index = 0; index < AFURLSessionManagerTaskDelegateRegistryShardCount; index++) {
+        pthread_mutex_init(&_shards[index].mutex, NULL);
+        _shards[index].capacity = 16;
+        _shards[index].entries = calloc(_shards[index].capacity, sizeof(AFURLSessionManagerTaskDelegateRegistryEntry));
+        _shards[index].count = 0;
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    for (NSUInteger index = 0; index < AFURLSessionManagerTaskDelegateRegistryShardCount; index++) {
+        AFURLSessionManagerTaskDelegateRegistryShard *shard = &_shards[index];
+        for (NSUInteger entryIndex = 0; entryIndex < shard->capacity; entryIndex++) {
+            if (shard->entries[entryIndex].delegate != NULL) {
+                CFRelease(shard->entries[entryIndex].delegate);
+            }
+        }
+        free(shard->entries);
+        pthread_mutex_destroy(&shard->mutex);
+    }
+}
+
+- (AFURLSessionManagerTaskDelegateRegistryShard *)shardForTaskIdentifier:(NSUInteger)taskIdentifier {
+    return &_shards[taskIdentifier % AFURLSessionManagerTaskDelegateRegistryShardCount];
+}
+
+- (AFURLSessionManagerTaskDelegate *)delegateForTaskIdentifier:(NSUInteger)taskIdentifier {
+    AFURLSessionManagerTaskDelegateRegistryShard *shard = [self shardForTaskIdentifier:taskIdentifier];
+    AFURLSessionManagerTaskDelegate *delegate = nil;
+
+    pthread_mutex_lock(&shard->mutex);
+    NSUInteger index = af_registryIndexOfTaskIdentifier(shard, taskIdentifier);
+    if (index != NSNotFound) {
+        delegate = (__bridge AFURLSessionManagerTaskDelegate *)shard->entries[index].delegate;
+    }
+    pthread_mutex_unlock(&shard->mutex);
+
+    return delegate;
+}
+
+- (void)setDelegate:(AFURLSessionManagerTaskDelegate *)delegate forTaskIdentifier:(NSUInteger)taskIdentifier {
+    AFURLSessionManagerTaskDelegateRegistryShard *shard = [self shardForTaskIdentifier:taskIdentifier];
+
+    pthread_mutex_lock(&shard->mutex);
+    void *replacedDelegate = af_registrySetDelegate(shard, taskIdentifier, (void *)CFBridgingRetain(delegate));
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (replacedDelegate != NULL) {
+        CFRelease(replacedDelegate);
+    }
+}
+
+// Locks each shard at most once, however many tasks are registered.
+- (void)setDelegates:(NSArray <AFURLSessionManagerTaskDelegate *> *)delegates
+  forTaskIdentifiers:(const NSUInteger *)taskIdentifiers
+{
+    NSUInteger count = delegates.count;
+    void **replacedDelegates = calloc(count, sizeof(void *));
+
+    for (NSUInteger shardIndex = 0; shardIndex < AFURLSessionManagerTaskDelegateRegistryShardCount; shardIndex++) {
+        AFURLSessionManagerTaskDelegateRegistryShard *shard = &_shards[shardIndex];
+        BOOL locked = NO;
+        for (NSUInteger index = 0; index < count; index++) {
+            if (taskIdentifiers[index] % AFURLSessionManagerTaskDelegateRegistryShardCount != shardIndex) {
+                continue;
+            }
+
+            if (!locked) {
+                pthread_mutex_lock(&shard->mutex);
+                locked = YES;
+            }
+            replacedDelegates[index] = af_registrySetDelegate(shard, taskIdentifiers[index], (void *)CFBridgingRetain(delegates[index]));
+        }
+        if (locked) {
+            pthread_mutex_unlock(&shard->mutex);
+        }
+    }
+
+    for (NSUInteger index = 0; index < count; index++) {
+        if (replacedDelegates[index] != NULL) {
+            CFRelease(replacedDelegates[index]);
+        }
+    }
+    free(replacedDelegates);
+}
+
+- (void)removeDelegateForTaskIdentifier:(NSUInteger)taskIdentifier {
+    AFURLSessionManagerTaskDelegateRegistryShard *shard = [self shardForTaskIdentifier:taskIdentifier];
+
+    pthread_mutex_lock(&shard->mutex);
+    void *removedDelegate = af_registryRemoveDelegate(shard, taskIdentifier);
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (removedDelegate != NULL) {
+        CFRelease(removedDelegate);
+    }
+}
+
+@end
+
+#pragma mark -
+
+typedef NS_ENUM(NSUInteger, AFURLSessionManagerTaskKind) {
+    AFURLSessionManagerTaskKindData = 0,
+    AFURLSessionManagerTaskKindUpload,
+    AFURLSessionManagerTaskKindDownload,
+    AFURLSessionManagerTaskKindOther,
+};
+
+enum {
+    AFURLSessionManagerTaskKindCount = 4,
+};
+
+static AFURLSessionManagerTaskKind af_taskKind(NSURLSessionTask *task) {
+    // Upload tasks are a subclass of data tasks, so they must be matched first
+    if ([task isKindOfClass:[NSURLSessionUploadTask class]]) {
+        return AFURLSessionManagerTaskKindUpload;
+    } else if ([task isKindOfClass:[NSURLSessionDataTask class]]) {
+        return AFURLSessionManagerTaskKindData;
+    } else if ([task isKindOfClass:[NSURLSessionDownloadTask class]]) {
+        return AFURLSessionManagerTaskKindDownload;
+    }
+
+    return AFURLSessionManagerTaskKindOther;
+}
+
+/**
+ Keeps track of the tasks registered with a manager, by kind, from the moment they are created until they complete. Reads are served from an immutable snapshot that is only rebuilt after the set of tasks has changed, so that they never wait on the session or its delegate queue.
+ */
+@interface AFURLSessionManagerTaskIndex : NSObject
+@property (atomic, strong) NSArray <NSArray <NSURLSessionTask *> *> *snapshot;
+@end
+
+@implementation AFURLSessionManagerTaskIndex {
+    pthread_mutex_t _mutex;
+    NSMutableSet <NSURLSessionTask *> *_tasksByKind[AFURLSessionManagerTaskKindCount];
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_mutex, NULL);
+    for (NSUInteger kind = 0; kind < AFURLSessionManagerTaskKindCount; kind++) {
+        _tasksByKind[kind] = [NSMutableSet set];
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (void)addTask:(NSURLSessionTask *)task {
+    AFURLSessionManagerTaskKind kind = af_taskKind(task);
+
+    pthread_mutex_lock(&_mutex);
+    if (![_tasksByKind[kind] containsObject:task]) {
+        [_tasksByKind[kind] addObject:task];
+        self.snapshot = nil;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+- (void)addTasks:(NSArray <NSURLSessionTask *> *)tasks {
+    pthread_mutex_lock(&_mutex);
+    for (NSURLSessionTask *task in tasks) {
+        [_tasksByKind[af_taskKind(task)] addObject:task];
+    }
+    self.snapshot = nil;
+    pthread_mutex_unlock(&_mutex);
+}
+
+- (void)removeTask:(NSURLSessionTask *)task {
+    AFURLSessionManagerTaskKind kind = af_taskKind(task);
+
+    pthread_mutex_lock(&_mutex);
+    if ([_tasksByKind[kind] containsObject:task]) {
+        [_tasksByKind[kind] removeObject:task];
+        self.snapshot = nil;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+// The snapshot holds one array per task kind, followed by an array of all tasks.
+- (NSArray <NSArray <NSURLSessionTask *> *> *)currentSnapshot {
+    NSArray <NSArray <NSURLSessionTask *> *> *snapshot = self.snapshot;
+    if (snapshot) {
+        return snapshot;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    snapshot = self.snapshot;
+    if (!snapshot) {
+        NSMutableArray *tasksByKind = [NSMutableArray arrayWithCapacity:AFURLSessionManagerTaskKindCount + 1];
+        NSMutableArray *allTasks = [NSMutableArray array];
+        for (NSUInteger kind = 0; kind < AFURLSessionManagerTaskKindCount; kind++) {
+            NSArray *tasks = [_tasksByKind[kind] allObjects];
+            [tasksByKind addObject:tasks];
+            [allTasks addObjectsFromArray:tasks];
+        }
+        [tasksByKind addObject:[allTasks copy]];
+
+        snapshot = [tasksByKind copy];
+        self.snapshot = snapshot;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    return snapshot;
+}
+
+- (NSArray *)tasksOfKind:(AFURLSessionManagerTaskKind)kind {
+    return [self currentSnapshot][kind];
+}
+
+- (NSArray *)allTasks {
+    return [self currentSnapshot][AFURLSessionManagerTaskKindCount];
+}
+
+- (NSUInteger)countOfTasksOfKind:(AFURLSessionManagerTaskKind)kind {
+    pthread_mutex_lock(&_mutex);
+    NSUInteger count = [_tasksByKind[kind] count];
+    pthread_mutex_unlock(&_mutex);
+
+    return count;
+}
+
+- (NSUInteger)countOfAllTasks {
+    NSUInteger count = 0;
+    pthread_mutex_lock(&_mutex);
+    for (NSUInteger kind = 0; kind < AFURLSessionManagerTaskKindCount; kind++) {
+        count += [_tasksByKind[kind] count];
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    return count;
+}
+
+@end
+
+#pragma mark -
+
+static float af_sessionTaskPriority(AFURLSessionTaskPriority priority) {
+    switch (priority) {
+        case AFURLSessionTaskPriorityLow:
+            return NSURLSessionTaskPriorityLow;
+        case AFURLSessionTaskPriorityDefault:
+            return NSURLSessionTaskPriorityDefault;
+        case AFURLSessionTaskPriorityHigh:
+            return NSURLSessionTaskPriorityHigh;
+    }
+    return NSURLSessionTaskPriorityDefault;
+}
+
+enum {
+    AFURLSessionTaskPriorityCount = 3,
+};
+
+typedef struct {
+    double tokens;
+    CFAbsoluteTime refillTime;
+} AFURLSessionManagerRateLimit;
+
+// A token bucket holding up to one second worth of task starts.
+static NSTimeInterval af_rateLimitDelayUntilToken(AFURLSessionManagerRateLimit *limit, double rate, CFAbsoluteTime now) {
+    if (rate <= 0.0) {
+        return 0.0;
+    }
+
+    double capacity = MAX(1.0, rate);
+    if (limit->refillTime <= 0.0) {
+        limit->tokens = capacity;
+    } else if (now > limit->refillTime) {
+        limit->tokens = MIN(capacity, limit->tokens + (now - limit->refillTime) * rate);
+    }
+    limit->refillTime = now;
+
+    return limit->tokens >= 1.0 ? 0.0 : (1.0 - limit->tokens) / rate;
+}
+
+static void af_rateLimitConsumeToken(AFURLSessionManagerRateLimit *limit, double rate) {
+    if (rate > 0.0) {
+        limit->tokens -= 1.0;
+    }
+}
+
+@interface AFURLSessionManagerScheduledTask : NSObject
+@property (nonatomic, strong) NSURLSessionTask *task;
+@property (nonatomic, copy) NSString *host;
+@property (nonatomic, assign) AFURLSessionTaskPriority priority;
+@property (nonatomic, assign) CFAbsoluteTime enqueueTime;
+@property (nonatomic, assign) NSTimeInterval queueWaitTime;
+@end
+
+@implementation AFURLSessionManagerScheduledTask
+@end
+
+@interface AFURLSessionManagerHostSchedulingState : NSObject
+@property (nonatomic, assign) NSUInteger activeTaskCount;
+@property (nonatomic, assign) AFURLSessionManagerRateLimit rateLimit;
+@end
+
+@implementation AFURLSessionManagerHostSchedulingState
+@end
+
+/**
+ Holds tasks back until they can be started within the concurrency and rate limits of a manager. Queued tasks are kept in one FIFO per priority, and a task gains one priority level for every aging interval it has been waiting.
+ */
+@interface AFURLSessionManagerTaskScheduler : NSObject
+@property (atomic, assign) NSUInteger maximumActiveTasks;
+@property (atomic, assign) NSUInteger maximumActiveTasksPerHost;
+@property (atomic, assign) double maximumTaskStartsPerSecond;
+@property (atomic, assign) double maximumTaskStartsPerSecondPerHost;
+@property (atomic, assign) NSTimeInterval agingInterval;
+@end
+
+@implementation AFURLSessionManagerTaskScheduler {
+    pthread_mutex_t _mutex;
+    NSMutableArray <AFURLSessionManagerScheduledTask *> *_queuedTasks[AFURLSessionTaskPriorityCount];
+    NSMutableDictionary <NSNumber *, AFURLSessionManagerScheduledTask *> *_queuedTasksByIdentifier;
+    NSMutableDictionary <NSNumber *, NSString *> *_activeTaskHosts;
+    NSMutableDictionary <NSString *, AFURLSessionManagerHostSchedulingState *> *_hostStates;
+    AFURLSessionManagerRateLimit _rateLimit;
+    BOOL _wakeupPending;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_mutex, NULL);
+    for (NSUInteger priority = 0; priority < AFURLSessionTaskPriorityCount; priority++) {
+        _queuedTasks[priority] = [NSMutableArray array];
+    }
+    _queuedTasksByIdentifier = [NSMutableDictionary dictionary];
+    _activeTaskHosts = [NSMutableDictionary dictionary];
+    _hostStates = [NSMutableDictionary dictionary];
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (BOOL)hasLimits {
+    return self.maximumActiveTasks > 0 || self.maximumActiveTasksPerHost > 0 || self.maximumTaskStartsPerSecond > 0.0 || self.maximumTaskStartsPerSecondPerHost > 0.0;
+}
+
+// Returns NO when the task can be resumed right away without being tracked.
+- (BOOL)enqueueTask:(NSURLSessionTask *)task priority:(AFURLSessionTaskPriority)priority {
+    NSNumber *taskIdentifier = @(task.taskIdentifier);
+
+    pthread_mutex_lock(&_mutex);
+    if (_queuedTasksByIdentifier[taskIdentifier] || _activeTaskHosts[taskIdentifier]) {
+        pthread_mutex_unlock(&_mutex);
+        return YES;
+    }
+
+    BOOL idle = _queuedTasksByIdentifier.count == 0 && _activeTaskHosts.count == 0;
+    if (idle && ![self hasLimits]) {
+        pthread_mutex_unlock(&_mutex);
+        return NO;
+    }
+
+    AFURLSessionManagerScheduledTask *scheduledTask = [[AFURLSessionManagerScheduledTask alloc] init];
+    scheduledTask.task = task;
+    scheduledTask.host = [task.originalRequest.URL.host lowercaseString] ?: @"";
+    scheduledTask.priority = priority;
+    scheduledTask.enqueueTime = CFAbsoluteTimeGetCurrent();
+
+    [_queuedTasks[priority] addObject:scheduledTask];
+    _queuedTasksByIdentifier[taskIdentifier] = scheduledTask;
+    pthread_mutex_unlock(&_mutex);
+
+    return YES;
+}
+
+- (void)taskDidComplete:(NSURLSessionTask *)task {
+    NSNumber *taskIdentifier = @(task.taskIdentifier);
+
+    pthread_mutex_lock(&_mutex);
+    AFURLSessionManagerScheduledTask *queuedTask = _queuedTasksByIdentifier[taskIdentifier];
+    if (queuedTask) {
+        [_queuedTasks[queuedTask.priority] removeObjectIdenticalTo:queuedTask];
+        [_queuedTasksByIdentifier removeObjectForKey:taskIdentifier];
+    }
+
+    NSString *host = _activeTaskHosts[taskIdentifier];
+    if (host) {
+        [_activeTaskHosts removeObjectForKey:taskIdentifier];
+
+        AFURLSessionManagerHostSchedulingState *hostState = _hostStates[host];
+        hostState.activeTaskCount -= 1;
+        if (hostState.activeTaskCount == 0 && self.maximumTaskStartsPerSecondPerHost <= 0.0) {
+            [_hostStates removeObjectForKey:host];
+        }
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+// A data task that becomes a download task never completes itself, so its slot is handed over to the download task.
+- (void)task:(NSURLSessionTask *)task didBecomeTask:(NSURLSessionTask *)newTask {
+    NSNumber *taskIdentifier = @(task.taskIdentifier);
+
+    pthread_mutex_lock(&_mutex);
+    NSString *host = _activeTaskHosts[taskIdentifier];
+    if (host) {
+        [_activeTaskHosts removeObjectForKey:taskIdentifier];
+        _activeTaskHosts[@(newTask.taskIdentifier)] = host;
+    }
+    pthread_mutex_unlock(&_mutex);
+}
+
+- (NSUInteger)countOfQueuedTasks {
+    pthread_mutex_lock(&_mutex);
+    NSUInteger count = _queuedTasksByIdentifier.count;
+    pthread_mutex_unlock(&_mutex);
+
+    return count;
+}
+
+//This method should only be called from safely within the mutex
+- (AFURLSessionManagerHostSchedulingState *)stateForHost:(NSString *)host {
+    AFURLSessionManagerHostSchedulingState *hostState = _hostStates[host];
+    if (!hostState) {
+        hostState = [[AFURLSessionManagerHostSchedulingState alloc] init];
+        _hostStates[host] = hostState;
+    }
+
+    return hostState;
+}
+
+/**
+ Removes the tasks that may be started now from the queue, highest effective priority first, and marks them as active. If tasks remain that are only held back by a rate limit, and no wakeup is pending yet, `wakeupDelay` is set to the time after which the queue should be drained again.
+ */
+- (NSArray <AFURLSessionManagerScheduledTask *> *)dequeueStartableTasksWithWakeupDelay:(NSTimeInterval *)wakeupDelay
+                                                                            fromWakeup:(BOOL)fromWakeup
+{
+    NSMutableArray <AFURLSessionManagerScheduledTask *> *startableTasks = [NSMutableArray array];
+    NSUInteger maximumActiveTasks = self.maximumActiveTasks;
+    NSUInteger maximumActiveTasksPerHost = self.maximumActiveTasksPerHost;
+    double maximumTaskStartsPerSecond = self.maximumTaskStartsPerSecond;
+    double maximumTaskStartsPerSecondPerHost = self.maximumTaskStartsPerSecondPerHost;
+    NSTimeInterval agingInterval = self.agingInterval;
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSTimeInterval delay = 0.0;
+
+    pthread_mutex_lock(&_mutex);
+    if (fromWakeup) {
+        _wakeupPending = NO;
+    }
+
+    while (_queuedTasksByIdentifier.count > 0) {
+        if (maximumActiveTasks > 0 && _activeTaskHosts.count >= maximumActiveTasks) {
+            break;
+        }
+
+        NSTimeInterval globalDelay = af_rateLimitDelayUntilToken(&_rateLimit, maximumTaskStartsPerSecond, now);
+        if (globalDelay > 0.0) {
+            delay = globalDelay;
+            break;
+        }
+
+        // Within a queue, tasks are ordered by enqueue time, so the first one that can run has aged the most.
+        AFURLSessionManagerScheduledTask *candidate = nil;
+        NSInteger candidatePriority = -1;
+        for (NSUInteger priority = 0; priority < AFURLSessionTaskPriorityCount; priority++) {
+            for (AFURLSessionManagerScheduledTask *scheduledTask in _queuedTasks[priority]) {
+                AFURLSessionManagerHostSchedulingState *hostState = _hostStates[scheduledTask.host];
+                if (maximumActiveTasksPerHost > 0 && hostState.activeTaskCount >= maximumActiveTasksPerHost) {
+                    continue;
+                }
+
+                if (maximumTaskStartsPerSecondPerHost > 0.0) {
+                    hostState = [self stateForHost:scheduledTask.host];
+                    AFURLSessionManagerRateLimit rateLimit = hostState.rateLimit;
+                    NSTimeInterval hostDelay = af_rateLimitDelayUntilToken(&rateLimit, maximumTaskStartsPerSecondPerHost, now);
+                    hostState.rateLimit = rateLimit;
+                    if (hostDelay > 0.0) {
+                        delay = delay > 0.0 ? MIN(delay, hostDelay) : hostDelay;
+                        continue;
+                    }
+                }
+
+                NSInteger effectivePriority = (NSInteger)priority;
+                if (agingInterval > 0.0) {
+                    effectivePriority += (NSInteger)floor((now - scheduledTask.enqueueTime) / agingInterval);
+                    effectivePriority = MIN(effectivePriority, (NSInteger)AFURLSessionTaskPriorityHigh);
+                }
+
+                if (effectivePriority > candidatePriority || (effectivePriority == candidatePriority && scheduledTask.enqueueTime < candidate.enqueueTime)) {
+                    candidate = scheduledTask;
+                    candidatePriority = effectivePriority;
+                }
+                break;
+            }
+        }
+
+        if (!candidate) {
+            break;
+        }
+
+        [_queuedTasks[candidate.priority] removeObjectIdenticalTo:candidate];
+        [_queuedTasksByIdentifier removeObjectForKey:@(candidate.task.taskIdentifier)];
+        _activeTaskHosts[@(candidate.task.taskIdentifier)] = candidate.host;
+
+        AFURLSessionManagerHostSchedulingState *hostState = [self stateForHost:candidate.host];
+        hostState.activeTaskCount += 1;
+        AFURLSessionManagerRateLimit rateLimit = hostState.rateLimit;
+        af_rateLimitConsumeToken(&rateLimit, maximumTaskStartsPerSecondPerHost);
+        hostState.rateLimit = rateLimit;
+        af_rateLimitConsumeToken(&_rateLimit, maximumTaskStartsPerSecond);
+
+        candidate.queueWaitTime = now - candidate.enqueueTime;
+        [startableTasks addObject:candidate];
+    }
+
+    if (delay > 0.0 && !_wakeupPending && _queuedTasksByIdentifier.count > 0) {
+        _wakeupPending = YES;
+    } else {
+        delay = 0.0;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    if (wakeupDelay) {
+        *wakeupDelay = delay;
+    }
+
+    return startableTasks;
+}
+
+@end
+
+#pragma mark -
+
+static NSString * af_SHA256HexDigest(NSData *data) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256_CTX context;
+    CC_SHA256_Init(&context);
+
+    // CC_SHA256_Update takes a 32-bit length, so large bodies are hashed in chunks
+    [data enumerateByteRangesUsingBlock:^(const void *bytes, NSRange byteRange, __unused BOOL *stop) {
+        NSUInteger offset = 0;
+        while (offset < byteRange.length) {
+            CC_LONG length = (CC_LONG)MIN(byteRange.length - offset, (NSUInteger)UINT32_MAX);
+            CC_SHA256_Update(&context, (const uint8_t *)bytes + offset, length);
+            offset += length;
+        }
+    }];
+    CC_SHA256_Final(digest, &context);
+
+    NSMutableString *hexDigest = [NSMutableString stringWithCapacity:CC_SHA256_DIGEST_LENGTH * 2];
+    for (NSUInteger index = 0; index < CC_SHA256_DIGEST_LENGTH; index++) {
+        [hexDigest appendFormat:@"%02x", digest[index]];
+    }
+
+    return hexDigest;
+}
+
+static BOOL af_responseSerializerReturnsImmutableObjects(id <AFURLResponseSerialization> responseSerializer) {
+    if ([responseSerializer isKindOfClass:[AFCompoundResponseSerializer class]]) {
+        for (id <AFURLResponseSerialization> serializer in [(AFCompoundResponseSerializer *)responseSerializer responseSerializers]) {
+            if (!af_responseSerializerReturnsImmutableObjects(serializer)) {
+                return NO;
+            }
+        }
+        return YES;
+    } else if ([responseSerializer isKindOfClass:[AFJSONResponseSerializer class]]) {
+        return ([(AFJSONResponseSerializer *)responseSerializer readingOptions] & (NSJSONReadingMutableContainers | NSJSONReadingMutableLeaves)) == 0;
+    } else if ([responseSerializer isKindOfClass:[AFPropertyListResponseSerializer class]]) {
+        return [(AFPropertyListResponseSerializer *)responseSerializer readOptions] == NSPropertyListImmutable;
+    } else if ([responseSerializer isKindOfClass:[AFImageResponseSerializer class]]) {
+        return YES;
+    }
+
+    // Parsers and documents are stateful or mutable, and subclasses or custom serializers may return anything
+    return [responseSerializer isMemberOfClass:[AFHTTPResponseSerializer class]];
+}
+
+// A cached object is only returned if the serializer would still accept the response; a compound serializer accepts it if one of its serializers does.
+static BOOL af_responseSerializerValidatesResponse(id <AFURLResponseSerialization> responseSerializer, NSURLResponse *response, NSData *data, NSError * __autoreleasing *error) {
+    if ([responseSerializer isKindOfClass:[AFCompoundResponseSerializer class]]) {
+        NSError *validationError = nil;
+        for (id <AFURLResponseSerialization> serializer in [(AFCompoundResponseSerializer *)responseSerializer responseSerializers]) {
+            if ([serializer isKindOfClass:[AFHTTPResponseSerializer class]] && af_responseSerializerValidatesResponse(serializer, response, data, &validationError)) {
+                return YES;
+            }
+        }
+
+        if (error) {
+            *error = validationError;
+        }
+
+        return NO;
+    }
+
+    return [(AFHTTPResponseSerializer *)responseSerializer validateResponse:(NSHTTPURLResponse *)response data:data error:error];
+}
+
+static NSArray * af_responseSerializerObservedKeyPaths() {
+    static NSArray *_af_responseSerializerObservedKeyPaths = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSMutableArray *keyPaths = [NSMutableArray arrayWithObjects:NSStringFromSelector(@selector(acceptableStatusCodes)), NSStringFromSelector(@selector(acceptableContentTypes)), NSStringFromSelector(@selector(maximumResponseDataLength)), NSStringFromSelector(@selector(readingOptions)), NSStringFromSelector(@selector(removesKeysWithNullValues)), NSStringFromSelector(@selector(options)), NSStringFromSelector(@selector(format)), NSStringFromSelector(@selector(readOptions)), nil];
+#if TARGET_OS_IOS || TARGET_OS_TV || TARGET_OS_WATCH
+        [keyPaths addObject:NSStringFromSelector(@selector(imageScale))];
+        [keyPaths addObject:NSStringFromSelector(@selector(automaticallyInflatesResponseImage))];
+#endif
+        _af_responseSerializerObservedKeyPaths = [keyPaths copy];
+    });
+
+    return _af_responseSerializerObservedKeyPaths;
+}
+
+static void *AFURLSessionManagerResponseSerializerObserverContext = &AFURLSessionManagerResponseSerializerObserverContext;
+
+static NSString * af_responseObjectCacheKey(NSURLResponse *response, NSData *data, NSString *serializerDigest) {
+    if (!response.URL) {
+        return nil;
+    }
+
+    NSString *validator = nil;
+    NSInteger statusCode = 0;
+    if ([response isKindOfClass:[NSHTTPURLResponse class]]) {
+        statusCode = [(NSHTTPURLResponse *)response statusCode];
+        NSDictionary *headerFields = [(NSHTTPURLResponse *)response allHeaderFields];
+        for (NSString *field in headerFields) {
+            if ([field caseInsensitiveCompare:@"ETag"] == NSOrderedSame) {
+                NSString *entityTag = headerFields[field];
+                // Weak validators only promise semantic equivalence, not identical bytes
+                if (![entityTag hasPrefix:@"W/"]) {
+                    validator = [@"etag:" stringByAppendingString:entityTag];
+                }
+                break;
+            }
+        }
+    }
+
+    if (!validator) {
+        validator = [@"sha256:" stringByAppendingString:af_SHA256HexDigest(data)];
+    }
+
+    // The same bytes may be parsed differently depending on their declared type and encoding
+    NSString *contentType = [NSString stringWithFormat:@"%@;%@", response.MIMEType ?: @"", response.textEncodingName ?: @""];
+
+    return [NSString stringWithFormat:@"%@\n%@\n%ld\n%@\n%@", response.URL.absoluteString, validator, (long)statusCode, contentType, serializerDigest];
+}
+
+#pragma mark -
+
+@interface AFURLSessionManager ()
+@property (readwrite, nonatomic, strong) NSURLSessionConfiguration *sessionConfiguration;
+@property (readwrite, nonatomic, strong) NSOperationQueue *operationQueue;
+@property (readwrite, nonatomic, strong) NSURLSession *session;
+@property (readwrite, nonatomic, strong) AFURLSessionManagerTaskDelegateRegistry *taskDelegates;
+@property (readwrite, nonatomic, strong) AFURLSessionManagerTaskIndex *taskIndex;
+@property (readwrite, atomic, copy) NSArray <dispatch_queue_t> *delegateLanes;
+@property (readwrite, nonatomic, strong) AFURLSessionManagerTaskScheduler *taskScheduler;
+@property (readwrite, atomic, strong) NSCache <NSString *, id> *responseObjectCache;
+@property (readwrite, atomic, copy) NSArray *responseSerializerDigestRecord;
+@property (readwrite, atomic, assign) NSUInteger responseSerializerConfigurationVersion;
+@property (readwrite, nonatomic, copy) NSArray <AFHTTPResponseSerializer *> *observedResponseSerializers;
+@property (readwrite, atomic, copy) void (^taskWillStartFromScheduler)(NSURLSession *session, NSURLSessionTask *task, NSTimeInterval queueWaitTime);
+@property (readwrite, nonatomic, strong) AFURLSessionMetricsRecorder *taskPhaseMetricsRecorder;
+@property (readwrite, atomic, copy) AFURLSessionTaskDidFinishCollectingPhaseMetricsBlock taskDidFinishCollectingPhaseMetrics;
+@property (readwrite, nonatomic, copy) AFURLSessionDidBecomeInvalidBlock sessionDidBecomeInvalid;
+@property (readwrite, nonatomic, copy) AFURLSessionDidReceiveAuthenticationChallengeBlock sessionDidReceiveAuthenticationChallenge;
+@property (readwrite, nonatomic, copy) AFURLSessionDidFinishEventsForBackgroundURLSessionBlock didFinishEventsForBackgroundURLSession;
+@property (readwrite, nonatomic, copy) AFURLSessionTaskWillPerformHTTPRedirectionBlock taskWillPerformHTTPRedirection;
+@property (readwrite, nonatomic, copy) AFURLSessionTaskDidReceiveAuthenticationChallengeBlock taskDidReceiveAuthenticationChallenge;
+@property (readwrite, nonatomic, copy) AFURLSessionTaskNeedNewBodyStreamBlock taskNeedNewBodyStream;
+@property (readwrite, nonatomic, copy) AFURLSessionTaskDidSendBodyDataBlock taskDidSendBodyData;
+@property (readwrite, nonatomic, copy) AFURLSessionTaskDidCompleteBlock taskDidComplete;
+@property (readwrite, nonatomic, copy) AFURLSessionDataTaskDidReceiveResponseBlock dataTaskDidReceiveResponse;
+@property (readwrite, nonatomic, copy) AFURLSessionDataTaskDidBecomeDownloadTaskBlock dataTaskDidBecomeDownloadTask;
+@property (readwrite, nonatomic, copy) AFURLSessionDataTaskDidReceiveDataBlock dataTaskDidReceiveData;
+@property (readwrite, nonatomic, copy) AFURLSessionDataTaskWillCacheResponseBlock dataTaskWillCacheResponse;
+@property (readwrite, nonatomic, copy) AFURLSessionDownloadTaskDidFinishDownloadingBlock downloadTaskDidFinishDownloading;
+@property (readwrite, nonatomic, copy) AFURLSessionDownloadTaskDidWriteDataBlock downloadTaskDidWriteData;
+@property (readwrite, nonatomic, copy) AFURLSessionDownloadTaskDidResumeBlock downloadTaskDidResume;
+@end
+
+@implementation AFURLSessionManager
+
+- (instancetype)init {
+    return [self initWithSessionConfiguration:nil];
+}
+
+- (instancetype)initWithSessionConfiguration:(NSURLSessionConfiguration *)configuration {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    if (!configuration) {
+        configuration = [NSURLSessionConfiguration defaultSessionConfiguration];
+    }
+
+    self.sessionConfiguration = configuration;
+
+    self.operationQueue = [[NSOperationQueue alloc] init];
+    self.operationQueue.maxConcurrentOperationCount = 1;
 
     self.session = [NSURLSession sessionWithConfiguration:self.sessionConfiguration delegate:self delegateQueue:self.operationQueue];
 
@@ -494,14 +1764,18 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 
     self.securityPolicy = [AFSecurityPolicy defaultPolicy];
 
+    self.postsTaskResumeAndSuspendNotifications = YES;
+    self.minimumProgressReportingInterval = 1.0 / 30.0;
+
 #if !TARGET_OS_WATCH
     self.reachabilityManager = [AFNetworkReachabilityManager sharedManager];
 #endif
 
-    self.mutableTaskDelegatesKeyedByTaskIdentifier = [[NSMutableDictionary alloc] init];
-
-    self.lock = [[NSLock alloc] init];
-    self.lock.name = AFURLSessionManagerLockName;
+    self.taskDelegates = [[AFURLSessionManagerTaskDelegateRegistry alloc] init];
+    self.taskIndex = [[AFURLSessionManagerTaskIndex alloc] init];
+    self.taskScheduler = [[AFURLSessionManagerTaskScheduler alloc] init];
+    self.taskScheduler.agingInterval = 5.0;
+    self.taskPhaseMetricsRecorder = [[AFURLSessionMetricsRecorder alloc] init];
 
     [self.session getTasksWithCompletionHandler:^(NSArray *dataTasks, NSArray *uploadTasks, NSArray *downloadTasks) {
         for (NSURLSessionDataTask *task in dataTasks) {
@@ -522,33 +1796,24 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 
 - (void)dealloc {
     [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self stopObservingResponseSerializers];
 }
 
 #pragma mark -
 
-- (NSString *)taskDescriptionForSessionTasks {
-    return [NSString stringWithFormat:@"%p", self];
-}
-
-- (void)taskDidResume:(NSNotification *)notification {
-    NSURLSessionTask *task = notification.object;
-    if ([task respondsToSelector:@selector(taskDescription)]) {
-        if ([task.taskDescription isEqualToString:self.taskDescriptionForSessionTasks]) {
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidResumeNotification object:task];
-            });
-        }
+- (void)taskDidResume:(NSURLSessionTask *)task {
+    if (self.postsTaskResumeAndSuspendNotifications) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidResumeNotification object:task];
+        });
     }
 }
 
-- (void)taskDidSuspend:(NSNotification *)notification {
-    NSURLSessionTask *task = notification.object;
-    if ([task respondsToSelector:@selector(taskDescription)]) {
-        if ([task.taskDescription isEqualToString:self.taskDescriptionForSessionTasks]) {
-            dispatch_async(dispatch_get_main_queue(), ^{
-                [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidSuspendNotification object:task];
-            });
-        }
+- (void)taskDidSuspend:(NSURLSessionTask *)task {
+    if (self.postsTaskResumeAndSuspendNotifications) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [[NSNotificationCenter defaultCenter] postNotificationName:AFNetworkingTaskDidSuspendNotification object:task];
+        });
     }
 }
 
@@ -557,12 +1822,7 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 - (AFURLSessionManagerTaskDelegate *)delegateForTask:(NSURLSessionTask *)task {
     NSParameterAssert(task);
 
-    AFURLSessionManagerTaskDelegate *delegate = nil;
-    [self.lock lock];
-    delegate = self.mutableTaskDelegatesKeyedByTaskIdentifier[@(task.taskIdentifier)];
-    [self.lock unlock];
-
-    return delegate;
+    return [self.taskDelegates delegateForTaskIdentifier:task.taskIdentifier];
 }
 
 - (void)setDelegate:(AFURLSessionManagerTaskDelegate *)delegate
@@ -571,10 +1831,33 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
     NSParameterAssert(task);
     NSParameterAssert(delegate);
 
-    [self.lock lock];
-    self.mutableTaskDelegatesKeyedByTaskIdentifier[@(task.taskIdentifier)] = delegate;
-    [self addNotificationObserverForTask:task];
-    [self.lock unlock];
+    if (self.collectsTaskPhaseMetrics) {
+        delegate.phaseMetrics = [[AFURLSessionTaskPhaseMetrics alloc] initWithHost:task.originalRequest.URL.host];
+    }
+
+    [self.taskDelegates setDelegate:delegate forTaskIdentifier:task.taskIdentifier];
+    af_setTaskManager(task, self);
+    [self.taskIndex addTask:task];
+}
+
+- (void)setDelegates:(NSArray <AFURLSessionManagerTaskDelegate *> *)delegates
+              forTasks:(NSArray <NSURLSessionTask *> *)tasks
+{
+    NSParameterAssert(delegates.count == tasks.count);
+
+    BOOL collectsTaskPhaseMetrics = self.collectsTaskPhaseMetrics;
+    NSUInteger *taskIdentifiers = malloc(MAX(tasks.count, 1U) * sizeof(NSUInteger));
+    for (NSUInteger index = 0; index < tasks.count; index++) {
+        if (collectsTaskPhaseMetrics) {
+            delegates[index].phaseMetrics = [[AFURLSessionTaskPhaseMetrics alloc] initWithHost:tasks[index].originalRequest.URL.host];
+        }
+        taskIdentifiers[index] = tasks[index].taskIdentifier;
+        af_setTaskManager(tasks[index], self);
+    }
+    [self.taskDelegates setDelegates:delegates forTaskIdentifiers:taskIdentifiers];
+    free(taskIdentifiers);
+
+    [self.taskIndex addTasks:tasks];
 }
 
 - (void)addDelegateForDataTask:(NSURLSessionDataTask *)dataTask
@@ -584,9 +1867,9 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 {
     AFURLSessionManagerTaskDelegate *delegate = [[AFURLSessionManagerTaskDelegate alloc] initWithTask:dataTask];
     delegate.manager = self;
+    delegate.progressReportingInterval = self.minimumProgressReportingInterval;
     delegate.completionHandler = completionHandler;
 
-    dataTask.taskDescription = self.taskDescriptionForSessionTasks;
     [self setDelegate:delegate forTask:dataTask];
 
     delegate.uploadProgressBlock = uploadProgressBlock;
@@ -599,10 +1882,9 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 {
     AFURLSessionManagerTaskDelegate *delegate = [[AFURLSessionManagerTaskDelegate alloc] initWithTask:uploadTask];
     delegate.manager = self;
+    delegate.progressReportingInterval = self.minimumProgressReportingInterval;
     delegate.completionHandler = completionHandler;
 
-    uploadTask.taskDescription = self.taskDescriptionForSessionTasks;
-
     [self setDelegate:delegate forTask:uploadTask];
 
     delegate.uploadProgressBlock = uploadProgressBlock;
@@ -615,6 +1897,7 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 {
     AFURLSessionManagerTaskDelegate *delegate = [[AFURLSessionManagerTaskDelegate alloc] initWithTask:downloadTask];
     delegate.manager = self;
+    delegate.progressReportingInterval = self.minimumProgressReportingInterval;
     delegate.completionHandler = completionHandler;
 
     if (destination) {
@@ -623,8 +1906,6 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
         };
     }
 
-    downloadTask.taskDescription = self.taskDescriptionForSessionTasks;
-
     [self setDelegate:delegate forTask:downloadTask];
 
     delegate.downloadProgressBlock = downloadProgressBlock;
@@ -633,79 +1914,203 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
 - (void)removeDelegateForTask:(NSURLSessionTask *)task {
     NSParameterAssert(task);
 
-    [self.lock lock];
-    [self removeNotificationObserverForTask:task];
-    [self.mutableTaskDelegatesKeyedByTaskIdentifier removeObjectForKey:@(task.taskIdentifier)];
-    [self.lock unlock];
+    [self.taskIndex removeTask:task];
+    af_setTaskManager(task, nil);
+    [self.taskDelegates removeDelegateForTaskIdentifier:task.taskIdentifier];
 }
 
 #pragma mark -
 
-- (NSArray *)tasksForKeyPath:(NSString *)keyPath {
-    __block NSArray *tasks = nil;
-    dispatch_semaphore_t semaphore = dispatch_semaphore_create(0);
+- (NSArray *)tasks {
+    return [self.taskIndex allTasks];
+}
+
+- (NSArray *)dataTasks {
+    return [self.taskIndex tasksOfKind:AFURLSessionManagerTaskKindData];
+}
+
+- (NSArray *)uploadTasks {
+    return [self.taskIndex tasksOfKind:AFURLSessionManagerTaskKindUpload];
+}
+
+- (NSArray *)downloadTasks {
+    return [self.taskIndex tasksOfKind:AFURLSessionManagerTaskKindDownload];
+}
+
+- (NSUInteger)taskCount {
+    return [self.taskIndex countOfAllTasks];
+}
+
+- (NSUInteger)dataTaskCount {
+    return [self.taskIndex countOfTasksOfKind:AFURLSessionManagerTaskKindData];
+}
+
+- (NSUInteger)uploadTaskCount {
+    return [self.taskIndex countOfTasksOfKind:AFURLSessionManagerTaskKindUpload];
+}
+
+- (NSUInteger)downloadTaskCount {
+    return [self.taskIndex countOfTasksOfKind:AFURLSessionManagerTaskKindDownload];
+}
+
+- (void)getTasksWithCompletionHandler:(void (^)(NSArray <NSURLSessionDataTask *> *dataTasks, NSArray <NSURLSessionUploadTask *> *uploadTasks, NSArray <NSURLSessionDownloadTask *> *downloadTasks))completionHandler {
+    NSParameterAssert(completionHandler);
+
     [self.session getTasksWithCompletionHandler:^(NSArray *dataTasks, NSArray *uploadTasks, NSArray *downloadTasks) {
-        if ([keyPath isEqualToString:NSStringFromSelector(@selector(dataTasks))]) {
-            tasks = dataTasks;
-        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(uploadTasks))]) {
-            tasks = uploadTasks;
-        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(downloadTasks))]) {
-            tasks = downloadTasks;
-        } else if ([keyPath isEqualToString:NSStringFromSelector(@selector(tasks))]) {
-            tasks = [@[dataTasks, uploadTasks, downloadTasks] valueForKeyPath:@"@unionOfArrays.self"];
+        dispatch_async(self.completionQueue ?: dispatch_get_main_queue(), ^{
+            completionHandler(dataTasks, uploadTasks, downloadTasks);
+        });
+    }];
+}
+
+#pragma mark -
+
+- (void)invalidateSessionCancelingTasks:(BOOL)cancelPendingTasks {
+    if (cancelPendingTasks) {
+        [self.session invalidateAndCancel];
+    } else {
+        [self.session finishTasksAndInvalidate];
+    }
+}
+
+#pragma mark -
+
+- (void)setResponseSerializer:(id <AFURLResponseSerialization>)responseSerializer {
+    NSParameterAssert(responseSerializer);
+
+    [self stopObservingResponseSerializers];
+    _responseSerializer = responseSerializer;
+    [self startObservingResponseSerializer:responseSerializer];
+    [self responseSerializerConfigurationDidChange];
+}
+
+// Settings of the serializer, and of the serializers of a compound serializer, are observed so that objects cached with earlier settings are never reused.
+- (void)startObservingResponseSerializer:(id <AFURLResponseSerialization>)responseSerializer {
+    NSMutableArray <AFHTTPResponseSerializer *> *serializers = [NSMutableArray array];
+    NSMutableArray <id <AFURLResponseSerialization>> *pendingSerializers = [NSMutableArray arrayWithObject:responseSerializer];
+    while (pendingSerializers.count > 0) {
+        id <AFURLResponseSerialization> serializer = pendingSerializers.lastObject;
+        [pendingSerializers removeLastObject];
+        if (![serializer isKindOfClass:[AFHTTPResponseSerializer class]] || [serializers containsObject:serializer]) {
+            continue;
         }
 
-        dispatch_semaphore_signal(semaphore);
-    }];
+        [serializers addObject:(AFHTTPResponseSerializer *)serializer];
+        if ([serializer isKindOfClass:[AFCompoundResponseSerializer class]]) {
+            [pendingSerializers addObjectsFromArray:[(AFCompoundResponseSerializer *)serializer responseSerializers]];
+        }
+    }
 
-    dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER);
+    for (AFHTTPResponseSerializer *serializer in serializers) {
+        for (NSString *keyPath in af_responseSerializerObservedKeyPaths()) {
+            if ([serializer respondsToSelector:NSSelectorFromString(keyPath)]) {
+                [serializer addObserver:self forKeyPath:keyPath options:(NSKeyValueObservingOptions)0 context:AFURLSessionManagerResponseSerializerObserverContext];
+            }
+        }
+    }
+    self.observedResponseSerializers = serializers;
+}
 
-    return tasks;
+- (void)stopObservingResponseSerializers {
+    for (AFHTTPResponseSerializer *serializer in self.observedResponseSerializers) {
+        for (NSString *keyPath in af_responseSerializerObservedKeyPaths()) {
+            if ([serializer respondsToSelector:NSSelectorFromString(keyPath)]) {
+                [serializer removeObserver:self forKeyPath:keyPath context:AFURLSessionManagerResponseSerializerObserverContext];
+            }
+        }
+    }
+    self.observedResponseSerializers = nil;
 }
 
-- (NSArray *)tasks {
-    return [self tasksForKeyPath:NSStringFromSelector(_cmd)];
+- (void)responseSerializerConfigurationDidChange {
+    self.responseSerializerConfigurationVersion += 1;
+    [self.responseObjectCache removeAllObjects];
+}
+
+- (void)observeValueForKeyPath:(NSString *)keyPath
+                      ofObject:(id)object
+                        change:(NSDictionary *)change
+                       context:(void *)context
+{
+    if (context == AFURLSessionManagerResponseSerializerObserverContext) {
+        [self responseSerializerConfigurationDidChange];
+    } else {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+    }
+}
+
+#pragma mark - Response Object Cache
+
+- (NSUInteger)responseObjectCacheCostLimit {
+    return self.responseObjectCache.totalCostLimit;
+}
+
+- (void)setResponseObjectCacheCostLimit:(NSUInteger)responseObjectCacheCostLimit {
+    if (responseObjectCacheCostLimit == 0) {
+        self.responseObjectCache = nil;
+    } else if (self.responseObjectCache) {
+        self.responseObjectCache.totalCostLimit = responseObjectCacheCostLimit;
+    } else {
+        NSCache *responseObjectCache = [[NSCache alloc] init];
+        responseObjectCache.totalCostLimit = responseObjectCacheCostLimit;
+        self.responseObjectCache = responseObjectCache;
+    }
 }
 
-- (NSArray *)dataTasks {
-    return [self tasksForKeyPath:NSStringFromSelector(_cmd)];
-}
+// Archiving captures every setting of the serializer, and is only done again once the serializer or one of its settings changes, rather than for every response.
+// The serializer and the version of its settings are kept along with the digest, so that a digest is never used with another serializer or with changed settings.
+- (NSString *)digestOfResponseSerializer:(id <AFURLResponseSerialization>)responseSerializer {
+    NSUInteger configurationVersion = self.responseSerializerConfigurationVersion;
+    NSArray *responseSerializerDigestRecord = self.responseSerializerDigestRecord;
+    if (responseSerializerDigestRecord[0] == responseSerializer && [responseSerializerDigestRecord[2] unsignedIntegerValue] == configurationVersion) {
+        return responseSerializerDigestRecord[1];
+    }
 
-- (NSArray *)uploadTasks {
-    return [self tasksForKeyPath:NSStringFromSelector(_cmd)];
-}
+    NSString *digest = af_SHA256HexDigest([NSKeyedArchiver archivedDataWithRootObject:responseSerializer]);
+    self.responseSerializerDigestRecord = @[responseSerializer, digest, @(configurationVersion)];
 
-- (NSArray *)downloadTasks {
-    return [self tasksForKeyPath:NSStringFromSelector(_cmd)];
+    return digest;
 }
 
-#pragma mark -
+- (id)responseObjectForResponse:(NSURLResponse *)response
+                           data:(NSData *)data
+                          error:(NSError * __autoreleasing *)error
+{
+    id <AFURLResponseSerialization> responseSerializer = self.responseSerializer;
+    NSCache *responseObjectCache = self.responseObjectCache;
 
-- (void)invalidateSessionCancelingTasks:(BOOL)cancelPendingTasks {
-    if (cancelPendingTasks) {
-        [self.session invalidateAndCancel];
-    } else {
-        [self.session finishTasksAndInvalidate];
+    NSString *key = nil;
+    if (responseObjectCache && data.length >= AFMinimumDataLengthForCachedResponseObject && af_responseSerializerReturnsImmutableObjects(responseSerializer)) {
+        key = af_responseObjectCacheKey(response, data, [self digestOfResponseSerializer:responseSerializer]);
     }
-}
 
-#pragma mark -
+    id responseObject = key ? [responseObjectCache objectForKey:key] : nil;
+    if (responseObject) {
+        if (af_responseSerializerValidatesResponse(responseSerializer, response, data, nil)) {
+            if (error) {
+                *error = nil;
+            }
 
-- (void)setResponseSerializer:(id <AFURLResponseSerialization>)responseSerializer {
-    NSParameterAssert(responseSerializer);
+            return responseObject;
+        }
 
-    _responseSerializer = responseSerializer;
-}
+        // The response is serialized again, so that it fails the way the serializer reports it.
+        [responseObjectCache removeObjectForKey:key];
+    }
 
-#pragma mark -
-- (void)addNotificationObserverForTask:(NSURLSessionTask *)task {
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(taskDidResume:) name:AFNSURLSessionTaskDidResumeNotification object:task];
-    [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(taskDidSuspend:) name:AFNSURLSessionTaskDidSuspendNotification object:task];
-}
+    NSError *serializationError = nil;
+    uint64_t traceBeginTime = AFTraceBegin();
+    responseObject = [responseSerializer responseObjectForResponse:response data:data error:&serializationError];
+    AFTraceEnd(traceBeginTime, "responseObjectForResponse:data:error:", "serialization");
+    if (key && responseObject && !serializationError) {
+        [responseObjectCache setObject:responseObject forKey:key cost:data.length];
+    }
+
+    if (error) {
+        *error = serializationError;
+    }
 
-- (void)removeNotificationObserverForTask:(NSURLSessionTask *)task {
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:AFNSURLSessionTaskDidSuspendNotification object:task];
-    [[NSNotificationCenter defaultCenter] removeObserver:self name:AFNSURLSessionTaskDidResumeNotification object:task];
+    return responseObject;
 }
 
 #pragma mark -
@@ -731,6 +2136,84 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
     return dataTask;
 }
 
+- (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request
+                               uploadProgress:(void (^)(NSProgress *uploadProgress))uploadProgressBlock
+                             downloadProgress:(void (^)(NSProgress *downloadProgress))downloadProgressBlock
+                        dataCompletionHandler:(void (^)(NSURLResponse *response, NSData *data, id responseObject, NSError *error))completionHandler
+{
+    NSURLSessionDataTask *dataTask = [self dataTaskWithRequest:request uploadProgress:uploadProgressBlock downloadProgress:downloadProgressBlock completionHandler:nil];
+    [self delegateForTask:dataTask].dataCompletionHandler = completionHandler;
+
+    return dataTask;
+}
+
+- (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request
+                                highWatermark:(NSUInteger)highWatermark
+                                 lowWatermark:(NSUInteger)lowWatermark
+                                 chunkHandler:(void (^)(NSData *chunk))chunkHandler
+                            completionHandler:(void (^)(NSURLResponse *response, NSError *error))completionHandler
+{
+    return [self dataTaskWithRequest:request highWatermark:highWatermark lowWatermark:lowWatermark queue:nil chunkHandler:chunkHandler completionHandler:completionHandler];
+}
+
+- (NSURLSessionDataTask *)dataTaskWithRequest:(NSURLRequest *)request
+                                highWatermark:(NSUInteger)highWatermark
+                                 lowWatermark:(NSUInteger)lowWatermark
+                                        queue:(dispatch_queue_t)queue
+                                 chunkHandler:(void (^)(NSData *chunk))chunkHandler
+                            completionHandler:(void (^)(NSURLResponse *response, NSError *error))completionHandler
+{
+    NSParameterAssert(chunkHandler);
+    NSParameterAssert(lowWatermark <= highWatermark);
+
+    NSURLSessionDataTask *dataTask = [self dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse *response, __unused id responseObject, NSError *error) {
+        if (completionHandler) {
+            completionHandler(response, error);
+        }
+    }];
+
+    NSString *name = [NSString stringWithFormat:@"com.alamofire.networking.session.manager.chunk-%@", [[NSUUID UUID] UUIDString]];
+    dispatch_queue_t chunkQueue = dispatch_queue_create([name cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_SERIAL);
+    dispatch_set_target_queue(chunkQueue, queue ?: self.completionQueue ?: dispatch_get_main_queue());
+
+    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:dataTask];
+    delegate.mutableData = nil;
+    delegate.chunkQueue = chunkQueue;
+    delegate.highWatermark = highWatermark;
+    delegate.lowWatermark = lowWatermark;
+    delegate.chunkHandler = chunkHandler;
+
+    return dataTask;
+}
+
+- (NSArray <NSURLSessionDataTask *> *)dataTasksWithRequests:(NSArray <NSURLRequest *> *)requests
+                                           completionHandler:(void (^)(NSURLSessionDataTask *task, NSURLResponse *response, id responseObject, NSError *error))completionHandler
+{
+    NSMutableArray <NSURLSessionDataTask *> *dataTasks = [NSMutableArray arrayWithCapacity:requests.count];
+    url_session_manager_create_task_safely(^{
+        for (NSURLRequest *request in requests) {
+            [dataTasks addObject:[self.session dataTaskWithRequest:request]];
+        }
+    });
+
+    NSMutableArray <AFURLSessionManagerTaskDelegate *> *delegates = [NSMutableArray arrayWithCapacity:dataTasks.count];
+    for (NSURLSessionDataTask *dataTask in dataTasks) {
+        AFURLSessionManagerTaskDelegate *delegate = [[AFURLSessionManagerTaskDelegate alloc] initWithTask:dataTask];
+        delegate.manager = self;
+        delegate.progressReportingInterval = self.minimumProgressReportingInterval;
+        if (completionHandler) {
+            delegate.completionHandler = ^(NSURLResponse *response, id responseObject, NSError *error) {
+                completionHandler(dataTask, response, responseObject, error);
+            };
+        }
+        [delegates addObject:delegate];
+    }
+
+    [self setDelegates:delegates forTasks:dataTasks];
+
+    return [dataTasks copy];
+}
+
 #pragma mark -
 
 - (NSURLSessionUploadTask *)uploadTaskWithRequest:(NSURLRequest *)request
@@ -903,16 +2386,211 @@ static NSString * const AFNSURLSessionTaskDidSuspendNotification = @"com.alamofi
     if (selector == @selector(URLSession:task:willPerformHTTPRedirection:newRequest:completionHandler:)) {
         return self.taskWillPerformHTTPRedirection != nil;
     } else if (selector == @selector(URLSession:dataTask:didReceiveResponse:completionHandler:)) {
-        return self.dataTaskDidReceiveResponse != nil;
+        return self.dataTaskDidReceiveResponse != nil || self.validatesResponsesOnReceipt || self.maximumInMemoryResponseDataLength > 0;
     } else if (selector == @selector(URLSession:dataTask:willCacheResponse:completionHandler:)) {
         return self.dataTaskWillCacheResponse != nil;
     } else if (selector == @selector(URLSessionDidFinishEventsForBackgroundURLSession:)) {
         return self.didFinishEventsForBackgroundURLSession != nil;
     }
 
+#if AF_CAN_COLLECT_TASK_METRICS
+    if (selector == @selector(URLSession:task:didFinishCollectingMetrics:)) {
+        return self.collectsTaskPhaseMetrics;
+    }
+#endif
+
     return [[self class] instancesRespondToSelector:selector];
 }
 
+#pragma mark - Task Scheduling
+
+- (NSUInteger)maximumActiveTasks {
+    return self.taskScheduler.maximumActiveTasks;
+}
+
+- (void)setMaximumActiveTasks:(NSUInteger)maximumActiveTasks {
+    self.taskScheduler.maximumActiveTasks = maximumActiveTasks;
+    [self startScheduledTasksFromWakeup:NO];
+}
+
+- (NSUInteger)maximumActiveTasksPerHost {
+    return self.taskScheduler.maximumActiveTasksPerHost;
+}
+
+- (void)setMaximumActiveTasksPerHost:(NSUInteger)maximumActiveTasksPerHost {
+    self.taskScheduler.maximumActiveTasksPerHost = maximumActiveTasksPerHost;
+    [self startScheduledTasksFromWakeup:NO];
+}
+
+- (double)maximumTaskStartsPerSecond {
+    return self.taskScheduler.maximumTaskStartsPerSecond;
+}
+
+- (void)setMaximumTaskStartsPerSecond:(double)maximumTaskStartsPerSecond {
+    self.taskScheduler.maximumTaskStartsPerSecond = maximumTaskStartsPerSecond;
+    [self startScheduledTasksFromWakeup:NO];
+}
+
+- (double)maximumTaskStartsPerSecondPerHost {
+    return self.taskScheduler.maximumTaskStartsPerSecondPerHost;
+}
+
+- (void)setMaximumTaskStartsPerSecondPerHost:(double)maximumTaskStartsPerSecondPerHost {
+    self.taskScheduler.maximumTaskStartsPerSecondPerHost = maximumTaskStartsPerSecondPerHost;
+    [self startScheduledTasksFromWakeup:NO];
+}
+
+- (NSTimeInterval)taskPriorityAgingInterval {
+    return self.taskScheduler.agingInterval;
+}
+
+- (void)setTaskPriorityAgingInterval:(NSTimeInterval)taskPriorityAgingInterval {
+    self.taskScheduler.agingInterval = taskPriorityAgingInterval;
+}
+
+- (NSUInteger)queuedTaskCount {
+    return [self.taskScheduler countOfQueuedTasks];
+}
+
+- (void)scheduleTask:(NSURLSessionTask *)task {
+    [self scheduleTask:task priority:AFURLSessionTaskPriorityDefault];
+}
+
+- (void)scheduleTask:(NSURLSessionTask *)task
+            priority:(AFURLSessionTaskPriority)priority
+{
+    if (!task) {
+        return;
+    }
+
+    if ([task respondsToSelector:@selector(setPriority:)]) {
+        task.priority = af_sessionTaskPriority(priority);
+    }
+
+    if (![self.taskScheduler enqueueTask:task priority:priority]) {
+        [self recordDuration:0.0 ofPhase:AFURLSessionTaskPhaseQueueWait forTask:task];
+        [task resume];
+        return;
+    }
+
+    [self startScheduledTasksFromWakeup:NO];
+}
+
+- (void)startScheduledTasksFromWakeup:(BOOL)fromWakeup {
+    NSTimeInterval wakeupDelay = 0.0;
+    NSArray <AFURLSessionManagerScheduledTask *> *startableTasks = [self.taskScheduler dequeueStartableTasksWithWakeupDelay:&wakeupDelay fromWakeup:fromWakeup];
+
+    for (AFURLSessionManagerScheduledTask *scheduledTask in startableTasks) {
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:scheduledTask.task];
+        delegate.queueWaitTime = @(scheduledTask.queueWaitTime);
+        [delegate.phaseMetrics recordDuration:scheduledTask.queueWaitTime forPhase:AFURLSessionTaskPhaseQueueWait];
+
+        if (self.taskWillStartFromScheduler) {
+            self.taskWillStartFromScheduler(self.session, scheduledTask.task, scheduledTask.queueWaitTime);
+        }
+
+        [scheduledTask.task resume];
+    }
+
+    if (wakeupDelay > 0.0) {
+        __weak __typeof__(self) weakSelf = self;
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(wakeupDelay * NSEC_PER_SEC)), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            [weakSelf startScheduledTasksFromWakeup:YES];
+        });
+    }
+}
+
+- (void)setTaskWillStartFromSchedulerBlock:(void (^)(NSURLSession *session, NSURLSessionTask *task, NSTimeInterval queueWaitTime))block {
+    self.taskWillStartFromScheduler = block;
+}
+
+#pragma mark - Task Phase Metrics
+
+- (void)recordDuration:(NSTimeInterval)duration
+               ofPhase:(AFURLSessionTaskPhase)phase
+               forTask:(NSURLSessionTask *)task
+{
+    if (!task || !self.collectsTaskPhaseMetrics) {
+        return;
+    }
+
+    [[self delegateForTask:task].phaseMetrics recordDuration:duration forPhase:phase];
+}
+
+- (void)taskDidFinishCollectingPhaseMetrics:(AFURLSessionTaskPhaseMetrics *)phaseMetrics
+                                    forTask:(NSURLSessionTask *)task
+{
+    [self.taskPhaseMetricsRecorder recordPhaseMetrics:phaseMetrics];
+
+    AFURLSessionTaskDidFinishCollectingPhaseMetricsBlock taskDidFinishCollectingPhaseMetrics = self.taskDidFinishCollectingPhaseMetrics;
+    if (taskDidFinishCollectingPhaseMetrics) {
+        taskDidFinishCollectingPhaseMetrics(self.session, task, phaseMetrics);
+    }
+}
+
+- (void)setTaskDidFinishCollectingPhaseMetricsBlock:(void (^)(NSURLSession *session, NSURLSessionTask *task, AFURLSessionTaskPhaseMetrics *metrics))block {
+    self.taskDidFinishCollectingPhaseMetrics = block;
+}
+
+#pragma mark - Delegate Lanes
+
+// Selector names are registered for the life of the process, so they can be used as span names without copying them.
+static dispatch_block_t af_tracedDelegateCallback(SEL selector, dispatch_block_t block) {
+    if (!AFTracingEnabled) {
+        return block;
+    }
+
+    const char *name = sel_getName(selector);
+    return ^{
+        uint64_t traceBeginTime = AFTraceBegin();
+        block();
+        AFTraceEnd(traceBeginTime, name, "delegate");
+    };
+}
+
+- (void)setDelegateLaneCount:(NSUInteger)delegateLaneCount {
+    NSMutableArray <dispatch_queue_t> *lanes = [NSMutableArray arrayWithCapacity:delegateLaneCount];
+    for (NSUInteger index = 0; index < delegateLaneCount; index++) {
+        NSString *label = [NSString stringWithFormat:@"com.alamofire.networking.session.manager.lane-%lu-%@", (unsigned long)index, [[NSUUID UUID] UUIDString]];
+        [lanes addObject:dispatch_queue_create([label UTF8String], DISPATCH_QUEUE_SERIAL)];
+    }
+
+    _delegateLaneCount = delegateLaneCount;
+    self.delegateLanes = lanes;
+}
+
+// Callbacks for a task always go to the same lane, in the order the session delivered them.
+- (void)performDelegateCallbackForTask:(NSURLSessionTask *)task
+                              selector:(SEL)selector
+                            usingBlock:(dispatch_block_t)block
+{
+    block = af_tracedDelegateCallback(selector, block);
+
+    NSArray <dispatch_queue_t> *lanes = self.delegateLanes;
+    if (lanes.count == 0) {
+        block();
+        return;
+    }
+
+    dispatch_async(lanes[task.taskIdentifier % lanes.count], block);
+}
+
+// Used for callbacks that must be finished before returning to the session, such as moving a downloaded file before it is deleted.
+- (void)performDelegateCallbackAndWaitForTask:(NSURLSessionTask *)task
+                                     selector:(SEL)selector
+                                   usingBlock:(dispatch_block_t)block
+{
+    block = af_tracedDelegateCallback(selector, block);
+
+    NSArray <dispatch_queue_t> *lanes = self.delegateLanes;
+    if (lanes.count == 0) {
+        block();
+        return;
+    }
+
+    dispatch_sync(lanes[task.taskIdentifier % lanes.count], block);
+}
+
 #pragma mark - NSURLSessionDelegate
 
 - (void)URLSession:(NSURLSession *)session
@@ -964,15 +2642,17 @@ willPerformHTTPRedirection:(NSHTTPURLResponse *)response
         newRequest:(NSURLRequest *)request
  completionHandler:(void (^)(NSURLRequest *))completionHandler
 {
-    NSURLRequest *redirectRequest = request;
+    [self performDelegateCallbackForTask:task selector:_cmd usingBlock:^{
+        NSURLRequest *redirectRequest = request;
 
-    if (self.taskWillPerformHTTPRedirection) {
-        redirectRequest = self.taskWillPerformHTTPRedirection(session, task, response, request);
-    }
+        if (self.taskWillPerformHTTPRedirection) {
+            redirectRequest = self.taskWillPerformHTTPRedirection(session, task, response, request);
+        }
 
-    if (completionHandler) {
-        completionHandler(redirectRequest);
-    }
+        if (completionHandler) {
+            completionHandler(redirectRequest);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -980,44 +2660,48 @@ willPerformHTTPRedirection:(NSHTTPURLResponse *)response
 didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
  completionHandler:(void (^)(NSURLSessionAuthChallengeDisposition disposition, NSURLCredential *credential))completionHandler
 {
-    NSURLSessionAuthChallengeDisposition disposition = NSURLSessionAuthChallengePerformDefaultHandling;
-    __block NSURLCredential *credential = nil;
+    [self performDelegateCallbackForTask:task selector:_cmd usingBlock:^{
+        NSURLSessionAuthChallengeDisposition disposition = NSURLSessionAuthChallengePerformDefaultHandling;
+        __block NSURLCredential *credential = nil;
 
-    if (self.taskDidReceiveAuthenticationChallenge) {
-        disposition = self.taskDidReceiveAuthenticationChallenge(session, task, challenge, &credential);
-    } else {
-        if ([challenge.protectionSpace.authenticationMethod isEqualToString:NSURLAuthenticationMethodServerTrust]) {
-            if ([self.securityPolicy evaluateServerTrust:challenge.protectionSpace.serverTrust forDomain:challenge.protectionSpace.host]) {
-                disposition = NSURLSessionAuthChallengeUseCredential;
-                credential = [NSURLCredential credentialForTrust:challenge.protectionSpace.serverTrust];
+        if (self.taskDidReceiveAuthenticationChallenge) {
+            disposition = self.taskDidReceiveAuthenticationChallenge(session, task, challenge, &credential);
+        } else {
+            if ([challenge.protectionSpace.authenticationMethod isEqualToString:NSURLAuthenticationMethodServerTrust]) {
+                if ([self.securityPolicy evaluateServerTrust:challenge.protectionSpace.serverTrust forDomain:challenge.protectionSpace.host]) {
+                    disposition = NSURLSessionAuthChallengeUseCredential;
+                    credential = [NSURLCredential credentialForTrust:challenge.protectionSpace.serverTrust];
+                } else {
+                    disposition = NSURLSessionAuthChallengeCancelAuthenticationChallenge;
+                }
             } else {
-                disposition = NSURLSessionAuthChallengeCancelAuthenticationChallenge;
+                disposition = NSURLSessionAuthChallengePerformDefaultHandling;
             }
-        } else {
-            disposition = NSURLSessionAuthChallengePerformDefaultHandling;
         }
-    }
 
-    if (completionHandler) {
-        completionHandler(disposition, credential);
-    }
+        if (completionHandler) {
+            completionHandler(disposition, credential);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
               task:(NSURLSessionTask *)task
  needNewBodyStream:(void (^)(NSInputStream *bodyStream))completionHandler
 {
-    NSInputStream *inputStream = nil;
+    [self performDelegateCallbackForTask:task selector:_cmd usingBlock:^{
+        NSInputStream *inputStream = nil;
 
-    if (self.taskNeedNewBodyStream) {
-        inputStream = self.taskNeedNewBodyStream(session, task);
-    } else if (task.originalRequest.HTTPBodyStream && [task.originalRequest.HTTPBodyStream conformsToProtocol:@protocol(NSCopying)]) {
-        inputStream = [task.originalRequest.HTTPBodyStream copy];
-    }
+        if (self.taskNeedNewBodyStream) {
+            inputStream = self.taskNeedNewBodyStream(session, task);
+        } else if (task.originalRequest.HTTPBodyStream && [task.originalRequest.HTTPBodyStream conformsToProtocol:@protocol(NSCopying)]) {
+            inputStream = [task.originalRequest.HTTPBodyStream copy];
+        }
 
-    if (completionHandler) {
-        completionHandler(inputStream);
-    }
+        if (completionHandler) {
+            completionHandler(inputStream);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -1026,42 +2710,62 @@ didReceiveChallenge:(NSURLAuthenticationChallenge *)challenge
     totalBytesSent:(int64_t)totalBytesSent
 totalBytesExpectedToSend:(int64_t)totalBytesExpectedToSend
 {
+    [self performDelegateCallbackForTask:task selector:_cmd usingBlock:^{
+        int64_t totalUnitCount = totalBytesExpectedToSend;
+        if(totalUnitCount == NSURLSessionTransferSizeUnknown) {
+            NSString *contentLength = [task.originalRequest valueForHTTPHeaderField:@"Content-Length"];
+            if(contentLength) {
+                totalUnitCount = (int64_t) [contentLength longLongValue];
+            }
+        }
+
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:task];
 
-    int64_t totalUnitCount = totalBytesExpectedToSend;
-    if(totalUnitCount == NSURLSessionTransferSizeUnknown) {
-        NSString *contentLength = [task.originalRequest valueForHTTPHeaderField:@"Content-Length"];
-        if(contentLength) {
-            totalUnitCount = (int64_t) [contentLength longLongValue];
+        if (delegate) {
+            [delegate URLSession:session task:task didSendBodyData:bytesSent totalBytesSent:totalBytesSent totalBytesExpectedToSend:totalBytesExpectedToSend];
         }
-    }
-    
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:task];
-    
-    if (delegate) {
-        [delegate URLSession:session task:task didSendBodyData:bytesSent totalBytesSent:totalBytesSent totalBytesExpectedToSend:totalBytesExpectedToSend];
-    }
 
-    if (self.taskDidSendBodyData) {
-        self.taskDidSendBodyData(session, task, bytesSent, totalBytesSent, totalUnitCount);
-    }
+        if (self.taskDidSendBodyData) {
+            self.taskDidSendBodyData(session, task, bytesSent, totalBytesSent, totalUnitCount);
+        }
+    }];
+}
+
+#if AF_CAN_COLLECT_TASK_METRICS
+- (void)URLSession:(__unused NSURLSession *)session
+              task:(NSURLSessionTask *)task
+didFinishCollectingMetrics:(NSURLSessionTaskMetrics *)metrics
+{
+    [self performDelegateCallbackForTask:task selector:_cmd usingBlock:^{
+        AFURLSessionTaskPhaseMetrics *phaseMetrics = [self delegateForTask:task].phaseMetrics;
+        if (phaseMetrics) {
+            af_recordNetworkPhaseMetrics(phaseMetrics, metrics);
+        }
+    }];
 }
+#endif
 
 - (void)URLSession:(NSURLSession *)session
               task:(NSURLSessionTask *)task
 didCompleteWithError:(NSError *)error
 {
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:task];
+    [self.taskScheduler taskDidComplete:task];
+    [self startScheduledTasksFromWakeup:NO];
 
-    // delegate may be nil when completing a task in the background
-    if (delegate) {
-        [delegate URLSession:session task:task didCompleteWithError:error];
+    [self performDelegateCallbackForTask:task selector:_cmd usingBlock:^{
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:task];
 
-        [self removeDelegateForTask:task];
-    }
+        // delegate may be nil when completing a task in the background
+        if (delegate) {
+            [delegate URLSession:session task:task didCompleteWithError:error];
 
-    if (self.taskDidComplete) {
-        self.taskDidComplete(session, task, error);
-    }
+            [self removeDelegateForTask:task];
+        }
+
+        if (self.taskDidComplete) {
+            self.taskDidComplete(session, task, error);
+        }
+    }];
 }
 
 #pragma mark - NSURLSessionDataDelegate
@@ -1071,43 +2775,60 @@ didCompleteWithError:(NSError *)error
 didReceiveResponse:(NSURLResponse *)response
  completionHandler:(void (^)(NSURLSessionResponseDisposition disposition))completionHandler
 {
-    NSURLSessionResponseDisposition disposition = NSURLSessionResponseAllow;
+    [self performDelegateCallbackForTask:dataTask selector:_cmd usingBlock:^{
+        NSURLSessionResponseDisposition disposition = NSURLSessionResponseAllow;
 
-    if (self.dataTaskDidReceiveResponse) {
-        disposition = self.dataTaskDidReceiveResponse(session, dataTask, response);
-    }
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:dataTask];
+        if (self.validatesResponsesOnReceipt && delegate && ![delegate acceptsResponse:response]) {
+            disposition = self.maximumRejectedResponseDataLength > 0 ? NSURLSessionResponseAllow : NSURLSessionResponseCancel;
+        } else {
+            if (self.dataTaskDidReceiveResponse) {
+                disposition = self.dataTaskDidReceiveResponse(session, dataTask, response);
+            }
 
-    if (completionHandler) {
-        completionHandler(disposition);
-    }
+            // Upload tasks cannot become download tasks.
+            if (disposition == NSURLSessionResponseAllow && ![dataTask isKindOfClass:[NSURLSessionUploadTask class]] && [delegate shouldBecomeDownloadTaskForResponse:response]) {
+                disposition = NSURLSessionResponseBecomeDownload;
+            }
+        }
+
+        if (completionHandler) {
+            completionHandler(disposition);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
           dataTask:(NSURLSessionDataTask *)dataTask
 didBecomeDownloadTask:(NSURLSessionDownloadTask *)downloadTask
 {
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:dataTask];
-    if (delegate) {
-        [self removeDelegateForTask:dataTask];
-        [self setDelegate:delegate forTask:downloadTask];
-    }
+    [self.taskScheduler task:dataTask didBecomeTask:downloadTask];
 
-    if (self.dataTaskDidBecomeDownloadTask) {
-        self.dataTaskDidBecomeDownloadTask(session, dataTask, downloadTask);
-    }
+    [self performDelegateCallbackAndWaitForTask:dataTask selector:_cmd usingBlock:^{
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:dataTask];
+        if (delegate) {
+            [self removeDelegateForTask:dataTask];
+            [self setDelegate:delegate forTask:downloadTask];
+        }
+
+        if (self.dataTaskDidBecomeDownloadTask) {
+            self.dataTaskDidBecomeDownloadTask(session, dataTask, downloadTask);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
           dataTask:(NSURLSessionDataTask *)dataTask
     didReceiveData:(NSData *)data
 {
+    [self performDelegateCallbackForTask:dataTask selector:_cmd usingBlock:^{
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:dataTask];
+        [delegate URLSession:session dataTask:dataTask didReceiveData:data];
 
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:dataTask];
-    [delegate URLSession:session dataTask:dataTask didReceiveData:data];
-
-    if (self.dataTaskDidReceiveData) {
-        self.dataTaskDidReceiveData(session, dataTask, data);
-    }
+        if (self.dataTaskDidReceiveData) {
+            self.dataTaskDidReceiveData(session, dataTask, data);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -1115,15 +2836,17 @@ didBecomeDownloadTask:(NSURLSessionDownloadTask *)downloadTask
  willCacheResponse:(NSCachedURLResponse *)proposedResponse
  completionHandler:(void (^)(NSCachedURLResponse *cachedResponse))completionHandler
 {
-    NSCachedURLResponse *cachedResponse = proposedResponse;
+    [self performDelegateCallbackForTask:dataTask selector:_cmd usingBlock:^{
+        NSCachedURLResponse *cachedResponse = proposedResponse;
 
-    if (self.dataTaskWillCacheResponse) {
-        cachedResponse = self.dataTaskWillCacheResponse(session, dataTask, proposedResponse);
-    }
+        if (self.dataTaskWillCacheResponse) {
+            cachedResponse = self.dataTaskWillCacheResponse(session, dataTask, proposedResponse);
+        }
 
-    if (completionHandler) {
-        completionHandler(cachedResponse);
-    }
+        if (completionHandler) {
+            completionHandler(cachedResponse);
+        }
+    }];
 }
 
 - (void)URLSessionDidFinishEventsForBackgroundURLSession:(NSURLSession *)session {
@@ -1140,24 +2863,26 @@ didBecomeDownloadTask:(NSURLSessionDownloadTask *)downloadTask
       downloadTask:(NSURLSessionDownloadTask *)downloadTask
 didFinishDownloadingToURL:(NSURL *)location
 {
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:downloadTask];
-    if (self.downloadTaskDidFinishDownloading) {
-        NSURL *fileURL = self.downloadTaskDidFinishDownloading(session, downloadTask, location);
-        if (fileURL) {
-            delegate.downloadFileURL = fileURL;
-            NSError *error = nil;
-            
-            if (![[NSFileManager defaultManager] moveItemAtURL:location toURL:fileURL error:&error]) {
-                [[NSNotificationCenter defaultCenter] postNotificationName:AFURLSessionDownloadTaskDidFailToMoveFileNotification object:downloadTask userInfo:error.userInfo];
-            }
+    [self performDelegateCallbackAndWaitForTask:downloadTask selector:_cmd usingBlock:^{
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:downloadTask];
+        if (self.downloadTaskDidFinishDownloading) {
+            NSURL *fileURL = self.downloadTaskDidFinishDownloading(session, downloadTask, location);
+            if (fileURL) {
+                delegate.downloadFileURL = fileURL;
+                NSError *error = nil;
+
+                if (![[NSFileManager defaultManager] moveItemAtURL:location toURL:fileURL error:&error]) {
+                    [[NSNotificationCenter defaultCenter] postNotificationName:AFURLSessionDownloadTaskDidFailToMoveFileNotification object:downloadTask userInfo:error.userInfo];
+                }
 
-            return;
+                return;
+            }
         }
-    }
 
-    if (delegate) {
-        [delegate URLSession:session downloadTask:downloadTask didFinishDownloadingToURL:location];
-    }
+        if (delegate) {
+            [delegate URLSession:session downloadTask:downloadTask didFinishDownloadingToURL:location];
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -1166,16 +2891,17 @@ didFinishDownloadingToURL:(NSURL *)location
  totalBytesWritten:(int64_t)totalBytesWritten
 totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite
 {
-    
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:downloadTask];
-    
-    if (delegate) {
-        [delegate URLSession:session downloadTask:downloadTask didWriteData:bytesWritten totalBytesWritten:totalBytesWritten totalBytesExpectedToWrite:totalBytesExpectedToWrite];
-    }
+    [self performDelegateCallbackForTask:downloadTask selector:_cmd usingBlock:^{
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:downloadTask];
 
-    if (self.downloadTaskDidWriteData) {
-        self.downloadTaskDidWriteData(session, downloadTask, bytesWritten, totalBytesWritten, totalBytesExpectedToWrite);
-    }
+        if (delegate) {
+            [delegate URLSession:session downloadTask:downloadTask didWriteData:bytesWritten totalBytesWritten:totalBytesWritten totalBytesExpectedToWrite:totalBytesExpectedToWrite];
+        }
+
+        if (self.downloadTaskDidWriteData) {
+            self.downloadTaskDidWriteData(session, downloadTask, bytesWritten, totalBytesWritten, totalBytesExpectedToWrite);
+        }
+    }];
 }
 
 - (void)URLSession:(NSURLSession *)session
@@ -1183,16 +2909,17 @@ totalBytesExpectedToWrite:(int64_t)totalBytesExpectedToWrite
  didResumeAtOffset:(int64_t)fileOffset
 expectedTotalBytes:(int64_t)expectedTotalBytes
 {
-    
-    AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:downloadTask];
-    
-    if (delegate) {
-        [delegate URLSession:session downloadTask:downloadTask didResumeAtOffset:fileOffset expectedTotalBytes:expectedTotalBytes];
-    }
+    [self performDelegateCallbackForTask:downloadTask selector:_cmd usingBlock:^{
+        AFURLSessionManagerTaskDelegate *delegate = [self delegateForTask:downloadTask];
 
-    if (self.downloadTaskDidResume) {
-        self.downloadTaskDidResume(session, downloadTask, fileOffset, expectedTotalBytes);
-    }
+        if (delegate) {
+            [delegate URLSession:session downloadTask:downloadTask didResumeAtOffset:fileOffset expectedTotalBytes:expectedTotalBytes];
+        }
+
+        if (self.downloadTaskDidResume) {
+            self.downloadTaskDidResume(session, downloadTask, fileOffset, expectedTotalBytes);
+        }
+    }];
 }
 
 #pragma mark - NSSecureCoding
@@ -0,0 +1,190 @@
+// AFURLSessionMetrics.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The phases of the life of a task measured by an `AFURLSessionManager`.
+
+ - `AFURLSessionTaskPhaseRequestSerialization`: Building the request with the request serializer. Only measured for tasks created by `AFHTTPSessionManager`.
+ - `AFURLSessionTaskPhaseQueueWait`: Waiting in the queue of the manager before being resumed. Only measured for tasks started with `-scheduleTask:priority:`.
+ - `AFURLSessionTaskPhaseDomainLookup`: Resolving the host name.
+ - `AFURLSessionTaskPhaseConnect`: Establishing the TCP connection, excluding the TLS handshake.
+ - `AFURLSessionTaskPhaseSecureConnection`: Performing the TLS handshake.
+ - `AFURLSessionTaskPhaseTimeToFirstByte`: From sending the request to receiving the first byte of the response.
+ - `AFURLSessionTaskPhaseBodyTransfer`: From receiving the first byte of the response to receiving the last one.
+ - `AFURLSessionTaskPhaseProcessingQueueWait`: Waiting for the processing queue before the response is serialized.
+ - `AFURLSessionTaskPhaseResponseSerialization`: Creating the response object with the response serializer.
+ - `AFURLSessionTaskPhaseCompletionDelivery`: Waiting for the completion queue before the completion handler is called.
+
+ The domain lookup, connect, secure connection, time to first byte and body transfer phases are taken from `NSURLSessionTaskMetrics`, and are therefore only measured on iOS 10, macOS 10.12, watchOS 3 and tvOS 10 or later. The domain lookup and connect phases are not measured when a persistent connection is reused.
+ */
+typedef NS_ENUM(NSUInteger, AFURLSessionTaskPhase) {
+    AFURLSessionTaskPhaseRequestSerialization,
+    AFURLSessionTaskPhaseQueueWait,
+    AFURLSessionTaskPhaseDomainLookup,
+    AFURLSessionTaskPhaseConnect,
+    AFURLSessionTaskPhaseSecureConnection,
+    AFURLSessionTaskPhaseTimeToFirstByte,
+    AFURLSessionTaskPhaseBodyTransfer,
+    AFURLSessionTaskPhaseProcessingQueueWait,
+    AFURLSessionTaskPhaseResponseSerialization,
+    AFURLSessionTaskPhaseCompletionDelivery,
+};
+
+enum {
+    AFURLSessionTaskPhaseCount = AFURLSessionTaskPhaseCompletionDelivery + 1,
+};
+
+/**
+ `AFURLSessionTaskPhaseMetrics` holds the time spent by a single task in each of its phases.
+ */
+@interface AFURLSessionTaskPhaseMetrics : NSObject
+
+/**
+ The host of the original request of the task, or an empty string if it has none.
+ */
+@property (readonly, nonatomic, copy) NSString *host;
+
+/**
+ Initializes the metrics of a task sent to the specified host.
+
+ @param host The host of the request.
+
+ @return The newly-initialized metrics, with no phase measured.
+ */
+- (instancetype)initWithHost:(nullable NSString *)host NS_DESIGNATED_INITIALIZER;
+
+- (instancetype)init NS_UNAVAILABLE;
+
+/**
+ Returns the time, in seconds, spent in the specified phase, or a negative value if the phase was not measured.
+
+ @param phase The phase.
+ */
+- (NSTimeInterval)durationOfPhase:(AFURLSessionTaskPhase)phase;
+
+/**
+ Records the time spent in the specified phase, replacing any earlier measurement. Durations may be recorded from any thread, but must be recorded before the task completes.
+
+ @param duration The time, in seconds, spent in the phase.
+ @param phase The phase.
+ */
+- (void)recordDuration:(NSTimeInterval)duration
+              forPhase:(AFURLSessionTaskPhase)phase;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFLatencyHistogram` is an immutable snapshot of the distribution of the durations recorded for one phase.
+
+ Durations are counted in logarithmic buckets, each power of two of microseconds being divided into 16 linear buckets, so that values are reported within about 3% from 1 microsecond to over an hour.
+ */
+@interface AFLatencyHistogram : NSObject
+
+/**
+ The number of recorded durations.
+ */
+@property (readonly, nonatomic, assign) NSUInteger count;
+
+/**
+ The shortest recorded duration, in seconds, or `0` if none was recorded.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval minimum;
+
+/**
+ The longest recorded duration, in seconds, or `0` if none was recorded.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval maximum;
+
+/**
+ The mean of the recorded durations, in seconds, or `0` if none was recorded.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval mean;
+
+/**
+ Returns the duration, in seconds, below which the specified percentage of the recorded durations fall, or `0` if none was recorded.
+
+ @param percentile The percentage, between `0` and `100`.
+ */
+- (NSTimeInterval)valueAtPercentile:(double)percentile;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFURLSessionMetricsSnapshot` holds the histograms of every phase and host at the time it was taken.
+ */
+@interface AFURLSessionMetricsSnapshot : NSObject
+
+/**
+ The hosts for which durations were recorded.
+ */
+@property (readonly, nonatomic, copy) NSArray <NSString *> *hosts;
+
+/**
+ Returns the histogram of the durations recorded for the specified phase and host.
+
+ @param phase The phase.
+ @param host The host, or `nil` to merge the durations recorded for every host.
+
+ @return The histogram, or `nil` if no duration was recorded for the host.
+ */
+- (nullable AFLatencyHistogram *)histogramForPhase:(AFURLSessionTaskPhase)phase
+                                              host:(nullable NSString *)host;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFURLSessionMetricsRecorder` aggregates the phase metrics of many tasks into a histogram per phase and host.
+
+ Recording only uses atomic operations on the counters of the histograms, and may be performed from any thread without waiting for other threads to record or take snapshots. A lock is only taken the first time a host is seen.
+ */
+@interface AFURLSessionMetricsRecorder : NSObject
+
+/**
+ Adds every measured phase of the specified task metrics to the histograms of its host.
+
+ @param metrics The metrics of a task.
+ */
+- (void)recordPhaseMetrics:(AFURLSessionTaskPhaseMetrics *)metrics;
+
+/**
+ Returns a snapshot of the histograms. Durations recorded while the snapshot is being taken may be only partially included.
+ */
+- (AFURLSessionMetricsSnapshot *)snapshot;
+
+/**
+ Removes every recorded duration.
+ */
+- (void)reset;
+
+@end
+
+NS_ASSUME_NONNULL_END
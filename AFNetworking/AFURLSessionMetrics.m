@@ -0,0 +1,412 @@
+// AFURLSessionMetrics.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "AFURLSessionMetrics.h"
+
+#import <pthread.h>
+#import <stdatomic.h>
+
+// Values are recorded in microseconds. Values below 16 have a bucket each; above, every power of two is split into 16 buckets, up to 2^32 microseconds.
+enum {
+    AFLatencyHistogramSubBucketBits = 4,
+    AFLatencyHistogramSubBucketCount = 1 << AFLatencyHistogramSubBucketBits,
+    AFLatencyHistogramMaximumValueBits = 32,
+    AFLatencyHistogramBucketCount = (AFLatencyHistogramMaximumValueBits - AFLatencyHistogramSubBucketBits + 1) * AFLatencyHistogramSubBucketCount,
+};
+
+typedef struct {
+    _Atomic(uint32_t) counts[AFLatencyHistogramBucketCount];
+    _Atomic(uint64_t) totalValue;
+    _Atomic(uint64_t) minimumValue;
+    _Atomic(uint64_t) maximumValue;
+} AFLatencyHistogramCounters;
+
+static inline uint64_t AFLatencyHistogramValueFromDuration(NSTimeInterval duration) {
+    return (uint64_t)llround(MIN(MAX(duration, 0.0) * USEC_PER_SEC, 1e15));
+}
+
+static inline NSUInteger AFLatencyHistogramBucketIndex(uint64_t value) {
+    if (value >= ((uint64_t)1 << AFLatencyHistogramMaximumValueBits)) {
+        return AFLatencyHistogramBucketCount - 1;
+    }
+
+    if (value < AFLatencyHistogramSubBucketCount) {
+        return (NSUInteger)value;
+    }
+
+    unsigned int exponent = 63 - (unsigned int)__builtin_clzll(value);
+    unsigned int shift = exponent - AFLatencyHistogramSubBucketBits;
+
+    return (exponent - AFLatencyHistogramSubBucketBits + 1) * AFLatencyHistogramSubBucketCount + (NSUInteger)((value >> shift) & (AFLatencyHistogramSubBucketCount - 1));
+}
+
+static inline uint64_t AFLatencyHistogramMedianValueOfBucket(NSUInteger index) {
+    if (index < AFLatencyHistogramSubBucketCount) {
+        return index;
+    }
+
+    unsigned int shift = (unsigned int)(index / AFLatencyHistogramSubBucketCount) - 1;
+    uint64_t lowestValue = (uint64_t)(AFLatencyHistogramSubBucketCount + index % AFLatencyHistogramSubBucketCount) << shift;
+
+    return lowestValue + ((((uint64_t)1) << shift) - 1) / 2;
+}
+
+static void AFLatencyHistogramCountersReset(AFLatencyHistogramCounters *counters) {
+    for (NSUInteger index = 0; index < AFLatencyHistogramBucketCount; index++) {
+        atomic_store_explicit(&counters->counts[index], 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&counters->totalValue, 0, memory_order_relaxed);
+    atomic_store_explicit(&counters->minimumValue, UINT64_MAX, memory_order_relaxed);
+    atomic_store_explicit(&counters->maximumValue, 0, memory_order_relaxed);
+}
+
+static void AFLatencyHistogramCountersRecordValue(AFLatencyHistogramCounters *counters, uint64_t value) {
+    atomic_fetch_add_explicit(&counters->counts[AFLatencyHistogramBucketIndex(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->totalValue, value, memory_order_relaxed);
+
+    uint64_t minimumValue = atomic_load_explicit(&counters->minimumValue, memory_order_relaxed);
+    while (value < minimumValue && !atomic_compare_exchange_weak_explicit(&counters->minimumValue, &minimumValue, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+
+    uint64_t maximumValue = atomic_load_explicit(&counters->maximumValue, memory_order_relaxed);
+    while (value > maximumValue && !atomic_compare_exchange_weak_explicit(&counters->maximumValue, &maximumValue, value, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+#pragma mark -
+
+@implementation AFURLSessionTaskPhaseMetrics {
+    pthread_mutex_t _mutex;
+    NSTimeInterval _durations[AFURLSessionTaskPhaseCount];
+}
+
+- (instancetype)initWithHost:(NSString *)host {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    _host = [host copy] ?: @"";
+    pthread_mutex_init(&_mutex, NULL);
+    for (NSUInteger phase = 0; phase < AFURLSessionTaskPhaseCount; phase++) {
+        _durations[phase] = -1.0;
+    }
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (NSTimeInterval)durationOfPhase:(AFURLSessionTaskPhase)phase {
+    NSParameterAssert(phase < AFURLSessionTaskPhaseCount);
+
+    pthread_mutex_lock(&_mutex);
+    NSTimeInterval duration = _durations[phase];
+    pthread_mutex_unlock(&_mutex);
+
+    return duration;
+}
+
+- (void)recordDuration:(NSTimeInterval)duration
+              forPhase:(AFURLSessionTaskPhase)phase
+{
+    NSParameterAssert(phase < AFURLSessionTaskPhaseCount);
+
+    // Phases are recorded from the session delegate, processing and completion queues.
+    pthread_mutex_lock(&_mutex);
+    _durations[phase] = MAX(duration, 0.0);
+    pthread_mutex_unlock(&_mutex);
+}
+
+- (NSString *)description {
+    NSMutableString *description = [NSMutableString stringWithFormat:@"<%@: %p, host: %@", NSStringFromClass([self class]), self, self.host];
+    for (NSUInteger phase = 0; phase < AFURLSessionTaskPhaseCount; phase++) {
+        NSTimeInterval duration = [self durationOfPhase:phase];
+        if (duration >= 0.0) {
+            [description appendFormat:@", %lu: %.6f", (unsigned long)phase, duration];
+        }
+    }
+    [description appendString:@">"];
+
+    return description;
+}
+
+@end
+
+#pragma mark -
+
+@implementation AFLatencyHistogram {
+    uint64_t _counts[AFLatencyHistogramBucketCount];
+    uint64_t _minimumValue;
+    uint64_t _maximumValue;
+    uint64_t _totalValue;
+}
+
+- (instancetype)initWithCounters:(AFLatencyHistogramCounters *)counters {
+    if (self = [super init]) {
+        uint64_t count = 0;
+        for (NSUInteger index = 0; index < AFLatencyHistogramBucketCount; index++) {
+            _counts[index] = atomic_load_explicit(&counters->counts[index], memory_order_relaxed);
+            count += _counts[index];
+        }
+
+        [self setStatisticsWithCount:count
+                        minimumValue:atomic_load_explicit(&counters->minimumValue, memory_order_relaxed)
+                        maximumValue:atomic_load_explicit(&counters->maximumValue, memory_order_relaxed)
+                          totalValue:atomic_load_explicit(&counters->totalValue, memory_order_relaxed)];
+    }
+
+    return self;
+}
+
+- (instancetype)initByMergingHistograms:(NSArray <AFLatencyHistogram *> *)histograms {
+    if (self = [super init]) {
+        uint64_t count = 0;
+        uint64_t minimumValue = UINT64_MAX;
+        uint64_t maximumValue = 0;
+        uint64_t totalValue = 0;
+
+        for (AFLatencyHistogram *histogram in histograms) {
+            for (NSUInteger index = 0; index < AFLatencyHistogramBucketCount; index++) {
+                _counts[index] += histogram->_counts[index];
+            }
+
+            if (histogram.count > 0) {
+                count += histogram.count;
+                minimumValue = MIN(minimumValue, histogram->_minimumValue);
+                maximumValue = MAX(maximumValue, histogram->_maximumValue);
+                totalValue += histogram->_totalValue;
+            }
+        }
+
+        [self setStatisticsWithCount:count minimumValue:minimumValue maximumValue:maximumValue totalValue:totalValue];
+    }
+
+    return self;
+}
+
+// Counters are read one at a time while other threads may be recording, so the extremes are kept consistent with the counts.
+- (void)setStatisticsWithCount:(uint64_t)count
+                 minimumValue:(uint64_t)minimumValue
+                 maximumValue:(uint64_t)maximumValue
+                   totalValue:(uint64_t)totalValue
+{
+    _count = (NSUInteger)count;
+    if (count == 0) {
+        return;
+    }
+
+    _minimumValue = MIN(minimumValue, maximumValue);
+    _maximumValue = maximumValue;
+    _totalValue = totalValue;
+    _minimum = (NSTimeInterval)_minimumValue / USEC_PER_SEC;
+    _maximum = (NSTimeInterval)_maximumValue / USEC_PER_SEC;
+    _mean = MIN(MAX((NSTimeInterval)totalValue / count / USEC_PER_SEC, _minimum), _maximum);
+}
+
+- (NSTimeInterval)valueAtPercentile:(double)percentile {
+    if (self.count == 0) {
+        return 0.0;
+    }
+
+    uint64_t rank = MAX((uint64_t)ceil(MIN(MAX(percentile, 0.0), 100.0) / 100.0 * self.count), (uint64_t)1);
+    if (rank >= self.count) {
+        return self.maximum;
+    }
+
+    uint64_t cumulativeCount = 0;
+    for (NSUInteger index = 0; index < AFLatencyHistogramBucketCount; index++) {
+        cumulativeCount += _counts[index];
+        if (cumulativeCount >= rank) {
+            uint64_t value = MIN(MAX(AFLatencyHistogramMedianValueOfBucket(index), _minimumValue), _maximumValue);
+            return (NSTimeInterval)value / USEC_PER_SEC;
+        }
+    }
+
+    return self.maximum;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"<%@: %p, count: %lu, minimum: %.6f, p50: %.6f, p99: %.6f, maximum: %.6f>", NSStringFromClass([self class]), self, (unsigned long)self.count, self.minimum, [self valueAtPercentile:50.0], [self valueAtPercentile:99.0], self.maximum];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFURLSessionMetricsSnapshot ()
+@property (readwrite, nonatomic, copy) NSDictionary <NSString *, NSArray <AFLatencyHistogram *> *> *histogramsByHost;
+@end
+
+@implementation AFURLSessionMetricsSnapshot
+
+- (instancetype)initWithHistogramsByHost:(NSDictionary <NSString *, NSArray <AFLatencyHistogram *> *> *)histogramsByHost {
+    if (self = [super init]) {
+        self.histogramsByHost = histogramsByHost;
+    }
+
+    return self;
+}
+
+- (NSArray <NSString *> *)hosts {
+    return [self.histogramsByHost allKeys];
+}
+
+- (AFLatencyHistogram *)histogramForPhase:(AFURLSessionTaskPhase)phase
+                                     host:(NSString *)host
+{
+    NSParameterAssert(phase < AFURLSessionTaskPhaseCount);
+
+    if (host) {
+        return self.histogramsByHost[host][phase];
+    }
+
+    NSMutableArray <AFLatencyHistogram *> *histograms = [NSMutableArray arrayWithCapacity:self.histogramsByHost.count];
+    for (NSArray <AFLatencyHistogram *> *hostHistograms in [self.histogramsByHost allValues]) {
+        [histograms addObject:hostHistograms[phase]];
+    }
+
+    return [[AFLatencyHistogram alloc] initByMergingHistograms:histograms];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFURLSessionMetricsHostHistograms : NSObject
+- (AFLatencyHistogramCounters *)countersForPhase:(AFURLSessionTaskPhase)phase;
+@end
+
+@implementation AFURLSessionMetricsHostHistograms {
+    AFLatencyHistogramCounters *_counters;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    _counters = calloc(AFURLSessionTaskPhaseCount, sizeof(AFLatencyHistogramCounters));
+    [self reset];
+
+    return self;
+}
+
+- (void)dealloc {
+    free(_counters);
+}
+
+- (AFLatencyHistogramCounters *)countersForPhase:(AFURLSessionTaskPhase)phase {
+    return &_counters[phase];
+}
+
+- (void)reset {
+    for (NSUInteger phase = 0; phase < AFURLSessionTaskPhaseCount; phase++) {
+        AFLatencyHistogramCountersReset(&_counters[phase]);
+    }
+}
+
+@end
+
+#pragma mark -
+
+@interface AFURLSessionMetricsRecorder ()
+@property (readwrite, atomic, copy) NSDictionary <NSString *, AFURLSessionMetricsHostHistograms *> *histogramsByHost;
+@end
+
+@implementation AFURLSessionMetricsRecorder {
+    pthread_mutex_t _mutex;
+}
+
+- (instancetype)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+
+    pthread_mutex_init(&_mutex, NULL);
+    self.histogramsByHost = @{};
+
+    return self;
+}
+
+- (void)dealloc {
+    pthread_mutex_destroy(&_mutex);
+}
+
+- (AFURLSessionMetricsHostHistograms *)histogramsForHost:(NSString *)host {
+    AFURLSessionMetricsHostHistograms *histograms = self.histogramsByHost[host];
+    if (histograms) {
+        return histograms;
+    }
+
+    pthread_mutex_lock(&_mutex);
+    histograms = self.histogramsByHost[host];
+    if (!histograms) {
+        histograms = [[AFURLSessionMetricsHostHistograms alloc] init];
+
+        NSMutableDictionary *mutableHistogramsByHost = [self.histogramsByHost mutableCopy];
+        mutableHistogramsByHost[host] = histograms;
+        self.histogramsByHost = mutableHistogramsByHost;
+    }
+    pthread_mutex_unlock(&_mutex);
+
+    return histograms;
+}
+
+- (void)recordPhaseMetrics:(AFURLSessionTaskPhaseMetrics *)metrics {
+    NSParameterAssert(metrics);
+
+    AFURLSessionMetricsHostHistograms *histograms = [self histogramsForHost:metrics.host];
+    for (NSUInteger phase = 0; phase < AFURLSessionTaskPhaseCount; phase++) {
+        NSTimeInterval duration = [metrics durationOfPhase:phase];
+        if (duration >= 0.0) {
+            AFLatencyHistogramCountersRecordValue([histograms countersForPhase:phase], AFLatencyHistogramValueFromDuration(duration));
+        }
+    }
+}
+
+- (AFURLSessionMetricsSnapshot *)snapshot {
+    NSDictionary <NSString *, AFURLSessionMetricsHostHistograms *> *histogramsByHost = self.histogramsByHost;
+
+    NSMutableDictionary <NSString *, NSArray <AFLatencyHistogram *> *> *snapshotHistogramsByHost = [NSMutableDictionary dictionaryWithCapacity:histogramsByHost.count];
+    [histogramsByHost enumerateKeysAndObjectsUsingBlock:^(NSString *host, AFURLSessionMetricsHostHistograms *histograms, __unused BOOL *stop) {
+        NSMutableArray <AFLatencyHistogram *> *phaseHistograms = [NSMutableArray arrayWithCapacity:AFURLSessionTaskPhaseCount];
+        for (NSUInteger phase = 0; phase < AFURLSessionTaskPhaseCount; phase++) {
+            [phaseHistograms addObject:[[AFLatencyHistogram alloc] initWithCounters:[histograms countersForPhase:phase]]];
+        }
+        snapshotHistogramsByHost[host] = phaseHistograms;
+    }];
+
+    return [[AFURLSessionMetricsSnapshot alloc] initWithHistogramsByHost:snapshotHistogramsByHost];
+}
+
+- (void)reset {
+    for (AFURLSessionMetricsHostHistograms *histograms in [self.histogramsByHost allValues]) {
+        [histograms reset];
+    }
+}
+
+@end
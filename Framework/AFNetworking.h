@@ -35,6 +35,7 @@ FOUNDATION_EXPORT const unsigned char AFNetworkingVersionString[];
 #ifndef _AFNETWORKING_
 #define _AFNETWORKING_
 
+#import <AFNetworking/AFTracing.h>
 #import <AFNetworking/AFURLRequestSerialization.h>
 #import <AFNetworking/AFURLResponseSerialization.h>
 #import <AFNetworking/AFSecurityPolicy.h>
@@ -43,7 +44,13 @@ FOUNDATION_EXPORT const unsigned char AFNetworkingVersionString[];
 #import <AFNetworking/AFNetworkReachabilityManager.h>
 #endif
 
+#import <AFNetworking/AFURLSessionMetrics.h>
 #import <AFNetworking/AFURLSessionManager.h>
+#import <AFNetworking/AFHTTPRetryPolicy.h>
+#import <AFNetworking/AFHTTPResponseCache.h>
+#import <AFNetworking/AFEventStreamTask.h>
+#import <AFNetworking/AFSegmentedDownloadTask.h>
+#import <AFNetworking/AFChunkedUploadTask.h>
 #import <AFNetworking/AFHTTPSessionManager.h>
 
 #if TARGET_OS_IOS || TARGET_OS_TV
@@ -21,6 +21,7 @@
 
 #import <XCTest/XCTest.h>
 #import "AFAutoPurgingImageCache.h"
+#import "AFDiskImageCache.h"
 
 @interface AFAutoPurgingImageCacheTests : XCTestCase
 @property (nonatomic, strong) AFAutoPurgingImageCache *cache;
@@ -181,6 +182,31 @@
     XCTAssertTrue(currentUsage > self.cache.memoryUsage);
 }
 
+#pragma mark - Disk Cache
+
+- (void)testImageIsRestoredFromDiskCacheAfterMemoryWarning {
+    NSURL *directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString] isDirectory:YES];
+    AFDiskImageCache *diskCache = [[AFDiskImageCache alloc] initWithDirectoryURL:directoryURL diskCapacity:100 * 1024 * 1024 preferredDiskCapacity:60 * 1024 * 1024];
+    self.cache.diskCache = diskCache;
+
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"diskUsage > 0"] evaluatedWithObject:diskCache handler:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:UIApplicationDidReceiveMemoryWarningNotification object:nil];
+    XCTAssertTrue(self.cache.memoryUsage == 0);
+
+    UIImage *cachedImage = [self.cache imageWithIdentifier:identifier];
+    XCTAssertNotNil(cachedImage, @"Image should be restored from the disk cache");
+    XCTAssertTrue(self.cache.memoryUsage > 0, @"Image should be promoted back into memory");
+
+    XCTAssertTrue([self.cache removeImageWithIdentifier:identifier]);
+    XCTAssertNil([diskCache imageWithIdentifier:identifier], @"Removing an image should also remove it from the disk cache");
+
+    [[NSFileManager defaultManager] removeItemAtURL:directoryURL error:nil];
+}
+
 #pragma mark - Purging
 - (void)testThatImagesArePurgedWhenCapcityIsReached {
     UInt64 imageSize = 1020000;
@@ -230,4 +256,73 @@
     }
 }
 
+#pragma mark - Admission
+
+- (void)testThatFrequentlyAccessedImagesSurviveAScanWithFrequencyBasedAdmission {
+    UInt64 imageSize = 1020000;
+    UInt64 numberOfImages = 10;
+    UInt64 numberOfImagesAfterPurge = 6;
+    self.cache = [[AFAutoPurgingImageCache alloc] initWithMemoryCapacity:numberOfImages * imageSize preferredMemoryCapacity:numberOfImagesAfterPurge * imageSize];
+    self.cache.usesFrequencyBasedAdmission = YES;
+
+    for (NSUInteger index = 0; index < 4; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"hot-%ld", (long)index];
+        [self.cache addImage:self.testImage withIdentifier:identifier];
+        for (NSUInteger access = 0; access < 5; access++) {
+            XCTAssertNotNil([self.cache imageWithIdentifier:identifier]);
+        }
+    }
+
+    for (NSUInteger index = 0; index < 20; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"scan-%ld", (long)index];
+        XCTAssertNil([self.cache imageWithIdentifier:identifier]);
+        [self.cache addImage:self.testImage withIdentifier:identifier];
+    }
+
+    XCTAssertTrue(self.cache.memoryUsage <= numberOfImages * imageSize);
+    for (NSUInteger index = 0; index < 4; index++) {
+        NSString *identifier = [NSString stringWithFormat:@"hot-%ld", (long)index];
+        XCTAssertNotNil([self.cache imageWithIdentifier:identifier], @"Image for %@ should be cached", identifier);
+    }
+}
+
+- (double)hitRatioReplayingTrace:(NSArray <NSString *> *)trace inCache:(AFAutoPurgingImageCache *)cache {
+    NSUInteger hits = 0;
+    for (NSString *identifier in trace) {
+        if ([cache imageWithIdentifier:identifier] != nil) {
+            hits++;
+        } else {
+            [cache addImage:self.testImage withIdentifier:identifier];
+        }
+    }
+    return (double)hits / (double)trace.count;
+}
+
+- (void)testFrequencyBasedAdmissionHitRatioOnTraceWithScans {
+    // A skewed working set of 40 images, interrupted by scrolls through lists of images that are only seen once.
+    NSUInteger numberOfHotImages = 40;
+    NSMutableArray <NSString *> *trace = [NSMutableArray array];
+    srand48(27);
+    NSUInteger scanIndex = 0;
+    for (NSUInteger round = 0; round < 20; round++) {
+        for (NSUInteger request = 0; request < 200; request++) {
+            NSUInteger rank = (NSUInteger)((double)numberOfHotImages * pow(drand48(), 3.0));
+            [trace addObject:[NSString stringWithFormat:@"https://cdn.example.com/images/hot/%ld.jpg", (long)rank]];
+        }
+        for (NSUInteger request = 0; request < 150; request++) {
+            [trace addObject:[NSString stringWithFormat:@"https://cdn.example.com/images/scan/%ld.jpg", (long)scanIndex++]];
+        }
+    }
+
+    UInt64 imageSize = 1020000;
+    AFAutoPurgingImageCache *lruCache = [[AFAutoPurgingImageCache alloc] initWithMemoryCapacity:80 * imageSize preferredMemoryCapacity:50 * imageSize];
+    AFAutoPurgingImageCache *admissionCache = [[AFAutoPurgingImageCache alloc] initWithMemoryCapacity:80 * imageSize preferredMemoryCapacity:50 * imageSize];
+    admissionCache.usesFrequencyBasedAdmission = YES;
+
+    double lruHitRatio = [self hitRatioReplayingTrace:trace inCache:lruCache];
+    double admissionHitRatio = [self hitRatioReplayingTrace:trace inCache:admissionCache];
+
+    XCTAssertGreaterThan(admissionHitRatio, lruHitRatio);
+}
+
 @end
@@ -0,0 +1,238 @@
+// AFChunkedUploadTaskTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "AFTestCase.h"
+#import "AFChunkedUploadTask.h"
+#import "AFHTTPRetryPolicy.h"
+#import "AFURLSessionManager.h"
+
+static NSMutableDictionary <NSString *, NSData *> *AFChunkedUploadTestParts = nil;
+static NSMutableArray <NSString *> *AFChunkedUploadTestRequests = nil;
+static NSMutableSet <NSString *> *AFChunkedUploadTestFailingRequests = nil;
+static NSData *AFChunkedUploadTestUploadedData = nil;
+
+static NSData * AFChunkedUploadTestBody(NSURLRequest *request) {
+    if (request.HTTPBody || !request.HTTPBodyStream) {
+        return request.HTTPBody ?: [NSData data];
+    }
+
+    NSMutableData *body = [NSMutableData data];
+    uint8_t buffer[4096];
+    NSInputStream *stream = request.HTTPBodyStream;
+    [stream open];
+    NSInteger length = 0;
+    while ((length = [stream read:buffer maxLength:sizeof(buffer)]) > 0) {
+        [body appendBytes:buffer length:(NSUInteger)length];
+    }
+    [stream close];
+
+    return body;
+}
+
+// Stands in for an S3 multipart upload server at `s3.test`, and a tus server with the concatenation extension at `tus.test`. Requests listed in the failing requests fail once with a 503 response.
+@interface AFChunkedUploadTestURLProtocol : NSURLProtocol
+@end
+
+@implementation AFChunkedUploadTestURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [request.URL.host isEqualToString:@"s3.test"] || [request.URL.host isEqualToString:@"tus.test"];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    NSURLRequest *request = self.request;
+    NSString *description = [NSString stringWithFormat:@"%@ %@%@", request.HTTPMethod, request.URL.path, request.URL.query ? [@"?" stringByAppendingString:request.URL.query] : @""];
+    if ([request.URL.host isEqualToString:@"tus.test"]) {
+        description = [NSString stringWithFormat:@"%@ %@", request.HTTPMethod, [request valueForHTTPHeaderField:@"Upload-Concat"]];
+    }
+
+    NSInteger statusCode = 200;
+    NSMutableDictionary *headerFields = [NSMutableDictionary dictionary];
+    NSData *body = [NSData data];
+
+    @synchronized (AFChunkedUploadTestParts) {
+        [AFChunkedUploadTestRequests addObject:description];
+
+        if ([AFChunkedUploadTestFailingRequests containsObject:description]) {
+            [AFChunkedUploadTestFailingRequests removeObject:description];
+            statusCode = 503;
+        } else if ([description hasSuffix:@"?uploads"]) {
+            headerFields[@"Content-Type"] = @"application/xml";
+            body = [@"<InitiateMultipartUploadResult><UploadId>upload-1</UploadId></InitiateMultipartUploadResult>" dataUsingEncoding:NSUTF8StringEncoding];
+        } else if ([request.HTTPMethod isEqualToString:@"PUT"]) {
+            NSString *partNumber = [[request.URL.query componentsSeparatedByString:@"&"].firstObject substringFromIndex:[@"partNumber=" length]];
+            AFChunkedUploadTestParts[partNumber] = AFChunkedUploadTestBody(request);
+            headerFields[@"ETag"] = [NSString stringWithFormat:@"\"etag-%@\"", partNumber];
+        } else if ([description hasPrefix:@"POST partial"]) {
+            NSString *partNumber = [@(AFChunkedUploadTestParts.count + 1) stringValue];
+            AFChunkedUploadTestParts[partNumber] = AFChunkedUploadTestBody(request);
+            headerFields[@"Location"] = [@"/files/" stringByAppendingString:partNumber];
+            statusCode = 201;
+        } else {
+            NSString *completion = [request.URL.host isEqualToString:@"tus.test"] ? [request valueForHTTPHeaderField:@"Upload-Concat"] : [[NSString alloc] initWithData:AFChunkedUploadTestBody(request) encoding:NSUTF8StringEncoding];
+            NSMutableData *uploadedData = [NSMutableData data];
+            for (NSUInteger partNumber = 1; partNumber <= AFChunkedUploadTestParts.count; partNumber++) {
+                NSString *reference = [request.URL.host isEqualToString:@"tus.test"] ? [NSString stringWithFormat:@"http://tus.test/files/%lu", (unsigned long)partNumber] : [NSString stringWithFormat:@"<PartNumber>%lu</PartNumber><ETag>\"etag-%lu\"</ETag>", (unsigned long)partNumber, (unsigned long)partNumber];
+                if ([completion rangeOfString:reference].location != NSNotFound) {
+                    [uploadedData appendData:AFChunkedUploadTestParts[[@(partNumber) stringValue]]];
+                }
+            }
+            AFChunkedUploadTestUploadedData = uploadedData;
+            statusCode = [request.URL.host isEqualToString:@"tus.test"] ? 201 : 200;
+        }
+    }
+
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:request.URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    if (body.length > 0) {
+        [self.client URLProtocol:self didLoadData:body];
+    }
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+}
+
+@end
+
+#pragma mark -
+
+@interface AFChunkedUploadTaskTests : AFTestCase
+@property (nonatomic, strong) AFURLSessionManager *manager;
+@property (nonatomic, strong) NSURL *fileURL;
+@property (nonatomic, strong) NSData *fileData;
+@property (nonatomic, strong) id <AFChunkedUploadAdapter> adapter;
+@end
+
+@implementation AFChunkedUploadTaskTests
+
+- (void)setUp {
+    [super setUp];
+
+    AFChunkedUploadTestParts = [NSMutableDictionary dictionary];
+    AFChunkedUploadTestRequests = [NSMutableArray array];
+    AFChunkedUploadTestFailingRequests = [NSMutableSet set];
+    AFChunkedUploadTestUploadedData = nil;
+
+    NSMutableData *fileData = [NSMutableData dataWithLength:10000];
+    uint8_t *bytes = (uint8_t *)fileData.mutableBytes;
+    for (NSUInteger index = 0; index < fileData.length; index++) {
+        bytes[index] = (uint8_t)(index % 251);
+    }
+    self.fileData = fileData;
+    self.fileURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [self.fileData writeToURL:self.fileURL atomically:YES];
+
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[AFChunkedUploadTestURLProtocol class]];
+    self.manager = [[AFURLSessionManager alloc] initWithSessionConfiguration:configuration];
+    self.adapter = [[AFS3MultipartUploadAdapter alloc] initWithRequest:[NSURLRequest requestWithURL:[NSURL URLWithString:@"http://s3.test/bucket/file"]]];
+}
+
+- (void)tearDown {
+    [self.manager invalidateSessionCancelingTasks:YES];
+    self.manager = nil;
+
+    [[NSFileManager defaultManager] removeItemAtURL:self.fileURL error:nil];
+    [[NSFileManager defaultManager] removeItemAtURL:[self.fileURL URLByAppendingPathExtension:@"journal"] error:nil];
+
+    [super tearDown];
+}
+
+- (AFChunkedUploadTask *)uploadTask {
+    AFChunkedUploadTask *task = [[AFChunkedUploadTask alloc] initWithSessionManager:self.manager fileURL:self.fileURL adapter:self.adapter];
+    task.partLength = 3000;
+    task.retryPolicy.baseDelay = 0.01;
+    task.journalURL = [self.fileURL URLByAppendingPathExtension:@"journal"];
+
+    return task;
+}
+
+- (void)uploadWithTask:(AFChunkedUploadTask *)task {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Upload completes"];
+    [task resumeWithCompletionHandler:^(NSURLResponse *response, __unused NSData *responseData, NSError *error) {
+        XCTAssertNil(error);
+        XCTAssertNotNil(response);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testFileIsUploadedInParts {
+    AFChunkedUploadTask *task = [self uploadTask];
+
+    [self uploadWithTask:task];
+
+    XCTAssertEqualObjects(AFChunkedUploadTestUploadedData, self.fileData);
+    XCTAssertEqual(task.progress.completedUnitCount, 10000);
+    XCTAssertEqualObjects(AFChunkedUploadTestRequests.firstObject, @"POST /bucket/file?uploads");
+    XCTAssertEqualObjects(AFChunkedUploadTestRequests.lastObject, @"POST /bucket/file?uploadId=upload-1");
+    XCTAssertEqual(AFChunkedUploadTestRequests.count, 6u);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:task.journalURL.path]);
+}
+
+- (void)testFailedPartIsRetriedOnItsOwn {
+    [AFChunkedUploadTestFailingRequests addObject:@"PUT /bucket/file?partNumber=2&uploadId=upload-1"];
+    AFChunkedUploadTask *task = [self uploadTask];
+
+    [self uploadWithTask:task];
+
+    XCTAssertEqualObjects(AFChunkedUploadTestUploadedData, self.fileData);
+    NSCountedSet <NSString *> *requests = [[NSCountedSet alloc] initWithArray:AFChunkedUploadTestRequests];
+    XCTAssertEqual([requests countForObject:@"PUT /bucket/file?partNumber=1&uploadId=upload-1"], 1u);
+    XCTAssertEqual([requests countForObject:@"PUT /bucket/file?partNumber=2&uploadId=upload-1"], 2u);
+}
+
+- (void)testUploadResumesFromJournal {
+    AFChunkedUploadTestParts[@"1"] = [self.fileData subdataWithRange:NSMakeRange(0, 3000)];
+    AFChunkedUploadTestParts[@"2"] = [self.fileData subdataWithRange:NSMakeRange(3000, 3000)];
+
+    AFChunkedUploadTask *task = [self uploadTask];
+    NSDate *modificationDate = [[[NSFileManager defaultManager] attributesOfItemAtPath:self.fileURL.path error:nil] fileModificationDate];
+    NSDictionary *journal = @{@"filePath": self.fileURL.path, @"fileSize": @10000, @"modificationDate": @([modificationDate timeIntervalSinceReferenceDate]), @"partLength": @3000, @"uploadIdentifier": @"upload-1", @"tags": @[@"\"etag-1\"", @"\"etag-2\"", @"", @""]};
+    [journal writeToURL:task.journalURL atomically:YES];
+
+    [self uploadWithTask:task];
+
+    XCTAssertEqualObjects(AFChunkedUploadTestUploadedData, self.fileData);
+    NSSet <NSString *> *expectedRequests = [NSSet setWithArray:@[@"PUT /bucket/file?partNumber=3&uploadId=upload-1", @"PUT /bucket/file?partNumber=4&uploadId=upload-1", @"POST /bucket/file?uploadId=upload-1"]];
+    XCTAssertEqualObjects([NSSet setWithArray:AFChunkedUploadTestRequests], expectedRequests);
+}
+
+- (void)testPartsAreConcatenatedWithTus {
+    self.adapter = [[AFTusUploadAdapter alloc] initWithRequest:[NSURLRequest requestWithURL:[NSURL URLWithString:@"http://tus.test/files"]]];
+    AFChunkedUploadTask *task = [self uploadTask];
+    task.maximumConcurrentPartCount = 1;
+
+    [self uploadWithTask:task];
+
+    XCTAssertEqualObjects(AFChunkedUploadTestUploadedData, self.fileData);
+    XCTAssertEqual(AFChunkedUploadTestRequests.count, 5u);
+    XCTAssertEqualObjects(AFChunkedUploadTestRequests.lastObject, @"POST final;http://tus.test/files/1 http://tus.test/files/2 http://tus.test/files/3 http://tus.test/files/4");
+}
+
+@end
@@ -0,0 +1,181 @@
+// AFDiskImageCacheTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <XCTest/XCTest.h>
+#import "AFDiskImageCache.h"
+
+@interface AFDiskImageCacheTests : XCTestCase
+@property (nonatomic, strong) NSURL *directoryURL;
+@property (nonatomic, strong) AFDiskImageCache *cache;
+@property (nonatomic, strong) UIImage *testImage;
+@end
+
+@implementation AFDiskImageCacheTests
+
+- (void)setUp {
+    [super setUp];
+    self.directoryURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString] isDirectory:YES];
+    self.cache = [[AFDiskImageCache alloc] initWithDirectoryURL:self.directoryURL
+                                                   diskCapacity:100 * 1024 * 1024
+                                          preferredDiskCapacity:60 * 1024 * 1024];
+
+    NSString *path = [[NSBundle bundleForClass:[self class]] pathForResource:@"logo" ofType:@"png"];
+    self.testImage = [UIImage imageWithContentsOfFile:path];
+}
+
+- (void)tearDown {
+    [self.cache removeAllImages];
+    self.cache = nil;
+    self.testImage = nil;
+    [[NSFileManager defaultManager] removeItemAtURL:self.directoryURL error:nil];
+    [super tearDown];
+}
+
+- (void)waitForDiskUsageOfCache:(AFDiskImageCache *)cache toReach:(UInt64)diskUsage {
+    NSPredicate *predicate = [NSPredicate predicateWithFormat:@"diskUsage >= %llu", diskUsage];
+    [self expectationForPredicate:predicate evaluatedWithObject:cache handler:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+}
+
+#pragma mark - Cache Return Images
+
+- (void)testImageIsReturnedFromCacheForIdentifier {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+
+    UIImage *cachedImage = [self.cache imageWithIdentifier:identifier];
+    XCTAssertNotNil(cachedImage, @"Cached image should not be nil");
+}
+
+- (void)testImageIsReturnedFromCacheForURLRequestWithAdditionalIdentifier {
+    NSURLRequest *request = [[NSURLRequest alloc] initWithURL:[NSURL URLWithString:@"http://test.com/image"]];
+    [self.cache addImage:self.testImage forRequest:request withAdditionalIdentifier:@"filter"];
+
+    XCTAssertNotNil([self.cache imageforRequest:request withAdditionalIdentifier:@"filter"]);
+    XCTAssertNil([self.cache imageforRequest:request withAdditionalIdentifier:nil]);
+}
+
+- (void)testImageIsMappedFromDiskWithOriginalDimensions {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    [self waitForDiskUsageOfCache:self.cache toReach:1];
+
+    UIImage *cachedImage = [self.cache imageWithIdentifier:identifier];
+    XCTAssertNotEqual(cachedImage, self.testImage, @"Cached image should be read back from disk");
+    XCTAssertEqual(CGImageGetWidth(cachedImage.CGImage), CGImageGetWidth(self.testImage.CGImage));
+    XCTAssertEqual(CGImageGetHeight(cachedImage.CGImage), CGImageGetHeight(self.testImage.CGImage));
+    XCTAssertEqual(cachedImage.scale, self.testImage.scale);
+}
+
+- (void)testImageIsReturnedAfterCacheIsReopened {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    [self waitForDiskUsageOfCache:self.cache toReach:1];
+    UInt64 diskUsage = self.cache.diskUsage;
+
+    AFDiskImageCache *reopenedCache = [[AFDiskImageCache alloc] initWithDirectoryURL:self.directoryURL
+                                                                        diskCapacity:100 * 1024 * 1024
+                                                               preferredDiskCapacity:60 * 1024 * 1024];
+    XCTAssertEqual(reopenedCache.diskUsage, diskUsage);
+    XCTAssertNotNil([reopenedCache imageWithIdentifier:identifier], @"Cached image should survive reopening the cache");
+}
+
+#pragma mark - Remove Image Tests
+
+- (void)testImageIsRemovedWithIdentifier {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    [self waitForDiskUsageOfCache:self.cache toReach:1];
+
+    XCTAssertTrue([self.cache removeImageWithIdentifier:identifier], @"image should be reported as removed");
+    XCTAssertFalse([self.cache removeImageWithIdentifier:identifier], @"image should not be reported as removed the second time");
+    XCTAssertNil([self.cache imageWithIdentifier:identifier], @"cached image should be nil");
+    XCTAssertTrue(self.cache.diskUsage == 0);
+}
+
+- (void)testPendingImageIsNotWrittenOnceRemoved {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    XCTAssertTrue([self.cache removeAllImages]);
+
+    AFDiskImageCache *reopenedCache = [[AFDiskImageCache alloc] initWithDirectoryURL:self.directoryURL
+                                                                        diskCapacity:100 * 1024 * 1024
+                                                               preferredDiskCapacity:60 * 1024 * 1024];
+    XCTAssertNil([reopenedCache imageWithIdentifier:identifier]);
+}
+
+#pragma mark - Crash Recovery
+
+- (void)testThatCorruptIndexIsDiscardedWhenCacheIsOpened {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    [self waitForDiskUsageOfCache:self.cache toReach:1];
+
+    NSURL *indexURL = [self.directoryURL URLByAppendingPathComponent:@"index"];
+    NSFileHandle *fileHandle = [NSFileHandle fileHandleForWritingToURL:indexURL error:nil];
+    [fileHandle seekToFileOffset:16];
+    [fileHandle writeData:[NSMutableData dataWithLength:8]];
+    [fileHandle closeFile];
+
+    AFDiskImageCache *reopenedCache = [[AFDiskImageCache alloc] initWithDirectoryURL:self.directoryURL
+                                                                        diskCapacity:100 * 1024 * 1024
+                                                               preferredDiskCapacity:60 * 1024 * 1024];
+    XCTAssertNil([reopenedCache imageWithIdentifier:identifier], @"Entry with a bad checksum should be discarded");
+    XCTAssertTrue(reopenedCache.diskUsage == 0);
+
+    [reopenedCache addImage:self.testImage withIdentifier:identifier];
+    [self waitForDiskUsageOfCache:reopenedCache toReach:1];
+    XCTAssertNotNil([reopenedCache imageWithIdentifier:identifier]);
+}
+
+- (void)testThatMissingDataFileIsTreatedAsMiss {
+    NSString *identifier = @"logo";
+    [self.cache addImage:self.testImage withIdentifier:identifier];
+    [self waitForDiskUsageOfCache:self.cache toReach:1];
+
+    NSURL *dataDirectoryURL = [self.directoryURL URLByAppendingPathComponent:@"data"];
+    for (NSURL *fileURL in [[NSFileManager defaultManager] contentsOfDirectoryAtURL:dataDirectoryURL includingPropertiesForKeys:nil options:0 error:nil]) {
+        [[NSFileManager defaultManager] removeItemAtURL:fileURL error:nil];
+    }
+
+    XCTAssertNil([self.cache imageWithIdentifier:identifier]);
+}
+
+#pragma mark - Purging
+
+- (void)testThatImagesArePurgedWhenCapacityIsReached {
+    [self.cache addImage:self.testImage withIdentifier:@"image-0"];
+    [self waitForDiskUsageOfCache:self.cache toReach:1];
+    UInt64 imageSize = self.cache.diskUsage;
+
+    self.cache.diskCapacity = 3 * imageSize;
+    self.cache.preferredDiskUsageAfterPurge = 2 * imageSize;
+    for (NSUInteger index = 1; index < 4; index++) {
+        [self.cache addImage:self.testImage withIdentifier:[NSString stringWithFormat:@"image-%lu", (unsigned long)index]];
+    }
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"diskUsage == %llu", 2 * imageSize] evaluatedWithObject:self.cache handler:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertNil([self.cache imageWithIdentifier:@"image-0"], @"Least recently used image should be purged");
+    XCTAssertNotNil([self.cache imageWithIdentifier:@"image-3"]);
+}
+
+@end
@@ -0,0 +1,215 @@
+// AFEventStreamTaskTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "AFTestCase.h"
+#import "AFEventStreamTask.h"
+#import "AFURLSessionManager.h"
+
+static NSMutableArray <NSURLRequest *> *AFEventStreamTestRequests = nil;
+static NSMutableArray <NSArray *> *AFEventStreamTestResponses = nil;
+
+// Stands in for an event stream server, answering each request with the next status code and body.
+@interface AFEventStreamTestURLProtocol : NSURLProtocol
+@end
+
+@implementation AFEventStreamTestURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [request.URL.host isEqualToString:@"events.test"];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    NSArray *response = nil;
+    @synchronized (AFEventStreamTestResponses) {
+        [AFEventStreamTestRequests addObject:self.request];
+        response = AFEventStreamTestResponses.firstObject ?: @[@204, @""];
+        if (AFEventStreamTestResponses.count > 0) {
+            [AFEventStreamTestResponses removeObjectAtIndex:0];
+        }
+    }
+
+    NSHTTPURLResponse *HTTPResponse = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:[response[0] integerValue] HTTPVersion:@"HTTP/1.1" headerFields:@{@"Content-Type": @"text/event-stream"}];
+    [self.client URLProtocol:self didReceiveResponse:HTTPResponse cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocol:self didLoadData:[response[1] dataUsingEncoding:NSUTF8StringEncoding]];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+}
+
+@end
+
+#pragma mark -
+
+@interface AFEventStreamTaskTests : AFTestCase
+@property (nonatomic, strong) AFURLSessionManager *manager;
+@end
+
+@implementation AFEventStreamTaskTests
+
+- (void)setUp {
+    [super setUp];
+
+    AFEventStreamTestRequests = [NSMutableArray array];
+    AFEventStreamTestResponses = [NSMutableArray array];
+
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[AFEventStreamTestURLProtocol class]];
+    self.manager = [[AFURLSessionManager alloc] initWithSessionConfiguration:configuration];
+}
+
+- (void)tearDown {
+    [self.manager invalidateSessionCancelingTasks:YES];
+    self.manager = nil;
+
+    [super tearDown];
+}
+
+- (NSArray <AFEventStreamEvent *> *)eventsByParsingChunks:(NSArray <NSString *> *)chunks
+                                                   format:(AFEventStreamFormat)format
+{
+    AFEventStreamParser *parser = [[AFEventStreamParser alloc] initWithFormat:format];
+    NSMutableArray <AFEventStreamEvent *> *events = [NSMutableArray array];
+    void (^block)(AFEventStreamEvent *) = ^(AFEventStreamEvent *event) {
+        [events addObject:event];
+    };
+
+    for (NSString *chunk in chunks) {
+        [parser parseData:[chunk dataUsingEncoding:NSUTF8StringEncoding] usingBlock:block];
+    }
+    [parser finishUsingBlock:block];
+
+    return events;
+}
+
+#pragma mark - Server-Sent Events
+
+- (void)testEventsAreParsedFromFields {
+    NSArray <AFEventStreamEvent *> *events = [self eventsByParsingChunks:@[@": comment\nevent: update\nid: 42\ndata: first\ndata:second\n\ndata: third\n\n"] format:AFEventStreamFormatServerSentEvents];
+
+    XCTAssertEqual(events.count, 2u);
+    XCTAssertEqualObjects(events[0].type, @"update");
+    XCTAssertEqualObjects(events[0].identifier, @"42");
+    XCTAssertEqualObjects([events[0] dataString], @"first\nsecond");
+    XCTAssertEqualObjects(events[1].type, @"message");
+    XCTAssertEqualObjects(events[1].identifier, @"42");
+    XCTAssertEqualObjects([events[1] dataString], @"third");
+}
+
+- (void)testEventsAreParsedAcrossChunksAndLineBreaks {
+    NSArray <AFEventStreamEvent *> *events = [self eventsByParsingChunks:@[@"\uFEFFda", @"ta: a\r", @"\ndata: b\r\r", @"data: c\n", @"\n"] format:AFEventStreamFormatServerSentEvents];
+
+    XCTAssertEqual(events.count, 2u);
+    XCTAssertEqualObjects([events[0] dataString], @"a\nb");
+    XCTAssertEqualObjects([events[1] dataString], @"c");
+}
+
+- (void)testIncompleteEventIsDiscardedAtEndOfStream {
+    NSArray <AFEventStreamEvent *> *events = [self eventsByParsingChunks:@[@"data: complete\n\ndata: incomplete\n"] format:AFEventStreamFormatServerSentEvents];
+
+    XCTAssertEqual(events.count, 1u);
+    XCTAssertEqualObjects([events[0] dataString], @"complete");
+}
+
+- (void)testRetryFieldSetsReconnectionInterval {
+    AFEventStreamParser *parser = [[AFEventStreamParser alloc] initWithFormat:AFEventStreamFormatServerSentEvents];
+    XCTAssertLessThan(parser.reconnectionInterval, 0.0);
+
+    [parser parseData:[@"retry: 1500\nretry: soon\n" dataUsingEncoding:NSUTF8StringEncoding] usingBlock:^(AFEventStreamEvent *event) {}];
+    XCTAssertEqualWithAccuracy(parser.reconnectionInterval, 1.5, 0.0001);
+}
+
+#pragma mark - NDJSON
+
+- (void)testNDJSONLinesAreParsedAsJSONObjects {
+    NSArray <AFEventStreamEvent *> *events = [self eventsByParsingChunks:@[@"{\"a\":1}\n{\"b\"", @":2}\r\n\nnot json\n[3]"] format:AFEventStreamFormatNDJSON];
+
+    XCTAssertEqual(events.count, 4u);
+    XCTAssertEqualObjects(events[0].JSONObject, @{@"a": @1});
+    XCTAssertEqualObjects(events[1].JSONObject, @{@"b": @2});
+    XCTAssertNil(events[2].JSONObject);
+    XCTAssertEqualObjects([events[2] dataString], @"not json");
+    XCTAssertEqualObjects(events[3].JSONObject, @[@3]);
+}
+
+#pragma mark - Reconnection
+
+- (void)testStreamReconnectsWithLastEventIdentifier {
+    [AFEventStreamTestResponses addObject:@[@200, @"retry: 10\nid: 7\ndata: hello\n\n"]];
+    [AFEventStreamTestResponses addObject:@[@200, @"data: again\n\n"]];
+
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://events.test/stream"]];
+    AFEventStreamTask *task = [[AFEventStreamTask alloc] initWithSessionManager:self.manager request:request format:AFEventStreamFormatServerSentEvents];
+
+    NSMutableArray <NSString *> *data = [NSMutableArray array];
+    [task setEventBlock:^(AFEventStreamEvent *event) {
+        [data addObject:[event dataString]];
+    }];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Stream should close"];
+    [task setDidCloseBlock:^(NSError *error) {
+        XCTAssertNil(error);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertEqualObjects(data, (@[@"hello", @"again"]));
+    XCTAssertEqual(AFEventStreamTestRequests.count, 3u);
+    XCTAssertEqualObjects([AFEventStreamTestRequests[0] valueForHTTPHeaderField:@"Accept"], @"text/event-stream");
+    XCTAssertNil([AFEventStreamTestRequests[0] valueForHTTPHeaderField:@"Last-Event-ID"]);
+    XCTAssertEqualObjects([AFEventStreamTestRequests[1] valueForHTTPHeaderField:@"Last-Event-ID"], @"7");
+    XCTAssertEqualObjects(task.lastEventIdentifier, @"7");
+}
+
+- (void)testCancelledStreamIsNotReconnected {
+    [AFEventStreamTestResponses addObject:@[@200, @"retry: 60000\ndata: hello\n\n"]];
+
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://events.test/stream"]];
+    AFEventStreamTask *task = [[AFEventStreamTask alloc] initWithSessionManager:self.manager request:request format:AFEventStreamFormatServerSentEvents];
+
+    XCTestExpectation *eventExpectation = [self expectationWithDescription:@"Event should be received"];
+    [task setEventBlock:^(AFEventStreamEvent *event) {
+        [eventExpectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTestExpectation *closeExpectation = [self expectationWithDescription:@"Stream should close"];
+    [task setDidCloseBlock:^(NSError *error) {
+        XCTAssertNil(error);
+        [closeExpectation fulfill];
+    }];
+
+    [task cancel];
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertEqual(AFEventStreamTestRequests.count, 1u);
+}
+
+@end
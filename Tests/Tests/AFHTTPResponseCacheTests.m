@@ -0,0 +1,231 @@
+// AFHTTPResponseCacheTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFTestCase.h"
+#import "AFHTTPResponseCache.h"
+
+@interface AFHTTPResponseCacheTests : AFTestCase
+@property (nonatomic, strong) AFHTTPResponseCache *cache;
+@property (nonatomic, copy) NSString *diskPath;
+@end
+
+@implementation AFHTTPResponseCacheTests
+
+- (void)setUp {
+    [super setUp];
+    self.diskPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    self.cache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:1024 * 1024 diskCapacity:1024 * 1024 diskPath:self.diskPath];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:self.diskPath error:nil];
+    [super tearDown];
+}
+
+- (NSURLRequest *)request {
+    return [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"get"]];
+}
+
+- (NSHTTPURLResponse *)responseWithStatusCode:(NSInteger)statusCode headerFields:(NSDictionary *)headerFields {
+    return [[NSHTTPURLResponse alloc] initWithURL:[self request].URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+}
+
+- (AFCachedHTTPResponse *)storeResponseWithHeaderFields:(NSDictionary *)headerFields {
+    return [self.cache storeResponse:[self responseWithStatusCode:200 headerFields:headerFields]
+                                data:[@"body" dataUsingEncoding:NSUTF8StringEncoding]
+                          forRequest:[self request]
+                         requestDate:[NSDate date]];
+}
+
+- (AFHTTPResponseCacheLookupResult)lookupResultForRequest:(NSURLRequest *)request {
+    __block AFHTTPResponseCacheLookupResult result = [self.cache lookupResponseForRequest:request cachedResponse:nil];
+    if (result == AFHTTPResponseCacheLookupStoredOnDisk) {
+        XCTestExpectation *expectation = [self expectationWithDescription:@"Response should be looked up on disk"];
+        [self.cache lookupResponseOnDiskForRequest:request completionHandler:^(AFHTTPResponseCacheLookupResult diskResult, AFCachedHTTPResponse * _Nullable cachedResponse) {
+            result = diskResult;
+            [expectation fulfill];
+        }];
+        [self waitForExpectationsWithCommonTimeout];
+    }
+
+    return result;
+}
+
+#pragma mark - Storage
+
+- (void)testResponseWithMaxAgeIsServedFresh {
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=60"}];
+
+    AFCachedHTTPResponse *cachedResponse = nil;
+    XCTAssertEqual([self.cache lookupResponseForRequest:[self request] cachedResponse:&cachedResponse], AFHTTPResponseCacheLookupFresh);
+    XCTAssertEqualObjects(cachedResponse.data, [@"body" dataUsingEncoding:NSUTF8StringEncoding]);
+    XCTAssertEqual(self.cache.hitCount, 1u);
+}
+
+- (void)testResponsesWithoutFreshnessOrValidatorsAreNotStored {
+    XCTAssertNil([self storeResponseWithHeaderFields:@{}]);
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupMiss);
+    XCTAssertEqual(self.cache.missCount, 1u);
+}
+
+- (void)testNoStoreResponsesAreNotStoredAndRemoveEarlierOnes {
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=60"}];
+    XCTAssertNil([self storeResponseWithHeaderFields:@{@"Cache-Control": @"no-store, max-age=60"}]);
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupMiss);
+}
+
+- (void)testExpiredResponseWithValidatorRequiresRevalidation {
+    NSDate *date = [NSDate dateWithTimeIntervalSinceNow:-120.0];
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    dateFormatter.timeZone = [NSTimeZone timeZoneForSecondsFromGMT:0];
+    dateFormatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+
+    [self storeResponseWithHeaderFields:@{@"Date": [dateFormatter stringFromDate:date], @"Cache-Control": @"max-age=60", @"ETag": @"\"v1\""}];
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupRequiresRevalidation);
+    XCTAssertEqual(self.cache.revalidationCount, 1u);
+}
+
+- (void)testStaleWhileRevalidateAllowsServingStaleResponses {
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=0, stale-while-revalidate=60", @"ETag": @"\"v1\""}];
+
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupStale);
+    XCTAssertEqual(self.cache.staleHitCount, 1u);
+    XCTAssertEqual(self.cache.revalidationCount, 1u);
+}
+
+- (void)testRequestNoCacheForcesRevalidation {
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=60"}];
+
+    NSMutableURLRequest *request = [[self request] mutableCopy];
+    [request setValue:@"no-cache" forHTTPHeaderField:@"Cache-Control"];
+    XCTAssertEqual([self lookupResultForRequest:request], AFHTTPResponseCacheLookupRequiresRevalidation);
+}
+
+- (void)testStaleIfErrorAllowsServingStaleResponsesAfterErrors {
+    AFCachedHTTPResponse *cachedResponse = [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=0, stale-if-error=60", @"ETag": @"\"v1\""}];
+
+    XCTAssertFalse([cachedResponse isFreshAtDate:[NSDate date]]);
+    XCTAssertTrue([cachedResponse canBeServedAfterErrorAtDate:[NSDate date]]);
+    XCTAssertFalse([cachedResponse canBeServedAfterErrorAtDate:[NSDate dateWithTimeIntervalSinceNow:120.0]]);
+}
+
+- (void)testRequestsWithDifferentVaryHeadersAreNotServed {
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=60", @"Vary": @"Accept-Language"}];
+
+    NSMutableURLRequest *request = [[self request] mutableCopy];
+    [request setValue:@"fr" forHTTPHeaderField:@"Accept-Language"];
+    XCTAssertEqual([self lookupResultForRequest:request], AFHTTPResponseCacheLookupMiss);
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupFresh);
+}
+
+- (void)testCacheControlOverrideBlockReplacesServerPolicy {
+    [self.cache setCacheControlOverrideBlock:^NSString * _Nullable(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nonnull response) {
+        return @"max-age=60";
+    }];
+
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"no-store"}];
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupFresh);
+}
+
+#pragma mark - Revalidation
+
+- (void)testConditionalRequestCarriesValidators {
+    AFCachedHTTPResponse *cachedResponse = [self storeResponseWithHeaderFields:@{@"ETag": @"\"v1\"", @"Last-Modified": @"Mon, 05 Oct 2015 10:00:00 GMT"}];
+
+    NSURLRequest *conditionalRequest = [self.cache conditionalRequestForRequest:[self request] cachedResponse:cachedResponse];
+    XCTAssertEqualObjects([conditionalRequest valueForHTTPHeaderField:@"If-None-Match"], @"\"v1\"");
+    XCTAssertEqualObjects([conditionalRequest valueForHTTPHeaderField:@"If-Modified-Since"], @"Mon, 05 Oct 2015 10:00:00 GMT");
+    XCTAssertEqual(conditionalRequest.cachePolicy, NSURLRequestReloadIgnoringLocalCacheData);
+}
+
+- (void)testNotModifiedResponseRefreshesHeadersAndKeepsBody {
+    AFCachedHTTPResponse *cachedResponse = [self storeResponseWithHeaderFields:@{@"Cache-Control": @"no-cache", @"ETag": @"\"v1\""}];
+
+    NSHTTPURLResponse *notModifiedResponse = [self responseWithStatusCode:304 headerFields:@{@"Cache-Control": @"max-age=60", @"ETag": @"\"v1\""}];
+    AFCachedHTTPResponse *updatedResponse = [self.cache updateCachedResponse:cachedResponse withNotModifiedResponse:notModifiedResponse forRequest:[self request] requestDate:[NSDate date]];
+
+    XCTAssertEqual(updatedResponse.response.statusCode, 200);
+    XCTAssertEqualObjects(updatedResponse.data, cachedResponse.data);
+    XCTAssertEqual([self lookupResultForRequest:[self request]], AFHTTPResponseCacheLookupFresh);
+    XCTAssertEqual(self.cache.notModifiedCount, 1u);
+}
+
+#pragma mark - Disk Tier
+
+- (void)testResponsesArePersistedOnDisk {
+    [self storeResponseWithHeaderFields:@{@"Cache-Control": @"max-age=60"}];
+    XCTAssertGreaterThan(self.cache.currentDiskUsage, 0u);
+
+    AFHTTPResponseCache *diskOnlyCache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:0 diskCapacity:1024 * 1024 diskPath:self.diskPath];
+    XCTAssertEqual([diskOnlyCache lookupResponseForRequest:[self request] cachedResponse:nil], AFHTTPResponseCacheLookupStoredOnDisk);
+    XCTAssertEqual(diskOnlyCache.missCount, 0u);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Response should be read from disk"];
+    [diskOnlyCache lookupResponseOnDiskForRequest:[self request] completionHandler:^(AFHTTPResponseCacheLookupResult result, AFCachedHTTPResponse * _Nullable cachedResponse) {
+        XCTAssertEqual(result, AFHTTPResponseCacheLookupFresh);
+        XCTAssertEqualObjects(cachedResponse.data, [@"body" dataUsingEncoding:NSUTF8StringEncoding]);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testRemovedResponseIsNotReadFromDisk {
+    AFHTTPResponseCache *diskOnlyCache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:0 diskCapacity:1024 * 1024 diskPath:self.diskPath];
+    [diskOnlyCache storeResponse:[self responseWithStatusCode:200 headerFields:@{@"Cache-Control": @"max-age=60"}]
+                            data:[@"body" dataUsingEncoding:NSUTF8StringEncoding]
+                      forRequest:[self request]
+                     requestDate:[NSDate date]];
+    [diskOnlyCache removeCachedResponseForURL:[self request].URL];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Lookup should miss"];
+    [diskOnlyCache lookupResponseOnDiskForRequest:[self request] completionHandler:^(AFHTTPResponseCacheLookupResult result, AFCachedHTTPResponse * _Nullable cachedResponse) {
+        XCTAssertEqual(result, AFHTTPResponseCacheLookupMiss);
+        XCTAssertNil(cachedResponse);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqual([diskOnlyCache lookupResponseForRequest:[self request] cachedResponse:nil], AFHTTPResponseCacheLookupMiss);
+}
+
+- (void)testDiskTierIsTrimmedToItsCapacity {
+    AFHTTPResponseCache *cache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:0 diskCapacity:32 * 1024 diskPath:self.diskPath];
+    NSMutableData *data = [NSMutableData dataWithLength:1024];
+
+    for (NSUInteger index = 0; index < 64; index++) {
+        NSURL *URL = [self.baseURL URLByAppendingPathComponent:[NSString stringWithFormat:@"cache/%lu", (unsigned long)index]];
+        NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:URL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"Cache-Control": @"max-age=60"}];
+        [cache storeResponse:response data:data forRequest:[NSURLRequest requestWithURL:URL] requestDate:[NSDate date]];
+    }
+
+    XCTAssertGreaterThan(cache.currentDiskUsage, 0u);
+    XCTAssertLessThanOrEqual(cache.currentDiskUsage, cache.diskCapacity);
+
+    NSURL *lastURL = [self.baseURL URLByAppendingPathComponent:@"cache/63"];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Most recent response should be read from disk"];
+    [cache lookupResponseOnDiskForRequest:[NSURLRequest requestWithURL:lastURL] completionHandler:^(AFHTTPResponseCacheLookupResult result, AFCachedHTTPResponse * _Nullable cachedResponse) {
+        XCTAssertEqual(result, AFHTTPResponseCacheLookupFresh);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+@end
@@ -108,6 +108,35 @@
     XCTAssertNotEqual(copiedSerializer, self.responseSerializer);
     XCTAssertTrue(copiedSerializer.acceptableContentTypes.count == self.responseSerializer.acceptableContentTypes.count);
     XCTAssertTrue(copiedSerializer.acceptableStatusCodes.count == self.responseSerializer.acceptableStatusCodes.count);
+    XCTAssertEqual(copiedSerializer.maximumResponseDataLength, self.responseSerializer.maximumResponseDataLength);
+}
+
+- (void)testThatValidationBeforeLoadingDataReportsUnacceptableContentTypeWithoutData {
+    self.responseSerializer.acceptableContentTypes = [NSSet setWithObject:@"application/json"];
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"1.1" headerFields:@{@"Content-Type": @"text/html"}];
+
+    NSError *error = nil;
+    XCTAssertFalse([self.responseSerializer validateResponseBeforeLoadingData:response partialData:nil error:&error]);
+    XCTAssertEqualObjects(error.domain, AFURLResponseSerializationErrorDomain);
+    XCTAssertEqual(error.code, NSURLErrorCannotDecodeContentData);
+    XCTAssertEqualObjects(error.userInfo[AFNetworkingOperationFailingURLResponseErrorKey], response);
+}
+
+- (void)testThatValidationBeforeLoadingDataIncludesPartialData {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:500 HTTPVersion:@"1.1" headerFields:@{@"Content-Type": @"text/html"}];
+    NSData *data = [@"<html>" dataUsingEncoding:NSUTF8StringEncoding];
+
+    NSError *error = nil;
+    XCTAssertFalse([self.responseSerializer validateResponseBeforeLoadingData:response partialData:data error:&error]);
+    XCTAssertEqual(error.code, NSURLErrorBadServerResponse);
+    XCTAssertEqualObjects(error.userInfo[AFNetworkingOperationFailingURLResponseDataErrorKey], data);
+}
+
+- (void)testThatValidationBeforeLoadingDataAcceptsAnyContentTypeForEmptyBody {
+    self.responseSerializer.acceptableContentTypes = [NSSet setWithObject:@"application/json"];
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"1.1" headerFields:@{@"Content-Type": @"text/html", @"Content-Length": @"0"}];
+
+    XCTAssertTrue([self.responseSerializer validateResponseBeforeLoadingData:response partialData:nil error:nil]);
 }
 
 - (void)testSupportsSecureCoding {
@@ -0,0 +1,127 @@
+// AFHTTPRetryPolicyTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFTestCase.h"
+#import "AFHTTPRetryPolicy.h"
+
+@interface AFHTTPRetryPolicyTests : AFTestCase
+@property (nonatomic, strong) AFHTTPRetryPolicy *policy;
+@end
+
+@implementation AFHTTPRetryPolicyTests
+
+- (void)setUp {
+    [super setUp];
+    self.policy = [AFHTTPRetryPolicy defaultPolicy];
+}
+
+- (NSHTTPURLResponse *)responseWithStatusCode:(NSInteger)statusCode headerFields:(NSDictionary *)headerFields {
+    return [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+}
+
+- (NSURLRequest *)requestWithHTTPMethod:(NSString *)method {
+    NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:self.baseURL];
+    request.HTTPMethod = method;
+    return request;
+}
+
+#pragma mark - Retry Decisions
+
+- (void)testIdempotentRequestsAreRetriedForRetriableStatusCodes {
+    NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:nil];
+
+    XCTAssertTrue([self.policy shouldRetryRequest:[self requestWithHTTPMethod:@"GET"] response:[self responseWithStatusCode:503 headerFields:nil] error:error]);
+    XCTAssertTrue([self.policy shouldRetryRequest:[self requestWithHTTPMethod:@"PUT"] response:[self responseWithStatusCode:429 headerFields:nil] error:error]);
+    XCTAssertFalse([self.policy shouldRetryRequest:[self requestWithHTTPMethod:@"GET"] response:[self responseWithStatusCode:404 headerFields:nil] error:error]);
+}
+
+- (void)testNonIdempotentRequestsAreNotRetried {
+    NSError *error = [NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil];
+
+    XCTAssertFalse([self.policy shouldRetryRequest:[self requestWithHTTPMethod:@"POST"] response:[self responseWithStatusCode:503 headerFields:nil] error:error]);
+    XCTAssertFalse([self.policy shouldRetryRequest:[self requestWithHTTPMethod:@"PATCH"] response:nil error:error]);
+}
+
+- (void)testTransientURLErrorsAreRetriedWithoutAResponse {
+    NSURLRequest *request = [self requestWithHTTPMethod:@"GET"];
+
+    XCTAssertTrue([self.policy shouldRetryRequest:request response:nil error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:nil]]);
+    XCTAssertTrue([self.policy shouldRetryRequest:request response:nil error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorNetworkConnectionLost userInfo:nil]]);
+    XCTAssertFalse([self.policy shouldRetryRequest:request response:nil error:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]]);
+}
+
+#pragma mark - Delays
+
+- (void)testBackoffDelayIsJitteredWithinTheExponentialBound {
+    self.policy.baseDelay = 1.0;
+    self.policy.maximumDelay = 4.0;
+
+    for (NSUInteger retryCount = 1; retryCount <= 5; retryCount++) {
+        NSTimeInterval bound = MIN(4.0, pow(2.0, retryCount - 1));
+        for (NSUInteger sample = 0; sample < 100; sample++) {
+            NSTimeInterval delay = [self.policy delayBeforeRetry:retryCount response:nil];
+            XCTAssertGreaterThanOrEqual(delay, 0.0);
+            XCTAssertLessThanOrEqual(delay, bound);
+        }
+    }
+}
+
+- (void)testRetryAfterHeaderInSecondsIsRespected {
+    NSHTTPURLResponse *response = [self responseWithStatusCode:503 headerFields:@{@"Retry-After": @"7"}];
+    XCTAssertEqualWithAccuracy([self.policy delayBeforeRetry:1 response:response], 7.0, 0.001);
+
+    self.policy.respectsRetryAfterHeader = NO;
+    XCTAssertLessThanOrEqual([self.policy delayBeforeRetry:1 response:response], self.policy.baseDelay);
+}
+
+- (void)testRetryAfterHeaderWithHTTPDateIsRespected {
+    NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
+    dateFormatter.locale = [NSLocale localeWithLocaleIdentifier:@"en_US_POSIX"];
+    dateFormatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+    dateFormatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+
+    NSString *retryAfter = [dateFormatter stringFromDate:[NSDate dateWithTimeIntervalSinceNow:10.0]];
+    NSHTTPURLResponse *response = [self responseWithStatusCode:503 headerFields:@{@"Retry-After": retryAfter}];
+    XCTAssertEqualWithAccuracy([self.policy delayBeforeRetry:1 response:response], 10.0, 1.5);
+}
+
+#pragma mark - Hedging
+
+- (void)testHedgingDelayFollowsTheObservedLatency {
+    XCTAssertEqualWithAccuracy(self.policy.hedgingDelay, self.policy.minimumHedgingDelay, 0.001);
+
+    for (NSUInteger index = 0; index < 64; index++) {
+        [self.policy recordLatency:(index < 60) ? 0.2 : 2.0];
+    }
+    XCTAssertEqualWithAccuracy(self.policy.hedgingDelay, 2.0, 0.001);
+}
+
+- (void)testCopyKeepsTheConfiguration {
+    self.policy.maximumNumberOfAttempts = 7;
+    self.policy.hedgesRequests = YES;
+
+    AFHTTPRetryPolicy *copy = [self.policy copy];
+    XCTAssertEqual(copy.maximumNumberOfAttempts, (NSUInteger)7);
+    XCTAssertTrue(copy.hedgesRequests);
+    XCTAssertEqualObjects(copy.retriableHTTPMethods, self.policy.retriableHTTPMethods);
+}
+
+@end
@@ -435,6 +435,247 @@
     [self waitForExpectationsWithCommonTimeout];
 }
 
+#pragma mark - Shared Requests
+
+- (void)testThatIdenticalSharedRequestsShareOneTaskAndResponse {
+    XCTestExpectation *firstExpectation = [self expectationWithDescription:@"First request should succeed"];
+    XCTestExpectation *secondExpectation = [self expectationWithDescription:@"Second request should succeed"];
+    __block id firstResponseObject = nil;
+    __block id secondResponseObject = nil;
+
+    AFHTTPSharedRequestReceipt *firstReceipt = [self.manager sharedGET:@"delay/1" parameters:nil success:^(NSURLSessionDataTask * _Nonnull task, id  _Nullable responseObject) {
+        firstResponseObject = responseObject;
+        [firstExpectation fulfill];
+    } failure:nil];
+    AFHTTPSharedRequestReceipt *secondReceipt = [self.manager sharedGET:@"delay/1" parameters:nil success:^(NSURLSessionDataTask * _Nonnull task, id  _Nullable responseObject) {
+        secondResponseObject = responseObject;
+        [secondExpectation fulfill];
+    } failure:nil];
+
+    XCTAssertEqual(firstReceipt.task, secondReceipt.task);
+    XCTAssertNotEqualObjects(firstReceipt.receiptID, secondReceipt.receiptID);
+
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertNotNil(firstResponseObject);
+    XCTAssertEqual(firstResponseObject, secondResponseObject);
+}
+
+- (void)testThatSharedRequestsWithDifferentHeadersDoNotShareATask {
+    AFHTTPSharedRequestReceipt *firstReceipt = [self.manager sharedGET:@"delay/1" parameters:nil success:nil failure:nil];
+    [self.manager.requestSerializer setValue:@"fr" forHTTPHeaderField:@"Accept-Language"];
+    AFHTTPSharedRequestReceipt *secondReceipt = [self.manager sharedGET:@"delay/1" parameters:nil success:nil failure:nil];
+
+    XCTAssertNotEqual(firstReceipt.task, secondReceipt.task);
+    [self.manager cancelSharedRequestForReceipt:firstReceipt];
+    [self.manager cancelSharedRequestForReceipt:secondReceipt];
+}
+
+- (void)testThatCancellingOneSharedRequestDoesNotCancelTheTaskForOthers {
+    XCTestExpectation *cancelledExpectation = [self expectationWithDescription:@"Cancelled request should fail"];
+    XCTestExpectation *remainingExpectation = [self expectationWithDescription:@"Remaining request should succeed"];
+
+    AFHTTPSharedRequestReceipt *cancelledReceipt = [self.manager sharedGET:@"delay/1" parameters:nil success:nil failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
+        XCTAssertEqual(error.code, NSURLErrorCancelled);
+        [cancelledExpectation fulfill];
+    }];
+    AFHTTPSharedRequestReceipt *remainingReceipt = [self.manager sharedGET:@"delay/1" parameters:nil success:^(NSURLSessionDataTask * _Nonnull task, id  _Nullable responseObject) {
+        [remainingExpectation fulfill];
+    } failure:nil];
+
+    [self.manager cancelSharedRequestForReceipt:cancelledReceipt];
+    XCTAssertNotEqual(remainingReceipt.task.state, NSURLSessionTaskStateCanceling);
+
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testThatCancellingTheLastSharedRequestCancelsTheTask {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should be cancelled"];
+    AFHTTPSharedRequestReceipt *receipt = [self.manager sharedHEAD:@"delay/1" parameters:nil success:nil failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
+        XCTAssertEqual(error.code, NSURLErrorCancelled);
+        [expectation fulfill];
+    }];
+
+    [self.manager cancelSharedRequestForReceipt:receipt];
+    XCTAssertEqual(receipt.task.state, NSURLSessionTaskStateCanceling);
+
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+#pragma mark - Retry Policy
+
+- (void)testFailingGETIsRetriedUpToTheMaximumNumberOfAttempts {
+    AFHTTPRetryPolicy *retryPolicy = [AFHTTPRetryPolicy defaultPolicy];
+    retryPolicy.baseDelay = 0.05;
+    self.manager.retryPolicy = retryPolicy;
+
+    __block NSUInteger numberOfAttempts = 0;
+    [self.manager setTaskDidCompleteBlock:^(NSURLSession * _Nonnull session, NSURLSessionTask * _Nonnull task, NSError * _Nullable error) {
+        numberOfAttempts++;
+    }];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should fail after all attempts"];
+    [self.manager
+     GET:@"status/503"
+     parameters:nil
+     progress:nil
+     success:nil
+     failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
+         XCTAssertEqual(((NSHTTPURLResponse *)task.response).statusCode, 503);
+         [expectation fulfill];
+     }];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqual(numberOfAttempts, retryPolicy.maximumNumberOfAttempts);
+}
+
+- (void)testFailingPOSTIsNotRetried {
+    self.manager.retryPolicy = [AFHTTPRetryPolicy defaultPolicy];
+
+    __block NSUInteger numberOfAttempts = 0;
+    [self.manager setTaskDidCompleteBlock:^(NSURLSession * _Nonnull session, NSURLSessionTask * _Nonnull task, NSError * _Nullable error) {
+        numberOfAttempts++;
+    }];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should fail"];
+    [self.manager
+     POST:@"status/503"
+     parameters:nil
+     progress:nil
+     success:nil
+     failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
+         [expectation fulfill];
+     }];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqual(numberOfAttempts, (NSUInteger)1);
+}
+
+- (void)testAttemptIsCancelledWhenTheDeadlinePasses {
+    AFHTTPRetryPolicy *retryPolicy = [AFHTTPRetryPolicy defaultPolicy];
+    retryPolicy.deadline = 1.0;
+    self.manager.retryPolicy = retryPolicy;
+
+    CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+    __block NSTimeInterval elapsed = 0.0;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should time out"];
+    [self.manager
+     GET:@"delay/5"
+     parameters:nil
+     progress:nil
+     success:nil
+     failure:^(NSURLSessionDataTask * _Nullable task, NSError * _Nonnull error) {
+         elapsed = CFAbsoluteTimeGetCurrent() - startTime;
+         XCTAssertEqualObjects(error.domain, NSURLErrorDomain);
+         XCTAssertEqual(error.code, NSURLErrorTimedOut);
+         [expectation fulfill];
+     }];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertLessThan(elapsed, 2.0);
+
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"taskCount == 0"] evaluatedWithObject:self.manager handler:nil];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testHedgedGETSucceedsExactlyOnce {
+    AFHTTPRetryPolicy *retryPolicy = [AFHTTPRetryPolicy defaultPolicy];
+    retryPolicy.hedgesRequests = YES;
+    retryPolicy.minimumHedgingDelay = 0.1;
+    self.manager.retryPolicy = retryPolicy;
+
+    __block NSUInteger numberOfSuccesses = 0;
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should succeed"];
+    [self.manager
+     GET:@"delay/1"
+     parameters:nil
+     progress:nil
+     success:^(NSURLSessionDataTask * _Nonnull task, id  _Nullable responseObject) {
+         numberOfSuccesses++;
+         [expectation fulfill];
+     }
+     failure:nil];
+    [self waitForExpectationsWithCommonTimeout];
+
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"taskCount == 0"] evaluatedWithObject:self.manager handler:nil];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqual(numberOfSuccesses, (NSUInteger)1);
+}
+
+#pragma mark - Response Cache
+
+- (void)testFreshCachedResponseIsServedWithoutATask {
+    NSString *diskPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    self.manager.responseCache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:1024 * 1024 diskCapacity:0 diskPath:diskPath];
+
+    XCTestExpectation *networkExpectation = [self expectationWithDescription:@"Request should succeed"];
+    NSURLSessionDataTask *networkTask = [self.manager GET:@"cache/60" parameters:nil progress:nil success:^(NSURLSessionDataTask * _Nullable task, id  _Nullable responseObject) {
+        [networkExpectation fulfill];
+    } failure:nil];
+    XCTAssertNotNil(networkTask);
+    [self waitForExpectationsWithCommonTimeout];
+
+    __block id cachedResponseObject = nil;
+    XCTestExpectation *cacheExpectation = [self expectationWithDescription:@"Request should be served from the cache"];
+    NSURLSessionDataTask *cachedTask = [self.manager GET:@"cache/60" parameters:nil progress:nil success:^(NSURLSessionDataTask * _Nullable task, id  _Nullable responseObject) {
+        XCTAssertNil(task);
+        cachedResponseObject = responseObject;
+        [cacheExpectation fulfill];
+    } failure:nil];
+    XCTAssertNil(cachedTask);
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertNotNil(cachedResponseObject);
+    XCTAssertEqual(self.manager.responseCache.hitCount, 1u);
+    XCTAssertEqual(self.manager.responseCache.missCount, 1u);
+}
+
+- (void)testRevalidatedResponseReusesStoredBodyOnNotModified {
+    NSString *diskPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    self.manager.responseCache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:1024 * 1024 diskCapacity:0 diskPath:diskPath];
+
+    __block id firstResponseObject = nil;
+    XCTestExpectation *firstExpectation = [self expectationWithDescription:@"Request should succeed"];
+    [self.manager GET:@"etag/af" parameters:nil progress:nil success:^(NSURLSessionDataTask * _Nullable task, id  _Nullable responseObject) {
+        firstResponseObject = responseObject;
+        [firstExpectation fulfill];
+    } failure:nil];
+    [self waitForExpectationsWithCommonTimeout];
+
+    __block id secondResponseObject = nil;
+    XCTestExpectation *secondExpectation = [self expectationWithDescription:@"Revalidated request should succeed"];
+    [self.manager GET:@"etag/af" parameters:nil progress:nil success:^(NSURLSessionDataTask * _Nullable task, id  _Nullable responseObject) {
+        XCTAssertEqual(((NSHTTPURLResponse *)task.response).statusCode, 304);
+        secondResponseObject = responseObject;
+        [secondExpectation fulfill];
+    } failure:nil];
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertEqualObjects(secondResponseObject, firstResponseObject);
+    XCTAssertEqual(self.manager.responseCache.notModifiedCount, 1u);
+}
+
+- (void)testFreshResponseStoredOnDiskIsServedWithoutATask {
+    NSString *diskPath = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    self.manager.responseCache = [[AFHTTPResponseCache alloc] initWithMemoryCapacity:0 diskCapacity:1024 * 1024 diskPath:diskPath];
+
+    XCTestExpectation *networkExpectation = [self expectationWithDescription:@"Request should succeed"];
+    [self.manager GET:@"cache/60" parameters:nil progress:nil success:^(NSURLSessionDataTask * _Nullable task, id  _Nullable responseObject) {
+        [networkExpectation fulfill];
+    } failure:nil];
+    [self waitForExpectationsWithCommonTimeout];
+
+    __block id cachedResponseObject = nil;
+    XCTestExpectation *cacheExpectation = [self expectationWithDescription:@"Request should be served from disk"];
+    NSURLSessionDataTask *cachedTask = [self.manager GET:@"cache/60" parameters:nil progress:nil success:^(NSURLSessionDataTask * _Nullable task, id  _Nullable responseObject) {
+        XCTAssertNil(task);
+        cachedResponseObject = responseObject;
+        [cacheExpectation fulfill];
+    } failure:nil];
+    XCTAssertNil(cachedTask);
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertNotNil(cachedResponseObject);
+    XCTAssertEqual(self.manager.responseCache.hitCount, 1u);
+    [[NSFileManager defaultManager] removeItemAtPath:diskPath error:nil];
+}
+
 #pragma mark - Deprecated Rest Interface
 
 - (void)testDeprecatedGET {
@@ -401,6 +401,178 @@
     [self waitForExpectationsWithCommonTimeout];
 }
 
+- (void)testThatCancellingActiveDownloadReleasesItsSlotAfterGracePeriod {
+    self.downloader = [self downloaderWithMaximumActiveDownloads:1];
+    self.downloader.cancellationGracePeriod = 0.1;
+
+    NSURLRequest *slowRequest = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"delay/10"]];
+    AFImageDownloadReceipt *receipt = [self.downloader downloadImageForURLRequest:slowRequest success:nil failure:nil];
+    [self.downloader cancelTaskForImageDownloadReceipt:receipt];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"queued download should succeed"];
+    [self.downloader
+     downloadImageForURLRequest:self.pngRequest
+     success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+         [expectation fulfill];
+     }
+     failure:nil];
+    [self waitForExpectationsWithTimeout:5.0 handler:nil];
+
+    XCTAssertNotEqual(receipt.task.state, NSURLSessionTaskStateRunning);
+}
+
+- (void)testThatRequestDuringGracePeriodReattachesToActiveDownload {
+    self.downloader.cancellationGracePeriod = 10.0;
+    AFImageDownloadReceipt *receipt1 = [self.downloader downloadImageForURLRequest:self.pngRequest success:nil failure:nil];
+    [self.downloader cancelTaskForImageDownloadReceipt:receipt1];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"reattached download should succeed"];
+    AFImageDownloadReceipt *receipt2 = [self.downloader
+                                        downloadImageForURLRequest:self.pngRequest
+                                        success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+                                            [expectation fulfill];
+                                        }
+                                        failure:nil];
+    XCTAssertEqual(receipt1.task, receipt2.task);
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+#pragma mark - Prioritization
+
+- (AFImageDownloader *)downloaderWithMaximumActiveDownloads:(NSInteger)maximumActiveDownloads {
+    AFHTTPSessionManager *sessionManager = [[AFHTTPSessionManager alloc] initWithSessionConfiguration:[NSURLSessionConfiguration ephemeralSessionConfiguration]];
+    sessionManager.responseSerializer = [AFImageResponseSerializer serializer];
+    return [[AFImageDownloader alloc] initWithSessionManager:sessionManager
+                                      downloadPrioritization:AFImageDownloadPrioritizationFIFO
+                                      maximumActiveDownloads:maximumActiveDownloads
+                                                  imageCache:nil];
+}
+
+- (void)occupyActiveDownloadSlotOfDownloader:(AFImageDownloader *)downloader {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"delayed request should finish"];
+    [downloader
+     downloadImageForURLRequest:[NSURLRequest requestWithURL:self.delayURL]
+     success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+         [expectation fulfill];
+     }
+     failure:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, NSError * _Nonnull error) {
+         [expectation fulfill];
+     }];
+}
+
+- (void)testThatQueuedDownloadsStartInPriorityOrder {
+    self.downloader = [self downloaderWithMaximumActiveDownloads:1];
+    [self occupyActiveDownloadSlotOfDownloader:self.downloader];
+
+    NSMutableArray <NSURL *> *completedURLs = [NSMutableArray array];
+    XCTestExpectation *expectation1 = [self expectationWithDescription:@"background download should succeed"];
+    [self.downloader
+     downloadImageForURLRequest:self.pngRequest
+     withReceiptID:[NSUUID UUID]
+     priority:AFImageDownloadPriorityBackground
+     success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+         [completedURLs addObject:request.URL];
+         [expectation1 fulfill];
+     }
+     failure:nil];
+
+    XCTestExpectation *expectation2 = [self expectationWithDescription:@"visible download should succeed"];
+    AFImageDownloadReceipt *receipt = [self.downloader
+                                       downloadImageForURLRequest:self.jpegRequest
+                                       withReceiptID:[NSUUID UUID]
+                                       priority:AFImageDownloadPriorityVisible
+                                       success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+                                           [completedURLs addObject:request.URL];
+                                           [expectation2 fulfill];
+                                       }
+                                       failure:nil];
+    XCTAssertEqual(receipt.task.priority, NSURLSessionTaskPriorityHigh);
+    [self waitForExpectationsWithCommonTimeout];
+
+    NSArray *expectedURLs = @[self.jpegURL, self.pngURL];
+    XCTAssertEqualObjects(completedURLs, expectedURLs);
+}
+
+- (void)testThatSettingReceiptPriorityReordersQueuedDownloads {
+    self.downloader = [self downloaderWithMaximumActiveDownloads:1];
+    [self occupyActiveDownloadSlotOfDownloader:self.downloader];
+
+    NSMutableArray <NSURL *> *completedURLs = [NSMutableArray array];
+    XCTestExpectation *expectation1 = [self expectationWithDescription:@"first download should succeed"];
+    [self.downloader
+     downloadImageForURLRequest:self.pngRequest
+     withReceiptID:[NSUUID UUID]
+     priority:AFImageDownloadPriorityPrefetch
+     success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+         [completedURLs addObject:request.URL];
+         [expectation1 fulfill];
+     }
+     failure:nil];
+
+    XCTestExpectation *expectation2 = [self expectationWithDescription:@"second download should succeed"];
+    AFImageDownloadReceipt *receipt = [self.downloader
+                                       downloadImageForURLRequest:self.jpegRequest
+                                       withReceiptID:[NSUUID UUID]
+                                       priority:AFImageDownloadPriorityPrefetch
+                                       success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+                                           [completedURLs addObject:request.URL];
+                                           [expectation2 fulfill];
+                                       }
+                                       failure:nil];
+    XCTAssertGreaterThan(receipt.task.priority, NSURLSessionTaskPriorityLow);
+    XCTAssertLessThan(receipt.task.priority, NSURLSessionTaskPriorityDefault);
+    receipt.priority = AFImageDownloadPriorityVisible;
+    XCTAssertEqual(receipt.task.priority, NSURLSessionTaskPriorityHigh);
+    [self waitForExpectationsWithCommonTimeout];
+
+    NSArray *expectedURLs = @[self.jpegURL, self.pngURL];
+    XCTAssertEqualObjects(completedURLs, expectedURLs);
+}
+
+#pragma mark - Prefetching
+
+- (void)testThatPrefetchedImagesAreAddedToImageCache {
+    [self.downloader prefetchImagesForURLRequests:@[self.pngRequest, self.jpegRequest]];
+
+    id <AFImageRequestCache> imageCache = self.downloader.imageCache;
+    NSURLRequest *pngRequest = self.pngRequest;
+    NSURLRequest *jpegRequest = self.jpegRequest;
+    [self expectationForPredicate:[NSPredicate predicateWithBlock:^BOOL(id  _Nullable evaluatedObject, NSDictionary<NSString *,id> * _Nullable bindings) {
+        return [imageCache imageforRequest:pngRequest withAdditionalIdentifier:nil] != nil &&
+               [imageCache imageforRequest:jpegRequest withAdditionalIdentifier:nil] != nil;
+    }] evaluatedWithObject:self handler:nil];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testThatDownloadRequestIsAttachedToActivePrefetch {
+    [self.downloader prefetchImagesForURLRequests:@[self.pngRequest]];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"image download should succeed"];
+    AFImageDownloadReceipt *receipt = [self.downloader
+                                       downloadImageForURLRequest:self.pngRequest
+                                       success:^(NSURLRequest * _Nonnull request, NSHTTPURLResponse * _Nullable response, UIImage * _Nonnull responseObject) {
+                                           [expectation fulfill];
+                                       }
+                                       failure:nil];
+    XCTAssertEqual(receipt.task.state, NSURLSessionTaskStateRunning);
+    XCTAssertEqual(receipt.task.priority, NSURLSessionTaskPriorityHigh);
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testThatCancelledPrefetchesAreNotAddedToImageCache {
+    AFImagePrefetchToken *prefetchToken = [self.downloader prefetchImagesForURLRequests:@[self.pngRequest, self.jpegRequest]];
+    [self.downloader cancelImagePrefetchForToken:prefetchToken];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"cancelled prefetches should not finish"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(2.0 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertNil([self.downloader.imageCache imageforRequest:self.pngRequest withAdditionalIdentifier:nil]);
+    XCTAssertNil([self.downloader.imageCache imageforRequest:self.jpegRequest withAdditionalIdentifier:nil]);
+}
+
 #pragma mark - Threading
 - (void)testThatItAlwaysCallsTheSuccessHandlerOnTheMainQueue {
     XCTestExpectation *expectation = [self expectationWithDescription:@"image download should succeed"];
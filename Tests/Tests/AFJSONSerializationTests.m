@@ -205,4 +205,51 @@ static NSData * AFJSONTestData() {
     XCTAssertEqual(copiedSerializer.removesKeysWithNullValues, self.responseSerializer.removesKeysWithNullValues);
 }
 
+#pragma mark - Lazy Response Objects
+
+- (void)testThatLazyResponseObjectDeserializesDataOnlyOnFirstAccess {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"1.1" headerFields:@{@"Content-Type": @"application/json"}];
+    AFLazyResponseObject *lazyResponseObject = [[AFLazyResponseObject alloc] initWithResponse:response data:AFJSONTestData() responseSerializer:self.responseSerializer];
+    XCTAssertFalse(lazyResponseObject.isSerialized);
+
+    NSError *error = nil;
+    id responseObject = [lazyResponseObject responseObjectWithError:&error];
+    XCTAssertNil(error);
+    XCTAssert([responseObject isKindOfClass:[NSDictionary class]]);
+    XCTAssertTrue(lazyResponseObject.isSerialized);
+    XCTAssertEqual([lazyResponseObject responseObjectWithError:nil], responseObject);
+}
+
+- (void)testThatLazyResponseObjectKeepsSerializationError {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"1.1" headerFields:@{@"Content-Type": @"application/json"}];
+    AFLazyResponseObject *lazyResponseObject = [[AFLazyResponseObject alloc] initWithResponse:response data:[@"{invalid}" dataUsingEncoding:NSUTF8StringEncoding] responseSerializer:self.responseSerializer];
+
+    NSError *firstError = nil;
+    XCTAssertNil([lazyResponseObject responseObjectWithError:&firstError]);
+    XCTAssertNotNil(firstError);
+
+    NSError *secondError = nil;
+    [lazyResponseObject responseObjectWithError:&secondError];
+    XCTAssertEqual(firstError, secondError);
+}
+
+- (void)testThatLazyResponseObjectDeserializesDataOnSpecifiedQueue {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"1.1" headerFields:@{@"Content-Type": @"application/json"}];
+    AFLazyResponseObject *lazyResponseObject = [[AFLazyResponseObject alloc] initWithResponse:response data:AFJSONTestData() responseSerializer:self.responseSerializer];
+
+    dispatch_queue_t queue = dispatch_queue_create("com.alamofire.test.lazy-response-object", DISPATCH_QUEUE_SERIAL);
+    static void *AFLazyResponseObjectTestQueueKey = &AFLazyResponseObjectTestQueueKey;
+    dispatch_queue_set_specific(queue, AFLazyResponseObjectTestQueueKey, AFLazyResponseObjectTestQueueKey, NULL);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Response object is created"];
+    [lazyResponseObject getResponseObjectOnQueue:queue completionHandler:^(id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertTrue(dispatch_get_specific(AFLazyResponseObjectTestQueueKey) == AFLazyResponseObjectTestQueueKey);
+        XCTAssert([responseObject isKindOfClass:[NSDictionary class]]);
+        XCTAssertNil(error);
+        [expectation fulfill];
+    }];
+
+    [self waitForExpectationsWithCommonTimeout];
+}
+
 @end
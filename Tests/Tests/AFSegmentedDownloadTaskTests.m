@@ -0,0 +1,185 @@
+// AFSegmentedDownloadTaskTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#import "AFTestCase.h"
+#import "AFSegmentedDownloadTask.h"
+#import "AFURLSessionManager.h"
+
+static NSData *AFSegmentedDownloadTestData = nil;
+static BOOL AFSegmentedDownloadTestSupportsRanges = YES;
+static NSMutableArray <NSString *> *AFSegmentedDownloadTestRanges = nil;
+
+// Stands in for a file server, answering `Range` requests with the matching bytes of the test data when ranges are supported.
+@interface AFSegmentedDownloadTestURLProtocol : NSURLProtocol
+@end
+
+@implementation AFSegmentedDownloadTestURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [request.URL.host isEqualToString:@"files.test"];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    NSData *data = AFSegmentedDownloadTestData;
+    NSString *range = [self.request valueForHTTPHeaderField:@"Range"];
+    @synchronized (AFSegmentedDownloadTestRanges) {
+        [AFSegmentedDownloadTestRanges addObject:range ?: @""];
+    }
+
+    NSInteger statusCode = 200;
+    NSMutableDictionary *headerFields = [NSMutableDictionary dictionaryWithObjectsAndKeys:@"application/octet-stream", @"Content-Type", @"\"v1\"", @"ETag", nil];
+    if (range && AFSegmentedDownloadTestSupportsRanges) {
+        NSArray <NSString *> *bounds = [[range substringFromIndex:[@"bytes=" length]] componentsSeparatedByString:@"-"];
+        NSUInteger start = (NSUInteger)[bounds[0] integerValue];
+        NSUInteger end = MIN((NSUInteger)[bounds[1] integerValue], data.length - 1);
+        headerFields[@"Content-Range"] = [NSString stringWithFormat:@"bytes %lu-%lu/%lu", (unsigned long)start, (unsigned long)end, (unsigned long)data.length];
+        data = [data subdataWithRange:NSMakeRange(start, end - start + 1)];
+        statusCode = 206;
+    }
+    headerFields[@"Content-Length"] = [@(data.length) stringValue];
+
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:statusCode HTTPVersion:@"HTTP/1.1" headerFields:headerFields];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    [self.client URLProtocol:self didLoadData:data];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+}
+
+@end
+
+#pragma mark -
+
+@interface AFSegmentedDownloadTaskTests : AFTestCase
+@property (nonatomic, strong) AFURLSessionManager *manager;
+@property (nonatomic, strong) NSURLRequest *request;
+@property (nonatomic, strong) NSURL *destinationURL;
+@end
+
+@implementation AFSegmentedDownloadTaskTests
+
+- (void)setUp {
+    [super setUp];
+
+    NSMutableData *data = [NSMutableData dataWithLength:10000];
+    uint8_t *bytes = (uint8_t *)data.mutableBytes;
+    for (NSUInteger index = 0; index < data.length; index++) {
+        bytes[index] = (uint8_t)(index % 251);
+    }
+    AFSegmentedDownloadTestData = data;
+    AFSegmentedDownloadTestSupportsRanges = YES;
+    AFSegmentedDownloadTestRanges = [NSMutableArray array];
+
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[AFSegmentedDownloadTestURLProtocol class]];
+    self.manager = [[AFURLSessionManager alloc] initWithSessionConfiguration:configuration];
+    self.request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://files.test/file"]];
+    self.destinationURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+}
+
+- (void)tearDown {
+    [self.manager invalidateSessionCancelingTasks:YES];
+    self.manager = nil;
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    [fileManager removeItemAtURL:self.destinationURL error:nil];
+    [fileManager removeItemAtURL:[self.destinationURL URLByAppendingPathExtension:@"afdownload"] error:nil];
+    [fileManager removeItemAtURL:[self.destinationURL URLByAppendingPathExtension:@"afdownload-state"] error:nil];
+
+    [super tearDown];
+}
+
+- (NSURL *)downloadedFileURLWithTask:(AFSegmentedDownloadTask *)task {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Download completes"];
+    __block NSURL *downloadedFileURL = nil;
+    [task resumeWithCompletionHandler:^(NSURL *fileURL, NSError *error) {
+        XCTAssertNil(error);
+        downloadedFileURL = fileURL;
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+
+    return downloadedFileURL;
+}
+
+- (void)testFileIsDownloadedInSegments {
+    AFSegmentedDownloadTask *task = [[AFSegmentedDownloadTask alloc] initWithSessionManager:self.manager request:self.request destinationURL:self.destinationURL];
+    task.minimumSegmentLength = 1000;
+
+    NSURL *fileURL = [self downloadedFileURLWithTask:task];
+
+    XCTAssertEqualObjects(fileURL, self.destinationURL);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:self.destinationURL], AFSegmentedDownloadTestData);
+    XCTAssertEqual(task.progress.completedUnitCount, 10000);
+
+    NSSet <NSString *> *expectedRanges = [NSSet setWithArray:@[@"bytes=0-0", @"bytes=0-2499", @"bytes=2500-4999", @"bytes=5000-7499", @"bytes=7500-9999"]];
+    XCTAssertEqualObjects([NSSet setWithArray:AFSegmentedDownloadTestRanges], expectedRanges);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self.destinationURL URLByAppendingPathExtension:@"afdownload"].path]);
+}
+
+- (void)testSmallFileIsDownloadedInFewerSegments {
+    AFSegmentedDownloadTask *task = [[AFSegmentedDownloadTask alloc] initWithSessionManager:self.manager request:self.request destinationURL:self.destinationURL];
+    task.minimumSegmentLength = 5000;
+
+    [self downloadedFileURLWithTask:task];
+
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:self.destinationURL], AFSegmentedDownloadTestData);
+    XCTAssertEqual(AFSegmentedDownloadTestRanges.count, 3u);
+}
+
+- (void)testFileIsDownloadedOverSingleConnectionWhenRangesAreNotSupported {
+    AFSegmentedDownloadTestSupportsRanges = NO;
+    AFSegmentedDownloadTask *task = [[AFSegmentedDownloadTask alloc] initWithSessionManager:self.manager request:self.request destinationURL:self.destinationURL];
+    task.minimumSegmentLength = 1000;
+
+    NSURL *fileURL = [self downloadedFileURLWithTask:task];
+
+    XCTAssertEqualObjects(fileURL, self.destinationURL);
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:self.destinationURL], AFSegmentedDownloadTestData);
+    XCTAssertEqual(AFSegmentedDownloadTestRanges.count, 2u);
+}
+
+- (void)testDownloadResumesFromRecordedRanges {
+    NSMutableData *partialData = [NSMutableData dataWithLength:AFSegmentedDownloadTestData.length];
+    [partialData replaceBytesInRange:NSMakeRange(0, 7000) withBytes:AFSegmentedDownloadTestData.bytes];
+    [partialData writeToURL:[self.destinationURL URLByAppendingPathExtension:@"afdownload"] atomically:YES];
+
+    NSDictionary *state = @{@"url": self.request.URL.absoluteString, @"length": @10000, @"validator": @"\"v1\"", @"segments": @[@[@0, @4999, @5000], @[@5000, @9999, @2000]]};
+    [state writeToURL:[self.destinationURL URLByAppendingPathExtension:@"afdownload-state"] atomically:YES];
+
+    AFSegmentedDownloadTask *task = [[AFSegmentedDownloadTask alloc] initWithSessionManager:self.manager request:self.request destinationURL:self.destinationURL];
+
+    [self downloadedFileURLWithTask:task];
+
+    XCTAssertEqualObjects([NSData dataWithContentsOfURL:self.destinationURL], AFSegmentedDownloadTestData);
+    NSArray <NSString *> *expectedRanges = @[@"bytes=0-0", @"bytes=7000-9999"];
+    XCTAssertEqualObjects(AFSegmentedDownloadTestRanges, expectedRanges);
+    XCTAssertFalse([[NSFileManager defaultManager] fileExistsAtPath:[self.destinationURL URLByAppendingPathExtension:@"afdownload-state"].path]);
+}
+
+@end
@@ -0,0 +1,145 @@
+// AFTracingTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <pthread.h>
+
+#import "AFTestCase.h"
+#import "AFTracing.h"
+#import "AFURLRequestSerialization.h"
+
+@interface AFTracingTests : AFTestCase
+@end
+
+@implementation AFTracingTests
+
+- (void)setUp {
+    [super setUp];
+    [[AFTracer sharedTracer] removeAllSpans];
+}
+
+- (void)tearDown {
+    [AFTracer sharedTracer].enabled = NO;
+    [[AFTracer sharedTracer] removeAllSpans];
+    [super tearDown];
+}
+
+- (NSArray <NSDictionary *> *)traceEventsNamed:(NSString *)name {
+    NSDictionary *trace = [NSJSONSerialization JSONObjectWithData:[[AFTracer sharedTracer] chromeTraceData] options:(NSJSONReadingOptions)0 error:nil];
+    XCTAssertTrue([trace[@"traceEvents"] isKindOfClass:[NSArray class]]);
+
+    return [trace[@"traceEvents"] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"name == %@", name]];
+}
+
+- (void)testSpansAreNotRecordedWhileDisabled {
+    uint64_t traceBeginTime = AFTraceBegin();
+    XCTAssertEqual(traceBeginTime, 0u);
+    AFTraceEnd(traceBeginTime, "disabled span", "test");
+
+    XCTAssertEqual([self traceEventsNamed:@"disabled span"].count, 0u);
+}
+
+- (void)testSpansAreExportedAsCompleteEvents {
+    [AFTracer sharedTracer].enabled = YES;
+
+    uint64_t traceBeginTime = AFTraceBegin();
+    [NSThread sleepForTimeInterval:0.01];
+    AFTraceEnd(traceBeginTime, "complete span", "test");
+
+    NSDictionary *event = [[self traceEventsNamed:@"complete span"] firstObject];
+    XCTAssertEqualObjects(event[@"ph"], @"X");
+    XCTAssertEqualObjects(event[@"cat"], @"test");
+    XCTAssertEqualObjects(event[@"pid"], @([[NSProcessInfo processInfo] processIdentifier]));
+    XCTAssertNotNil(event[@"tid"]);
+    XCTAssertGreaterThanOrEqual([event[@"dur"] doubleValue], 10000.0);
+}
+
+- (void)_recordSpansWithArguments:(NSArray *)arguments {
+    NSUInteger spanCount = [arguments[0] unsignedIntegerValue];
+    NSMutableDictionary <NSNumber *, NSNumber *> *expectedSpanCounts = arguments[1];
+    dispatch_group_t group = arguments[2];
+
+    for (NSUInteger index = 0; index < spanCount; index++) {
+        AFTraceEnd(AFTraceBegin(), "concurrent span", "test");
+    }
+
+    uint64_t threadIdentifier = 0;
+    pthread_threadid_np(NULL, &threadIdentifier);
+    @synchronized (expectedSpanCounts) {
+        expectedSpanCounts[@(threadIdentifier)] = @(spanCount);
+    }
+    dispatch_group_leave(group);
+}
+
+- (void)testSpansAreRecordedPerThread {
+    [AFTracer sharedTracer].enabled = YES;
+
+    // Each thread records a different number of spans, so that spans attributed to the wrong thread are noticed.
+    NSUInteger threadCount = 8;
+    NSMutableDictionary <NSNumber *, NSNumber *> *expectedSpanCounts = [NSMutableDictionary dictionary];
+    dispatch_group_t group = dispatch_group_create();
+    for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        dispatch_group_enter(group);
+        NSThread *thread = [[NSThread alloc] initWithTarget:self
+                                                   selector:@selector(_recordSpansWithArguments:)
+                                                     object:@[@(10 * (threadIndex + 1)), expectedSpanCounts, group]];
+        [thread start];
+    }
+    dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+
+    NSArray <NSDictionary *> *events = [self traceEventsNamed:@"concurrent span"];
+    NSCountedSet *spanCounts = [[NSCountedSet alloc] initWithArray:[events valueForKey:@"tid"]];
+    XCTAssertEqual(expectedSpanCounts.count, threadCount);
+    XCTAssertEqual(spanCounts.count, threadCount);
+    for (NSNumber *threadIdentifier in expectedSpanCounts) {
+        XCTAssertEqual([spanCounts countForObject:threadIdentifier], [expectedSpanCounts[threadIdentifier] unsignedIntegerValue]);
+    }
+}
+
+- (void)testOldestSpansOfAThreadAreOverwritten {
+    [AFTracer sharedTracer].enabled = YES;
+
+    dispatch_sync(dispatch_queue_create("com.alamofire.networking.test.tracing", DISPATCH_QUEUE_SERIAL), ^{
+        for (NSUInteger index = 0; index < AFTraceBufferCapacity + 10; index++) {
+            AFTraceEnd(AFTraceBegin(), "overwritten span", "test");
+        }
+    });
+
+    XCTAssertLessThanOrEqual([self traceEventsNamed:@"overwritten span"].count, AFTraceBufferCapacity);
+}
+
+- (void)testRemoveAllSpansLeavesEarlierSpansOut {
+    [AFTracer sharedTracer].enabled = YES;
+    AFTraceEnd(AFTraceBegin(), "removed span", "test");
+
+    [[AFTracer sharedTracer] removeAllSpans];
+
+    XCTAssertEqual([self traceEventsNamed:@"removed span"].count, 0u);
+}
+
+- (void)testRequestSerializationIsTraced {
+    [AFTracer sharedTracer].enabled = YES;
+
+    [[AFHTTPRequestSerializer serializer] requestWithMethod:@"GET" URLString:self.baseURL.absoluteString parameters:@{@"key": @"value"} error:nil];
+
+    XCTAssertEqual([self traceEventsNamed:@"requestBySerializingRequest:withParameters:error:"].count, 1u);
+}
+
+@end
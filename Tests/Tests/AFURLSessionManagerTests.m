@@ -31,6 +31,58 @@
 #define NSFoundationVersionNumber_With_Fixed_28588583_bug DBL_MAX
 #endif
 
+// Stands in for a file server, answering every request with 16 KB sent in four chunks.
+@interface AFURLSessionManagerTestBytesURLProtocol : NSURLProtocol
+@end
+
+@implementation AFURLSessionManagerTestBytesURLProtocol
+
++ (BOOL)canInitWithRequest:(NSURLRequest *)request {
+    return [request.URL.host isEqualToString:@"bytes.test"];
+}
+
++ (NSURLRequest *)canonicalRequestForRequest:(NSURLRequest *)request {
+    return request;
+}
+
+- (void)startLoading {
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"Content-Type": @"application/octet-stream", @"Content-Length": @"16384"}];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    for (NSUInteger index = 0; index < 4; index++) {
+        [self.client URLProtocol:self didLoadData:[NSMutableData dataWithLength:4096]];
+    }
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void)stopLoading {
+}
+
+@end
+
+
+// Rejects every response once `rejectsResponses` is set, which is not a setting the manager observes.
+@interface AFURLSessionManagerTestRejectingJSONResponseSerializer : AFJSONResponseSerializer
+@property (nonatomic, assign) BOOL rejectsResponses;
+@end
+
+@implementation AFURLSessionManagerTestRejectingJSONResponseSerializer
+
+- (BOOL)validateResponse:(NSHTTPURLResponse *)response
+                    data:(NSData *)data
+                   error:(NSError * __autoreleasing *)error
+{
+    if (self.rejectsResponses) {
+        if (error) {
+            *error = [NSError errorWithDomain:AFURLResponseSerializationErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:nil];
+        }
+
+        return NO;
+    }
+
+    return [super validateResponse:response data:data error:error];
+}
+
+@end
 
 @interface AFURLSessionManagerTests : AFTestCase
 @property (readwrite, nonatomic, strong) AFURLSessionManager *localManager;
@@ -185,6 +237,706 @@
     [self waitForExpectationsWithCommonTimeout];
 }
 
+- (void)testDownloadProgressBlockIsThrottledAndReceivesFinalUpdate {
+    self.localManager.minimumProgressReportingInterval = 60.0;
+
+    __block NSUInteger progressBlockCount = 0;
+    __block double lastFractionCompleted = 0.0;
+    NSURLSessionDownloadTask *task = [self.localManager downloadTaskWithRequest:[self _delayURLRequest]
+                                                                       progress:^(NSProgress * _Nonnull downloadProgress) {
+                                                                           progressBlockCount++;
+                                                                           lastFractionCompleted = downloadProgress.fractionCompleted;
+                                                                       }
+                                                                    destination:nil
+                                                              completionHandler:nil];
+
+    for (int64_t totalBytesWritten = 100; totalBytesWritten <= 10000; totalBytesWritten += 100) {
+        [self.localManager URLSession:self.localManager.session
+                         downloadTask:task
+                         didWriteData:100
+                    totalBytesWritten:totalBytesWritten
+            totalBytesExpectedToWrite:10000];
+    }
+
+    XCTAssertEqual(progressBlockCount, 2u);
+    XCTAssertEqual(lastFractionCompleted, 1.0);
+    [task cancel];
+}
+
+- (void)testProgressIsOnlyCreatedOnDemandButReflectsEarlierUpdates {
+    NSURLSessionDownloadTask *task = [self.localManager downloadTaskWithRequest:[self _delayURLRequest]
+                                                                       progress:nil
+                                                                    destination:nil
+                                                              completionHandler:nil];
+    [self.localManager URLSession:self.localManager.session
+                     downloadTask:task
+                     didWriteData:500
+                totalBytesWritten:500
+        totalBytesExpectedToWrite:1000];
+
+    NSProgress *progress = [self.localManager downloadProgressForTask:task];
+    XCTAssertEqual(progress.completedUnitCount, 500);
+    XCTAssertEqual(progress.totalUnitCount, 1000);
+    XCTAssertTrue(progress.isCancellable);
+    XCTAssertTrue(progress.isPausable);
+
+    [self.localManager URLSession:self.localManager.session
+                     downloadTask:task
+                     didWriteData:500
+                totalBytesWritten:1000
+        totalBytesExpectedToWrite:1000];
+    XCTAssertEqual(progress.fractionCompleted, 1.0);
+    [task cancel];
+}
+
+- (void)testTaskSetupAndProgressCallbackCost {
+    NSURLRequest *request = [self _delayURLRequest];
+    [self measureBlock:^{
+        NSMutableArray <NSURLSessionDownloadTask *> *tasks = [NSMutableArray array];
+        for (NSUInteger index = 0; index < 500; index++) {
+            NSURLSessionDownloadTask *task = [self.localManager downloadTaskWithRequest:request
+                                                                               progress:nil
+                                                                            destination:nil
+                                                                      completionHandler:nil];
+            for (int64_t totalBytesWritten = 1024; totalBytesWritten <= 64 * 1024; totalBytesWritten += 1024) {
+                [self.localManager URLSession:self.localManager.session
+                                 downloadTask:task
+                                 didWriteData:1024
+                            totalBytesWritten:totalBytesWritten
+                    totalBytesExpectedToWrite:64 * 1024];
+            }
+            [tasks addObject:task];
+        }
+
+        for (NSURLSessionDownloadTask *task in tasks) {
+            [task cancel];
+        }
+    }];
+}
+
+#pragma mark - Task Index
+
+- (void)testTasksAreIndexedByKindUntilTheyComplete {
+    NSURLSessionDataTask *dataTask = [self.localManager dataTaskWithRequest:[self _delayURLRequest]
+                                                             uploadProgress:nil
+                                                           downloadProgress:nil
+                                                          completionHandler:nil];
+    NSURLSessionUploadTask *uploadTask = [self.localManager uploadTaskWithRequest:[self _delayURLRequest]
+                                                                         fromData:[NSData data]
+                                                                         progress:nil
+                                                                completionHandler:nil];
+    NSURLSessionDownloadTask *downloadTask = [self.localManager downloadTaskWithRequest:[self _delayURLRequest]
+                                                                               progress:nil
+                                                                            destination:nil
+                                                                      completionHandler:nil];
+
+    XCTAssertEqual(self.localManager.taskCount, 3u);
+    XCTAssertEqual(self.localManager.dataTaskCount, 1u);
+    XCTAssertEqual(self.localManager.uploadTaskCount, 1u);
+    XCTAssertEqual(self.localManager.downloadTaskCount, 1u);
+    XCTAssertEqualObjects(self.localManager.dataTasks, @[dataTask]);
+    XCTAssertEqualObjects(self.localManager.uploadTasks, @[uploadTask]);
+    XCTAssertEqualObjects(self.localManager.downloadTasks, @[downloadTask]);
+    XCTAssertEqual(self.localManager.tasks.count, 3u);
+
+    [dataTask cancel];
+    [uploadTask cancel];
+    [downloadTask cancel];
+
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"taskCount == 0"] evaluatedWithObject:self.localManager handler:nil];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqual(self.localManager.tasks.count, 0u);
+}
+
+- (void)testGetTasksAsynchronouslyIncludesTasksNotCreatedByTheManager {
+    NSURLSessionDataTask *task = [self.localManager.session dataTaskWithRequest:[self _delayURLRequest]];
+    XCTAssertEqual(self.localManager.dataTaskCount, 0u);
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Tasks should be reported"];
+    [self.localManager getTasksWithCompletionHandler:^(NSArray<NSURLSessionDataTask *> * _Nonnull dataTasks, NSArray<NSURLSessionUploadTask *> * _Nonnull uploadTasks, NSArray<NSURLSessionDownloadTask *> * _Nonnull downloadTasks) {
+        XCTAssertTrue([NSThread isMainThread]);
+        XCTAssertTrue([dataTasks containsObject:task]);
+        [expectation fulfill];
+    }];
+    [self waitForExpectationsWithCommonTimeout];
+    [task cancel];
+}
+
+#pragma mark - Batch Task Creation
+
+- (void)testBatchCreatedDataTasksAreRegisteredAndComplete {
+    NSMutableArray <NSURLRequest *> *requests = [NSMutableArray array];
+    for (NSUInteger index = 0; index < 3; index++) {
+        NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"get?index=%lu", (unsigned long)index] relativeToURL:[self.baseURL URLByAppendingPathComponent:@"/"]];
+        [requests addObject:[NSURLRequest requestWithURL:url]];
+    }
+
+    NSMutableSet <NSURLSessionDataTask *> *completedTasks = [NSMutableSet set];
+    XCTestExpectation *expectation = [self expectationWithDescription:@"All tasks should complete"];
+    NSArray <NSURLSessionDataTask *> *tasks = [self.localManager dataTasksWithRequests:requests
+                                                                      completionHandler:^(NSURLSessionDataTask * _Nonnull task, NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+                                                                          XCTAssertNil(error);
+                                                                          [completedTasks addObject:task];
+                                                                          if (completedTasks.count == requests.count) {
+                                                                              [expectation fulfill];
+                                                                          }
+                                                                      }];
+
+    XCTAssertEqual(tasks.count, requests.count);
+    XCTAssertEqual(self.localManager.dataTaskCount, requests.count);
+    for (NSUInteger index = 0; index < tasks.count; index++) {
+        XCTAssertEqualObjects(tasks[index].originalRequest.URL.absoluteString, requests[index].URL.absoluteString);
+        XCTAssertNotNil([self.localManager downloadProgressForTask:tasks[index]]);
+        [tasks[index] resume];
+    }
+
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqualObjects(completedTasks, [NSSet setWithArray:tasks]);
+}
+
+#pragma mark - Delegate Lanes
+
+- (void)testDataAndDownloadTasksCompleteWhenCallbacksAreDispatchedOntoLanes {
+    self.localManager.delegateLaneCount = 4;
+
+    XCTestExpectation *dataExpectation = [self expectationWithDescription:@"Data task should complete"];
+    NSURLSessionDataTask *dataTask = [self.localManager dataTaskWithRequest:[NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"get"]]
+                                                             uploadProgress:nil
+                                                           downloadProgress:nil
+                                                          completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+                                                              XCTAssertNil(error);
+                                                              XCTAssertNotNil(responseObject);
+                                                              [dataExpectation fulfill];
+                                                          }];
+
+    NSURL *destinationURL = [[NSURL fileURLWithPath:NSTemporaryDirectory()] URLByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    XCTestExpectation *downloadExpectation = [self expectationWithDescription:@"Download task should complete"];
+    NSURLSessionDownloadTask *downloadTask = [self.localManager downloadTaskWithRequest:[NSURLRequest requestWithURL:self.pngURL]
+                                                                               progress:nil
+                                                                            destination:^NSURL * _Nonnull(NSURL * _Nonnull targetPath, NSURLResponse * _Nonnull response) {
+                                                                                return destinationURL;
+                                                                            }
+                                                                      completionHandler:^(NSURLResponse * _Nonnull response, NSURL * _Nullable filePath, NSError * _Nullable error) {
+                                                                          XCTAssertNil(error);
+                                                                          XCTAssertEqualObjects(filePath, destinationURL);
+                                                                          XCTAssertTrue([[NSFileManager defaultManager] fileExistsAtPath:destinationURL.path]);
+                                                                          [downloadExpectation fulfill];
+                                                                      }];
+
+    [dataTask resume];
+    [downloadTask resume];
+    [self waitForExpectationsWithCommonTimeout];
+    [[NSFileManager defaultManager] removeItemAtURL:destinationURL error:nil];
+}
+
+- (void)testFiveHundredParallelDownloadsCompleteWithAndWithoutDelegateLanes {
+    for (NSNumber *laneCount in @[@0, @8]) {
+        AFURLSessionManager *manager = [self _bytesManagerWithDelegateLaneCount:[laneCount unsignedIntegerValue]];
+        XCTAssertEqual([self _failureCountOfFiveHundredParallelDownloadsWithManager:manager], 0u);
+        [manager invalidateSessionCancelingTasks:YES];
+    }
+}
+
+- (void)testFiveHundredParallelDownloadsWithoutDelegateLanesPerformance {
+    AFURLSessionManager *manager = [self _bytesManagerWithDelegateLaneCount:0];
+    [self measureBlock:^{
+        [self _failureCountOfFiveHundredParallelDownloadsWithManager:manager];
+    }];
+    [manager invalidateSessionCancelingTasks:YES];
+}
+
+- (void)testFiveHundredParallelDownloadsWithEightDelegateLanesPerformance {
+    AFURLSessionManager *manager = [self _bytesManagerWithDelegateLaneCount:8];
+    [self measureBlock:^{
+        [self _failureCountOfFiveHundredParallelDownloadsWithManager:manager];
+    }];
+    [manager invalidateSessionCancelingTasks:YES];
+}
+
+#pragma mark - Task Scheduling
+
+- (NSURLSessionDataTask *)_scheduledDataTaskFulfillingExpectation:(XCTestExpectation *)expectation {
+    return [self.localManager dataTaskWithRequest:[self _delayURLRequest]
+                                   uploadProgress:nil
+                                 downloadProgress:nil
+                                completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+                                    [expectation fulfill];
+                                }];
+}
+
+- (void)testTasksAreResumedImmediatelyWithoutSchedulingLimits {
+    NSURLSessionDataTask *task = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Task should complete"]];
+
+    [self.localManager scheduleTask:task];
+    XCTAssertEqual(task.state, NSURLSessionTaskStateRunning);
+    XCTAssertEqual(self.localManager.queuedTaskCount, 0u);
+
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testPerHostLimitQueuesTasksAndReportsTheirWaitTime {
+    self.localManager.maximumActiveTasksPerHost = 1;
+
+    NSURLSessionDataTask *firstTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"First task should complete"]];
+    NSURLSessionDataTask *secondTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Second task should complete"]];
+
+    __block NSNumber *queueWaitTime = nil;
+    [self expectationForNotification:AFNetworkingTaskDidCompleteNotification object:secondTask handler:^BOOL(NSNotification * _Nonnull notification) {
+        queueWaitTime = notification.userInfo[AFNetworkingTaskDidCompleteQueueWaitTimeKey];
+        return YES;
+    }];
+
+    [self.localManager scheduleTask:firstTask];
+    [self.localManager scheduleTask:secondTask];
+    XCTAssertEqual(firstTask.state, NSURLSessionTaskStateRunning);
+    XCTAssertEqual(secondTask.state, NSURLSessionTaskStateSuspended);
+    XCTAssertEqual(self.localManager.queuedTaskCount, 1u);
+
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertNotNil(queueWaitTime);
+    XCTAssertGreaterThan(queueWaitTime.doubleValue, 0.5);
+}
+
+- (void)testHigherPriorityTasksAreStartedFirst {
+    self.localManager.maximumActiveTasks = 1;
+
+    NSMutableArray <NSURLSessionTask *> *startedTasks = [NSMutableArray array];
+    [self.localManager setTaskWillStartFromSchedulerBlock:^(NSURLSession * _Nonnull session, NSURLSessionTask * _Nonnull task, NSTimeInterval queueWaitTime) {
+        @synchronized (startedTasks) {
+            [startedTasks addObject:task];
+        }
+    }];
+
+    NSURLSessionDataTask *blockingTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Blocking task should complete"]];
+    NSURLSessionDataTask *lowPriorityTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Low priority task should complete"]];
+    NSURLSessionDataTask *highPriorityTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"High priority task should complete"]];
+
+    [self.localManager scheduleTask:blockingTask];
+    [self.localManager scheduleTask:lowPriorityTask priority:AFURLSessionTaskPriorityLow];
+    [self.localManager scheduleTask:highPriorityTask priority:AFURLSessionTaskPriorityHigh];
+    XCTAssertEqualWithAccuracy(highPriorityTask.priority, NSURLSessionTaskPriorityHigh, 0.001);
+
+    [self waitForExpectationsWithCommonTimeout];
+    NSArray *expectedOrder = @[blockingTask, highPriorityTask, lowPriorityTask];
+    XCTAssertEqualObjects(startedTasks, expectedOrder);
+}
+
+- (void)testQueuedLowPriorityTasksAgeAheadOfNewerHighPriorityTasks {
+    self.localManager.maximumActiveTasks = 1;
+    self.localManager.taskPriorityAgingInterval = 0.05;
+
+    NSMutableArray <NSURLSessionTask *> *startedTasks = [NSMutableArray array];
+    [self.localManager setTaskWillStartFromSchedulerBlock:^(NSURLSession * _Nonnull session, NSURLSessionTask * _Nonnull task, NSTimeInterval queueWaitTime) {
+        @synchronized (startedTasks) {
+            [startedTasks addObject:task];
+        }
+    }];
+
+    NSURLSessionDataTask *blockingTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Blocking task should complete"]];
+    NSURLSessionDataTask *lowPriorityTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Low priority task should complete"]];
+    NSURLSessionDataTask *highPriorityTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"High priority task should complete"]];
+
+    [self.localManager scheduleTask:blockingTask];
+    [self.localManager scheduleTask:lowPriorityTask priority:AFURLSessionTaskPriorityLow];
+    [NSThread sleepForTimeInterval:0.2];
+    [self.localManager scheduleTask:highPriorityTask priority:AFURLSessionTaskPriorityHigh];
+
+    [self waitForExpectationsWithCommonTimeout];
+    NSArray *expectedOrder = @[blockingTask, lowPriorityTask, highPriorityTask];
+    XCTAssertEqualObjects(startedTasks, expectedOrder);
+}
+
+- (void)testTaskStartsAreRateLimited {
+    self.localManager.maximumTaskStartsPerSecond = 2.0;
+
+    __block NSTimeInterval longestQueueWaitTime = 0.0;
+    [self.localManager setTaskWillStartFromSchedulerBlock:^(NSURLSession * _Nonnull session, NSURLSessionTask * _Nonnull task, NSTimeInterval queueWaitTime) {
+        longestQueueWaitTime = MAX(longestQueueWaitTime, queueWaitTime);
+    }];
+
+    for (NSUInteger index = 0; index < 4; index++) {
+        NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:[NSURLRequest requestWithURL:self.baseURL]
+                                                             uploadProgress:nil
+                                                           downloadProgress:nil
+                                                          completionHandler:nil];
+        [self.localManager scheduleTask:task];
+    }
+    XCTAssertEqual(self.localManager.queuedTaskCount, 2u);
+
+    [self expectationForPredicate:[NSPredicate predicateWithFormat:@"queuedTaskCount == 0"] evaluatedWithObject:self.localManager handler:nil];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertGreaterThan(longestQueueWaitTime, 0.8);
+}
+
+- (void)testCancellingAQueuedTaskRemovesItFromTheQueue {
+    self.localManager.maximumActiveTasks = 1;
+
+    NSURLSessionDataTask *blockingTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Blocking task should complete"]];
+    NSURLSessionDataTask *queuedTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Queued task should be cancelled"]];
+
+    [self.localManager scheduleTask:blockingTask];
+    [self.localManager scheduleTask:queuedTask];
+    XCTAssertEqual(self.localManager.queuedTaskCount, 1u);
+
+    [queuedTask cancel];
+    [self waitForExpectationsWithCommonTimeout];
+    XCTAssertEqual(self.localManager.queuedTaskCount, 0u);
+}
+
+#pragma mark - Response Object Cache
+
+- (NSData *)_largeJSONData {
+    NSMutableArray *items = [NSMutableArray array];
+    for (NSUInteger index = 0; index < 100; index++) {
+        [items addObject:@{@"index": @(index), @"name": [NSString stringWithFormat:@"item-%lu", (unsigned long)index]}];
+    }
+
+    return [NSJSONSerialization dataWithJSONObject:items options:0 error:nil];
+}
+
+- (NSHTTPURLResponse *)_JSONResponseWithHeaderFields:(NSDictionary *)headerFields {
+    NSMutableDictionary *mutableHeaderFields = [NSMutableDictionary dictionaryWithDictionary:headerFields];
+    mutableHeaderFields[@"Content-Type"] = @"application/json";
+
+    return [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:mutableHeaderFields];
+}
+
+- (void)testIdenticalResponsesReuseTheCachedResponseObject {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{@"ETag": @"\"v1\""}];
+
+    id firstResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    id secondResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    XCTAssertNotNil(firstResponseObject);
+    XCTAssertTrue(firstResponseObject == secondResponseObject);
+}
+
+- (void)testResponsesWithoutEntityTagAreKeyedByBodyDigest {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{}];
+
+    id firstResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    id secondResponseObject = [self.localManager responseObjectForResponse:response data:[data copy] error:nil];
+    XCTAssertTrue(firstResponseObject == secondResponseObject);
+
+    NSData *otherData = [NSJSONSerialization dataWithJSONObject:@[@"other", [@"" stringByPaddingToLength:2048 withString:@"x" startingAtIndex:0]] options:0 error:nil];
+    id otherResponseObject = [self.localManager responseObjectForResponse:response data:otherData error:nil];
+    XCTAssertFalse(otherResponseObject == firstResponseObject);
+}
+
+- (void)testSettingChangedSerializerInvalidatesCachedResponseObjects {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{@"ETag": @"\"v1\""}];
+
+    id firstResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    AFJSONResponseSerializer *responseSerializer = (AFJSONResponseSerializer *)self.localManager.responseSerializer;
+    responseSerializer.removesKeysWithNullValues = YES;
+    self.localManager.responseSerializer = responseSerializer;
+    id secondResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    XCTAssertFalse(firstResponseObject == secondResponseObject);
+}
+
+- (void)testChangingSerializerInPlaceInvalidatesCachedResponseObjects {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{@"ETag": @"\"v1\""}];
+
+    id firstResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    ((AFJSONResponseSerializer *)self.localManager.responseSerializer).removesKeysWithNullValues = YES;
+    id secondResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    XCTAssertFalse(firstResponseObject == secondResponseObject);
+
+    NSError *error = nil;
+    ((AFJSONResponseSerializer *)self.localManager.responseSerializer).acceptableContentTypes = [NSSet setWithObject:@"text/json"];
+    [self.localManager responseObjectForResponse:response data:data error:&error];
+    XCTAssertNotNil(error);
+}
+
+- (void)testCachedResponseObjectsAreValidatedAgain {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    AFURLSessionManagerTestRejectingJSONResponseSerializer *responseSerializer = [AFURLSessionManagerTestRejectingJSONResponseSerializer serializer];
+    self.localManager.responseSerializer = responseSerializer;
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{@"ETag": @"\"v1\""}];
+
+    NSError *error = nil;
+    XCTAssertNotNil([self.localManager responseObjectForResponse:response data:data error:&error]);
+    XCTAssertNil(error);
+
+    responseSerializer.rejectsResponses = YES;
+    [self.localManager responseObjectForResponse:response data:data error:&error];
+    XCTAssertNotNil(error);
+}
+
+- (void)testResponsesWithDifferentContentTypesAreCachedSeparately {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{@"ETag": @"\"v1\""}];
+    NSHTTPURLResponse *otherResponse = [[NSHTTPURLResponse alloc] initWithURL:self.baseURL statusCode:200 HTTPVersion:@"HTTP/1.1" headerFields:@{@"ETag": @"\"v1\"", @"Content-Type": @"text/json"}];
+
+    id firstResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    id otherResponseObject = [self.localManager responseObjectForResponse:otherResponse data:data error:nil];
+    XCTAssertNotNil(otherResponseObject);
+    XCTAssertFalse(firstResponseObject == otherResponseObject);
+}
+
+- (void)testMutableResponseObjectsAreNotCached {
+    self.localManager.responseObjectCacheCostLimit = 1024 * 1024;
+    self.localManager.responseSerializer = [AFJSONResponseSerializer serializerWithReadingOptions:NSJSONReadingMutableContainers];
+    NSData *data = [self _largeJSONData];
+    NSHTTPURLResponse *response = [self _JSONResponseWithHeaderFields:@{@"ETag": @"\"v1\""}];
+
+    id firstResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    id secondResponseObject = [self.localManager responseObjectForResponse:response data:data error:nil];
+    XCTAssertFalse(firstResponseObject == secondResponseObject);
+}
+
+#pragma mark - Task Phase Metrics
+
+- (NSNotification *)_completionNotificationOfScheduledTaskWithRequest:(NSURLRequest *)request {
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:nil];
+
+    __block NSNotification *completionNotification = nil;
+    [self expectationForNotification:AFNetworkingTaskDidCompleteNotification object:task handler:^BOOL(NSNotification * _Nonnull notification) {
+        completionNotification = notification;
+        return YES;
+    }];
+
+    [self.localManager scheduleTask:task];
+    [self waitForExpectationsWithCommonTimeout];
+
+    return completionNotification;
+}
+
+- (void)testTaskPhaseMetricsAreCollectedWhenEnabled {
+    self.localManager.collectsTaskPhaseMetrics = YES;
+
+    __block AFURLSessionTaskPhaseMetrics *blockMetrics = nil;
+    [self.localManager setTaskDidFinishCollectingPhaseMetricsBlock:^(NSURLSession * _Nonnull session, NSURLSessionTask * _Nonnull task, AFURLSessionTaskPhaseMetrics * _Nonnull metrics) {
+        blockMetrics = metrics;
+    }];
+
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"get"]];
+    NSNotification *notification = [self _completionNotificationOfScheduledTaskWithRequest:request];
+
+    AFURLSessionTaskPhaseMetrics *metrics = notification.userInfo[AFNetworkingTaskDidCompletePhaseMetricsKey];
+    XCTAssertNotNil(metrics);
+    XCTAssertEqual(metrics, blockMetrics);
+    XCTAssertEqualObjects(metrics.host, self.baseURL.host);
+    XCTAssertGreaterThanOrEqual([metrics durationOfPhase:AFURLSessionTaskPhaseQueueWait], 0.0);
+    XCTAssertGreaterThanOrEqual([metrics durationOfPhase:AFURLSessionTaskPhaseProcessingQueueWait], 0.0);
+    XCTAssertGreaterThanOrEqual([metrics durationOfPhase:AFURLSessionTaskPhaseResponseSerialization], 0.0);
+    XCTAssertGreaterThanOrEqual([metrics durationOfPhase:AFURLSessionTaskPhaseCompletionDelivery], 0.0);
+
+    AFURLSessionMetricsSnapshot *snapshot = [self.localManager.taskPhaseMetricsRecorder snapshot];
+    XCTAssertEqual([snapshot histogramForPhase:AFURLSessionTaskPhaseResponseSerialization host:self.baseURL.host].count, 1u);
+}
+
+- (void)testTaskPhaseMetricsAreNotCollectedByDefault {
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"get"]];
+    NSNotification *notification = [self _completionNotificationOfScheduledTaskWithRequest:request];
+
+    XCTAssertNil(notification.userInfo[AFNetworkingTaskDidCompletePhaseMetricsKey]);
+    XCTAssertEqual([self.localManager.taskPhaseMetricsRecorder snapshot].hosts.count, 0u);
+}
+
+#pragma mark - Deferred Response Serialization
+
+- (void)testResponseSerializationIsDeferredWhenEnabled {
+    self.localManager.defersResponseSerialization = YES;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should succeed"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"get"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertNil(error);
+        XCTAssert([responseObject isKindOfClass:[AFLazyResponseObject class]]);
+
+        AFLazyResponseObject *lazyResponseObject = responseObject;
+        XCTAssertFalse(lazyResponseObject.isSerialized);
+        XCTAssert([[lazyResponseObject responseObjectWithError:nil] isKindOfClass:[NSDictionary class]]);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testResponseSerializationIsNotDeferredForInvalidResponses {
+    self.localManager.defersResponseSerialization = YES;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should fail"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"status/404"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertNotNil(error);
+        XCTAssertFalse([responseObject isKindOfClass:[AFLazyResponseObject class]]);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+#pragma mark - Response Validation on Receipt
+
+- (void)testRejectedResponseFailsWithValidationErrorWhenValidatedOnReceipt {
+    self.localManager.validatesResponsesOnReceipt = YES;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should fail"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"status/500"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertEqualObjects(error.domain, AFURLResponseSerializationErrorDomain);
+        XCTAssertEqual(error.code, NSURLErrorBadServerResponse);
+        XCTAssertEqualObjects(error.userInfo[AFNetworkingOperationFailingURLResponseErrorKey], response);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testResponseDataIsLimitedToMaximumResponseDataLength {
+    AFHTTPResponseSerializer *responseSerializer = [AFHTTPResponseSerializer serializer];
+    responseSerializer.maximumResponseDataLength = 1024;
+    self.localManager.responseSerializer = responseSerializer;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should fail"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"bytes/65536"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertEqualObjects(error.domain, AFURLResponseSerializationErrorDomain);
+        XCTAssertEqual(error.code, NSURLErrorDataLengthExceedsMaximum);
+        XCTAssertEqual([error.userInfo[AFNetworkingOperationFailingURLResponseDataErrorKey] length], 1024u);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+#pragma mark - Large Responses
+
+- (void)testResponseDataAboveMaximumInMemoryLengthIsWrittenToFile {
+    self.localManager.responseSerializer = [AFHTTPResponseSerializer serializer];
+    self.localManager.maximumInMemoryResponseDataLength = 1024;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should succeed"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"stream-bytes/65536"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertNil(error);
+        XCTAssertEqual([responseObject length], 65536u);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testDataTaskWithContentLengthAboveMaximumInMemoryLengthBecomesDownloadTask {
+    self.localManager.responseSerializer = [AFHTTPResponseSerializer serializer];
+    self.localManager.maximumInMemoryResponseDataLength = 1024;
+
+    __block NSURLSessionDownloadTask *downloadTask = nil;
+    [self.localManager setDataTaskDidBecomeDownloadTaskBlock:^(NSURLSession * _Nonnull session, NSURLSessionDataTask * _Nonnull dataTask, NSURLSessionDownloadTask * _Nonnull task) {
+        downloadTask = task;
+    }];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should succeed"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"bytes/65536"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertNil(error);
+        XCTAssertEqual([responseObject length], 65536u);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertNotNil(downloadTask);
+}
+
+- (void)testScheduledTaskSlotIsReleasedWhenDataTaskBecomesDownloadTask {
+    self.localManager.responseSerializer = [AFHTTPResponseSerializer serializer];
+    self.localManager.maximumInMemoryResponseDataLength = 1024;
+    self.localManager.maximumActiveTasks = 1;
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should succeed"];
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"bytes/65536"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request uploadProgress:nil downloadProgress:nil completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+        XCTAssertNil(error);
+        [expectation fulfill];
+    }];
+
+    [self.localManager scheduleTask:task];
+    [self waitForExpectationsWithCommonTimeout];
+
+    NSURLSessionDataTask *secondTask = [self _scheduledDataTaskFulfillingExpectation:[self expectationWithDescription:@"Second task should complete"]];
+    [self.localManager scheduleTask:secondTask];
+    XCTAssertNotEqual(secondTask.state, NSURLSessionTaskStateSuspended);
+    XCTAssertEqual(self.localManager.queuedTaskCount, 0u);
+
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+#pragma mark - Streaming Data Tasks
+
+- (void)testChunksAreHandledInOrderBeforeCompletion {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should complete"];
+    __block NSUInteger receivedLength = 0;
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"stream-bytes/65536"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request highWatermark:0 lowWatermark:0 chunkHandler:^(NSData * _Nonnull chunk) {
+        receivedLength += chunk.length;
+    } completionHandler:^(NSURLResponse * _Nonnull response, NSError * _Nullable error) {
+        XCTAssertNil(error);
+        XCTAssertEqual(receivedLength, 65536u);
+        [expectation fulfill];
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+}
+
+- (void)testTaskIsSuspendedWhenPendingChunksExceedHighWatermark {
+    XCTestExpectation *expectation = [self expectationWithDescription:@"Request should complete"];
+    __block NSUInteger receivedLength = 0;
+    NSURLRequest *request = [NSURLRequest requestWithURL:[self.baseURL URLByAppendingPathComponent:@"stream-bytes/262144"]];
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:request highWatermark:1024 lowWatermark:0 chunkHandler:^(NSData * _Nonnull chunk) {
+        usleep(10000);
+        receivedLength += chunk.length;
+    } completionHandler:^(NSURLResponse * _Nonnull response, NSError * _Nullable error) {
+        XCTAssertNil(error);
+        XCTAssertEqual(receivedLength, 262144u);
+        [expectation fulfill];
+    }];
+
+    __block NSUInteger suspendCount = 0;
+    __block NSUInteger resumeCount = 0;
+    id suspendObserver = [[NSNotificationCenter defaultCenter] addObserverForName:AFNetworkingTaskDidSuspendNotification object:task queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+        suspendCount++;
+    }];
+    id resumeObserver = [[NSNotificationCenter defaultCenter] addObserverForName:AFNetworkingTaskDidResumeNotification object:task queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+        resumeCount++;
+    }];
+
+    [task resume];
+    [self waitForExpectationsWithCommonTimeout];
+
+    // Notifications are posted on the main queue, so draining it delivers those of the last resume.
+    XCTestExpectation *drainExpectation = [self expectationWithDescription:@"Main queue should drain"];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [drainExpectation fulfill];
+    });
+    [self waitForExpectationsWithCommonTimeout];
+
+    [[NSNotificationCenter defaultCenter] removeObserver:suspendObserver];
+    [[NSNotificationCenter defaultCenter] removeObserver:resumeObserver];
+
+    XCTAssertGreaterThan(suspendCount, 0u);
+    XCTAssertEqual(resumeCount, suspendCount + 1);
+    XCTAssertEqual(task.state, NSURLSessionTaskStateCompleted);
+}
+
 #pragma mark - rdar://17029580
 
 - (void)testRDAR17029580IsFixed {
@@ -330,6 +1082,37 @@
     }
 }
 
+- (void)testResumeAndSuspendNotificationsAreNotPostedWhenDisabled {
+    self.localManager.postsTaskResumeAndSuspendNotifications = NO;
+    NSURLSessionDataTask *task = [self.localManager dataTaskWithRequest:[self _delayURLRequest]
+                                                         uploadProgress:nil
+                                                       downloadProgress:nil
+                                                      completionHandler:nil];
+
+    __block NSUInteger notificationCount = 0;
+    id resumeObserver = [[NSNotificationCenter defaultCenter] addObserverForName:AFNetworkingTaskDidResumeNotification object:task queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+        notificationCount++;
+    }];
+    id suspendObserver = [[NSNotificationCenter defaultCenter] addObserverForName:AFNetworkingTaskDidSuspendNotification object:task queue:nil usingBlock:^(NSNotification * _Nonnull note) {
+        notificationCount++;
+    }];
+
+    [task resume];
+    [task suspend];
+    [task resume];
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"main queue should drain"];
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(0.5 * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithCommonTimeout];
+
+    XCTAssertEqual(notificationCount, 0u);
+    [[NSNotificationCenter defaultCenter] removeObserver:resumeObserver];
+    [[NSNotificationCenter defaultCenter] removeObserver:suspendObserver];
+    [task cancel];
+}
+
 - (void)testSwizzlingIsProperlyConfiguredForDummyClass {
     IMP originalAFResumeIMP = [self _originalAFResumeImplementation];
     IMP originalAFSuspendIMP = [self _originalAFSuspendImplementation];
@@ -431,6 +1214,36 @@
     }
 }
 
+#pragma mark - Task Delegate Registry
+
+- (void)testTaskDelegateLookupContentionOnOneThread {
+    [self _measureDelegateLookupsOnThreadCount:1];
+}
+
+- (void)testTaskDelegateLookupContentionOnTwoThreads {
+    [self _measureDelegateLookupsOnThreadCount:2];
+}
+
+- (void)testTaskDelegateLookupContentionOnFourThreads {
+    [self _measureDelegateLookupsOnThreadCount:4];
+}
+
+- (void)testTaskDelegateLookupContentionOnEightThreads {
+    [self _measureDelegateLookupsOnThreadCount:8];
+}
+
+- (void)testTaskDelegateLookupContentionOnSixteenThreads {
+    [self _measureDelegateLookupsOnThreadCount:16];
+}
+
+- (void)testTaskDelegateLookupContentionOnThirtyTwoThreads {
+    [self _measureDelegateLookupsOnThreadCount:32];
+}
+
+- (void)testTaskDelegateLookupContentionOnSixtyFourThreads {
+    [self _measureDelegateLookupsOnThreadCount:64];
+}
+
 #pragma mark - private
 
 - (void)_testResumeNotificationForTask:(NSURLSessionTask *)task {
@@ -455,6 +1268,85 @@
     [task cancel];
 }
 
+- (void)_measureDelegateLookupsOnThreadCount:(NSUInteger)threadCount {
+    NSMutableArray <NSURLSessionDataTask *> *tasks = [NSMutableArray array];
+    for (NSUInteger index = 0; index < 256; index++) {
+        [tasks addObject:[self.localManager dataTaskWithRequest:[self _delayURLRequest]
+                                                 uploadProgress:nil
+                                               downloadProgress:nil
+                                              completionHandler:nil]];
+    }
+
+    NSUInteger lookupsPerThread = 20000;
+    [self measureBlock:^{
+        dispatch_group_t group = dispatch_group_create();
+        for (NSUInteger threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+            dispatch_group_enter(group);
+            NSThread *thread = [[NSThread alloc] initWithTarget:self
+                                                       selector:@selector(_lookUpDelegatesWithArguments:)
+                                                         object:@[tasks, @(lookupsPerThread), group]];
+            [thread start];
+        }
+        dispatch_group_wait(group, DISPATCH_TIME_FOREVER);
+    }];
+
+    for (NSURLSessionDataTask *task in tasks) {
+        XCTAssertNotNil([self.localManager downloadProgressForTask:task]);
+        [task cancel];
+    }
+}
+
+- (void)_lookUpDelegatesWithArguments:(NSArray *)arguments {
+    @autoreleasepool {
+        NSArray <NSURLSessionTask *> *tasks = arguments[0];
+        NSUInteger lookups = [arguments[1] unsignedIntegerValue];
+        dispatch_group_t group = arguments[2];
+        for (NSUInteger index = 0; index < lookups; index++) {
+            [self.localManager downloadProgressForTask:tasks[index % tasks.count]];
+        }
+        dispatch_group_leave(group);
+    }
+}
+
+- (AFURLSessionManager *)_bytesManagerWithDelegateLaneCount:(NSUInteger)laneCount {
+    NSURLSessionConfiguration *configuration = [NSURLSessionConfiguration ephemeralSessionConfiguration];
+    configuration.protocolClasses = @[[AFURLSessionManagerTestBytesURLProtocol class]];
+    AFURLSessionManager *manager = [[AFURLSessionManager alloc] initWithSessionConfiguration:configuration];
+    manager.responseSerializer = [AFHTTPResponseSerializer serializer];
+    manager.delegateLaneCount = laneCount;
+    [manager setDataTaskDidReceiveDataBlock:^(NSURLSession * _Nonnull session, NSURLSessionDataTask * _Nonnull dataTask, NSData * _Nonnull data) {
+        // Stands in for a slow consumer of each chunk
+        usleep(200);
+    }];
+    return manager;
+}
+
+- (NSUInteger)_failureCountOfFiveHundredParallelDownloadsWithManager:(AFURLSessionManager *)manager {
+    NSURLRequest *request = [NSURLRequest requestWithURL:[NSURL URLWithString:@"http://bytes.test/bytes/16384"]];
+    __block NSUInteger failureCount = 0;
+    dispatch_group_t group = dispatch_group_create();
+    for (NSUInteger index = 0; index < 500; index++) {
+        dispatch_group_enter(group);
+        NSURLSessionDataTask *task = [manager dataTaskWithRequest:request
+                                                   uploadProgress:nil
+                                                 downloadProgress:nil
+                                                completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+                                                    if (error || [responseObject length] != 16384) {
+                                                        failureCount++;
+                                                    }
+                                                    dispatch_group_leave(group);
+                                                }];
+        [task resume];
+    }
+
+    XCTestExpectation *expectation = [self expectationWithDescription:@"All downloads should complete"];
+    dispatch_group_notify(group, dispatch_get_main_queue(), ^{
+        [expectation fulfill];
+    });
+    [self waitForExpectationsWithTimeout:120.0 handler:nil];
+    return failureCount;
+}
+
 - (NSURLRequest *)_delayURLRequest {
     return [NSURLRequest requestWithURL:self.delayURL];
 }
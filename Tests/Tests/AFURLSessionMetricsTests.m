@@ -0,0 +1,100 @@
+// AFURLSessionMetricsTests.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFTestCase.h"
+#import "AFURLSessionMetrics.h"
+
+@interface AFURLSessionMetricsTests : AFTestCase
+@property (nonatomic, strong) AFURLSessionMetricsRecorder *recorder;
+@end
+
+@implementation AFURLSessionMetricsTests
+
+- (void)setUp {
+    [super setUp];
+    self.recorder = [[AFURLSessionMetricsRecorder alloc] init];
+}
+
+- (void)recordDuration:(NSTimeInterval)duration ofPhase:(AFURLSessionTaskPhase)phase host:(NSString *)host {
+    AFURLSessionTaskPhaseMetrics *metrics = [[AFURLSessionTaskPhaseMetrics alloc] initWithHost:host];
+    [metrics recordDuration:duration forPhase:phase];
+    [self.recorder recordPhaseMetrics:metrics];
+}
+
+- (void)testUnmeasuredPhasesHaveNegativeDuration {
+    AFURLSessionTaskPhaseMetrics *metrics = [[AFURLSessionTaskPhaseMetrics alloc] initWithHost:nil];
+    [metrics recordDuration:0.25 forPhase:AFURLSessionTaskPhaseTimeToFirstByte];
+
+    XCTAssertEqualObjects(metrics.host, @"");
+    XCTAssertEqualWithAccuracy([metrics durationOfPhase:AFURLSessionTaskPhaseTimeToFirstByte], 0.25, 0.0001);
+    XCTAssertLessThan([metrics durationOfPhase:AFURLSessionTaskPhaseConnect], 0.0);
+}
+
+- (void)testPercentilesAreWithinBucketPrecision {
+    for (NSUInteger index = 1; index <= 1000; index++) {
+        [self recordDuration:index / 1000.0 ofPhase:AFURLSessionTaskPhaseTimeToFirstByte host:@"example.com"];
+    }
+
+    AFLatencyHistogram *histogram = [[self.recorder snapshot] histogramForPhase:AFURLSessionTaskPhaseTimeToFirstByte host:@"example.com"];
+    XCTAssertEqual(histogram.count, 1000u);
+    XCTAssertEqualWithAccuracy(histogram.minimum, 0.001, 0.000001);
+    XCTAssertEqualWithAccuracy(histogram.maximum, 1.0, 0.000001);
+    XCTAssertEqualWithAccuracy(histogram.mean, 0.5005, 0.0001);
+    XCTAssertEqualWithAccuracy([histogram valueAtPercentile:50.0], 0.5, 0.5 * 0.07);
+    XCTAssertEqualWithAccuracy([histogram valueAtPercentile:99.0], 0.99, 0.99 * 0.07);
+    XCTAssertEqualWithAccuracy([histogram valueAtPercentile:100.0], 1.0, 0.000001);
+}
+
+- (void)testHistogramsAreKeptPerHostAndMerged {
+    [self recordDuration:0.010 ofPhase:AFURLSessionTaskPhaseConnect host:@"a.example.com"];
+    [self recordDuration:0.030 ofPhase:AFURLSessionTaskPhaseConnect host:@"b.example.com"];
+
+    AFURLSessionMetricsSnapshot *snapshot = [self.recorder snapshot];
+    XCTAssertEqualObjects([NSSet setWithArray:snapshot.hosts], ([NSSet setWithObjects:@"a.example.com", @"b.example.com", nil]));
+    XCTAssertEqual([snapshot histogramForPhase:AFURLSessionTaskPhaseConnect host:@"a.example.com"].count, 1u);
+    XCTAssertEqual([snapshot histogramForPhase:AFURLSessionTaskPhaseDomainLookup host:@"a.example.com"].count, 0u);
+    XCTAssertNil([snapshot histogramForPhase:AFURLSessionTaskPhaseConnect host:@"c.example.com"]);
+
+    AFLatencyHistogram *mergedHistogram = [snapshot histogramForPhase:AFURLSessionTaskPhaseConnect host:nil];
+    XCTAssertEqual(mergedHistogram.count, 2u);
+    XCTAssertEqualWithAccuracy(mergedHistogram.minimum, 0.010, 0.000001);
+    XCTAssertEqualWithAccuracy(mergedHistogram.maximum, 0.030, 0.000001);
+    XCTAssertEqualWithAccuracy(mergedHistogram.mean, 0.020, 0.000001);
+}
+
+- (void)testConcurrentRecordingIsNotLost {
+    dispatch_apply(1000, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t iteration) {
+        [self recordDuration:(iteration % 10 + 1) / 100.0 ofPhase:AFURLSessionTaskPhaseBodyTransfer host:(iteration % 2 ? @"a.example.com" : @"b.example.com")];
+    });
+
+    XCTAssertEqual([[self.recorder snapshot] histogramForPhase:AFURLSessionTaskPhaseBodyTransfer host:nil].count, 1000u);
+}
+
+- (void)testResetRemovesRecordedDurations {
+    [self recordDuration:0.010 ofPhase:AFURLSessionTaskPhaseConnect host:@"example.com"];
+    [self.recorder reset];
+
+    AFLatencyHistogram *histogram = [[self.recorder snapshot] histogramForPhase:AFURLSessionTaskPhaseConnect host:@"example.com"];
+    XCTAssertEqual(histogram.count, 0u);
+    XCTAssertEqual([histogram valueAtPercentile:50.0], 0.0);
+}
+
+@end
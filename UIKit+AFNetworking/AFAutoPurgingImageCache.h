@@ -104,7 +104,9 @@ NS_ASSUME_NONNULL_BEGIN
 @end
 
 /**
- The `AutoPurgingImageCache` in an in-memory image cache used to store images up to a given memory capacity. When the memory capacity is reached, the image cache is sorted by last access date, then the oldest image is continuously purged until the preferred memory usage after purge is met. Each time an image is accessed through the cache, the internal access date of the image is updated.
+ The `AutoPurgingImageCache` in an in-memory image cache used to store images up to a given memory capacity. When the memory capacity is reached, the image cache is sorted by last access date, then the oldest image is continuously purged until the preferred memory usage after purge is met. Each time an image is accessed through the cache, the internal access date of the image is updated. An optional `diskCache` can be set to keep images across relaunches and memory warnings.
+
+ Images are stored under a 128-bit digest of their identifier rather than the identifier itself, so long URLs do not cost more memory than the images they identify.
  */
 @interface AFAutoPurgingImageCache : NSObject <AFImageRequestCache>
 
@@ -123,6 +125,20 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property (nonatomic, assign, readonly) UInt64 memoryUsage;
 
+/**
+ The second level cache consulted when an image is not found in memory, typically an `AFDiskImageCache`. Images added to the cache are also added to the disk cache, and images found in the disk cache are promoted back into memory. `nil` by default.
+
+ When a memory warning is received, only the in-memory images are purged, so that they can be restored from the disk cache without being decoded again.
+ */
+@property (nonatomic, strong, nullable) id <AFImageCache> diskCache;
+
+/**
+ Whether the cache uses the access frequency of images to decide which images to keep during a purge. `NO` by default.
+
+ When enabled, the cache records how often each identifier is requested in a compact, periodically aged frequency sketch. Images added since the last purge are then only admitted if they are requested more often than the least recently used images they would replace, in the manner of W-TinyLFU. This keeps frequently used images cached while a one-time scroll through a long list passes through the cache.
+ */
+@property (nonatomic, assign) BOOL usesFrequencyBasedAdmission;
+
 /**
  Initialies the `AutoPurgingImageCache` instance with default values for memory capacity and preferred memory usage after purge limit. `memoryCapcity` defaults to `100 MB`. `preferredMemoryUsageAfterPurge` defaults to `60 MB`.
 
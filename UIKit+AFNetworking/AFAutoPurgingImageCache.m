@@ -24,23 +24,136 @@
 #if TARGET_OS_IOS || TARGET_OS_TV 
 
 #import "AFAutoPurgingImageCache.h"
+#import "AFTracing.h"
+#import <CommonCrypto/CommonDigest.h>
+
+@interface AFImageCacheKey : NSObject <NSCopying>
+
+@property (nonatomic, assign, readonly) uint64_t firstHalf;
+@property (nonatomic, assign, readonly) uint64_t secondHalf;
+
+@end
+
+@implementation AFImageCacheKey
+
+- (instancetype)initWithIdentifier:(NSString *)identifier {
+    if (self = [super init]) {
+        uint64_t digest[2];
+        NSData *data = [identifier dataUsingEncoding:NSUTF8StringEncoding];
+        CC_MD5(data.bytes, (CC_LONG)data.length, (unsigned char *)digest);
+        _firstHalf = digest[0];
+        _secondHalf = digest[1];
+    }
+    return self;
+}
+
+- (id)copyWithZone:(NSZone *)zone {
+    return self;
+}
+
+- (NSUInteger)hash {
+    return (NSUInteger)self.firstHalf;
+}
+
+- (BOOL)isEqual:(id)object {
+    if (object == self) {
+        return YES;
+    }
+    if (![object isKindOfClass:[AFImageCacheKey class]]) {
+        return NO;
+    }
+    AFImageCacheKey *key = (AFImageCacheKey *)object;
+    return self.firstHalf == key.firstHalf && self.secondHalf == key.secondHalf;
+}
+
+- (NSString *)description {
+    return [NSString stringWithFormat:@"%016llx%016llx", self.firstHalf, self.secondHalf];
+}
+
+@end
+
+enum {
+    AFImageCacheFrequencySketchDepth = 4,
+    AFImageCacheFrequencySketchWidth = 4096,
+};
+static uint8_t const AFImageCacheFrequencySketchMaximumCount = 15;
+
+/**
+ A count-min sketch of how often keys were requested. Counters saturate at 15 and are all halved once the number of recorded accesses reaches ten times the width of the sketch, so that images which used to be popular eventually make room for new ones.
+ */
+@interface AFImageCacheFrequencySketch : NSObject
+@property (nonatomic, strong) NSLock *lock;
+@property (nonatomic, assign) NSUInteger additions;
+@end
+
+@implementation AFImageCacheFrequencySketch {
+    uint8_t _counters[AFImageCacheFrequencySketchDepth][AFImageCacheFrequencySketchWidth];
+}
+
+- (instancetype)init {
+    if (self = [super init]) {
+        self.lock = [[NSLock alloc] init];
+    }
+    return self;
+}
+
+static inline NSUInteger AFImageCacheFrequencySketchIndex(AFImageCacheKey *key, NSUInteger row) {
+    return (NSUInteger)((key.firstHalf + (uint64_t)row * (key.secondHalf | 1)) & (AFImageCacheFrequencySketchWidth - 1));
+}
+
+- (void)recordAccessForKey:(AFImageCacheKey *)key {
+    [self.lock lock];
+    for (NSUInteger row = 0; row < AFImageCacheFrequencySketchDepth; row++) {
+        uint8_t *counter = &_counters[row][AFImageCacheFrequencySketchIndex(key, row)];
+        if (*counter < AFImageCacheFrequencySketchMaximumCount) {
+            *counter += 1;
+        }
+    }
+    self.additions += 1;
+    if (self.additions >= AFImageCacheFrequencySketchWidth * 10) {
+        for (NSUInteger row = 0; row < AFImageCacheFrequencySketchDepth; row++) {
+            for (NSUInteger column = 0; column < AFImageCacheFrequencySketchWidth; column++) {
+                _counters[row][column] >>= 1;
+            }
+        }
+        self.additions /= 2;
+    }
+    [self.lock unlock];
+}
+
+- (NSDictionary <AFImageCacheKey*, NSNumber*> *)frequenciesForKeys:(NSArray <AFImageCacheKey*> *)keys {
+    NSMutableDictionary <AFImageCacheKey*, NSNumber*> *frequencies = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+    [self.lock lock];
+    for (AFImageCacheKey *key in keys) {
+        uint8_t frequency = AFImageCacheFrequencySketchMaximumCount;
+        for (NSUInteger row = 0; row < AFImageCacheFrequencySketchDepth; row++) {
+            frequency = MIN(frequency, _counters[row][AFImageCacheFrequencySketchIndex(key, row)]);
+        }
+        frequencies[key] = @(frequency);
+    }
+    [self.lock unlock];
+    return frequencies;
+}
+
+@end
 
 @interface AFCachedImage : NSObject
 
 @property (nonatomic, strong) UIImage *image;
-@property (nonatomic, strong) NSString *identifier;
+@property (nonatomic, strong) AFImageCacheKey *key;
 @property (nonatomic, assign) UInt64 totalBytes;
 @property (nonatomic, strong) NSDate *lastAccessDate;
 @property (nonatomic, assign) UInt64 currentMemoryUsage;
+@property (nonatomic, assign, getter=isAdmitted) BOOL admitted;
 
 @end
 
 @implementation AFCachedImage
 
--(instancetype)initWithImage:(UIImage *)image identifier:(NSString *)identifier {
+-(instancetype)initWithImage:(UIImage *)image key:(AFImageCacheKey *)key {
     if (self = [self init]) {
         self.image = image;
-        self.identifier = identifier;
+        self.key = key;
 
         CGSize imageSize = CGSizeMake(image.size.width * image.scale, image.size.height * image.scale);
         CGFloat bytesPerPixel = 4.0;
@@ -57,7 +170,7 @@
 }
 
 - (NSString *)description {
-    NSString *descriptionString = [NSString stringWithFormat:@"Idenfitier: %@  lastAccessDate: %@ ", self.identifier, self.lastAccessDate];
+    NSString *descriptionString = [NSString stringWithFormat:@"Key: %@  lastAccessDate: %@ ", self.key, self.lastAccessDate];
     return descriptionString;
 
 }
@@ -65,9 +178,10 @@
 @end
 
 @interface AFAutoPurgingImageCache ()
-@property (nonatomic, strong) NSMutableDictionary <NSString* , AFCachedImage*> *cachedImages;
+@property (nonatomic, strong) NSMutableDictionary <AFImageCacheKey* , AFCachedImage*> *cachedImages;
 @property (nonatomic, assign) UInt64 currentMemoryUsage;
 @property (nonatomic, strong) dispatch_queue_t synchronizationQueue;
+@property (nonatomic, strong) AFImageCacheFrequencySketch *frequencySketch;
 @end
 
 @implementation AFAutoPurgingImageCache
@@ -87,7 +201,7 @@
 
         [[NSNotificationCenter defaultCenter]
          addObserver:self
-         selector:@selector(removeAllImages)
+         selector:@selector(removeAllInMemoryImages)
          name:UIApplicationDidReceiveMemoryWarningNotification
          object:nil];
 
@@ -99,6 +213,16 @@
     [[NSNotificationCenter defaultCenter] removeObserver:self];
 }
 
+- (void)setUsesFrequencyBasedAdmission:(BOOL)usesFrequencyBasedAdmission {
+    // The sketch is only allocated once admission is enabled, and is read on the synchronization queue.
+    dispatch_barrier_sync(self.synchronizationQueue, ^{
+        if (usesFrequencyBasedAdmission && self.frequencySketch == nil) {
+            self.frequencySketch = [[AFImageCacheFrequencySketch alloc] init];
+        }
+        self->_usesFrequencyBasedAdmission = usesFrequencyBasedAdmission;
+    });
+}
+
 - (UInt64)memoryUsage {
     __block UInt64 result = 0;
     dispatch_sync(self.synchronizationQueue, ^{
@@ -108,54 +232,137 @@
 }
 
 - (void)addImage:(UIImage *)image withIdentifier:(NSString *)identifier {
+    [self addInMemoryImage:image withIdentifier:identifier];
+    [self.diskCache addImage:image withIdentifier:identifier];
+}
+
+- (void)addInMemoryImage:(UIImage *)image withIdentifier:(NSString *)identifier {
+    AFImageCacheKey *key = [[AFImageCacheKey alloc] initWithIdentifier:identifier];
     dispatch_barrier_async(self.synchronizationQueue, ^{
-        AFCachedImage *cacheImage = [[AFCachedImage alloc] initWithImage:image identifier:identifier];
+        AFCachedImage *cacheImage = [[AFCachedImage alloc] initWithImage:image key:key];
 
-        AFCachedImage *previousCachedImage = self.cachedImages[identifier];
+        AFCachedImage *previousCachedImage = self.cachedImages[key];
         if (previousCachedImage != nil) {
             self.currentMemoryUsage -= previousCachedImage.totalBytes;
         }
 
-        self.cachedImages[identifier] = cacheImage;
+        self.cachedImages[key] = cacheImage;
         self.currentMemoryUsage += cacheImage.totalBytes;
     });
 
     dispatch_barrier_async(self.synchronizationQueue, ^{
         if (self.currentMemoryUsage > self.memoryCapacity) {
+            uint64_t traceBeginTime = AFTraceBegin();
             UInt64 bytesToPurge = self.currentMemoryUsage - self.preferredMemoryUsageAfterPurge;
-            NSMutableArray <AFCachedImage*> *sortedImages = [NSMutableArray arrayWithArray:self.cachedImages.allValues];
-            NSSortDescriptor *sortDescriptor = [[NSSortDescriptor alloc] initWithKey:@"lastAccessDate"
-                                                                           ascending:YES];
-            [sortedImages sortUsingDescriptors:@[sortDescriptor]];
-
             UInt64 bytesPurged = 0;
 
-            for (AFCachedImage *cachedImage in sortedImages) {
-                [self.cachedImages removeObjectForKey:cachedImage.identifier];
-                bytesPurged += cachedImage.totalBytes;
-                if (bytesPurged >= bytesToPurge) {
-                    break ;
+            if (self.usesFrequencyBasedAdmission) {
+                bytesPurged = [self purgeImagesByAccessFrequency:bytesToPurge];
+            } else {
+                NSMutableArray <AFCachedImage*> *sortedImages = [NSMutableArray arrayWithArray:self.cachedImages.allValues];
+                NSSortDescriptor *sortDescriptor = [[NSSortDescriptor alloc] initWithKey:@"lastAccessDate"
+                                                                               ascending:YES];
+                [sortedImages sortUsingDescriptors:@[sortDescriptor]];
+
+                for (AFCachedImage *cachedImage in sortedImages) {
+                    [self.cachedImages removeObjectForKey:cachedImage.key];
+                    bytesPurged += cachedImage.totalBytes;
+                    if (bytesPurged >= bytesToPurge) {
+                        break ;
+                    }
                 }
             }
             self.currentMemoryUsage -= bytesPurged;
+            AFTraceEnd(traceBeginTime, "image memory cache purge", "cache");
         }
     });
 }
 
+//This method should only be called from safely within the synchronizationQueue
+- (UInt64)purgeImagesByAccessFrequency:(UInt64)bytesToPurge {
+    NSMutableArray <AFCachedImage*> *candidateImages = [NSMutableArray array];
+    NSMutableArray <AFCachedImage*> *admittedImages = [NSMutableArray array];
+    for (AFCachedImage *cachedImage in self.cachedImages.objectEnumerator) {
+        if (cachedImage.isAdmitted) {
+            [admittedImages addObject:cachedImage];
+        } else {
+            [candidateImages addObject:cachedImage];
+        }
+    }
+    NSSortDescriptor *sortDescriptor = [[NSSortDescriptor alloc] initWithKey:@"lastAccessDate" ascending:YES];
+    [admittedImages sortUsingDescriptors:@[sortDescriptor]];
+    // Take the sketch lock once for all images rather than on every comparison.
+    NSDictionary <AFImageCacheKey*, NSNumber*> *frequencies = [self.frequencySketch frequenciesForKeys:self.cachedImages.allKeys];
+    [candidateImages sortUsingComparator:^NSComparisonResult(AFCachedImage *image1, AFCachedImage *image2) {
+        NSComparisonResult result = [frequencies[image1.key] compare:frequencies[image2.key]];
+        if (result != NSOrderedSame) {
+            return result;
+        }
+        return [image1.lastAccessDate compare:image2.lastAccessDate];
+    }];
+
+    // Images added since the last purge, least requested first, compete with the least recently used admitted images.
+    // Whichever was requested less often is evicted, and the new image loses ties.
+    UInt64 bytesPurged = 0;
+    NSUInteger candidateIndex = 0;
+    NSUInteger admittedIndex = 0;
+    while (bytesPurged < bytesToPurge) {
+        AFCachedImage *candidate = candidateIndex < candidateImages.count ? candidateImages[candidateIndex] : nil;
+        AFCachedImage *victim = admittedIndex < admittedImages.count ? admittedImages[admittedIndex] : nil;
+        AFCachedImage *evictedImage = nil;
+        if (candidate != nil && victim != nil) {
+            if (frequencies[candidate.key].unsignedIntegerValue > frequencies[victim.key].unsignedIntegerValue) {
+                evictedImage = victim;
+                admittedIndex++;
+            } else {
+                evictedImage = candidate;
+                candidateIndex++;
+            }
+        } else if (candidate != nil) {
+            evictedImage = candidate;
+            candidateIndex++;
+        } else if (victim != nil) {
+            evictedImage = victim;
+            admittedIndex++;
+        } else {
+            break;
+        }
+        [self.cachedImages removeObjectForKey:evictedImage.key];
+        bytesPurged += evictedImage.totalBytes;
+    }
+
+    for (; candidateIndex < candidateImages.count; candidateIndex++) {
+        candidateImages[candidateIndex].admitted = YES;
+    }
+    return bytesPurged;
+}
+
 - (BOOL)removeImageWithIdentifier:(NSString *)identifier {
+    AFImageCacheKey *key = [[AFImageCacheKey alloc] initWithIdentifier:identifier];
     __block BOOL removed = NO;
     dispatch_barrier_sync(self.synchronizationQueue, ^{
-        AFCachedImage *cachedImage = self.cachedImages[identifier];
+        AFCachedImage *cachedImage = self.cachedImages[key];
         if (cachedImage != nil) {
-            [self.cachedImages removeObjectForKey:identifier];
+            [self.cachedImages removeObjectForKey:key];
             self.currentMemoryUsage -= cachedImage.totalBytes;
             removed = YES;
         }
     });
+    if ([self.diskCache removeImageWithIdentifier:identifier]) {
+        removed = YES;
+    }
     return removed;
 }
 
 - (BOOL)removeAllImages {
+    BOOL removed = [self removeAllInMemoryImages];
+    if ([self.diskCache removeAllImages]) {
+        removed = YES;
+    }
+    return removed;
+}
+
+- (BOOL)removeAllInMemoryImages {
     __block BOOL removed = NO;
     dispatch_barrier_sync(self.synchronizationQueue, ^{
         if (self.cachedImages.count > 0) {
@@ -168,11 +375,21 @@
 }
 
 - (nullable UIImage *)imageWithIdentifier:(NSString *)identifier {
+    AFImageCacheKey *key = [[AFImageCacheKey alloc] initWithIdentifier:identifier];
     __block UIImage *image = nil;
     dispatch_sync(self.synchronizationQueue, ^{
-        AFCachedImage *cachedImage = self.cachedImages[identifier];
+        if (self.usesFrequencyBasedAdmission) {
+            [self.frequencySketch recordAccessForKey:key];
+        }
+        AFCachedImage *cachedImage = self.cachedImages[key];
         image = [cachedImage accessImage];
     });
+    if (image == nil && self.diskCache != nil) {
+        image = [self.diskCache imageWithIdentifier:identifier];
+        if (image != nil) {
+            [self addInMemoryImage:image withIdentifier:identifier];
+        }
+    }
     return image;
 }
 
@@ -0,0 +1,84 @@
+// AFDiskImageCache.h
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <TargetConditionals.h>
+#import <Foundation/Foundation.h>
+
+#if TARGET_OS_IOS || TARGET_OS_TV
+#import <UIKit/UIKit.h>
+#import "AFAutoPurgingImageCache.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+/**
+ The `AFDiskImageCache` is a persistent image cache used to store decoded images on disk up to a given disk capacity. It is intended to be used as the second level behind an `AFAutoPurgingImageCache`, so that images survive a relaunch or a memory warning without having to be decoded again.
+
+ Each image is stored as a raw bitmap in its own data file, and is described by a fixed-size entry in a memory-mapped index file. Images returned from the cache are backed by memory-mapped bitmap data, which allows a warm start to map pixels directly instead of decoding them. When the disk capacity is reached, entries are sorted by last access date, and the oldest images are purged until the preferred disk usage after purge is met.
+
+ Entries in the index are checksummed, and bitmap data is always committed to disk before the index entry describing it. An index left partially written by a crash is detected when the cache is opened, and the affected entries are discarded rather than corrupting the cache.
+ */
+@interface AFDiskImageCache : NSObject <AFImageRequestCache>
+
+/**
+ The directory in which the index and data files are stored.
+ */
+@property (readonly, nonatomic, copy) NSURL *directoryURL;
+
+/**
+ The total disk capacity of the cache in bytes.
+ */
+@property (nonatomic, assign) UInt64 diskCapacity;
+
+/**
+ The preferred disk usage after purge in bytes. During a purge, images will be purged until the disk usage drops below this limit.
+ */
+@property (nonatomic, assign) UInt64 preferredDiskUsageAfterPurge;
+
+/**
+ The current total disk usage in bytes of all images stored within the cache.
+ */
+@property (nonatomic, assign, readonly) UInt64 diskUsage;
+
+/**
+ Initializes the `AFDiskImageCache` instance in the `com.alamofire.diskimagecache` directory of the user caches directory. `diskCapacity` defaults to `150 MB`. `preferredDiskUsageAfterPurge` defaults to `100 MB`.
+
+ @return The new `AFDiskImageCache` instance.
+ */
+- (instancetype)init;
+
+/**
+ Initializes the `AFDiskImageCache` instance with the given directory, disk capacity and preferred disk usage after purge limit. The directory is created if needed, and any entries already stored in it are loaded from its index.
+
+ @param directoryURL The directory in which the index and data files are stored.
+ @param diskCapacity The total disk capacity of the cache in bytes.
+ @param preferredDiskCapacity The preferred disk usage after purge in bytes.
+
+ @return The new `AFDiskImageCache` instance.
+ */
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL
+                        diskCapacity:(UInt64)diskCapacity
+               preferredDiskCapacity:(UInt64)preferredDiskCapacity;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+#endif
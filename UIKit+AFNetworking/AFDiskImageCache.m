@@ -0,0 +1,585 @@
+// AFDiskImageCache.m
+// Copyright (c) 2011–2016 Alamofire Software Foundation ( http://alamofire.org/ )
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <TargetConditionals.h>
+
+#if TARGET_OS_IOS || TARGET_OS_TV
+
+#import "AFDiskImageCache.h"
+#import "AFTracing.h"
+
+#import <CommonCrypto/CommonDigest.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <errno.h>
+#import <fcntl.h>
+#import <unistd.h>
+
+static uint32_t const AFDiskImageCacheIndexMagic = 0x43494641;
+static uint32_t const AFDiskImageCacheIndexVersion = 1;
+static uint32_t const AFDiskImageCacheIndexEntryCount = 4096;
+
+static uint32_t const AFDiskImageCacheEntryStateFree = 0;
+static uint32_t const AFDiskImageCacheEntryStateValid = 1;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+} AFDiskImageCacheIndexHeader;
+
+// Every field up to `checksum` is covered by the checksum. `lastAccessTime` is a
+// hint that is updated in place on every hit, so it is deliberately left out.
+typedef struct {
+    uint8_t digest[CC_MD5_DIGEST_LENGTH];
+    uint64_t byteCount;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesPerRow;
+    uint32_t bitmapInfo;
+    uint32_t orientation;
+    float scale;
+    uint32_t checksum;
+    uint32_t state;
+    double lastAccessTime;
+} AFDiskImageCacheIndexEntry;
+
+static uint32_t AFDiskImageCacheChecksumForEntry(const AFDiskImageCacheIndexEntry *entry) {
+    // FNV-1a
+    const uint8_t *bytes = (const uint8_t *)entry;
+    uint32_t hash = 2166136261u;
+    for (size_t idx = 0; idx < offsetof(AFDiskImageCacheIndexEntry, checksum); idx++) {
+        hash ^= bytes[idx];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static NSData * AFDiskImageCacheDigestForIdentifier(NSString *identifier) {
+    NSData *data = [identifier dataUsingEncoding:NSUTF8StringEncoding];
+    uint8_t digest[CC_MD5_DIGEST_LENGTH];
+    CC_MD5(data.bytes, (CC_LONG)data.length, digest);
+    return [NSData dataWithBytes:digest length:CC_MD5_DIGEST_LENGTH];
+}
+
+static NSString * AFDiskImageCacheFileNameForDigest(const uint8_t *digest) {
+    NSMutableString *fileName = [NSMutableString stringWithCapacity:CC_MD5_DIGEST_LENGTH * 2];
+    for (NSUInteger idx = 0; idx < CC_MD5_DIGEST_LENGTH; idx++) {
+        [fileName appendFormat:@"%02x", digest[idx]];
+    }
+    return fileName;
+}
+
+static BOOL AFDiskImageCacheEntryIsValid(const AFDiskImageCacheIndexEntry *entry) {
+    if (entry->state != AFDiskImageCacheEntryStateValid) {
+        return NO;
+    }
+
+    if (entry->checksum != AFDiskImageCacheChecksumForEntry(entry)) {
+        return NO;
+    }
+
+    return entry->width > 0 && entry->height > 0 && entry->bytesPerRow >= entry->width * 4 && entry->byteCount == (uint64_t)entry->bytesPerRow * (uint64_t)entry->height;
+}
+
+// Writes the data to a temporary file that is flushed to stable storage before being renamed into place, and then flushes the rename itself, so that nothing refers to the file before its contents are durable.
+static BOOL AFDiskImageCacheWriteDataDurably(NSData *data, NSURL *fileURL) {
+    NSString *path = [fileURL path];
+    NSString *temporaryPath = [path stringByAppendingPathExtension:@"tmp"];
+    int fd = open([temporaryPath fileSystemRepresentation], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return NO;
+    }
+
+    const uint8_t *bytes = (const uint8_t *)data.bytes;
+    size_t remainingLength = data.length;
+    while (remainingLength > 0) {
+        ssize_t writtenLength = write(fd, bytes, remainingLength);
+        if (writtenLength < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        bytes += writtenLength;
+        remainingLength -= (size_t)writtenLength;
+    }
+
+    // fsync only reaches the drive cache on Darwin; F_FULLFSYNC also flushes the drive, when the file system supports it.
+    BOOL synced = remainingLength == 0 && (fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0);
+    close(fd);
+
+    if (!synced || rename([temporaryPath fileSystemRepresentation], [path fileSystemRepresentation]) != 0) {
+        unlink([temporaryPath fileSystemRepresentation]);
+        return NO;
+    }
+
+    int directoryFD = open([[path stringByDeletingLastPathComponent] fileSystemRepresentation], O_RDONLY);
+    if (directoryFD >= 0) {
+        fsync(directoryFD);
+        close(directoryFD);
+    }
+
+    return YES;
+}
+
+@interface AFDiskImageCache ()
+@property (readwrite, nonatomic, copy) NSURL *directoryURL;
+@property (nonatomic, copy) NSURL *dataDirectoryURL;
+@property (nonatomic, assign) AFDiskImageCacheIndexHeader *indexHeader;
+@property (nonatomic, assign) AFDiskImageCacheIndexEntry *indexEntries;
+@property (nonatomic, assign) size_t indexLength;
+@property (nonatomic, strong) NSMutableDictionary <NSData *, NSNumber *> *entryIndexesByDigest;
+@property (nonatomic, strong) NSMutableIndexSet *freeEntryIndexes;
+@property (nonatomic, strong) NSMutableDictionary <NSData *, UIImage *> *pendingImages;
+@property (nonatomic, assign) UInt64 currentDiskUsage;
+@property (nonatomic, strong) dispatch_queue_t synchronizationQueue;
+@property (nonatomic, strong) dispatch_queue_t ioQueue;
+@end
+
+@implementation AFDiskImageCache
+
+- (instancetype)init {
+    NSURL *cachesDirectoryURL = [[[NSFileManager defaultManager] URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask] firstObject];
+    return [self initWithDirectoryURL:[cachesDirectoryURL URLByAppendingPathComponent:@"com.alamofire.diskimagecache" isDirectory:YES]
+                         diskCapacity:150 * 1024 * 1024
+                preferredDiskCapacity:100 * 1024 * 1024];
+}
+
+- (instancetype)initWithDirectoryURL:(NSURL *)directoryURL
+                        diskCapacity:(UInt64)diskCapacity
+               preferredDiskCapacity:(UInt64)preferredDiskCapacity
+{
+    if (self = [super init]) {
+        self.directoryURL = directoryURL;
+        self.dataDirectoryURL = [directoryURL URLByAppendingPathComponent:@"data" isDirectory:YES];
+        self.diskCapacity = diskCapacity;
+        self.preferredDiskUsageAfterPurge = preferredDiskCapacity;
+        self.entryIndexesByDigest = [[NSMutableDictionary alloc] init];
+        self.freeEntryIndexes = [[NSMutableIndexSet alloc] init];
+        self.pendingImages = [[NSMutableDictionary alloc] init];
+
+        NSString *queueName = [NSString stringWithFormat:@"com.alamofire.diskimagecache-%@", [[NSUUID UUID] UUIDString]];
+        self.synchronizationQueue = dispatch_queue_create([queueName cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_CONCURRENT);
+
+        queueName = [NSString stringWithFormat:@"com.alamofire.diskimagecache.io-%@", [[NSUUID UUID] UUIDString]];
+        self.ioQueue = dispatch_queue_create([queueName cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_SERIAL);
+
+        [[NSFileManager defaultManager] createDirectoryAtURL:self.dataDirectoryURL withIntermediateDirectories:YES attributes:nil error:nil];
+
+        if ([self openIndex]) {
+            [self loadIndex];
+            dispatch_async(self.ioQueue, ^{
+                [self removeOrphanedDataFiles];
+            });
+        }
+    }
+    return self;
+}
+
+- (void)dealloc {
+    if (self.indexHeader) {
+        msync(self.indexHeader, self.indexLength, MS_ASYNC);
+        munmap(self.indexHeader, self.indexLength);
+    }
+}
+
+#pragma mark - Index
+
+- (BOOL)openIndex {
+    NSString *indexPath = [[self.directoryURL URLByAppendingPathComponent:@"index"] path];
+    int fd = open([indexPath fileSystemRepresentation], O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return NO;
+    }
+
+    size_t length = sizeof(AFDiskImageCacheIndexHeader) + AFDiskImageCacheIndexEntryCount * sizeof(AFDiskImageCacheIndexEntry);
+    struct stat fileStatus;
+    if (fstat(fd, &fileStatus) != 0 || (size_t)fileStatus.st_size != length) {
+        // An index of unexpected size cannot be trusted, so start over with an empty one.
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)length) != 0) {
+            close(fd);
+            return NO;
+        }
+    }
+
+    void *bytes = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (bytes == MAP_FAILED) {
+        return NO;
+    }
+
+    self.indexLength = length;
+    self.indexHeader = (AFDiskImageCacheIndexHeader *)bytes;
+    self.indexEntries = (AFDiskImageCacheIndexEntry *)((uint8_t *)bytes + sizeof(AFDiskImageCacheIndexHeader));
+
+    AFDiskImageCacheIndexHeader *header = self.indexHeader;
+    if (header->magic != AFDiskImageCacheIndexMagic || header->version != AFDiskImageCacheIndexVersion || header->entryCount != AFDiskImageCacheIndexEntryCount) {
+        memset(bytes, 0, length);
+        header->magic = AFDiskImageCacheIndexMagic;
+        header->version = AFDiskImageCacheIndexVersion;
+        header->entryCount = AFDiskImageCacheIndexEntryCount;
+        msync(bytes, length, MS_SYNC);
+    }
+
+    return YES;
+}
+
+// Flushes the pages holding the entry synchronously, so that the entry reaches the disk only after the data file it describes.
+- (void)synchronizeIndexEntry:(AFDiskImageCacheIndexEntry *)entry {
+    uintptr_t pageSize = (uintptr_t)getpagesize();
+    uintptr_t start = (uintptr_t)entry & ~(pageSize - 1);
+    uintptr_t end = (uintptr_t)entry + sizeof(AFDiskImageCacheIndexEntry);
+    msync((void *)start, (size_t)(end - start), MS_SYNC);
+}
+
+- (void)loadIndex {
+    for (uint32_t idx = 0; idx < AFDiskImageCacheIndexEntryCount; idx++) {
+        AFDiskImageCacheIndexEntry *entry = &self.indexEntries[idx];
+        NSData *digest = [NSData dataWithBytes:entry->digest length:CC_MD5_DIGEST_LENGTH];
+        if (AFDiskImageCacheEntryIsValid(entry) && self.entryIndexesByDigest[digest] == nil) {
+            self.entryIndexesByDigest[digest] = @(idx);
+            self.currentDiskUsage += entry->byteCount;
+        } else {
+            // Entries left partially written by a crash, or duplicated, are discarded.
+            entry->state = AFDiskImageCacheEntryStateFree;
+            [self.freeEntryIndexes addIndex:idx];
+        }
+    }
+}
+
+- (void)removeOrphanedDataFiles {
+    NSMutableSet <NSString *> *fileNames = [NSMutableSet set];
+    dispatch_sync(self.synchronizationQueue, ^{
+        for (NSNumber *entryIndex in self.entryIndexesByDigest.allValues) {
+            [fileNames addObject:AFDiskImageCacheFileNameForDigest(self.indexEntries[entryIndex.unsignedIntValue].digest)];
+        }
+    });
+
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    for (NSURL *fileURL in [fileManager contentsOfDirectoryAtURL:self.dataDirectoryURL includingPropertiesForKeys:nil options:0 error:nil]) {
+        if (![fileNames containsObject:fileURL.lastPathComponent]) {
+            [fileManager removeItemAtURL:fileURL error:nil];
+        }
+    }
+}
+
+- (NSURL *)dataFileURLForDigest:(const uint8_t *)digest {
+    return [self.dataDirectoryURL URLByAppendingPathComponent:AFDiskImageCacheFileNameForDigest(digest) isDirectory:NO];
+}
+
+//This method should only be called from safely within a barrier block on the synchronizationQueue
+- (BOOL)removeEntryForDigest:(NSData *)digest {
+    NSNumber *entryIndex = self.entryIndexesByDigest[digest];
+    if (entryIndex == nil) {
+        return NO;
+    }
+
+    AFDiskImageCacheIndexEntry *entry = &self.indexEntries[entryIndex.unsignedIntValue];
+    // The index entry is released before its data file, so a crash in between only leaves an orphaned file behind.
+    entry->state = AFDiskImageCacheEntryStateFree;
+    unlink([[[self dataFileURLForDigest:entry->digest] path] fileSystemRepresentation]);
+
+    self.currentDiskUsage -= entry->byteCount;
+    [self.entryIndexesByDigest removeObjectForKey:digest];
+    [self.freeEntryIndexes addIndex:entryIndex.unsignedIntegerValue];
+
+    return YES;
+}
+
+//This method should only be called from safely within a barrier block on the synchronizationQueue
+- (void)purgeEntriesToFreeBytes:(UInt64)bytesToPurge entries:(NSUInteger)entriesToPurge {
+    uint64_t traceBeginTime = AFTraceBegin();
+    AFDiskImageCacheIndexEntry *entries = self.indexEntries;
+    NSArray <NSData *> *sortedDigests = [self.entryIndexesByDigest keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber *index1, NSNumber *index2) {
+        double lastAccessTime1 = entries[index1.unsignedIntValue].lastAccessTime;
+        double lastAccessTime2 = entries[index2.unsignedIntValue].lastAccessTime;
+        if (lastAccessTime1 < lastAccessTime2) {
+            return NSOrderedAscending;
+        } else if (lastAccessTime1 > lastAccessTime2) {
+            return NSOrderedDescending;
+        }
+        return NSOrderedSame;
+    }];
+
+    UInt64 bytesPurged = 0;
+    NSUInteger entriesPurged = 0;
+    for (NSData *digest in sortedDigests) {
+        if (bytesPurged >= bytesToPurge && entriesPurged >= entriesToPurge) {
+            break;
+        }
+        bytesPurged += entries[self.entryIndexesByDigest[digest].unsignedIntValue].byteCount;
+        entriesPurged += 1;
+        [self removeEntryForDigest:digest];
+    }
+    AFTraceEnd(traceBeginTime, "image disk cache purge", "cache");
+}
+
+#pragma mark - Bitmaps
+
+- (NSData *)bitmapDataForImage:(UIImage *)image entry:(AFDiskImageCacheIndexEntry *)entry {
+    CGImageRef imageRef = image.CGImage;
+    if (imageRef == NULL) {
+        return nil;
+    }
+
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    if (width == 0 || height == 0) {
+        return nil;
+    }
+
+    CGImageAlphaInfo alphaInfo = CGImageGetAlphaInfo(imageRef);
+    BOOL hasAlpha = !(alphaInfo == kCGImageAlphaNone || alphaInfo == kCGImageAlphaNoneSkipFirst || alphaInfo == kCGImageAlphaNoneSkipLast);
+    CGBitmapInfo bitmapInfo = kCGBitmapByteOrder32Host | (CGBitmapInfo)(hasAlpha ? kCGImageAlphaPremultipliedFirst : kCGImageAlphaNoneSkipFirst);
+
+    // Rows are aligned to 64 bytes so that mapped bitmaps can be handed to Core Animation without being copied.
+    size_t bytesPerRow = ((width * 4) + 63) & ~(size_t)63;
+    NSMutableData *bitmapData = [NSMutableData dataWithLength:bytesPerRow * height];
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(bitmapData.mutableBytes, width, height, 8, bytesPerRow, colorSpace, bitmapInfo);
+    CGColorSpaceRelease(colorSpace);
+    if (!context) {
+        return nil;
+    }
+
+    CGContextDrawImage(context, CGRectMake(0.0f, 0.0f, (CGFloat)width, (CGFloat)height), imageRef);
+    CGContextRelease(context);
+
+    entry->byteCount = bitmapData.length;
+    entry->width = (uint32_t)width;
+    entry->height = (uint32_t)height;
+    entry->bytesPerRow = (uint32_t)bytesPerRow;
+    entry->bitmapInfo = (uint32_t)bitmapInfo;
+    entry->orientation = (uint32_t)image.imageOrientation;
+    entry->scale = (float)image.scale;
+
+    return bitmapData;
+}
+
+- (UIImage *)imageForEntry:(AFDiskImageCacheIndexEntry)entry {
+    NSURL *fileURL = [self dataFileURLForDigest:entry.digest];
+    NSData *bitmapData = [NSData dataWithContentsOfURL:fileURL options:NSDataReadingMappedAlways error:nil];
+    if (bitmapData.length != entry.byteCount) {
+        return nil;
+    }
+
+    CGDataProviderRef dataProvider = CGDataProviderCreateWithCFData((__bridge CFDataRef)bitmapData);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGImageRef imageRef = CGImageCreate(entry.width, entry.height, 8, 32, entry.bytesPerRow, colorSpace, (CGBitmapInfo)entry.bitmapInfo, dataProvider, NULL, false, kCGRenderingIntentDefault);
+    CGColorSpaceRelease(colorSpace);
+    CGDataProviderRelease(dataProvider);
+    if (!imageRef) {
+        return nil;
+    }
+
+    UIImage *image = [[UIImage alloc] initWithCGImage:imageRef scale:entry.scale orientation:(UIImageOrientation)entry.orientation];
+    CGImageRelease(imageRef);
+
+    return image;
+}
+
+#pragma mark - AFImageCache
+
+- (UInt64)diskUsage {
+    __block UInt64 result = 0;
+    dispatch_sync(self.synchronizationQueue, ^{
+        result = self.currentDiskUsage;
+    });
+    return result;
+}
+
+- (void)addImage:(UIImage *)image withIdentifier:(NSString *)identifier {
+    if (!self.indexEntries) {
+        return;
+    }
+
+    NSData *digest = AFDiskImageCacheDigestForIdentifier(identifier);
+
+    dispatch_barrier_async(self.synchronizationQueue, ^{
+        [self removeEntryForDigest:digest];
+        self.pendingImages[digest] = image;
+    });
+
+    dispatch_async(self.ioQueue, ^{
+        __block BOOL isPending = NO;
+        dispatch_sync(self.synchronizationQueue, ^{
+            isPending = self.pendingImages[digest] == image;
+        });
+        if (!isPending) {
+            return;
+        }
+
+        AFDiskImageCacheIndexEntry pendingEntry;
+        memset(&pendingEntry, 0, sizeof(pendingEntry));
+        memcpy(pendingEntry.digest, digest.bytes, CC_MD5_DIGEST_LENGTH);
+
+        NSData *bitmapData = [self bitmapDataForImage:image entry:&pendingEntry];
+        NSURL *fileURL = [self dataFileURLForDigest:pendingEntry.digest];
+        BOOL written = bitmapData != nil && AFDiskImageCacheWriteDataDurably(bitmapData, fileURL);
+
+        dispatch_barrier_sync(self.synchronizationQueue, ^{
+            if (self.pendingImages[digest] != image) {
+                // The image was removed or replaced while it was being written.
+                if (written && self.entryIndexesByDigest[digest] == nil) {
+                    unlink([[fileURL path] fileSystemRepresentation]);
+                }
+                return;
+            }
+            [self.pendingImages removeObjectForKey:digest];
+
+            if (!written) {
+                unlink([[fileURL path] fileSystemRepresentation]);
+                return;
+            }
+
+            if (self.freeEntryIndexes.count == 0) {
+                [self purgeEntriesToFreeBytes:0 entries:1];
+            }
+
+            NSUInteger entryIndex = self.freeEntryIndexes.firstIndex;
+            [self.freeEntryIndexes removeIndex:entryIndex];
+
+            // The data file is already in place, so the entry is only marked valid once all of its fields are written.
+            AFDiskImageCacheIndexEntry *entry = &self.indexEntries[entryIndex];
+            entry->state = AFDiskImageCacheEntryStateFree;
+            pendingEntry.checksum = AFDiskImageCacheChecksumForEntry(&pendingEntry);
+            pendingEntry.state = AFDiskImageCacheEntryStateFree;
+            pendingEntry.lastAccessTime = CFAbsoluteTimeGetCurrent();
+            *entry = pendingEntry;
+            entry->state = AFDiskImageCacheEntryStateValid;
+            [self synchronizeIndexEntry:entry];
+
+            self.entryIndexesByDigest[digest] = @(entryIndex);
+            self.currentDiskUsage += entry->byteCount;
+
+            if (self.currentDiskUsage > self.diskCapacity) {
+                UInt64 bytesToPurge = self.currentDiskUsage - MIN(self.preferredDiskUsageAfterPurge, self.currentDiskUsage);
+                [self purgeEntriesToFreeBytes:bytesToPurge entries:0];
+            }
+        });
+    });
+}
+
+- (BOOL)removeImageWithIdentifier:(NSString *)identifier {
+    NSData *digest = AFDiskImageCacheDigestForIdentifier(identifier);
+
+    __block BOOL removed = NO;
+    dispatch_barrier_sync(self.synchronizationQueue, ^{
+        removed = self.pendingImages[digest] != nil;
+        [self.pendingImages removeObjectForKey:digest];
+        if (self.indexEntries) {
+            removed = [self removeEntryForDigest:digest] || removed;
+        }
+    });
+    return removed;
+}
+
+- (BOOL)removeAllImages {
+    __block BOOL removed = NO;
+    dispatch_barrier_sync(self.synchronizationQueue, ^{
+        removed = self.pendingImages.count > 0 || self.entryIndexesByDigest.count > 0;
+        [self.pendingImages removeAllObjects];
+        for (NSData *digest in [self.entryIndexesByDigest allKeys]) {
+            [self removeEntryForDigest:digest];
+        }
+    });
+    return removed;
+}
+
+- (nullable UIImage *)imageWithIdentifier:(NSString *)identifier {
+    if (!self.indexEntries) {
+        return nil;
+    }
+
+    NSData *digest = AFDiskImageCacheDigestForIdentifier(identifier);
+
+    __block UIImage *pendingImage = nil;
+    __block BOOL found = NO;
+    __block AFDiskImageCacheIndexEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    dispatch_sync(self.synchronizationQueue, ^{
+        pendingImage = self.pendingImages[digest];
+        NSNumber *entryIndex = self.entryIndexesByDigest[digest];
+        if (pendingImage == nil && entryIndex != nil) {
+            entry = self.indexEntries[entryIndex.unsignedIntValue];
+            found = YES;
+        }
+    });
+
+    if (found) {
+        // Readers run concurrently on the synchronization queue, so the access time is only written by a barrier.
+        CFAbsoluteTime accessTime = CFAbsoluteTimeGetCurrent();
+        dispatch_barrier_async(self.synchronizationQueue, ^{
+            NSNumber *entryIndex = self.entryIndexesByDigest[digest];
+            if (entryIndex && self.indexEntries[entryIndex.unsignedIntValue].checksum == entry.checksum) {
+                self.indexEntries[entryIndex.unsignedIntValue].lastAccessTime = accessTime;
+            }
+        });
+    }
+
+    if (pendingImage) {
+        return pendingImage;
+    } else if (!found) {
+        return nil;
+    }
+
+    UIImage *image = [self imageForEntry:entry];
+    if (!image) {
+        // The data file is missing or truncated, so the entry can no longer be trusted.
+        dispatch_barrier_async(self.synchronizationQueue, ^{
+            NSNumber *entryIndex = self.entryIndexesByDigest[digest];
+            if (entryIndex && self.indexEntries[entryIndex.unsignedIntValue].checksum == entry.checksum) {
+                [self removeEntryForDigest:digest];
+            }
+        });
+    }
+
+    return image;
+}
+
+#pragma mark - AFImageRequestCache
+
+- (void)addImage:(UIImage *)image forRequest:(NSURLRequest *)request withAdditionalIdentifier:(NSString *)identifier {
+    [self addImage:image withIdentifier:[self imageCacheKeyFromURLRequest:request withAdditionalIdentifier:identifier]];
+}
+
+- (BOOL)removeImageforRequest:(NSURLRequest *)request withAdditionalIdentifier:(NSString *)identifier {
+    return [self removeImageWithIdentifier:[self imageCacheKeyFromURLRequest:request withAdditionalIdentifier:identifier]];
+}
+
+- (nullable UIImage *)imageforRequest:(NSURLRequest *)request withAdditionalIdentifier:(NSString *)identifier {
+    return [self imageWithIdentifier:[self imageCacheKeyFromURLRequest:request withAdditionalIdentifier:identifier]];
+}
+
+- (NSString *)imageCacheKeyFromURLRequest:(NSURLRequest *)request withAdditionalIdentifier:(NSString *)additionalIdentifier {
+    NSString *key = request.URL.absoluteString;
+    if (additionalIdentifier != nil) {
+        key = [key stringByAppendingString:additionalIdentifier];
+    }
+    return key;
+}
+
+@end
+
+#endif
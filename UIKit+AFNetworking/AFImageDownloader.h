@@ -34,6 +34,19 @@ typedef NS_ENUM(NSInteger, AFImageDownloadPrioritization) {
     AFImageDownloadPrioritizationLIFO
 };
 
+/**
+ The priority of an image download. Queued downloads with a higher priority are started before those with a lower priority, and the priority of the underlying `NSURLSessionTask` is set to match.
+
+ - `AFImageDownloadPriorityBackground`: Images that are not expected to be displayed soon. Maps to `NSURLSessionTaskPriorityLow`.
+ - `AFImageDownloadPriorityPrefetch`: Images that are likely to be displayed soon, such as those for cells about to scroll on screen. Maps to a priority halfway between `NSURLSessionTaskPriorityLow` and `NSURLSessionTaskPriorityDefault`, so that prefetches yield to ordinary tasks.
+ - `AFImageDownloadPriorityVisible`: Images that are currently displayed. Maps to `NSURLSessionTaskPriorityHigh`.
+ */
+typedef NS_ENUM(NSInteger, AFImageDownloadPriority) {
+    AFImageDownloadPriorityBackground,
+    AFImageDownloadPriorityPrefetch,
+    AFImageDownloadPriorityVisible
+};
+
 /**
  The `AFImageDownloadReceipt` is an object vended by the `AFImageDownloader` when starting a data task. It can be used to cancel active tasks running on the `AFImageDownloader` session. As a general rule, image data tasks should be cancelled using the `AFImageDownloadReceipt` instead of calling `cancel` directly on the `task` itself. The `AFImageDownloader` is optimized to handle duplicate task scenarios as well as pending versus active downloads.
  */
@@ -48,9 +61,25 @@ typedef NS_ENUM(NSInteger, AFImageDownloadPrioritization) {
  The unique identifier for the success and failure blocks when duplicate requests are made.
  */
 @property (nonatomic, strong) NSUUID *receiptID;
+
+/**
+ The priority of the download the receipt was vended for. Setting this property reprioritizes the download, moving it ahead of or behind other queued downloads. When several receipts share the same download, the download uses the highest priority among them.
+ */
+@property (nonatomic, assign) AFImageDownloadPriority priority;
 @end
 
-/** The `AFImageDownloader` class is responsible for downloading images in parallel on a prioritized queue. Incoming downloads are added to the front or back of the queue depending on the download prioritization. Each downloaded image is cached in the underlying `NSURLCache` as well as the in-memory image cache. By default, any download request with a cached image equivalent in the image cache will automatically be served the cached image representation.
+/**
+ The `AFImagePrefetchToken` is an object vended by the `AFImageDownloader` when prefetching a batch of images. It can be used to cancel the prefetches of the batch that have not completed yet.
+ */
+@interface AFImagePrefetchToken : NSObject
+
+/**
+ The URL requests of the batch.
+ */
+@property (nonatomic, copy, readonly) NSArray <NSURLRequest *> *requests;
+@end
+
+/** The `AFImageDownloader` class is responsible for downloading images in parallel on a prioritized queue. Incoming downloads are ordered by their `AFImageDownloadPriority`, and downloads of equal priority are started in the order given by the download prioritization. Each downloaded image is cached in the underlying `NSURLCache` as well as the in-memory image cache. By default, any download request with a cached image equivalent in the image cache will automatically be served the cached image representation.
  */
 @interface AFImageDownloader : NSObject
 
@@ -65,10 +94,20 @@ typedef NS_ENUM(NSInteger, AFImageDownloadPrioritization) {
 @property (nonatomic, strong) AFHTTPSessionManager *sessionManager;
 
 /**
- Defines the order prioritization of incoming download requests being inserted into the queue. `AFImageDownloadPrioritizationFIFO` by default.
+ Defines the order in which queued download requests of equal priority are started. `AFImageDownloadPrioritizationFIFO` by default.
  */
 @property (nonatomic, assign) AFImageDownloadPrioritization downloadPrioritizaton;
 
+/**
+ The time an active download keeps running once all of its receipts have been cancelled. A request for the same URL made during this period is attached to the running download instead of starting a new one. Once the period elapses, the download is cancelled and its active download slot is given to the next queued download. `0.5` seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval cancellationGracePeriod;
+
+/**
+ The maximum number of prefetches allowed to be active at any given time. Prefetches do not count towards the maximum number of active downloads. `2` by default.
+ */
+@property (nonatomic, assign) NSInteger maximumActivePrefetches;
+
 /**
  The shared default instance of `AFImageDownloader` initialized with default values.
  */
@@ -141,10 +180,48 @@ typedef NS_ENUM(NSInteger, AFImageDownloadPrioritization) {
                                                         success:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse  * _Nullable response, UIImage *responseObject))success
                                                         failure:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse * _Nullable response, NSError *error))failure;
 
+/**
+ Creates a data task using the `sessionManager` instance for the specified URL request with the given priority.
+
+ If the same data task is already in the queue or currently being downloaded, the success and failure blocks are
+ appended to the already existing task, and the task is reprioritized if the given priority is higher than its own.
+
+ @param request The URL request.
+ @param receiptID The identifier to use for the download receipt that will be created for this request. This must be a unique identifier that does not represent any other request.
+ @param priority The priority of the download. The other download methods use `AFImageDownloadPriorityVisible`.
+ @param success A block to be executed when the image data task finishes successfully. This block has no return value and takes three arguments: the request sent from the client, the response received from the server, and the image created from the response data of request. If the image was returned from cache, the response parameter will be `nil`.
+ @param failure A block object to be executed when the image data task finishes unsuccessfully, or that finishes successfully. This block has no return value and takes three arguments: the request sent from the client, the response received from the server, and the error object describing the network or parsing error that occurred.
+
+ @return The image download receipt for the data task if available. `nil` if the image is stored in the cache.
+ */
+- (nullable AFImageDownloadReceipt *)downloadImageForURLRequest:(NSURLRequest *)request
+                                                  withReceiptID:(NSUUID *)receiptID
+                                                       priority:(AFImageDownloadPriority)priority
+                                                        success:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse  * _Nullable response, UIImage *responseObject))success
+                                                        failure:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse * _Nullable response, NSError *error))failure;
+
+/**
+ Downloads the images for the specified URL requests into the image cache, without competing with other downloads for their active download slots.
+
+ Prefetches are started in order, up to `maximumActivePrefetches` at a time, at `AFImageDownloadPriorityPrefetch`. Requests whose image is already in the image cache, or which are already being downloaded, are skipped. A download request made for an image while it is being prefetched is attached to the prefetch.
+
+ @param requests The URL requests of the images to prefetch.
+
+ @return The prefetch token for the batch, which can be used to cancel it.
+ */
+- (AFImagePrefetchToken *)prefetchImagesForURLRequests:(NSArray <NSURLRequest *> *)requests;
+
+/**
+ Cancels the prefetches of the batch that have not completed yet. Prefetches that download requests were attached to are left running for those requests.
+
+ @param prefetchToken The prefetch token of the batch to cancel.
+ */
+- (void)cancelImagePrefetchForToken:(AFImagePrefetchToken *)prefetchToken;
+
 /**
  Cancels the data task in the receipt by removing the corresponding success and failure blocks and cancelling the data task if necessary.
 
- If the data task is pending in the queue, it will be cancelled if no other success and failure blocks are registered with the data task. If the data task is currently executing or is already completed, the success and failure blocks are removed and will not be called when the task finishes.
+ If the data task is pending in the queue, it will be cancelled if no other success and failure blocks are registered with the data task. If the data task is currently executing, the success and failure blocks are removed and will not be called when the task finishes, and the data task is cancelled after the `cancellationGracePeriod` if no other success and failure blocks are registered with it by then.
 
  @param imageDownloadReceipt The image download receipt to cancel.
  */
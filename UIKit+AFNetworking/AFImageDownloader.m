@@ -28,6 +28,7 @@
 
 @interface AFImageDownloaderResponseHandler : NSObject
 @property (nonatomic, strong) NSUUID *uuid;
+@property (nonatomic, assign) AFImageDownloadPriority priority;
 @property (nonatomic, copy) void (^successBlock)(NSURLRequest*, NSHTTPURLResponse*, UIImage*);
 @property (nonatomic, copy) void (^failureBlock)(NSURLRequest*, NSHTTPURLResponse*, NSError*);
 @end
@@ -35,10 +36,12 @@
 @implementation AFImageDownloaderResponseHandler
 
 - (instancetype)initWithUUID:(NSUUID *)uuid
+                    priority:(AFImageDownloadPriority)priority
                      success:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse * _Nullable response, UIImage *responseObject))success
                      failure:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse * _Nullable response, NSError *error))failure {
     if (self = [self init]) {
         self.uuid = uuid;
+        self.priority = priority;
         self.successBlock = success;
         self.failureBlock = failure;
     }
@@ -56,6 +59,12 @@
 @property (nonatomic, strong) NSUUID *identifier;
 @property (nonatomic, strong) NSURLSessionDataTask *task;
 @property (nonatomic, strong) NSMutableArray <AFImageDownloaderResponseHandler*> *responseHandlers;
+@property (nonatomic, assign) AFImageDownloadPriority priority;
+@property (nonatomic, assign) int64_t queueOrder;
+@property (nonatomic, assign) NSUInteger queuePosition;
+@property (nonatomic, assign) NSUInteger cancellationGeneration;
+@property (nonatomic, assign) AFImageDownloadPriority minimumPriority;
+@property (nonatomic, strong) AFImagePrefetchToken *prefetchToken;
 
 @end
 
@@ -67,6 +76,9 @@
         self.task = task;
         self.identifier = identifier;
         self.responseHandlers = [[NSMutableArray alloc] init];
+        self.priority = AFImageDownloadPriorityBackground;
+        self.minimumPriority = AFImageDownloadPriorityBackground;
+        self.queuePosition = NSNotFound;
     }
     return self;
 }
@@ -79,20 +91,168 @@
     [self.responseHandlers removeObject:handler];
 }
 
+- (AFImageDownloaderResponseHandler *)responseHandlerWithUUID:(NSUUID *)uuid {
+    for (AFImageDownloaderResponseHandler *handler in self.responseHandlers) {
+        if ([handler.uuid isEqual:uuid]) {
+            return handler;
+        }
+    }
+    return nil;
+}
+
+- (AFImageDownloadPriority)highestResponseHandlerPriority {
+    AFImageDownloadPriority priority = self.minimumPriority;
+    for (AFImageDownloaderResponseHandler *handler in self.responseHandlers) {
+        priority = MAX(priority, handler.priority);
+    }
+    return priority;
+}
+
 @end
 
-@implementation AFImageDownloadReceipt
+/**
+ A binary heap of the merged tasks waiting for an active download slot. Tasks with a higher priority come first, then those with a higher queue order. Each task stores its position in the heap, so that it can be removed or reprioritized in O(log n).
+ */
+@interface AFImageDownloaderTaskQueue : NSObject
+@property (nonatomic, strong) NSMutableArray <AFImageDownloaderMergedTask*> *heap;
+@property (nonatomic, assign, readonly) NSUInteger count;
+@end
+
+@implementation AFImageDownloaderTaskQueue
+
+- (instancetype)init {
+    if (self = [super init]) {
+        self.heap = [[NSMutableArray alloc] init];
+    }
+    return self;
+}
+
+- (NSUInteger)count {
+    return self.heap.count;
+}
+
+- (void)addMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
+    mergedTask.queuePosition = self.heap.count;
+    [self.heap addObject:mergedTask];
+    [self siftUpFromPosition:mergedTask.queuePosition];
+}
+
+- (AFImageDownloaderMergedTask *)removeFirstMergedTask {
+    AFImageDownloaderMergedTask *mergedTask = self.heap.firstObject;
+    if (mergedTask != nil) {
+        [self removeMergedTask:mergedTask];
+    }
+    return mergedTask;
+}
+
+- (void)removeMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
+    NSUInteger position = mergedTask.queuePosition;
+    if (position >= self.heap.count || self.heap[position] != mergedTask) {
+        return;
+    }
+
+    NSUInteger lastPosition = self.heap.count - 1;
+    if (position != lastPosition) {
+        [self swapMergedTaskAtPosition:position withMergedTaskAtPosition:lastPosition];
+    }
+    [self.heap removeLastObject];
+    mergedTask.queuePosition = NSNotFound;
+
+    if (position < self.heap.count) {
+        AFImageDownloaderMergedTask *movedMergedTask = self.heap[position];
+        [self siftDownFromPosition:position];
+        [self siftUpFromPosition:movedMergedTask.queuePosition];
+    }
+}
+
+- (void)updateMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
+    if (mergedTask.queuePosition >= self.heap.count) {
+        return;
+    }
+    [self siftUpFromPosition:mergedTask.queuePosition];
+    [self siftDownFromPosition:mergedTask.queuePosition];
+}
+
+- (BOOL)mergedTask:(AFImageDownloaderMergedTask *)mergedTask precedesMergedTask:(AFImageDownloaderMergedTask *)otherMergedTask {
+    if (mergedTask.priority != otherMergedTask.priority) {
+        return mergedTask.priority > otherMergedTask.priority;
+    }
+    return mergedTask.queueOrder > otherMergedTask.queueOrder;
+}
+
+- (void)swapMergedTaskAtPosition:(NSUInteger)position withMergedTaskAtPosition:(NSUInteger)otherPosition {
+    [self.heap exchangeObjectAtIndex:position withObjectAtIndex:otherPosition];
+    self.heap[position].queuePosition = position;
+    self.heap[otherPosition].queuePosition = otherPosition;
+}
+
+- (void)siftUpFromPosition:(NSUInteger)position {
+    while (position > 0) {
+        NSUInteger parentPosition = (position - 1) / 2;
+        if (![self mergedTask:self.heap[position] precedesMergedTask:self.heap[parentPosition]]) {
+            break;
+        }
+        [self swapMergedTaskAtPosition:position withMergedTaskAtPosition:parentPosition];
+        position = parentPosition;
+    }
+}
 
-- (instancetype)initWithReceiptID:(NSUUID *)receiptID task:(NSURLSessionDataTask *)task {
+- (void)siftDownFromPosition:(NSUInteger)position {
+    NSUInteger count = self.heap.count;
+    while (YES) {
+        NSUInteger firstPosition = position;
+        NSUInteger leftPosition = 2 * position + 1;
+        NSUInteger rightPosition = leftPosition + 1;
+        if (leftPosition < count && [self mergedTask:self.heap[leftPosition] precedesMergedTask:self.heap[firstPosition]]) {
+            firstPosition = leftPosition;
+        }
+        if (rightPosition < count && [self mergedTask:self.heap[rightPosition] precedesMergedTask:self.heap[firstPosition]]) {
+            firstPosition = rightPosition;
+        }
+        if (firstPosition == position) {
+            break;
+        }
+        [self swapMergedTaskAtPosition:position withMergedTaskAtPosition:firstPosition];
+        position = firstPosition;
+    }
+}
+
+@end
+
+static float AFURLSessionTaskPriorityForImageDownloadPriority(AFImageDownloadPriority priority) {
+    switch (priority) {
+        case AFImageDownloadPriorityBackground:
+            return NSURLSessionTaskPriorityLow;
+        case AFImageDownloadPriorityPrefetch:
+            // Below ordinary tasks, but still ahead of background downloads.
+            return (NSURLSessionTaskPriorityLow + NSURLSessionTaskPriorityDefault) / 2.0f;
+        case AFImageDownloadPriorityVisible:
+            return NSURLSessionTaskPriorityHigh;
+    }
+    return NSURLSessionTaskPriorityDefault;
+}
+
+@interface AFImagePrefetchToken ()
+@property (nonatomic, copy, readwrite) NSArray <NSURLRequest *> *requests;
+@property (nonatomic, assign) NSUInteger nextRequestIndex;
+@property (nonatomic, assign, getter=isCancelled) BOOL cancelled;
+@end
+
+@implementation AFImagePrefetchToken
+
+- (instancetype)initWithRequests:(NSArray <NSURLRequest *> *)requests {
     if (self = [self init]) {
-        self.receiptID = receiptID;
-        self.task = task;
+        self.requests = requests;
     }
     return self;
 }
 
 @end
 
+@interface AFImageDownloadReceipt ()
+@property (nonatomic, weak) AFImageDownloader *downloader;
+@end
+
 @interface AFImageDownloader ()
 
 @property (nonatomic, strong) dispatch_queue_t synchronizationQueue;
@@ -100,9 +260,34 @@
 
 @property (nonatomic, assign) NSInteger maximumActiveDownloads;
 @property (nonatomic, assign) NSInteger activeRequestCount;
+@property (nonatomic, strong) NSMutableSet <NSUUID*> *activeMergedTaskIdentifiers;
+@property (nonatomic, strong) NSMutableSet <NSUUID*> *activePrefetchMergedTaskIdentifiers;
+@property (nonatomic, strong) NSMutableArray <AFImagePrefetchToken*> *pendingPrefetchTokens;
 
-@property (nonatomic, strong) NSMutableArray *queuedMergedTasks;
+@property (nonatomic, strong) AFImageDownloaderTaskQueue *queuedMergedTasks;
 @property (nonatomic, strong) NSMutableDictionary *mergedTasks;
+@property (nonatomic, assign) int64_t enqueuedTaskCount;
+
+- (void)updatePriorityForImageDownloadReceipt:(AFImageDownloadReceipt *)imageDownloadReceipt;
+
+@end
+
+@implementation AFImageDownloadReceipt
+
+- (instancetype)initWithReceiptID:(NSUUID *)receiptID task:(NSURLSessionDataTask *)task priority:(AFImageDownloadPriority)priority downloader:(AFImageDownloader *)downloader {
+    if (self = [self init]) {
+        self.receiptID = receiptID;
+        self.task = task;
+        _priority = priority;
+        self.downloader = downloader;
+    }
+    return self;
+}
+
+- (void)setPriority:(AFImageDownloadPriority)priority {
+    _priority = priority;
+    [self.downloader updatePriorityForImageDownloadReceipt:self];
+}
 
 @end
 
@@ -163,9 +348,14 @@
         self.maximumActiveDownloads = maximumActiveDownloads;
         self.imageCache = imageCache;
 
-        self.queuedMergedTasks = [[NSMutableArray alloc] init];
+        self.queuedMergedTasks = [[AFImageDownloaderTaskQueue alloc] init];
         self.mergedTasks = [[NSMutableDictionary alloc] init];
         self.activeRequestCount = 0;
+        self.activeMergedTaskIdentifiers = [[NSMutableSet alloc] init];
+        self.cancellationGracePeriod = 0.5;
+        self.activePrefetchMergedTaskIdentifiers = [[NSMutableSet alloc] init];
+        self.pendingPrefetchTokens = [[NSMutableArray alloc] init];
+        self.maximumActivePrefetches = 2;
 
         NSString *name = [NSString stringWithFormat:@"com.alamofire.imagedownloader.synchronizationqueue-%@", [[NSUUID UUID] UUIDString]];
         self.synchronizationQueue = dispatch_queue_create([name cStringUsingEncoding:NSASCIIStringEncoding], DISPATCH_QUEUE_SERIAL);
@@ -196,6 +386,14 @@
                                                   withReceiptID:(nonnull NSUUID *)receiptID
                                                         success:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse  * _Nullable response, UIImage *responseObject))success
                                                         failure:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse * _Nullable response, NSError *error))failure {
+    return [self downloadImageForURLRequest:request withReceiptID:receiptID priority:AFImageDownloadPriorityVisible success:success failure:failure];
+}
+
+- (nullable AFImageDownloadReceipt *)downloadImageForURLRequest:(NSURLRequest *)request
+                                                  withReceiptID:(NSUUID *)receiptID
+                                                       priority:(AFImageDownloadPriority)priority
+                                                        success:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse  * _Nullable response, UIImage *responseObject))success
+                                                        failure:(nullable void (^)(NSURLRequest *request, NSHTTPURLResponse * _Nullable response, NSError *error))failure {
     __block NSURLSessionDataTask *task = nil;
     dispatch_sync(self.synchronizationQueue, ^{
         NSString *URLIdentifier = request.URL.absoluteString;
@@ -212,82 +410,34 @@
         // 1) Append the success and failure blocks to a pre-existing request if it already exists
         AFImageDownloaderMergedTask *existingMergedTask = self.mergedTasks[URLIdentifier];
         if (existingMergedTask != nil) {
-            AFImageDownloaderResponseHandler *handler = [[AFImageDownloaderResponseHandler alloc] initWithUUID:receiptID success:success failure:failure];
+            AFImageDownloaderResponseHandler *handler = [[AFImageDownloaderResponseHandler alloc] initWithUUID:receiptID priority:priority success:success failure:failure];
             [existingMergedTask addResponseHandler:handler];
+            [self updatePriorityOfMergedTask:existingMergedTask];
             task = existingMergedTask.task;
             return;
         }
 
         // 2) Attempt to load the image from the image cache if the cache policy allows it
-        switch (request.cachePolicy) {
-            case NSURLRequestUseProtocolCachePolicy:
-            case NSURLRequestReturnCacheDataElseLoad:
-            case NSURLRequestReturnCacheDataDontLoad: {
-                UIImage *cachedImage = [self.imageCache imageforRequest:request withAdditionalIdentifier:nil];
-                if (cachedImage != nil) {
-                    if (success) {
-                        dispatch_async(dispatch_get_main_queue(), ^{
-                            success(request, nil, cachedImage);
-                        });
-                    }
-                    return;
-                }
-                break;
+        UIImage *cachedImage = [self cachedImageForRequest:request];
+        if (cachedImage != nil) {
+            if (success) {
+                dispatch_async(dispatch_get_main_queue(), ^{
+                    success(request, nil, cachedImage);
+                });
             }
-            default:
-                break;
+            return;
         }
 
         // 3) Create the request and set up authentication, validation and response serialization
-        NSUUID *mergedTaskIdentifier = [NSUUID UUID];
-        NSURLSessionDataTask *createdTask;
-        __weak __typeof__(self) weakSelf = self;
-
-        createdTask = [self.sessionManager
-                       dataTaskWithRequest:request
-                       uploadProgress:nil
-                       downloadProgress:nil
-                       completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
-                           dispatch_async(self.responseQueue, ^{
-                               __strong __typeof__(weakSelf) strongSelf = weakSelf;
-                               AFImageDownloaderMergedTask *mergedTask = self.mergedTasks[URLIdentifier];
-                               if ([mergedTask.identifier isEqual:mergedTaskIdentifier]) {
-                                   mergedTask = [strongSelf safelyRemoveMergedTaskWithURLIdentifier:URLIdentifier];
-                                   if (error) {
-                                       for (AFImageDownloaderResponseHandler *handler in mergedTask.responseHandlers) {
-                                           if (handler.failureBlock) {
-                                               dispatch_async(dispatch_get_main_queue(), ^{
-                                                   handler.failureBlock(request, (NSHTTPURLResponse*)response, error);
-                                               });
-                                           }
-                                       }
-                                   } else {
-                                       [strongSelf.imageCache addImage:responseObject forRequest:request withAdditionalIdentifier:nil];
-
-                                       for (AFImageDownloaderResponseHandler *handler in mergedTask.responseHandlers) {
-                                           if (handler.successBlock) {
-                                               dispatch_async(dispatch_get_main_queue(), ^{
-                                                   handler.successBlock(request, (NSHTTPURLResponse*)response, responseObject);
-                                               });
-                                           }
-                                       }
-                                       
-                                   }
-                               }
-                               [strongSelf safelyDecrementActiveTaskCount];
-                               [strongSelf safelyStartNextTaskIfNecessary];
-                           });
-                       }];
+        AFImageDownloaderMergedTask *mergedTask = [self createMergedTaskForRequest:request URLIdentifier:URLIdentifier];
 
         // 4) Store the response handler for use when the request completes
         AFImageDownloaderResponseHandler *handler = [[AFImageDownloaderResponseHandler alloc] initWithUUID:receiptID
+                                                                                                  priority:priority
                                                                                                    success:success
                                                                                                    failure:failure];
-        AFImageDownloaderMergedTask *mergedTask = [[AFImageDownloaderMergedTask alloc]
-                                                   initWithURLIdentifier:URLIdentifier
-                                                   identifier:mergedTaskIdentifier
-                                                   task:createdTask];
         [mergedTask addResponseHandler:handler];
+        [self updatePriorityOfMergedTask:mergedTask];
         self.mergedTasks[URLIdentifier] = mergedTask;
 
         // 5) Either start the request or enqueue it depending on the current active request count
@@ -300,12 +450,120 @@
         task = mergedTask.task;
     });
     if (task) {
-        return [[AFImageDownloadReceipt alloc] initWithReceiptID:receiptID task:task];
+        return [[AFImageDownloadReceipt alloc] initWithReceiptID:receiptID task:task priority:priority downloader:self];
     } else {
         return nil;
     }
 }
 
+- (AFImagePrefetchToken *)prefetchImagesForURLRequests:(NSArray <NSURLRequest *> *)requests {
+    AFImagePrefetchToken *prefetchToken = [[AFImagePrefetchToken alloc] initWithRequests:requests];
+    if (requests.count > 0) {
+        dispatch_sync(self.synchronizationQueue, ^{
+            [self.pendingPrefetchTokens addObject:prefetchToken];
+            [self startNextPrefetchesIfNecessary];
+        });
+    }
+    return prefetchToken;
+}
+
+- (void)cancelImagePrefetchForToken:(AFImagePrefetchToken *)prefetchToken {
+    dispatch_sync(self.synchronizationQueue, ^{
+        prefetchToken.cancelled = YES;
+        [self.pendingPrefetchTokens removeObject:prefetchToken];
+        for (AFImageDownloaderMergedTask *mergedTask in self.mergedTasks.allValues) {
+            if (mergedTask.prefetchToken == prefetchToken) {
+                [self cancelMergedTaskWithoutResponseHandlers:mergedTask];
+            }
+        }
+    });
+}
+
+//This method should only be called from safely within the synchronizationQueue
+- (void)startNextPrefetchesIfNecessary {
+    while ((NSInteger)self.activePrefetchMergedTaskIdentifiers.count < self.maximumActivePrefetches && self.pendingPrefetchTokens.count > 0) {
+        AFImagePrefetchToken *prefetchToken = self.pendingPrefetchTokens.firstObject;
+        NSURLRequest *request = prefetchToken.requests[prefetchToken.nextRequestIndex];
+        prefetchToken.nextRequestIndex += 1;
+        if (prefetchToken.nextRequestIndex >= prefetchToken.requests.count) {
+            [self.pendingPrefetchTokens removeObjectAtIndex:0];
+        }
+
+        NSString *URLIdentifier = request.URL.absoluteString;
+        if (URLIdentifier == nil || self.mergedTasks[URLIdentifier] != nil || [self cachedImageForRequest:request] != nil) {
+            continue;
+        }
+
+        AFImageDownloaderMergedTask *mergedTask = [self createMergedTaskForRequest:request URLIdentifier:URLIdentifier];
+        mergedTask.prefetchToken = prefetchToken;
+        mergedTask.minimumPriority = AFImageDownloadPriorityPrefetch;
+        [self updatePriorityOfMergedTask:mergedTask];
+        self.mergedTasks[URLIdentifier] = mergedTask;
+
+        [mergedTask.task resume];
+        [self.activePrefetchMergedTaskIdentifiers addObject:mergedTask.identifier];
+    }
+}
+
+//This method should only be called from safely within the synchronizationQueue
+- (nullable UIImage *)cachedImageForRequest:(NSURLRequest *)request {
+    switch (request.cachePolicy) {
+        case NSURLRequestUseProtocolCachePolicy:
+        case NSURLRequestReturnCacheDataElseLoad:
+        case NSURLRequestReturnCacheDataDontLoad:
+            return [self.imageCache imageforRequest:request withAdditionalIdentifier:nil];
+        default:
+            return nil;
+    }
+}
+
+//This method should only be called from safely within the synchronizationQueue
+- (AFImageDownloaderMergedTask *)createMergedTaskForRequest:(NSURLRequest *)request URLIdentifier:(NSString *)URLIdentifier {
+    NSUUID *mergedTaskIdentifier = [NSUUID UUID];
+    NSURLSessionDataTask *createdTask;
+    __weak __typeof__(self) weakSelf = self;
+
+    createdTask = [self.sessionManager
+                   dataTaskWithRequest:request
+                   uploadProgress:nil
+                   downloadProgress:nil
+                   completionHandler:^(NSURLResponse * _Nonnull response, id  _Nullable responseObject, NSError * _Nullable error) {
+                       dispatch_async(self.responseQueue, ^{
+                           __strong __typeof__(weakSelf) strongSelf = weakSelf;
+                           AFImageDownloaderMergedTask *mergedTask = self.mergedTasks[URLIdentifier];
+                           if ([mergedTask.identifier isEqual:mergedTaskIdentifier]) {
+                               mergedTask = [strongSelf safelyRemoveMergedTaskWithURLIdentifier:URLIdentifier];
+                               if (error) {
+                                   for (AFImageDownloaderResponseHandler *handler in mergedTask.responseHandlers) {
+                                       if (handler.failureBlock) {
+                                           dispatch_async(dispatch_get_main_queue(), ^{
+                                               handler.failureBlock(request, (NSHTTPURLResponse*)response, error);
+                                           });
+                                       }
+                                   }
+                               } else {
+                                   [strongSelf.imageCache addImage:responseObject forRequest:request withAdditionalIdentifier:nil];
+
+                                   for (AFImageDownloaderResponseHandler *handler in mergedTask.responseHandlers) {
+                                       if (handler.successBlock) {
+                                           dispatch_async(dispatch_get_main_queue(), ^{
+                                               handler.successBlock(request, (NSHTTPURLResponse*)response, responseObject);
+                                           });
+                                       }
+                                   }
+                                   
+                               }
+                           }
+                           [strongSelf safelyReleaseActiveDownloadSlotForMergedTaskWithIdentifier:mergedTaskIdentifier];
+                           [strongSelf safelyStartNextTaskIfNecessary];
+                       });
+                   }];
+
+    return [[AFImageDownloaderMergedTask alloc] initWithURLIdentifier:URLIdentifier
+                                                           identifier:mergedTaskIdentifier
+                                                                 task:createdTask];
+}
+
 - (void)cancelTaskForImageDownloadReceipt:(AFImageDownloadReceipt *)imageDownloadReceipt {
     dispatch_sync(self.synchronizationQueue, ^{
         NSString *URLIdentifier = imageDownloadReceipt.task.originalRequest.URL.absoluteString;
@@ -329,11 +587,73 @@
 
         if (mergedTask.responseHandlers.count == 0 && mergedTask.task.state == NSURLSessionTaskStateSuspended) {
             [mergedTask.task cancel];
+            [self.queuedMergedTasks removeMergedTask:mergedTask];
             [self removeMergedTaskWithURLIdentifier:URLIdentifier];
+        } else if (mergedTask.responseHandlers.count == 0 && mergedTask.task.state == NSURLSessionTaskStateRunning) {
+            [self scheduleCancellationOfMergedTask:mergedTask];
+        } else if (mergedTask != nil) {
+            [self updatePriorityOfMergedTask:mergedTask];
         }
     });
 }
 
+//This method should only be called from safely within the synchronizationQueue
+- (void)scheduleCancellationOfMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
+    NSUInteger cancellationGeneration = ++mergedTask.cancellationGeneration;
+    if (self.cancellationGracePeriod <= 0) {
+        [self cancelMergedTaskWithoutResponseHandlers:mergedTask];
+        return;
+    }
+
+    __weak __typeof__(self) weakSelf = self;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.cancellationGracePeriod * NSEC_PER_SEC)), self.synchronizationQueue, ^{
+        // A request made during the grace period reattaches to the task, and a later cancellation schedules a new generation
+        if (mergedTask.cancellationGeneration == cancellationGeneration) {
+            [weakSelf cancelMergedTaskWithoutResponseHandlers:mergedTask];
+        }
+    });
+}
+
+//This method should only be called from safely within the synchronizationQueue
+- (void)cancelMergedTaskWithoutResponseHandlers:(AFImageDownloaderMergedTask *)mergedTask {
+    if (mergedTask.responseHandlers.count > 0 || self.mergedTasks[mergedTask.URLIdentifier] != mergedTask) {
+        return;
+    }
+    if (mergedTask.prefetchToken != nil && !mergedTask.prefetchToken.isCancelled) {
+        return;
+    }
+    [mergedTask.task cancel];
+    [self removeMergedTaskWithURLIdentifier:mergedTask.URLIdentifier];
+    [self releaseActiveDownloadSlotForMergedTaskWithIdentifier:mergedTask.identifier];
+    [self startNextTaskIfNecessary];
+}
+
+- (void)updatePriorityForImageDownloadReceipt:(AFImageDownloadReceipt *)imageDownloadReceipt {
+    dispatch_sync(self.synchronizationQueue, ^{
+        NSString *URLIdentifier = imageDownloadReceipt.task.originalRequest.URL.absoluteString;
+        AFImageDownloaderMergedTask *mergedTask = self.mergedTasks[URLIdentifier];
+        AFImageDownloaderResponseHandler *handler = [mergedTask responseHandlerWithUUID:imageDownloadReceipt.receiptID];
+        if (handler != nil) {
+            handler.priority = imageDownloadReceipt.priority;
+            [self updatePriorityOfMergedTask:mergedTask];
+        }
+    });
+}
+
+//This method should only be called from safely within the synchronizationQueue
+- (void)updatePriorityOfMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
+    AFImageDownloadPriority priority = [mergedTask highestResponseHandlerPriority];
+    // NSURLSessionTask only has a priority on iOS 8 / OS X 10.10 and later
+    BOOL updatesTaskPriority = [mergedTask.task respondsToSelector:@selector(setPriority:)];
+    if (priority != mergedTask.priority || (updatesTaskPriority && mergedTask.task.priority != AFURLSessionTaskPriorityForImageDownloadPriority(priority))) {
+        mergedTask.priority = priority;
+        if (updatesTaskPriority) {
+            mergedTask.task.priority = AFURLSessionTaskPriorityForImageDownloadPriority(priority);
+        }
+        [self.queuedMergedTasks updateMergedTask:mergedTask];
+    }
+}
+
 - (AFImageDownloaderMergedTask*)safelyRemoveMergedTaskWithURLIdentifier:(NSString *)URLIdentifier {
     __block AFImageDownloaderMergedTask *mergedTask = nil;
     dispatch_sync(self.synchronizationQueue, ^{
@@ -349,49 +669,59 @@
     return mergedTask;
 }
 
-- (void)safelyDecrementActiveTaskCount {
+- (void)safelyReleaseActiveDownloadSlotForMergedTaskWithIdentifier:(NSUUID *)mergedTaskIdentifier {
     dispatch_sync(self.synchronizationQueue, ^{
-        if (self.activeRequestCount > 0) {
-            self.activeRequestCount -= 1;
-        }
+        [self releaseActiveDownloadSlotForMergedTaskWithIdentifier:mergedTaskIdentifier];
     });
 }
 
+//This method should only be called from safely within the synchronizationQueue
+- (void)releaseActiveDownloadSlotForMergedTaskWithIdentifier:(NSUUID *)mergedTaskIdentifier {
+    // A task cancelled after its grace period already released its slot, and must not release it again when it completes
+    if ([self.activeMergedTaskIdentifiers containsObject:mergedTaskIdentifier]) {
+        [self.activeMergedTaskIdentifiers removeObject:mergedTaskIdentifier];
+        self.activeRequestCount -= 1;
+    }
+    [self.activePrefetchMergedTaskIdentifiers removeObject:mergedTaskIdentifier];
+}
+
 - (void)safelyStartNextTaskIfNecessary {
     dispatch_sync(self.synchronizationQueue, ^{
-        if ([self isActiveRequestCountBelowMaximumLimit]) {
-            while (self.queuedMergedTasks.count > 0) {
-                AFImageDownloaderMergedTask *mergedTask = [self dequeueMergedTask];
-                if (mergedTask.task.state == NSURLSessionTaskStateSuspended) {
-                    [self startMergedTask:mergedTask];
-                    break;
-                }
+        [self startNextTaskIfNecessary];
+    });
+}
+
+//This method should only be called from safely within the synchronizationQueue
+- (void)startNextTaskIfNecessary {
+    [self startNextPrefetchesIfNecessary];
+    if ([self isActiveRequestCountBelowMaximumLimit]) {
+        while (self.queuedMergedTasks.count > 0) {
+            AFImageDownloaderMergedTask *mergedTask = [self.queuedMergedTasks removeFirstMergedTask];
+            if (mergedTask.task.state == NSURLSessionTaskStateSuspended) {
+                [self startMergedTask:mergedTask];
+                break;
             }
         }
-    });
+    }
 }
 
 - (void)startMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
     [mergedTask.task resume];
+    [self.activeMergedTaskIdentifiers addObject:mergedTask.identifier];
     ++self.activeRequestCount;
 }
 
 - (void)enqueueMergedTask:(AFImageDownloaderMergedTask *)mergedTask {
+    ++self.enqueuedTaskCount;
     switch (self.downloadPrioritizaton) {
         case AFImageDownloadPrioritizationFIFO:
-            [self.queuedMergedTasks addObject:mergedTask];
+            mergedTask.queueOrder = -self.enqueuedTaskCount;
             break;
         case AFImageDownloadPrioritizationLIFO:
-            [self.queuedMergedTasks insertObject:mergedTask atIndex:0];
+            mergedTask.queueOrder = self.enqueuedTaskCount;
             break;
     }
-}
-
-- (AFImageDownloaderMergedTask *)dequeueMergedTask {
-    AFImageDownloaderMergedTask *mergedTask = nil;
-    mergedTask = [self.queuedMergedTasks firstObject];
-    [self.queuedMergedTasks removeObject:mergedTask];
-    return mergedTask;
+    [self.queuedMergedTasks addMergedTask:mergedTask];
 }
 
 - (BOOL)isActiveRequestCountBelowMaximumLimit {
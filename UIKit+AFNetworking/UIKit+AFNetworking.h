@@ -28,6 +28,7 @@
 
 #if TARGET_OS_IOS
     #import "AFAutoPurgingImageCache.h"
+    #import "AFDiskImageCache.h"
     #import "AFImageDownloader.h"
     #import "AFNetworkActivityIndicatorManager.h"
     #import "UIRefreshControl+AFNetworking.h"